@@ -25,6 +25,7 @@ static const SPStyleProp props[] = {
 	{SP_ATTR_INVALID, NULL},
 	/* SPObject */
 	{SP_ATTR_ID, "id"},
+	{SP_ATTR_CLASS, "class"},
 	/* SPItem */
 	{SP_ATTR_TRANSFORM, "transform"},
 	{SP_ATTR_SODIPODI_INSENSITIVE, "sodipodi:insensitive"},
@@ -55,8 +56,10 @@ static const SPStyleProp props[] = {
 	{SP_ATTR_SNAPTOGRID, "snaptogrid"},
 	{SP_ATTR_SHOWGUIDES, "showguides"},
 	{SP_ATTR_SNAPTOGUIDES, "snaptoguides"},
+	{SP_ATTR_SNAPTOOBJECTS, "snaptoobjects"},
 	{SP_ATTR_GRIDTOLERANCE, "gridtolerance"},
 	{SP_ATTR_GUIDETOLERANCE, "guidetolerance"},
+	{SP_ATTR_OBJECTTOLERANCE, "objecttolerance"},
 	{SP_ATTR_GRIDORIGINX, "gridoriginx"},
 	{SP_ATTR_GRIDORIGINY, "gridoriginy"},
 	{SP_ATTR_GRIDSPACINGX, "gridspacingx"},
@@ -260,6 +263,28 @@ sp_attribute_lookup (const gchar *key)
 	return GPOINTER_TO_UINT (g_hash_table_lookup (propdict, key));
 }
 
+/**
+ * Returns repr key quark for attribute code, so callers holding code can
+ * use sp_repr_attr_quark without hashing key string
+ */
+unsigned int
+sp_attribute_quark (unsigned int code)
+{
+	static unsigned int *propquarks = NULL;
+
+	if (code >= n_attrs) return 0;
+
+	if (!propquarks) {
+		unsigned int i;
+		propquarks = g_new0 (unsigned int, n_attrs);
+		for (i = 1; i < n_attrs; i++) {
+			propquarks[i] = g_quark_from_static_string (props[i].name);
+		}
+	}
+
+	return propquarks[code];
+}
+
 const unsigned char *
 sp_attribute_name (unsigned char id)
 {
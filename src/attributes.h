@@ -16,6 +16,7 @@
 G_BEGIN_DECLS
 
 unsigned int sp_attribute_lookup (const gchar *key);
+unsigned int sp_attribute_quark (unsigned int code);
 const unsigned char *sp_attribute_name (unsigned char id);
 
 #define SP_ATTRIBUTE_IS_CSS(k) (((k) >= SP_PROP_FONT) && ((k) <= SP_PROP_WRITING_MODE))
@@ -27,6 +28,7 @@ enum {
 	SP_ATTR_INVALID,
 	/* SPObject */
 	SP_ATTR_ID,
+	SP_ATTR_CLASS,
 	/* SPItem */
 	SP_ATTR_TRANSFORM,
 	SP_ATTR_SODIPODI_INSENSITIVE,
@@ -57,8 +59,10 @@ enum {
 	SP_ATTR_SNAPTOGRID,
 	SP_ATTR_SHOWGUIDES,
 	SP_ATTR_SNAPTOGUIDES,
+	SP_ATTR_SNAPTOOBJECTS,
 	SP_ATTR_GRIDTOLERANCE,
 	SP_ATTR_GUIDETOLERANCE,
+	SP_ATTR_OBJECTTOLERANCE,
 	SP_ATTR_GRIDORIGINX,
 	SP_ATTR_GRIDORIGINY,
 	SP_ATTR_GRIDSPACINGX,
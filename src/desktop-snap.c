@@ -13,14 +13,22 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "sp-guide.h"
 #include "sp-namedview.h"
+#include "sp-item-group.h"
+#include "sp-shape.h"
+#include "document.h"
+#include "selection.h"
+#include "desktop-handles.h"
 #include "desktop-snap.h"
 
 /* minimal distance to norm before point is considered for snap */
 #define MIN_DIST_NORM 1.0
 
-#define SNAP_ON(d) (((d)->gridsnap > 0.0) || ((d)->guidesnap > 0.0))
+#define SNAP_ON(d) (((d)->gridsnap > 0.0) || ((d)->guidesnap > 0.0) || ((d)->objectsnap > 0.0))
+
+static double sp_desktop_object_snap (SPDesktop *desktop, const NRPointF *req, double tolerance, NRPointF *result);
 
 /* Snap a point in horizontal and vertical direction */
 
@@ -242,6 +250,21 @@ sp_desktop_vector_snap (SPDesktop * desktop, NRPointF *req, double dx, double dy
 		}
 	}
 
+	if (nv->snaptoobjects) {
+		NRPointF p, trial;
+		double t;
+		/* Move along vector to projection of nearest object point */
+		if (sp_desktop_object_snap (desktop, req, desktop->objectsnap, &p) < 1e18) {
+			t = (p.x - req->x) * v.x + (p.y - req->y) * v.y;
+			trial.x = req->x + t * v.x;
+			trial.y = req->y + t * v.y;
+			if (fabs (t) < MIN (best, desktop->objectsnap)) {
+				best = fabs (t);
+				actual = trial;
+			}
+		}
+	}
+
 	if (nv->snaptogrid) {
 		double iv, ih, dist, upper;
 		NRPointF trial = *req;
@@ -712,3 +735,440 @@ sp_desktop_circular_snap_list (SPDesktop *desktop, NRPointF *p, int length, NRPo
 
 	return rotate;
 }
+
+/*
+ * Object snap points
+ *
+ * Nodes of shapes, and corners, edge midpoints and center of bboxes of
+ * all leaf items, in desktop coordinates.  Points are kept in uniform
+ * grid of cells, so query only looks at few cells around point.  Index
+ * is built on first query, and then items reported modified by document
+ * are reindexed on next query.
+ */
+
+/* Average number of points in cell, when index is built */
+#define SNAP_CELL_POINTS 8.0
+#define SNAP_CELL_KEY(cx,cy) GUINT_TO_POINTER (((guint) (gint) (cx) & 0xffff) | ((guint) (gint) (cy) << 16))
+#define SNAP_GEOMETRY_FLAGS (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG)
+
+typedef struct _SPSnapPoint SPSnapPoint;
+typedef struct _SPSnapItem SPSnapItem;
+
+struct _SPSnapPoint {
+	NRPointF p;
+	SPItem *item;
+};
+
+/* Points of single item, needed to find its cells again */
+struct _SPSnapItem {
+	NRMatrixF i2d;
+	NRPointF *points;
+	int length;
+};
+
+struct _SPSnapIndex {
+	SPDesktop *desktop;
+	SPDocument *document;
+	double cell;
+	/* Cell key -> GArray of SPSnapPoint */
+	GHashTable *cells;
+	/* Referenced item -> SPSnapItem */
+	GHashTable *items;
+	/* Referenced item -> modified flags, reindexed on next query */
+	GHashTable *dirty;
+};
+
+/* Selected objects are being moved, so they are not snapped to */
+static gboolean
+sp_snap_item_selected (SPSelection *selection, SPItem *item)
+{
+	SPObject *o;
+
+	for (o = SP_OBJECT (item); o && SP_IS_ITEM (o); o = SP_OBJECT_PARENT (o)) {
+		if (sp_selection_item_selected (selection, SP_ITEM (o))) return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+sp_snap_item_build (SPSnapItem *si, SPItem *item)
+{
+	NRMatrixD i2d;
+	NRRectF bbox;
+	int n;
+
+	sp_item_i2d_affine (item, &si->i2d);
+	nr_matrix_d_from_f (&i2d, &si->i2d);
+	sp_item_invoke_bbox (item, &bbox, &i2d, TRUE);
+
+	n = 0;
+	if (SP_IS_SHAPE (item) && SP_SHAPE (item)->curve) {
+		n = SP_SHAPE (item)->curve->end;
+	}
+	si->points = g_new (NRPointF, n + 9);
+	si->length = 0;
+
+	if (n > 0) {
+		ArtBpath *bp;
+		for (bp = SP_SHAPE (item)->curve->bpath; bp->code != ART_END; bp++) {
+			si->points[si->length].x = NR_MATRIX_DF_TRANSFORM_X (&si->i2d, bp->x3, bp->y3);
+			si->points[si->length].y = NR_MATRIX_DF_TRANSFORM_Y (&si->i2d, bp->x3, bp->y3);
+			si->length += 1;
+		}
+	}
+
+	if ((bbox.x0 <= bbox.x1) && (bbox.y0 <= bbox.y1)) {
+		double x[3], y[3];
+		int i, j;
+		x[0] = bbox.x0;
+		x[1] = 0.5 * (bbox.x0 + bbox.x1);
+		x[2] = bbox.x1;
+		y[0] = bbox.y0;
+		y[1] = 0.5 * (bbox.y0 + bbox.y1);
+		y[2] = bbox.y1;
+		for (i = 0; i < 3; i++) {
+			for (j = 0; j < 3; j++) {
+				si->points[si->length].x = x[i];
+				si->points[si->length].y = y[j];
+				si->length += 1;
+			}
+		}
+	}
+}
+
+static void
+sp_snap_index_insert (SPSnapIndex *index, SPItem *item, SPSnapItem *si)
+{
+	int i;
+
+	for (i = 0; i < si->length; i++) {
+		SPSnapPoint sp;
+		GArray *cell;
+		gpointer key;
+		key = SNAP_CELL_KEY (floor (si->points[i].x / index->cell), floor (si->points[i].y / index->cell));
+		cell = (GArray *) g_hash_table_lookup (index->cells, key);
+		if (!cell) {
+			cell = g_array_new (FALSE, FALSE, sizeof (SPSnapPoint));
+			g_hash_table_insert (index->cells, key, cell);
+		}
+		sp.p = si->points[i];
+		sp.item = item;
+		g_array_append_val (cell, sp);
+	}
+}
+
+static void
+sp_snap_index_add (SPSnapIndex *index, SPItem *item, unsigned int insert)
+{
+	SPSnapItem *si;
+
+	si = g_new (SPSnapItem, 1);
+	sp_snap_item_build (si, item);
+	g_object_ref (G_OBJECT (item));
+	g_hash_table_insert (index->items, item, si);
+
+	if (insert) sp_snap_index_insert (index, item, si);
+}
+
+static void
+sp_snap_index_remove (SPSnapIndex *index, SPItem *item)
+{
+	SPSnapItem *si;
+	int i;
+
+	si = (SPSnapItem *) g_hash_table_lookup (index->items, item);
+	if (!si) return;
+
+	for (i = 0; i < si->length; i++) {
+		GArray *cell;
+		gpointer key;
+		guint j;
+		key = SNAP_CELL_KEY (floor (si->points[i].x / index->cell), floor (si->points[i].y / index->cell));
+		cell = (GArray *) g_hash_table_lookup (index->cells, key);
+		/* All points of item in this cell go at once */
+		if (!cell) continue;
+		for (j = cell->len; j > 0; j--) {
+			if (g_array_index (cell, SPSnapPoint, j - 1).item == item) g_array_remove_index_fast (cell, j - 1);
+		}
+		if (cell->len == 0) {
+			g_hash_table_remove (index->cells, key);
+			g_array_free (cell, TRUE);
+		}
+	}
+
+	g_hash_table_remove (index->items, item);
+	g_free (si->points);
+	g_free (si);
+	g_object_unref (G_OBJECT (item));
+}
+
+static void
+sp_snap_index_mark (SPSnapIndex *index, SPItem *item, unsigned int flags)
+{
+	gpointer old;
+
+	old = g_hash_table_lookup (index->dirty, item);
+	if (!old) g_object_ref (G_OBJECT (item));
+	g_hash_table_insert (index->dirty, item, GUINT_TO_POINTER (GPOINTER_TO_UINT (old) | flags));
+}
+
+static void
+sp_snap_index_add_tree (SPSnapIndex *index, SPObject *object)
+{
+	if (SP_IS_GROUP (object)) {
+		SPObject *child;
+		for (child = SP_GROUP (object)->children; child != NULL; child = child->next) {
+			sp_snap_index_add_tree (index, child);
+		}
+	} else if (SP_IS_ITEM (object)) {
+		sp_snap_index_add (index, SP_ITEM (object), FALSE);
+	}
+}
+
+static void
+sp_snap_index_bounds (gpointer key, gpointer value, gpointer data)
+{
+	SPSnapItem *si;
+	NRRectF *bounds;
+	int i;
+
+	si = (SPSnapItem *) value;
+	bounds = (NRRectF *) data;
+
+	for (i = 0; i < si->length; i++) {
+		bounds->x0 = MIN (bounds->x0, si->points[i].x);
+		bounds->y0 = MIN (bounds->y0, si->points[i].y);
+		bounds->x1 = MAX (bounds->x1, si->points[i].x);
+		bounds->y1 = MAX (bounds->y1, si->points[i].y);
+	}
+}
+
+static void
+sp_snap_index_insert_item (gpointer key, gpointer value, gpointer data)
+{
+	sp_snap_index_insert ((SPSnapIndex *) data, (SPItem *) key, (SPSnapItem *) value);
+}
+
+/* Objects emit "modified" for geometry changes, and their children for transform changes */
+static void
+sp_snap_index_document_modified (SPDocument *doc, const SPModifiedEntry *entries, guint length, guint flags, gpointer data)
+{
+	SPSnapIndex *index;
+	guint i;
+
+	if (!(flags & SNAP_GEOMETRY_FLAGS)) return;
+
+	index = (SPSnapIndex *) data;
+
+	for (i = 0; i < length; i++) {
+		SPObject *object;
+		object = entries[i].object;
+		if (!SP_IS_ITEM (object) || SP_IS_GROUP (object)) continue;
+		if (!(entries[i].flags & SNAP_GEOMETRY_FLAGS)) continue;
+		sp_snap_index_mark (index, SP_ITEM (object), entries[i].flags & SNAP_GEOMETRY_FLAGS);
+	}
+}
+
+static gboolean
+sp_snap_index_flush_item (gpointer key, gpointer value, gpointer data)
+{
+	SPSnapIndex *index;
+	SPSnapItem *si;
+	SPItem *item;
+	unsigned int reindex;
+
+	index = (SPSnapIndex *) data;
+	item = (SPItem *) key;
+
+	/* Not needed before it is deselected, which spares reindexing while dragging */
+	if (SP_OBJECT_PARENT (item) && sp_snap_item_selected (index->desktop->selection, item)) return FALSE;
+
+	reindex = TRUE;
+	si = (SPSnapItem *) g_hash_table_lookup (index->items, item);
+	if (si && !(GPOINTER_TO_UINT (value) & SP_OBJECT_MODIFIED_FLAG)) {
+		NRMatrixF i2d;
+		/* Parent changed, but transform maybe not */
+		sp_item_i2d_affine (item, &i2d);
+		reindex = memcmp (&i2d, &si->i2d, sizeof (NRMatrixF)) != 0;
+	}
+
+	if (reindex) {
+		sp_snap_index_remove (index, item);
+		/* Released objects stay referenced only by us */
+		if (SP_OBJECT_PARENT (item) && (SP_OBJECT_DOCUMENT (item) == index->document)) {
+			sp_snap_index_add (index, item, TRUE);
+		}
+	}
+
+	g_object_unref (G_OBJECT (item));
+
+	return TRUE;
+}
+
+static SPSnapIndex *
+sp_desktop_snap_index (SPDesktop *desktop)
+{
+	SPSnapIndex *index;
+
+	index = desktop->snapindex;
+
+	if (!index) {
+		NRRectF bounds;
+		guint n;
+
+		index = g_new (SPSnapIndex, 1);
+		index->desktop = desktop;
+		index->document = SP_DT_DOCUMENT (desktop);
+		index->cells = g_hash_table_new (NULL, NULL);
+		index->items = g_hash_table_new (NULL, NULL);
+		index->dirty = g_hash_table_new (NULL, NULL);
+		sp_document_add_batch_observer (index->document, sp_snap_index_document_modified, index);
+		desktop->snapindex = index;
+
+		sp_snap_index_add_tree (index, SP_OBJECT (sp_document_root (index->document)));
+
+		/* Pick cell size from point density */
+		bounds.x0 = bounds.y0 = NR_HUGE_F;
+		bounds.x1 = bounds.y1 = -NR_HUGE_F;
+		g_hash_table_foreach (index->items, sp_snap_index_bounds, &bounds);
+		n = g_hash_table_size (index->items);
+		index->cell = 64.0;
+		if ((n > 0) && (bounds.x0 <= bounds.x1)) {
+			double area;
+			area = MAX (bounds.x1 - bounds.x0, 1.0) * MAX (bounds.y1 - bounds.y0, 1.0);
+			index->cell = MAX (sqrt (area * SNAP_CELL_POINTS / (9 * n)), 0.01);
+		}
+		g_hash_table_foreach (index->items, sp_snap_index_insert_item, index);
+	} else if (g_hash_table_size (index->dirty) > 0) {
+		g_hash_table_foreach_remove (index->dirty, sp_snap_index_flush_item, index);
+	}
+
+	return index;
+}
+
+static gboolean
+sp_snap_index_free_cell (gpointer key, gpointer value, gpointer data)
+{
+	g_array_free ((GArray *) value, TRUE);
+	return TRUE;
+}
+
+static gboolean
+sp_snap_index_free_item (gpointer key, gpointer value, gpointer data)
+{
+	SPSnapItem *si;
+
+	si = (SPSnapItem *) value;
+	g_free (si->points);
+	g_free (si);
+	g_object_unref (G_OBJECT (key));
+
+	return TRUE;
+}
+
+static gboolean
+sp_snap_index_free_dirty (gpointer key, gpointer value, gpointer data)
+{
+	g_object_unref (G_OBJECT (key));
+	return TRUE;
+}
+
+void
+sp_desktop_snap_index_release (SPDesktop *desktop)
+{
+	SPSnapIndex *index;
+
+	g_return_if_fail (desktop != NULL);
+	g_return_if_fail (SP_IS_DESKTOP (desktop));
+
+	index = desktop->snapindex;
+	if (!index) return;
+
+	sp_document_remove_batch_observer (index->document, sp_snap_index_document_modified, index);
+	g_hash_table_foreach_remove (index->cells, sp_snap_index_free_cell, NULL);
+	g_hash_table_destroy (index->cells);
+	g_hash_table_foreach_remove (index->items, sp_snap_index_free_item, NULL);
+	g_hash_table_destroy (index->items);
+	g_hash_table_foreach_remove (index->dirty, sp_snap_index_free_dirty, NULL);
+	g_hash_table_destroy (index->dirty);
+	g_free (index);
+
+	desktop->snapindex = NULL;
+}
+
+typedef struct {
+	SPDesktop *desktop;
+	const NRPointF *req;
+	double best;
+	NRPointF result;
+} SPSnapQuery;
+
+static void
+sp_snap_query_cell (gpointer key, gpointer value, gpointer data)
+{
+	SPSnapQuery *q;
+	GArray *cell;
+	guint i;
+
+	q = (SPSnapQuery *) data;
+	cell = (GArray *) value;
+
+	for (i = 0; i < cell->len; i++) {
+		SPSnapPoint *sp;
+		double d;
+		sp = &g_array_index (cell, SPSnapPoint, i);
+		d = hypot (sp->p.x - q->req->x, sp->p.y - q->req->y);
+		if (d >= q->best) continue;
+		if (!SP_OBJECT_PARENT (sp->item)) {
+			/* Released, drop it with next flush */
+			sp_snap_index_mark (q->desktop->snapindex, sp->item, SP_OBJECT_MODIFIED_FLAG);
+			continue;
+		}
+		if (sp_snap_item_selected (q->desktop->selection, sp->item)) continue;
+		q->best = d;
+		q->result = sp->p;
+	}
+}
+
+/* Finds nearest object point within tolerance, returns its distance or 1e18 */
+static double
+sp_desktop_object_snap (SPDesktop *desktop, const NRPointF *req, double tolerance, NRPointF *result)
+{
+	SPSnapIndex *index;
+	SPSnapQuery q;
+	double cx0, cy0, cx1, cy1;
+
+	if (tolerance <= 0.0) return 1e18;
+
+	index = sp_desktop_snap_index (desktop);
+
+	q.desktop = desktop;
+	q.req = req;
+	q.best = tolerance;
+
+	cx0 = floor ((req->x - tolerance) / index->cell);
+	cy0 = floor ((req->y - tolerance) / index->cell);
+	cx1 = floor ((req->x + tolerance) / index->cell);
+	cy1 = floor ((req->y + tolerance) / index->cell);
+
+	if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > g_hash_table_size (index->cells)) {
+		/* Zoomed out, fewer cells exist than are covered */
+		g_hash_table_foreach (index->cells, sp_snap_query_cell, &q);
+	} else {
+		double cx, cy;
+		for (cy = cy0; cy <= cy1; cy += 1.0) {
+			for (cx = cx0; cx <= cx1; cx += 1.0) {
+				GArray *cell;
+				cell = (GArray *) g_hash_table_lookup (index->cells, SNAP_CELL_KEY (cx, cy));
+				if (cell) sp_snap_query_cell (NULL, cell, &q);
+			}
+		}
+	}
+
+	if (q.best >= tolerance) return 1e18;
+
+	*result = q.result;
+
+	return q.best;
+}
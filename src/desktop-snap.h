@@ -15,6 +15,8 @@
 
 #include "desktop.h"
 
+typedef struct _SPSnapIndex SPSnapIndex;
+
 /* Single point methods */
 double sp_desktop_free_snap (SPDesktop *desktop, NRPointF *req);
 #define sp_desktop_horizontal_snap(dt,req) sp_desktop_vector_snap (dt, req, 1.0, 0.0);
@@ -33,6 +35,8 @@ double sp_desktop_vertical_snap_list_skew (SPDesktop *desktop, NRPointF *p, int
 
 NRMatrixF *sp_desktop_circular_snap_list (SPDesktop *desktop, NRPointF *p, int length, NRPointF *norm, NRMatrixF *rotate);
 
+/* Frees object snap points, they are collected again on next snap */
+void sp_desktop_snap_index_release (SPDesktop *desktop);
 
 
 #endif
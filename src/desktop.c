@@ -38,6 +38,7 @@
 #include "desktop.h"
 #include "desktop-events.h"
 #include "desktop-affine.h"
+#include "desktop-snap.h"
 #include "document.h"
 #include "selection.h"
 #include "select-context.h"
@@ -178,6 +179,7 @@ sp_desktop_init (SPDesktop *desktop)
 	desktop->drawing = NULL;
 	desktop->sketch = NULL;
 	desktop->controls = NULL;
+	desktop->snapindex = NULL;
 
 	nr_matrix_d_set_identity (NR_MATRIX_D_FROM_DOUBLE (desktop->d2w));
 	nr_matrix_d_set_identity (NR_MATRIX_D_FROM_DOUBLE (desktop->w2d));
@@ -205,6 +207,8 @@ sp_desktop_dispose (GObject *object)
 		g_object_unref (G_OBJECT (ec));
 	}
 
+	sp_desktop_snap_index_release (dt);
+
 	if (dt->selection) {
 		g_object_unref (G_OBJECT (dt->selection));
 		dt->selection = NULL;
@@ -382,6 +386,8 @@ sp_desktop_prepare_shutdown (SPDesktop *dt)
 		g_object_unref (G_OBJECT (ec));
 	}
 
+	sp_desktop_snap_index_release (dt);
+
 	if (dt->selection) {
 		g_object_unref (G_OBJECT (dt->selection));
 		dt->selection = NULL;
@@ -436,6 +442,8 @@ sp_dt_update_snap_distances (SPDesktop *desktop)
 	sp_convert_distance_full (&desktop->gridsnap, desktop->namedview->gridtoleranceunit, px, 1.0, px2doc);
 	desktop->guidesnap = (desktop->namedview->snaptoguides) ? desktop->namedview->guidetolerance : 0.0;
 	sp_convert_distance_full (&desktop->guidesnap, desktop->namedview->guidetoleranceunit, px, 1.0, px2doc);
+	desktop->objectsnap = (desktop->namedview->snaptoobjects) ? desktop->namedview->objecttolerance : 0.0;
+	sp_convert_distance_full (&desktop->objectsnap, desktop->namedview->objecttoleranceunit, px, 1.0, px2doc);
 }
 
 void
@@ -452,6 +460,8 @@ sp_desktop_set_document (SPView *view, SPDocument *doc)
 
 	desktop = SP_DESKTOP (view);
 
+	sp_desktop_snap_index_release (desktop);
+
 	if (view->doc) {
 		sp_namedview_hide (desktop->namedview, desktop);
 		sp_item_invoke_hide (SP_ITEM (sp_document_root (SP_VIEW_DOCUMENT (desktop))), desktop->dkey);
@@ -1183,6 +1193,8 @@ sp_desktop_set_display_area (SPDesktop *dt, float x0, float y0, float x1, float
 	newscale = CLAMP (newscale, SP_DESKTOP_ZOOM_MIN, SP_DESKTOP_ZOOM_MAX);
 
 	if (!NR_DF_TEST_CLOSE (newscale, scale, 1e-4 * scale)) {
+		/* Everything is repainted, so do it fast until zooming stops */
+		sp_canvas_arena_draft_briefly (SP_CANVAS_ARENA (dt->drawing));
 		/* Set zoom factors */
 		nr_matrix_d_set_scale (NR_MATRIX_D_FROM_DOUBLE (dt->d2w), newscale, -newscale);
 		nr_matrix_d_invert (NR_MATRIX_D_FROM_DOUBLE (dt->w2d), NR_MATRIX_D_FROM_DOUBLE (dt->d2w));
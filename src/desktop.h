@@ -58,6 +58,9 @@ struct _SPDesktop {
 	/* Normalized snap distances */
 	gdouble gridsnap;
 	gdouble guidesnap;
+	gdouble objectsnap;
+	/* Snap points of document objects, built on first use */
+	struct _SPSnapIndex *snapindex;
 	/* fixme: This has to be implemented in different way */
 	guint guides_active : 1;
 };
@@ -288,6 +288,7 @@ sp_desktop_dialog (void)
 		cb = G_CALLBACK(sp_dtw_whatever_toggled);
 		spw_checkbutton(dlg, t, _("Show guides"), "showguides", 0, row, 1, cb);
 		spw_checkbutton(dlg, t, _("Snap to guides"), "snaptoguides", 1, row++, 0, cb);
+		spw_checkbutton(dlg, t, _("Snap to objects"), "snaptoobjects", 1, row++, 0, cb);
 
 		cb = G_CALLBACK(sp_dtw_whatever_toggled);
 		us = sp_unit_selector_new (SP_UNIT_ABSOLUTE | SP_UNIT_DEVICE);
@@ -414,6 +415,9 @@ sp_dtw_update (GtkWidget *dialog, SPDesktop *desktop)
 		o = (GtkObject *)gtk_object_get_data (GTK_OBJECT (dialog), "snaptoguides");
 		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (o), nv->snaptogrid);
 
+		o = (GtkObject *)gtk_object_get_data (GTK_OBJECT (dialog), "snaptoobjects");
+		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (o), nv->snaptoobjects);
+
 		o = (GtkObject *)gtk_object_get_data (GTK_OBJECT (dialog), "guide_snap_units");
 		sp_unit_selector_set_unit (SP_UNIT_SELECTOR (o), nv->guidetoleranceunit);
 
@@ -433,14 +433,14 @@ sp_fill_style_widget_paint_dragged (SPPaintSelector *psel, SPWidget *spw)
 		sp_paint_selector_get_rgba_floatv (psel, c);
 		items = sp_widget_get_item_list (spw);
 		for (i = items; i != NULL; i = i->next) {
-			sp_style_set_fill_color_rgba (SP_OBJECT_STYLE (i->data), c[0], c[1], c[2], c[3], TRUE, TRUE);
+			sp_style_set_fill_color_rgba (sp_object_style_private (SP_OBJECT (i->data)), c[0], c[1], c[2], c[3], TRUE, TRUE);
 		}
 		break;
 	case SP_PAINT_SELECTOR_MODE_COLOR_CMYK:
 		sp_paint_selector_get_cmyka_floatv (psel, c);
 		items = sp_widget_get_item_list (spw);
 		for (i = items; i != NULL; i = i->next) {
-			sp_style_set_fill_color_cmyka (SP_OBJECT_STYLE (i->data), c[0], c[1], c[2], c[3], c[4], TRUE, TRUE);
+			sp_style_set_fill_color_cmyka (sp_object_style_private (SP_OBJECT (i->data)), c[0], c[1], c[2], c[3], c[4], TRUE, TRUE);
 		}
 		break;
 	case SP_PAINT_SELECTOR_MODE_GRADIENT_LINEAR:
@@ -12,14 +12,27 @@
  * Released under GNU GPL, read the file 'COPYING' for more information
  */
 
+#define noSP_CANVAS_ARENA_CLIP_STATS
+
+/* Brief draft ends after that many milliseconds without interaction */
+#define SP_CANVAS_ARENA_DRAFT_DELAY 250
+
 #include <string.h>
+#include <math.h>
+#include <libnr/nr-macros.h>
+#include <libnr/nr-values.h>
+#include <libnr/nr-rect.h>
 #include <libnr/nr-blit.h>
+#include <libnr/nr-matrix.h>
+#include <libnr/nr-compose-transform.h>
 #include <gtk/gtksignal.h>
+#include <gtk/gtkmain.h>
 #include "../helper/sp-canvas.h"
 #include "../helper/sp-canvas-util.h"
 #include "../helper/sp-marshal.h"
 #include "nr-arena.h"
 #include "nr-arena-group.h"
+#include "nr-arena-shape.h"
 #include "canvas-arena.h"
 #include "../prefs-utils.h"
 
@@ -41,6 +54,14 @@ static gint sp_canvas_arena_event (SPCanvasItem *item, GdkEvent *event);
 
 static gint sp_canvas_arena_send_event (SPCanvasArena *arena, GdkEvent *event);
 
+static void sp_canvas_arena_draft_changed (SPCanvasArena *ca, unsigned int was_draft);
+
+static void sp_canvas_arena_rasterize_layer (SPCanvasArena *ca);
+static void sp_canvas_arena_release_layer (SPCanvasArena *ca);
+static void sp_canvas_arena_render_layer (SPCanvasArena *ca, NRRectL *area, NRPixBlock *pb, unsigned int flags);
+
+#define SP_CANVAS_ARENA_IS_DRAFT(ca) ((ca)->draft || (ca)->interactive || (ca)->draft_timeout)
+
 #if 0
 static void sp_canvas_arena_item_added (NRArena *arena, NRArenaItem *item, SPCanvasArena *ca);
 static void sp_canvas_arena_remove_item (NRArena *arena, NRArenaItem *item, SPCanvasArena *ca);
@@ -114,6 +135,16 @@ sp_canvas_arena_init (SPCanvasArena *arena)
 
 	arena->active = NULL;
 
+	arena->draft = FALSE;
+	arena->interactive = 0;
+	arena->draft_timeout = 0;
+
+	arena->layer = FALSE;
+	arena->layer_items = NULL;
+	arena->layer_nitems = 0;
+	arena->layer_fg_valid = FALSE;
+	arena->layer_bg_valid = FALSE;
+
 #if 0
 	g_signal_connect (G_OBJECT (arena->arena), "item_added",
 			  G_CALLBACK (sp_canvas_arena_item_added), arena);
@@ -135,6 +166,13 @@ sp_canvas_arena_destroy (GtkObject *object)
 
 	arena = SP_CANVAS_ARENA (object);
 
+	if (arena->draft_timeout) {
+		gtk_timeout_remove (arena->draft_timeout);
+		arena->draft_timeout = 0;
+	}
+
+	if (arena->layer) sp_canvas_arena_pop_layer (arena);
+
 	if (arena->active) {
 		nr_object_unref ((NRObject *) arena->active);
 		arena->active = NULL;
@@ -164,7 +202,7 @@ static void
 sp_canvas_arena_update (SPCanvasItem *item, double *affine, unsigned int flags)
 {
 	SPCanvasArena *arena;
-	guint reset;
+	guint state, reset;
 
 	arena = SP_CANVAS_ARENA (item);
 
@@ -179,13 +217,21 @@ sp_canvas_arena_update (SPCanvasItem *item, double *affine, unsigned int flags)
 		reset = NR_ARENA_ITEM_STATE_NONE;
 	}
 
-	nr_arena_item_invoke_update (arena->root, NULL, &arena->gc, NR_ARENA_ITEM_STATE_ALL, reset);
+	state = NR_ARENA_ITEM_STATE_ALL;
+	if (SP_CANVAS_ARENA_IS_DRAFT (arena)) state &= ~NR_ARENA_ITEM_STATE_RENDER;
+
+	nr_arena_shape_update_parallel (arena->root, NULL, &arena->gc, state, reset);
 
 	item->x1 = arena->root->bbox.x0 - 1;
 	item->y1 = arena->root->bbox.y0 - 1;
 	item->x2 = arena->root->bbox.x1 + 1;
 	item->y2 = arena->root->bbox.y1 + 1;
 
+	/* Zoom invalidates layer bitmaps */
+	if (arena->layer && (flags & SP_CANVAS_UPDATE_AFFINE)) {
+		sp_canvas_arena_rasterize_layer (arena);
+	}
+
 	if (arena->cursor) {
 		NRArenaItem *new_arena;
 		/* Mess with enter/leave notifiers */
@@ -221,12 +267,21 @@ sp_canvas_arena_render (SPCanvasItem *item, SPCanvasBuf *buf)
 	SPCanvasArena *arena;
 	gint bw, bh, sw, sh;
 	gint x, y;
+	unsigned int flags;
 
 	arena = SP_CANVAS_ARENA (item);
 
-	nr_arena_item_invoke_update (arena->root, NULL, &arena->gc,
-				     NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER,
-				     NR_ARENA_ITEM_STATE_NONE);
+	if (SP_CANVAS_ARENA_IS_DRAFT (arena)) {
+		nr_arena_item_invoke_update (arena->root, NULL, &arena->gc,
+					     NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_DRAFT,
+					     NR_ARENA_ITEM_STATE_NONE);
+		flags = NR_ARENA_ITEM_RENDER_DRAFT;
+	} else {
+		nr_arena_shape_update_parallel (arena->root, NULL, &arena->gc,
+						NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER,
+						NR_ARENA_ITEM_STATE_NONE);
+		flags = 0;
+	}
 
 	if (buf->is_bg) {
 		sp_canvas_clear_buffer (buf);
@@ -285,16 +340,31 @@ sp_canvas_arena_render (SPCanvasItem *item, SPCanvasBuf *buf)
 						  FALSE, FALSE);
 
 #ifdef STRICT_RGBA
-			nr_arena_item_invoke_render (arena->root, &area, &pb, 0);
+			if (arena->layer) {
+				sp_canvas_arena_render_layer (arena, &area, &pb, flags);
+			} else {
+				nr_arena_item_invoke_render (arena->root, &area, &pb, flags);
+			}
 			nr_blit_pixblock_pixblock (&cb, &pb);
 			nr_pixblock_release (&pb);
 #else
-			nr_arena_item_invoke_render (arena->root, &area, &cb, 0);
+			nr_arena_item_invoke_render (arena->root, &area, &cb, flags);
 #endif
 
 			nr_pixblock_release (&cb);
 		}
 	}
+
+#ifdef SP_CANVAS_ARENA_CLIP_STATS
+	{
+		const NRArenaItemStats *stats;
+		stats = nr_arena_item_get_stats ();
+		g_print ("Paint %d %d - %d %d: clip renders %u mask renders %u coverage hits %u rect clips %u\n",
+			 buf->rect.x0, buf->rect.y0, buf->rect.x1, buf->rect.y1,
+			 stats->clip_renders, stats->mask_renders, stats->coverage_hits, stats->rect_clips);
+		nr_arena_item_reset_stats ();
+	}
+#endif
 }
 
 static double
@@ -438,6 +508,23 @@ sp_canvas_arena_request_update (NRArena *arena, NRArenaItem *item, void *data)
 static void
 sp_canvas_arena_request_render (NRArena *arena, NRRectL *area, void *data)
 {
+	SPCanvasArena *ca;
+
+	ca = SP_CANVAS_ARENA (data);
+
+	/* Cached drawing is stale, render it as usual */
+	if (ca->layer_bg_valid) {
+		NRRectL bgarea;
+		bgarea.x0 = ca->layer_bg.area.x0;
+		bgarea.y0 = ca->layer_bg.area.y0;
+		bgarea.x1 = ca->layer_bg.area.x1;
+		bgarea.y1 = ca->layer_bg.area.y1;
+		if (nr_rect_l_test_intersect (area, &bgarea)) {
+			nr_pixblock_release (&ca->layer_bg);
+			ca->layer_bg_valid = FALSE;
+		}
+	}
+
 	sp_canvas_request_redraw (SP_CANVAS_ITEM (data)->canvas, area->x0, area->y0, area->x1, area->y1);
 }
 
@@ -480,3 +567,291 @@ sp_canvas_arena_render_pixblock (SPCanvasArena *ca, NRPixBlock *pb)
 	nr_arena_item_invoke_render (ca->root, &area, pb, 0);
 }
 
+/*
+ * Leaving draft needs full update and repaint of everything drawn in
+ * draft; canvas does both from idle loop
+ */
+
+static void
+sp_canvas_arena_draft_changed (SPCanvasArena *ca, unsigned int was_draft)
+{
+	SPCanvasItem *item;
+
+	if (!was_draft || SP_CANVAS_ARENA_IS_DRAFT (ca)) return;
+
+	item = SP_CANVAS_ITEM (ca);
+	sp_canvas_item_request_update (item);
+	sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+}
+
+void
+sp_canvas_arena_set_draft (SPCanvasArena *ca, gboolean draft)
+{
+	unsigned int was_draft;
+
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+
+	was_draft = SP_CANVAS_ARENA_IS_DRAFT (ca);
+	ca->draft = draft;
+	/* Visible at once, not only in newly exposed areas */
+	if (draft && !was_draft) {
+		SPCanvasItem *item;
+		item = SP_CANVAS_ITEM (ca);
+		sp_canvas_item_request_update (item);
+		sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+	}
+	sp_canvas_arena_draft_changed (ca, was_draft);
+}
+
+void
+sp_canvas_arena_push_draft (SPCanvasArena *ca)
+{
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+
+	ca->interactive += 1;
+}
+
+void
+sp_canvas_arena_pop_draft (SPCanvasArena *ca)
+{
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+	g_return_if_fail (ca->interactive > 0);
+
+	ca->interactive -= 1;
+	sp_canvas_arena_draft_changed (ca, TRUE);
+}
+
+static gint
+sp_canvas_arena_draft_timeout (gpointer data)
+{
+	SPCanvasArena *ca;
+
+	ca = SP_CANVAS_ARENA (data);
+
+	ca->draft_timeout = 0;
+	sp_canvas_arena_draft_changed (ca, TRUE);
+
+	return FALSE;
+}
+
+void
+sp_canvas_arena_draft_briefly (SPCanvasArena *ca)
+{
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+
+	if (ca->draft_timeout) gtk_timeout_remove (ca->draft_timeout);
+	ca->draft_timeout = gtk_timeout_add (SP_CANVAS_ARENA_DRAFT_DELAY, sp_canvas_arena_draft_timeout, ca);
+}
+
+/* Layer transform in canvas coordinates, as it is given in item ones */
+static void
+sp_canvas_arena_layer_w2w (SPCanvasArena *ca, NRMatrixD *w2w)
+{
+	NRMatrixD c2i;
+
+	nr_matrix_d_invert (&c2i, &ca->gc.transform);
+	nr_matrix_multiply_ddd (w2w, &c2i, &ca->layer_transform);
+	nr_matrix_multiply_ddd (w2w, w2w, &ca->gc.transform);
+}
+
+/* Canvas area covered by layer bitmap with current transform */
+static void
+sp_canvas_arena_layer_area (SPCanvasArena *ca, NRRectL *area)
+{
+	NRMatrixD w2w;
+	NRRectD d;
+	int i;
+
+	sp_canvas_arena_layer_w2w (ca, &w2w);
+
+	if (!ca->layer_fg_valid) {
+		area->x0 = area->y0 = 0;
+		area->x1 = area->y1 = 0;
+		return;
+	}
+
+	d.x0 = d.y0 = NR_HUGE_D;
+	d.x1 = d.y1 = -NR_HUGE_D;
+	for (i = 0; i < 4; i++) {
+		double x, y, tx, ty;
+		x = (i & 1) ? ca->layer_fg.area.x1 : ca->layer_fg.area.x0;
+		y = (i & 2) ? ca->layer_fg.area.y1 : ca->layer_fg.area.y0;
+		tx = NR_MATRIX_DF_TRANSFORM_X (&w2w, x, y);
+		ty = NR_MATRIX_DF_TRANSFORM_Y (&w2w, x, y);
+		d.x0 = MIN (d.x0, tx);
+		d.y0 = MIN (d.y0, ty);
+		d.x1 = MAX (d.x1, tx);
+		d.y1 = MAX (d.y1, ty);
+	}
+	area->x0 = (NRLong) floor (d.x0) - 1;
+	area->y0 = (NRLong) floor (d.y0) - 1;
+	area->x1 = (NRLong) ceil (d.x1) + 1;
+	area->y1 = (NRLong) ceil (d.y1) + 1;
+}
+
+static void
+sp_canvas_arena_release_layer (SPCanvasArena *ca)
+{
+	if (ca->layer_fg_valid) {
+		nr_pixblock_release (&ca->layer_fg);
+		ca->layer_fg_valid = FALSE;
+	}
+	if (ca->layer_bg_valid) {
+		nr_pixblock_release (&ca->layer_bg);
+		ca->layer_bg_valid = FALSE;
+	}
+}
+
+/* Renders layer items and rest of drawing for visible canvas area */
+static void
+sp_canvas_arena_rasterize_layer (SPCanvasArena *ca)
+{
+	SPCanvas *canvas;
+	NRRectL view, area;
+	int dx, dy, i;
+
+	canvas = SP_CANVAS_ITEM (ca)->canvas;
+
+	sp_canvas_arena_release_layer (ca);
+
+	view.x0 = canvas->x0;
+	view.y0 = canvas->y0;
+	view.x1 = canvas->x0 + GTK_WIDGET (canvas)->allocation.width;
+	view.y1 = canvas->y0 + GTK_WIDGET (canvas)->allocation.height;
+	if ((view.x1 <= view.x0) || (view.y1 <= view.y0)) return;
+
+	nr_arena_shape_update_parallel (ca->root, NULL, &ca->gc,
+					NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER,
+					NR_ARENA_ITEM_STATE_NONE);
+
+	/* Items may be dragged in from just outside of view */
+	dx = (view.x1 - view.x0) / 4;
+	dy = (view.y1 - view.y0) / 4;
+	nr_rect_l_set_empty (&area);
+	for (i = 0; i < ca->layer_nitems; i++) {
+		nr_rect_l_union (&area, &area, &ca->layer_items[i]->bbox);
+	}
+	area.x0 = MAX (area.x0, view.x0 - dx);
+	area.y0 = MAX (area.y0, view.y0 - dy);
+	area.x1 = MIN (area.x1, view.x1 + dx);
+	area.y1 = MIN (area.y1, view.y1 + dy);
+
+	if ((area.x0 < area.x1) && (area.y0 < area.y1)) {
+		nr_pixblock_setup (&ca->layer_fg, NR_PIXBLOCK_MODE_R8G8B8A8P, area.x0, area.y0, area.x1, area.y1, TRUE);
+		ca->layer_fg.empty = FALSE;
+		/* Hidden items are shown only for this; setting visible directly does not request render */
+		for (i = 0; i < ca->layer_nitems; i++) {
+			ca->layer_items[i]->visible = TRUE;
+			nr_arena_item_invoke_render (ca->layer_items[i], &area, &ca->layer_fg, 0);
+			ca->layer_items[i]->visible = FALSE;
+		}
+		ca->layer_fg_valid = TRUE;
+	}
+
+	nr_pixblock_setup (&ca->layer_bg, NR_PIXBLOCK_MODE_R8G8B8A8P, view.x0, view.y0, view.x1, view.y1, TRUE);
+	ca->layer_bg.empty = FALSE;
+	nr_arena_item_invoke_render (ca->root, &view, &ca->layer_bg, 0);
+	ca->layer_bg_valid = TRUE;
+
+	sp_canvas_arena_layer_area (ca, &ca->layer_area);
+}
+
+static void
+sp_canvas_arena_render_layer (SPCanvasArena *ca, NRRectL *area, NRPixBlock *pb, unsigned int flags)
+{
+	if (ca->layer_bg_valid &&
+	    (area->x0 >= ca->layer_bg.area.x0) && (area->y0 >= ca->layer_bg.area.y0) &&
+	    (area->x1 <= ca->layer_bg.area.x1) && (area->y1 <= ca->layer_bg.area.y1)) {
+		nr_blit_pixblock_pixblock (pb, &ca->layer_bg);
+	} else {
+		/* Layer items are hidden */
+		nr_arena_item_invoke_render (ca->root, area, pb, flags);
+	}
+
+	if (ca->layer_fg_valid && nr_rect_l_test_intersect (area, &ca->layer_area)) {
+		NRMatrixD w2w, d2s;
+		NRMatrixF d2sf;
+		sp_canvas_arena_layer_w2w (ca, &w2w);
+		nr_matrix_d_invert (&d2s, &w2w);
+		/* Destination pixel to layer bitmap pixel */
+		d2sf.c[0] = d2s.c[0];
+		d2sf.c[1] = d2s.c[1];
+		d2sf.c[2] = d2s.c[2];
+		d2sf.c[3] = d2s.c[3];
+		d2sf.c[4] = d2s.c[0] * pb->area.x0 + d2s.c[2] * pb->area.y0 + d2s.c[4] - ca->layer_fg.area.x0;
+		d2sf.c[5] = d2s.c[1] * pb->area.x0 + d2s.c[3] * pb->area.y0 + d2s.c[5] - ca->layer_fg.area.y0;
+		nr_R8G8B8A8_P_R8G8B8A8_P_R8G8B8A8_P_TRANSFORM (NR_PIXBLOCK_PX (pb),
+							       pb->area.x1 - pb->area.x0, pb->area.y1 - pb->area.y0, pb->rs,
+							       NR_PIXBLOCK_PX (&ca->layer_fg),
+							       ca->layer_fg.area.x1 - ca->layer_fg.area.x0,
+							       ca->layer_fg.area.y1 - ca->layer_fg.area.y0,
+							       ca->layer_fg.rs, &d2sf, 255, 0, 0);
+	}
+}
+
+void
+sp_canvas_arena_push_layer (SPCanvasArena *ca, NRArenaItem **items, int nitems)
+{
+	int i;
+
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+	g_return_if_fail (!ca->layer);
+
+	ca->layer = TRUE;
+	ca->layer_items = nr_new (NRArenaItem *, nitems);
+	ca->layer_nitems = 0;
+	for (i = 0; i < nitems; i++) {
+		/* Invisible items stay as they are */
+		if (!items[i]->visible) continue;
+		ca->layer_items[ca->layer_nitems++] = nr_arena_item_ref (items[i]);
+		items[i]->visible = FALSE;
+	}
+	nr_matrix_d_set_identity (&ca->layer_transform);
+
+	sp_canvas_arena_rasterize_layer (ca);
+}
+
+void
+sp_canvas_arena_set_layer_transform (SPCanvasArena *ca, const NRMatrixD *transform)
+{
+	SPCanvas *canvas;
+
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+	g_return_if_fail (ca->layer);
+
+	canvas = SP_CANVAS_ITEM (ca)->canvas;
+
+	sp_canvas_request_redraw (canvas, ca->layer_area.x0, ca->layer_area.y0, ca->layer_area.x1, ca->layer_area.y1);
+	ca->layer_transform = *transform;
+	sp_canvas_arena_layer_area (ca, &ca->layer_area);
+	sp_canvas_request_redraw (canvas, ca->layer_area.x0, ca->layer_area.y0, ca->layer_area.x1, ca->layer_area.y1);
+}
+
+void
+sp_canvas_arena_pop_layer (SPCanvasArena *ca)
+{
+	int i;
+
+	g_return_if_fail (ca != NULL);
+	g_return_if_fail (SP_IS_CANVAS_ARENA (ca));
+	g_return_if_fail (ca->layer);
+
+	sp_canvas_request_redraw (SP_CANVAS_ITEM (ca)->canvas, ca->layer_area.x0, ca->layer_area.y0, ca->layer_area.x1, ca->layer_area.y1);
+
+	ca->layer = FALSE;
+	sp_canvas_arena_release_layer (ca);
+
+	for (i = 0; i < ca->layer_nitems; i++) {
+		nr_arena_item_set_visible (ca->layer_items[i], TRUE);
+		nr_arena_item_unref (ca->layer_items[i]);
+	}
+	nr_free (ca->layer_items);
+	ca->layer_items = NULL;
+	ca->layer_nitems = 0;
+}
@@ -40,6 +40,24 @@ struct _SPCanvasArena {
 	/* fixme: */
 	NRArenaItem *picked;
 	gdouble delta;
+
+	/* Draft rendering chosen for view */
+	guint draft : 1;
+	/* Interactions wanting draft, and timeout ending brief draft */
+	guint interactive;
+	guint draft_timeout;
+
+	/* Items rasterized once, drawn transformed over cached rest of drawing */
+	guint layer : 1;
+	NRArenaItem **layer_items;
+	int layer_nitems;
+	NRPixBlock layer_fg;
+	NRPixBlock layer_bg;
+	guint layer_fg_valid : 1;
+	guint layer_bg_valid : 1;
+	/* In item coordinates, and resulting canvas area */
+	NRMatrixD layer_transform;
+	NRRectL layer_area;
 };
 
 struct _SPCanvasArenaClass {
@@ -55,4 +73,25 @@ void sp_canvas_arena_set_sticky (SPCanvasArena *ca, gboolean sticky);
 
 void sp_canvas_arena_render_pixblock (SPCanvasArena *ca, NRPixBlock *pb);
 
+/*
+ * Draft renders coarse geometry in flat colors, without clips and masks.
+ * Besides being chosen for view, it is used temporarily during
+ * interaction; once that ends, full quality is rendered from idle loop.
+ */
+void sp_canvas_arena_set_draft (SPCanvasArena *ca, gboolean draft);
+void sp_canvas_arena_push_draft (SPCanvasArena *ca);
+void sp_canvas_arena_pop_draft (SPCanvasArena *ca);
+/* Draft until not called for a while, i.e. during zooming */
+void sp_canvas_arena_draft_briefly (SPCanvasArena *ca);
+
+/*
+ * Bitmap layer: given items (in z-order) are rendered once into bitmap and
+ * hidden, and rest of visible drawing is cached.  Until popped, canvas
+ * shows cached drawing with layer bitmap composited with transform, so
+ * moving layer does not touch items at all.
+ */
+void sp_canvas_arena_push_layer (SPCanvasArena *ca, NRArenaItem **items, int nitems);
+void sp_canvas_arena_set_layer_transform (SPCanvasArena *ca, const NRMatrixD *transform);
+void sp_canvas_arena_pop_layer (SPCanvasArena *ca);
+
 #endif
@@ -31,6 +31,7 @@ static void nr_arena_group_set_child_position (NRArenaItem *item, NRArenaItem *c
 static unsigned int nr_arena_group_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigned int state, unsigned int reset);
 static unsigned int nr_arena_group_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags);
 static unsigned int nr_arena_group_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb);
+static unsigned int nr_arena_group_clip_rect (NRArenaItem *item, NRRectL *rect);
 static NRArenaItem *nr_arena_group_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky);
 
 static NRArenaItemClass *parent_class;
@@ -70,6 +71,7 @@ nr_arena_group_class_init (NRArenaGroupClass *klass)
 	item_class->update = nr_arena_group_update;
 	item_class->render = nr_arena_group_render;
 	item_class->clip = nr_arena_group_clip;
+	item_class->clip_rect = nr_arena_group_clip_rect;
 	item_class->pick = nr_arena_group_pick;
 }
 
@@ -242,6 +244,19 @@ nr_arena_group_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 	return ret;
 }
 
+static unsigned int
+nr_arena_group_clip_rect (NRArenaItem *item, NRRectL *rect)
+{
+	NRArenaGroup *group;
+
+	group = NR_ARENA_GROUP (item);
+
+	/* Union of several rectangles is not worth checking */
+	if (!group->children || group->children->next) return FALSE;
+
+	return nr_arena_item_get_clip_rect (group->children, rect);
+}
+
 static NRArenaItem *
 nr_arena_group_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky)
 {
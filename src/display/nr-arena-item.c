@@ -23,6 +23,7 @@
 #include <libnr/nr-matrix.h>
 #include <libnr/nr-blit.h>
 #include <libnr/nr-pixops.h>
+#include <libnr/nr-trace.h>
 #include "nr-arena.h"
 #include "nr-arena-item.h"
 
@@ -30,8 +31,24 @@ static void nr_arena_item_class_init (NRArenaItemClass *klass);
 static void nr_arena_item_init (NRArenaItem *item);
 static void nr_arena_item_private_finalize (NRObject *object);
 
+static void nr_arena_item_free_coverage (NRArenaItem *item);
+static unsigned int nr_arena_item_get_coverage (NRArenaItem *item, unsigned int mask, NRRectL *area, NRPixBlock *pb, unsigned int flags);
+static unsigned int nr_arena_item_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags);
+
+/* Clip or mask coverage bigger than that is cached only for last render area */
+#define NR_ARENA_ITEM_COVERAGE_MAX (512 * 512)
+/* Pixel plus antialiasing margins, draft does not render anything smaller */
+#define NR_ARENA_ITEM_DRAFT_MIN_SIZE 3
+
+struct _NRArenaItemCoverage {
+	NRRectL area;
+	unsigned char *px;
+};
+
 static NRObjectClass *parent_class;
 
+static NRArenaItemStats item_stats = {0, 0, 0, 0};
+
 NRType
 nr_arena_item_get_type (void)
 {
@@ -69,6 +86,7 @@ nr_arena_item_init (NRArenaItem *item)
 	/* fixme: Initialize bbox */
 	item->transform = NULL;
 	item->opacity = 255;
+	item->coverage = NULL;
 }
 
 static void
@@ -97,6 +115,8 @@ nr_arena_item_private_finalize (NRObject *object)
 		nr_free (item->px);
 	}
 
+	nr_arena_item_free_coverage (item);
+
 	if (item->transform) {
 		nr_free (item->transform);
 	}
@@ -183,6 +203,7 @@ unsigned int
 nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigned int state, unsigned int reset)
 {
 	NRGC childgc;
+	double trace = 0.0;
 
 	nr_return_val_if_fail (item != NULL, NR_ARENA_ITEM_STATE_INVALID);
 	nr_return_val_if_fail (NR_IS_ARENA_ITEM (item), NR_ARENA_ITEM_STATE_INVALID);
@@ -203,6 +224,8 @@ nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigne
 	item->state &= ~reset;
 	/* Return if NOP */
 	if (!(~item->state & state)) return item->state;
+	/* Clip or mask geometry, or transform, may have changed */
+	nr_arena_item_free_coverage (item);
 	/* Test whether to return immediately */
 	if (area && (item->state & NR_ARENA_ITEM_STATE_BBOX)) {
 		if (!nr_rect_l_test_intersect (area, &item->bbox)) return item->state;
@@ -221,17 +244,30 @@ nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigne
 	}
 
 	/* Invoke the real method */
+	NR_TRACE_BEGIN (trace, "arena-update");
 	item->state = NR_ARENA_ITEM_VIRTUAL (item, update) (item, area, &childgc, state, reset);
+	NR_TRACE_END (trace, "arena-update");
 	if (item->state & NR_ARENA_ITEM_STATE_INVALID) return item->state;
 	/* Clipping */
 	if (item->clip) {
 		unsigned int newstate;
+		NRRectL crect;
 		newstate = nr_arena_item_invoke_update (item->clip, area, &childgc, state, reset);
 		if (newstate & NR_ARENA_ITEM_STATE_INVALID) {
 			item->state |= NR_ARENA_ITEM_STATE_INVALID;
 			return item->state;
 		}
-		nr_rect_l_intersect (&item->bbox, &item->bbox, &item->clip->bbox);
+		/* Clip geometry may be still pending, finish with next update */
+		if (!(newstate & NR_ARENA_ITEM_STATE_BBOX)) {
+			item->state &= ~(NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER);
+			return item->state;
+		}
+		if (nr_arena_item_get_clip_rect (item->clip, &crect)) {
+			/* Exact rectangle is tighter than antialiased bbox */
+			nr_rect_l_intersect (&item->bbox, &item->bbox, &crect);
+		} else {
+			nr_rect_l_intersect (&item->bbox, &item->bbox, &item->clip->bbox);
+		}
 	}
 	/* Masking */
 	if (item->mask) {
@@ -241,6 +277,10 @@ nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigne
 			item->state |= NR_ARENA_ITEM_STATE_INVALID;
 			return item->state;
 		}
+		if (!(newstate & NR_ARENA_ITEM_STATE_BBOX)) {
+			item->state &= ~(NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER);
+			return item->state;
+		}
 		nr_rect_l_intersect (&item->bbox, &item->bbox, &item->mask->bbox);
 	}
 
@@ -250,7 +290,21 @@ nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigne
 unsigned int
 nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags)
 {
-	NRRectL carea;
+	unsigned int state;
+	double trace = 0.0;
+
+	NR_TRACE_BEGIN (trace, "arena-render");
+	state = nr_arena_item_render (item, area, pb, flags);
+	NR_TRACE_END (trace, "arena-render");
+
+	return state;
+}
+
+static unsigned int
+nr_arena_item_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags)
+{
+	NRRectL carea, crect;
+	NRArenaItem *clip, *mask;
 	NRPixBlock *dpb;
 	NRPixBlock cpb;
 	unsigned int state;
@@ -271,6 +325,12 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 	if (!item->visible) return item->state | NR_ARENA_ITEM_STATE_RENDER;
 	nr_rect_l_intersect (&carea, area, &item->bbox);
 	if (nr_rect_l_test_empty (&carea)) return item->state | NR_ARENA_ITEM_STATE_RENDER;
+	/* Level of detail: subpixel items only have antialiasing margin */
+	if ((flags & NR_ARENA_ITEM_RENDER_DRAFT) &&
+	    ((item->bbox.x1 - item->bbox.x0) <= NR_ARENA_ITEM_DRAFT_MIN_SIZE) &&
+	    ((item->bbox.y1 - item->bbox.y0) <= NR_ARENA_ITEM_DRAFT_MIN_SIZE)) {
+		return item->state | NR_ARENA_ITEM_STATE_RENDER;
+	}
 
 	if (item->px) {
 		/* Has cache pixblock, render this and return */
@@ -287,6 +347,9 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 		return item->state | NR_ARENA_ITEM_STATE_RENDER;
 	}
 
+	/* Draft pixels must not outlive interaction */
+	if (flags & NR_ARENA_ITEM_RENDER_DRAFT) flags |= NR_ARENA_ITEM_RENDER_NO_CACHE;
+
 	dpb = pb;
 	/* Setup cache if we can */
 	if ((!(flags & NR_ARENA_ITEM_RENDER_NO_CACHE)) &&
@@ -307,8 +370,21 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 		flags |= NR_ARENA_ITEM_RENDER_NO_CACHE;
 	}
 
+	/* Bbox is already intersected with rectangular clip, so it can be skipped */
+	clip = item->clip;
+	if (clip && nr_arena_item_get_clip_rect (clip, &crect)) {
+		clip = NULL;
+		item_stats.rect_clips += 1;
+	}
+	mask = item->mask;
+	/* Draft is only clipped to bbox */
+	if (flags & NR_ARENA_ITEM_RENDER_DRAFT) {
+		clip = NULL;
+		mask = NULL;
+	}
+
 	/* Determine, whether we need temporary buffer */
-	if (item->clip || item->mask || ((item->opacity != 255) && !item->render_opacity)) {
+	if (clip || mask || ((item->opacity != 255) && !item->render_opacity)) {
 		NRPixBlock ipb, mpb;
 
 		/* Setup and render item buffer */
@@ -323,12 +399,12 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 		}
 		ipb.empty = FALSE;
 
-		if (item->clip || item->mask) {
+		if (clip || mask) {
 			/* Setup mask pixblock */
 			nr_pixblock_setup_fast (&mpb, NR_PIXBLOCK_MODE_A8, carea.x0, carea.y0, carea.x1, carea.y1, TRUE);
 			/* Do clip if needed */
-			if (item->clip) {
-				state = nr_arena_item_invoke_clip (item->clip, &carea, &mpb);
+			if (clip) {
+				state = nr_arena_item_get_coverage (clip, FALSE, &carea, &mpb, flags);
 				if (state & NR_ARENA_ITEM_STATE_INVALID) {
 					/* Clean up and return error */
 					nr_pixblock_release (&mpb);
@@ -337,17 +413,16 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 					item->state |= NR_ARENA_ITEM_STATE_INVALID;
 					return item->state;
 				}
-				mpb.empty = FALSE;
 			}
 			/* Do mask if needed */
-			if (item->mask) {
+			if (mask) {
 				NRPixBlock tpb;
-				/* Set up yet another temporary pixblock */
-				nr_pixblock_setup_fast (&tpb, NR_PIXBLOCK_MODE_R8G8B8A8N, carea.x0, carea.y0, carea.x1, carea.y1, TRUE);
-				state = NR_ARENA_ITEM_VIRTUAL (item->mask, render) (item->mask, &carea, &tpb, flags);
+				/* Without clip mask coverage goes directly to mask pixblock */
+				if (clip) nr_pixblock_setup_fast (&tpb, NR_PIXBLOCK_MODE_A8, carea.x0, carea.y0, carea.x1, carea.y1, FALSE);
+				state = nr_arena_item_get_coverage (mask, TRUE, &carea, (clip) ? &tpb : &mpb, flags);
 				if (state & NR_ARENA_ITEM_STATE_INVALID) {
 					/* Clean up and return error */
-					nr_pixblock_release (&tpb);
+					if (clip) nr_pixblock_release (&tpb);
 					nr_pixblock_release (&mpb);
 					nr_pixblock_release (&ipb);
 					if (dpb != pb) nr_pixblock_release (dpb);
@@ -355,38 +430,22 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 					return item->state;
 				}
 				/* Composite with clip */
-				if (item->clip) {
+				if (clip) {
 					int x, y;
 					for (y = carea.y0; y < carea.y1; y++) {
 						unsigned char *s, *d;
 						s = NR_PIXBLOCK_PX (&tpb) + (y - carea.y0) * tpb.rs;
 						d = NR_PIXBLOCK_PX (&mpb) + (y - carea.y0) * mpb.rs;
 						for (x = carea.x0; x < carea.x1; x++) {
-							unsigned int m;
-							m = ((s[0] + s[1] + s[2]) * s[3] + 127) / (3 * 255);
-							d[0] = NR_PREMUL (d[0], m);
-							s += 4;
+							d[0] = NR_PREMUL (d[0], s[0]);
+							s += 1;
 							d += 1;
 						}
 					}
-				} else {
-					int x, y;
-					for (y = carea.y0; y < carea.y1; y++) {
-						unsigned char *s, *d;
-						s = NR_PIXBLOCK_PX (&tpb) + (y - carea.y0) * tpb.rs;
-						d = NR_PIXBLOCK_PX (&mpb) + (y - carea.y0) * mpb.rs;
-						for (x = carea.x0; x < carea.x1; x++) {
-							unsigned int m;
-							m = ((s[0] + s[1] + s[2]) * s[3] + 127) / (3 * 255);
-							d[0] = m;
-							s += 4;
-							d += 1;
-						}
-					}
-					mpb.empty = FALSE;
+					nr_pixblock_release (&tpb);
 				}
-				nr_pixblock_release (&tpb);
 			}
+			mpb.empty = FALSE;
 			/* Multiply with opacity if needed */
 			if ((item->opacity != 255) && !item->render_opacity) {
 				int x, y;
@@ -433,6 +492,96 @@ nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, u
 	return item->state | NR_ARENA_ITEM_STATE_RENDER;
 }
 
+/*
+ * Coverage of clip or mask is rendered for its whole bbox if that is not
+ * too big, so following tiles are just copied from cache until clip or
+ * mask is updated
+ */
+static unsigned int
+nr_arena_item_get_coverage (NRArenaItem *item, unsigned int mask, NRRectL *area, NRPixBlock *pb, unsigned int flags)
+{
+	NRArenaItemCoverage *cov;
+	int y, w;
+
+	cov = item->coverage;
+	if (cov && (area->x0 >= cov->area.x0) && (area->y0 >= cov->area.y0) &&
+	    (area->x1 <= cov->area.x1) && (area->y1 <= cov->area.y1)) {
+		item_stats.coverage_hits += 1;
+	} else {
+		NRPixBlock cpb;
+		NRRectL carea;
+		unsigned int state;
+
+		nr_arena_item_free_coverage (item);
+
+		if ((area->x0 >= item->bbox.x0) && (area->y0 >= item->bbox.y0) &&
+		    (area->x1 <= item->bbox.x1) && (area->y1 <= item->bbox.y1) &&
+		    (((item->bbox.x1 - item->bbox.x0) * (item->bbox.y1 - item->bbox.y0)) <= NR_ARENA_ITEM_COVERAGE_MAX)) {
+			carea = item->bbox;
+		} else {
+			carea = *area;
+		}
+
+		cov = nr_new (NRArenaItemCoverage, 1);
+		cov->area = carea;
+		cov->px = nr_new (unsigned char, (carea.x1 - carea.x0) * (carea.y1 - carea.y0));
+		nr_pixblock_setup_extern (&cpb, NR_PIXBLOCK_MODE_A8, carea.x0, carea.y0, carea.x1, carea.y1,
+					  cov->px, carea.x1 - carea.x0, TRUE, TRUE);
+
+		if (mask) {
+			NRPixBlock tpb;
+			int x;
+			nr_pixblock_setup_fast (&tpb, NR_PIXBLOCK_MODE_R8G8B8A8N, carea.x0, carea.y0, carea.x1, carea.y1, TRUE);
+			state = NR_ARENA_ITEM_VIRTUAL (item, render) (item, &carea, &tpb, flags);
+			/* Coverage is luminance times alpha */
+			for (y = carea.y0; y < carea.y1; y++) {
+				unsigned char *s, *d;
+				s = NR_PIXBLOCK_PX (&tpb) + (y - carea.y0) * tpb.rs;
+				d = NR_PIXBLOCK_PX (&cpb) + (y - carea.y0) * cpb.rs;
+				for (x = carea.x0; x < carea.x1; x++) {
+					d[0] = ((s[0] + s[1] + s[2]) * s[3] + 127) / (3 * 255);
+					s += 4;
+					d += 1;
+				}
+			}
+			nr_pixblock_release (&tpb);
+			item_stats.mask_renders += 1;
+		} else {
+			state = nr_arena_item_invoke_clip (item, &carea, &cpb);
+			item_stats.clip_renders += 1;
+		}
+		nr_pixblock_release (&cpb);
+
+		if (state & NR_ARENA_ITEM_STATE_INVALID) {
+			nr_free (cov->px);
+			nr_free (cov);
+			return state;
+		}
+
+		item->coverage = cov;
+	}
+
+	w = area->x1 - area->x0;
+	for (y = area->y0; y < area->y1; y++) {
+		memcpy (NR_PIXBLOCK_PX (pb) + (y - pb->area.y0) * pb->rs + (area->x0 - pb->area.x0),
+			cov->px + (y - cov->area.y0) * (cov->area.x1 - cov->area.x0) + (area->x0 - cov->area.x0),
+			w);
+	}
+	pb->empty = FALSE;
+
+	return item->state;
+}
+
+static void
+nr_arena_item_free_coverage (NRArenaItem *item)
+{
+	if (item->coverage) {
+		nr_free (item->coverage->px);
+		nr_free (item->coverage);
+		item->coverage = NULL;
+	}
+}
+
 unsigned int
 nr_arena_item_invoke_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 {
@@ -457,6 +606,20 @@ nr_arena_item_invoke_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 	return item->state;
 }
 
+unsigned int
+nr_arena_item_get_clip_rect (NRArenaItem *item, NRRectL *rect)
+{
+	nr_return_val_if_fail (item != NULL, FALSE);
+	nr_return_val_if_fail (NR_IS_ARENA_ITEM (item), FALSE);
+
+	if (!item->visible) return FALSE;
+
+	if (((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->clip_rect)
+		return ((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->clip_rect (item, rect);
+
+	return FALSE;
+}
+
 NRArenaItem *
 nr_arena_item_invoke_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky)
 {
@@ -476,8 +639,14 @@ nr_arena_item_invoke_pick (NRArenaItem *item, double x, double y, double delta,
 	    ((x - delta) <  item->bbox.x1) &&
 	    ((y + delta) >= item->bbox.y0) &&
 	    ((y - delta) <  item->bbox.y1)) {
-		if (((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->pick)
-			return ((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->pick (item, x, y, delta, sticky);
+		if (((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->pick) {
+			NRArenaItem *picked;
+			double trace = 0.0;
+			NR_TRACE_BEGIN (trace, "arena-pick");
+			picked = ((NRArenaItemClass *) NR_OBJECT_GET_CLASS (item))->pick (item, x, y, delta, sticky);
+			NR_TRACE_END (trace, "arena-pick");
+			return picked;
+		}
 	}
 
 	return NULL;
@@ -519,6 +688,18 @@ nr_arena_item_request_render (NRArenaItem *item)
 	nr_arena_request_render_rect (item->arena, &item->bbox);
 }
 
+void
+nr_arena_item_invalidate_coverage (NRArenaItem *item)
+{
+	nr_return_if_fail (item != NULL);
+	nr_return_if_fail (NR_IS_ARENA_ITEM (item));
+
+	if (item->coverage) {
+		nr_arena_item_free_coverage (item);
+		nr_arena_item_request_render (item);
+	}
+}
+
 /* Public */
 
 NRArenaItem *
@@ -690,6 +871,18 @@ nr_arena_item_set_order (NRArenaItem *item, int order)
 	nr_arena_item_set_child_position (item->parent, item, ref);
 }
 
+const NRArenaItemStats *
+nr_arena_item_get_stats (void)
+{
+	return &item_stats;
+}
+
+void
+nr_arena_item_reset_stats (void)
+{
+	memset (&item_stats, 0, sizeof (item_stats));
+}
+
 /* Helpers */
 
 NRArenaItem *
@@ -20,6 +20,8 @@
 #define NR_ARENA_ITEM_VIRTUAL(i,m) (((NRArenaItemClass *) NR_OBJECT_GET_CLASS (i))->m)
 
 typedef struct _NRGC NRGC;
+typedef struct _NRArenaItemCoverage NRArenaItemCoverage;
+typedef struct _NRArenaItemStats NRArenaItemStats;
 
 /*
  * NRArenaItem state flags
@@ -38,6 +40,15 @@ typedef struct _NRGC NRGC;
 
 #define NR_ARENA_ITEM_STATE_BBOX     (1 << 1)
 #define NR_ARENA_ITEM_STATE_COVERAGE (1 << 2)
+
+/*
+ * NR_ARENA_ITEM_STATE_DRAFT
+ *
+ * Item can be rendered with NR_ARENA_ITEM_RENDER_DRAFT.  Shapes build
+ * coarse geometry for that, unless full rendering state is requested
+ * too, which implies draft.
+ */
+
 #define NR_ARENA_ITEM_STATE_DRAFT    (1 << 3)
 #define NR_ARENA_ITEM_STATE_RENDER   (1 << 4)
 #define NR_ARENA_ITEM_STATE_CLIP     (1 << 5)
@@ -53,6 +64,8 @@ typedef struct _NRGC NRGC;
 #define NR_ARENA_ITEM_UNSET_STATE(i,s) (NR_ARENA_ITEM (i)->state &= ~(s))
 
 #define NR_ARENA_ITEM_RENDER_NO_CACHE (1 << 0)
+/* Simplified rendering during interaction: no clips, masks or paint servers */
+#define NR_ARENA_ITEM_RENDER_DRAFT (1 << 1)
 
 #include <libnr/nr-types.h>
 #include <libnr/nr-pixblock.h>
@@ -93,6 +106,8 @@ struct _NRArenaItem {
 	NRArenaItem *mask;
 	/* Rendered buffer */
 	unsigned char *px;
+	/* Cached coverage, if used as clip or mask */
+	NRArenaItemCoverage *coverage;
 
 	/* Single data member */
 	void *data;
@@ -109,9 +124,20 @@ struct _NRArenaItemClass {
 	unsigned int (* update) (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigned int state, unsigned int reset);
 	unsigned int (* render) (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags);
 	unsigned int (* clip) (NRArenaItem *item, NRRectL *area, NRPixBlock *pb);
+	unsigned int (* clip_rect) (NRArenaItem *item, NRRectL *rect);
 	NRArenaItem * (* pick) (NRArenaItem *item, double x, double y, double delta, unsigned int sticky);
 };
 
+struct _NRArenaItemStats {
+	/* Clip and mask coverage rendered */
+	unsigned int clip_renders;
+	unsigned int mask_renders;
+	/* Coverage taken from cache instead */
+	unsigned int coverage_hits;
+	/* Renders clipped by plain area intersection */
+	unsigned int rect_clips;
+};
+
 #define NR_ARENA_ITEM_ARENA(ai) (((NRArenaItem *) (ai))->arena)
 
 NRType nr_arena_item_get_type (void);
@@ -144,10 +170,17 @@ unsigned int nr_arena_item_invoke_update (NRArenaItem *item, NRRectL *area, NRGC
 unsigned int nr_arena_item_invoke_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags);
 
 unsigned int nr_arena_item_invoke_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb);
+/*
+ * TRUE if clip coverage of item is fully opaque pixel-aligned rectangle,
+ * so clipping to it is just intersection with rect
+ */
+unsigned int nr_arena_item_get_clip_rect (NRArenaItem *item, NRRectL *rect);
 NRArenaItem *nr_arena_item_invoke_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky);
 
 void nr_arena_item_request_update (NRArenaItem *item, unsigned int reset, unsigned int propagate);
 void nr_arena_item_request_render (NRArenaItem *item);
+/* Drops coverage cached for clip or mask item */
+void nr_arena_item_invalidate_coverage (NRArenaItem *item);
 
 /* Public */
 
@@ -165,6 +198,10 @@ void nr_arena_item_set_clip (NRArenaItem *item, NRArenaItem *clip);
 void nr_arena_item_set_mask (NRArenaItem *item, NRArenaItem *mask);
 void nr_arena_item_set_order (NRArenaItem *item, int order);
 
+/* Clip and mask rendering counters, reset by caller once per frame */
+const NRArenaItemStats *nr_arena_item_get_stats (void);
+void nr_arena_item_reset_stats (void);
+
 /* Helpers */
 
 NRArenaItem *nr_arena_item_attach_ref (NRArenaItem *parent, NRArenaItem *child, NRArenaItem *prev, NRArenaItem *next);
@@ -13,9 +13,15 @@
  */
 
 
+#include "config.h"
+
 #include <math.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #include <glib.h>
+#include <libnr/nr-macros.h>
 #include <libnr/nr-rect.h>
 #include <libnr/nr-matrix.h>
 #include <libnr/nr-path.h>
@@ -23,6 +29,7 @@
 #include <libnr/nr-blit.h>
 #include <libnr/nr-stroke.h>
 #include <libnr/nr-svp-render.h>
+#include <libnr/nr-trace.h>
 
 #include <libnr/nr-svp-private.h>
 
@@ -49,10 +56,89 @@ static void nr_arena_shape_set_child_position (NRArenaItem *item, NRArenaItem *c
 static guint nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state, guint reset);
 static unsigned int nr_arena_shape_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigned int flags);
 static guint nr_arena_shape_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb);
+static unsigned int nr_arena_shape_clip_rect (NRArenaItem *item, NRRectL *rect);
 static NRArenaItem *nr_arena_shape_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky);
 
+static void nr_arena_shape_release_svps (NRArenaShape *shape);
+static void nr_arena_shape_release_draft (NRArenaShape *shape);
+static void nr_arena_shape_release_painters (NRArenaShape *shape);
+static void nr_arena_shape_build (NRArenaShape *shape, NRGC *gc);
+static void nr_arena_shape_commit (NRArenaShape *shape, NRGC *gc, unsigned int beststate);
+static void nr_arena_shape_render_mask (NRArenaShape *shape, NRPixBlock *m, NRSVP *svp, NRRectL *area);
+static unsigned int nr_arena_shape_update_draft (NRArenaShape *shape, NRGC *gc, unsigned int beststate);
+static unsigned int nr_arena_shape_render_draft (NRArenaShape *shape, NRRectL *area, NRPixBlock *pb, unsigned int flags);
+
+#define NR_ARENA_SHAPE_FILL 0
+#define NR_ARENA_SHAPE_STROKE 1
+
+/* Draft stroke width in pixels */
+#define NR_ARENA_SHAPE_DRAFT_HAIRLINE 1.0
+
+/* Translation is snapped to the grid svp coordinates are quantized to anyway */
+#define NR_ARENA_SHAPE_SNAP_X(v) (floor (NR_QUANT_X * (v) + 0.5) / NR_QUANT_X)
+#define NR_ARENA_SHAPE_SNAP_Y(v) (floor (NR_QUANT_Y * (v) + 0.5) / NR_QUANT_Y)
+
+struct _NRArenaShapeGeometry {
+	unsigned int refcount;
+	unsigned int hash;
+	/* Key */
+	unsigned int type;
+	/* Referenced, matched by identity rather than content */
+	SPCurve *curve;
+	unsigned int generation;
+	/* Linear part and subpixel translation */
+	double c[6];
+	unsigned int windrule;
+	float width;
+	unsigned int cap, join;
+	float miterlimit;
+	/* Flattened geometry */
+	NRSVP *svp;
+	size_t size;
+};
+
+/* Parallel update */
+
+typedef struct _NRArenaShapeJob NRArenaShapeJob;
+typedef struct _NRArenaShapeBatch NRArenaShapeBatch;
+
+struct _NRArenaShapeJob {
+	unsigned int type;
+	ArtBpath *bpath;
+	NRMatrixD transform;
+	SPStyle *style;
+	/* Result goes here */
+	NRSVP **svp;
+	/* Geometry owning svp, NULL if private */
+	NRArenaShapeGeometry *geometry;
+};
+
+struct _NRArenaShapeBatch {
+	GArray *jobs;
+	/* Next job to take, and workers not finished yet */
+	unsigned int next;
+	unsigned int running;
+	GMutex *mutex;
+	GCond *cond;
+};
+
+/* Fewer jobs than that are not worth waking workers */
+#define NR_ARENA_SHAPE_PARALLEL_MIN 32
+/* Jobs taken by worker at once */
+#define NR_ARENA_SHAPE_PARALLEL_CHUNK 8
+
 static NRArenaItemClass *shape_parent_class;
 
+static unsigned int shape_instancing = TRUE;
+static GHashTable *geometry_table = NULL;
+static GTimer *build_timer = NULL;
+static NRArenaShapeStats shape_stats = {0, 0.0, 0, 0, 0, 0, 0, 0, 0};
+
+static unsigned int shape_threads = 1;
+static GThreadPool *shape_pool = NULL;
+/* Set while first pass of parallel update collects jobs */
+static NRArenaShapeBatch *shape_batch = NULL;
+
 NRType
 nr_arena_shape_get_type (void)
 {
@@ -88,6 +174,7 @@ nr_arena_shape_class_init (NRArenaShapeClass *klass)
 	item_class->update = nr_arena_shape_update;
 	item_class->render = nr_arena_shape_render;
 	item_class->clip = nr_arena_shape_clip;
+	item_class->clip_rect = nr_arena_shape_clip_rect;
 	item_class->pick = nr_arena_shape_pick;
 }
 
@@ -104,6 +191,12 @@ nr_arena_shape_init (NRArenaShape *shape)
 	shape->stroke_painter = NULL;
 	shape->fill_svp = NULL;
 	shape->stroke_svp = NULL;
+	shape->fill_geometry = NULL;
+	shape->stroke_geometry = NULL;
+	shape->dx = shape->dy = 0;
+	shape->prepared = FALSE;
+	shape->draft_fill_svp = NULL;
+	shape->draft_stroke_svp = NULL;
 }
 
 static void
@@ -119,8 +212,8 @@ nr_arena_shape_finalize (NRObject *object)
 		shape->markers = nr_arena_item_detach_unref (item, shape->markers);
 	}
 
-	if (shape->fill_svp) nr_svp_free (shape->fill_svp);
-	if (shape->stroke_svp) nr_svp_free (shape->stroke_svp);
+	nr_arena_shape_release_svps (shape);
+	nr_arena_shape_release_draft (shape);
 	if (shape->fill_painter) sp_painter_free (shape->fill_painter);
 	if (shape->stroke_painter) sp_painter_free (shape->stroke_painter);
 	if (shape->style) sp_style_unref (shape->style);
@@ -199,17 +292,363 @@ nr_arena_shape_set_child_position (NRArenaItem *item, NRArenaItem *child, NRAren
 
 #include "enums.h"
 
+/* Flattened geometry */
+
+static unsigned int
+nr_arena_shape_svp_points (NRSVP *svp)
+{
+	unsigned int i, npoints;
+
+	npoints = 0;
+	for (i = 0; i < svp->length; i++) {
+		if (!NR_SVPSEG_IS_FLAT (svp, i)) {
+			unsigned int end;
+			end = svp->segments[i].start + svp->segments[i].length;
+			if (end > npoints) npoints = end;
+		}
+	}
+
+	return npoints;
+}
+
+static size_t
+nr_arena_shape_svp_size (NRSVP *svp)
+{
+	return sizeof (NRSVP) + svp->length * sizeof (NRSVPSegment) + nr_arena_shape_svp_points (svp) * sizeof (NRPointF);
+}
+
+/*
+ * Flattens path into svp; touches no shared state, so it may run in
+ * worker threads (svl allocators are thread local)
+ */
+
+static NRSVP *
+nr_arena_shape_svp_build (unsigned int type, ArtBpath *bpath, const NRMatrixD *transform, SPStyle *style)
+{
+	NRSVL *svl;
+	NRSVP *svp;
+	double trace = 0.0;
+
+	NR_TRACE_BEGIN (trace, "svp-build");
+	if (type == NR_ARENA_SHAPE_FILL) {
+		NRMatrixF ctmf;
+		unsigned int windrule;
+		nr_matrix_f_from_d (&ctmf, transform);
+		windrule = (style->fill_rule.value == SP_WIND_RULE_EVENODD) ? NR_WIND_RULE_EVENODD : NR_WIND_RULE_NONZERO;
+		svl = nr_svl_from_art_bpath (bpath, &ctmf, windrule, TRUE, NR_FLATNESS_NORMAL);
+	} else {
+		NRBPath bp;
+		float width, scale;
+		scale = NR_MATRIX_DF_EXPANSION (transform);
+		width = MAX (0.125, style->stroke_width.computed * scale);
+		bp.path = art_bpath_affine_transform (bpath, NR_MATRIX_D_TO_DOUBLE (transform));
+		if (!style->stroke_dash.n_dash) {
+			svl = nr_bpath_stroke (&bp, NULL, width,
+					       style->stroke_linecap.value,
+					       style->stroke_linejoin.value,
+					       style->stroke_miterlimit.value * M_PI / 180.0,
+					       NR_FLATNESS_NORMAL);
+		} else {
+			double dlen;
+			int i;
+			ArtVpath *vp, *pvp;
+			ArtSVP *asvp;
+			vp = art_bez_path_to_vec (bp.path, NR_FLATNESS_NORMAL);
+			pvp = art_vpath_perturb (vp);
+			art_free (vp);
+			dlen = 0.0;
+			for (i = 0; i < style->stroke_dash.n_dash; i++) dlen += style->stroke_dash.dash[i] * scale;
+			if (dlen >= 1.0) {
+				ArtVpathDash dash;
+				int i;
+				dash.offset = style->stroke_dash.offset * scale;
+				dash.n_dash = style->stroke_dash.n_dash;
+				dash.dash = g_new (double, dash.n_dash);
+				for (i = 0; i < dash.n_dash; i++) {
+					dash.dash[i] = style->stroke_dash.dash[i] * scale;
+				}
+				vp = art_vpath_dash (pvp, &dash);
+				art_free (pvp);
+				pvp = vp;
+				g_free (dash.dash);
+			}
+			asvp = art_svp_vpath_stroke (pvp,
+						     (ArtPathStrokeJoinType)style->stroke_linejoin.value,
+						     (ArtPathStrokeCapType)style->stroke_linecap.value,
+						     width,
+						     style->stroke_miterlimit.value, NR_FLATNESS_NORMAL);
+			art_free (pvp);
+			svl = nr_svl_from_art_svp (asvp);
+			art_svp_free (asvp);
+		}
+		art_free (bp.path);
+	}
+
+	svp = nr_svp_from_svl (svl, NULL);
+	nr_svl_free_list (svl);
+	NR_TRACE_END (trace, "svp-build");
+	NR_TRACE_COUNT ("svp-vertices", nr_arena_shape_svp_points (svp));
+
+	return svp;
+}
+
+/*
+ * Builds svp into *svp, or only queues job for it during first pass of
+ * parallel update
+ */
+
+static void
+nr_arena_shape_svp_new (NRSVP **svp, NRArenaShapeGeometry *geometry,
+			unsigned int type, ArtBpath *bpath, const NRMatrixD *transform, SPStyle *style)
+{
+	if (shape_batch) {
+		NRArenaShapeJob job;
+		job.type = type;
+		job.bpath = bpath;
+		job.transform = *transform;
+		job.style = style;
+		job.svp = svp;
+		job.geometry = geometry;
+		g_array_append_val (shape_batch->jobs, job);
+		*svp = NULL;
+		return;
+	}
+
+	if (!build_timer) build_timer = g_timer_new ();
+	g_timer_start (build_timer);
+
+	*svp = nr_arena_shape_svp_build (type, bpath, transform, style);
+
+	g_timer_stop (build_timer);
+	shape_stats.build_time += g_timer_elapsed (build_timer, NULL);
+	shape_stats.builds += 1;
+}
+
+/* Adds memory of newly built svp to statistics */
+
+static void
+nr_arena_shape_account_svp (NRSVP *svp, NRArenaShapeGeometry *geometry)
+{
+	unsigned int npoints;
+	size_t size;
+
+	npoints = nr_arena_shape_svp_points (svp);
+	shape_stats.vertices += npoints;
+	shape_stats.update_vertices += npoints;
+
+	size = nr_arena_shape_svp_size (svp);
+	if (geometry) {
+		geometry->size = size;
+		/* Every holder would have own copy if expanded */
+		shape_stats.expanded_bytes += size * geometry->refcount;
+	} else {
+		shape_stats.expanded_bytes += size;
+	}
+	shape_stats.svp_bytes += size;
+}
+
+static unsigned int
+nr_arena_shape_hash_double (unsigned int h, double v)
+{
+	unsigned int w[sizeof (double) / sizeof (unsigned int)];
+	unsigned int i;
+
+	/* Negative zero compares equal, so has to hash equal too */
+	if (v == 0.0) v = 0.0;
+	memcpy (w, &v, sizeof (double));
+	for (i = 0; i < sizeof (double) / sizeof (unsigned int); i++) h = h * 31 + w[i];
+
+	return h;
+}
+
+static guint
+nr_arena_shape_geometry_hash (gconstpointer key)
+{
+	return ((const NRArenaShapeGeometry *) key)->hash;
+}
+
+static gboolean
+nr_arena_shape_geometry_equal (gconstpointer a, gconstpointer b)
+{
+	const NRArenaShapeGeometry *ga, *gb;
+	unsigned int i;
+
+	ga = (const NRArenaShapeGeometry *) a;
+	gb = (const NRArenaShapeGeometry *) b;
+
+	if ((ga->hash != gb->hash) || (ga->type != gb->type) ||
+	    (ga->curve != gb->curve) || (ga->generation != gb->generation)) return FALSE;
+	for (i = 0; i < 6; i++) if (ga->c[i] != gb->c[i]) return FALSE;
+	if ((ga->windrule != gb->windrule) || (ga->width != gb->width) || (ga->cap != gb->cap) ||
+	    (ga->join != gb->join) || (ga->miterlimit != gb->miterlimit)) return FALSE;
+
+	return TRUE;
+}
+
+/*
+ * Returns referenced geometry of curve in given type and style, flattening
+ * it only if no other shape uses the same. Views of one object, clones of
+ * typed paths and marker instances hold the same SPCurve, so it is matched
+ * by pointer and generation; hashing the whole bpath would cost as much on
+ * every update as it saves.
+ */
+
+static NRArenaShapeGeometry *
+nr_arena_shape_geometry_get (unsigned int type, SPCurve *curve, const NRMatrixD *transform, SPStyle *style)
+{
+	NRArenaShapeGeometry key, *geometry;
+	unsigned int h, i;
+
+	if (!geometry_table) geometry_table = g_hash_table_new (nr_arena_shape_geometry_hash, nr_arena_shape_geometry_equal);
+
+	key.type = type;
+	key.curve = curve;
+	key.generation = curve->generation;
+	for (i = 0; i < 6; i++) key.c[i] = transform->c[i];
+	if (type == NR_ARENA_SHAPE_FILL) {
+		key.windrule = style->fill_rule.value;
+		key.width = 0.0;
+		key.cap = key.join = 0;
+		key.miterlimit = 0.0;
+	} else {
+		key.windrule = 0;
+		key.width = MAX (0.125, style->stroke_width.computed * NR_MATRIX_DF_EXPANSION (transform));
+		key.cap = style->stroke_linecap.value;
+		key.join = style->stroke_linejoin.value;
+		key.miterlimit = style->stroke_miterlimit.value;
+	}
+
+	h = type * 31 + GPOINTER_TO_UINT (curve);
+	h = h * 31 + key.generation;
+	for (i = 0; i < 6; i++) h = nr_arena_shape_hash_double (h, key.c[i]);
+	h = nr_arena_shape_hash_double (h, key.width);
+	key.hash = h;
+
+	shape_stats.lookups += 1;
+
+	geometry = (NRArenaShapeGeometry *) g_hash_table_lookup (geometry_table, &key);
+	if (geometry) {
+		shape_stats.hits += 1;
+		shape_stats.expanded_bytes += geometry->size;
+		geometry->refcount += 1;
+		return geometry;
+	}
+
+	geometry = g_new (NRArenaShapeGeometry, 1);
+	*geometry = key;
+	geometry->refcount = 1;
+	/* Keeps pointer from being reused by another curve while in table */
+	sp_curve_ref (curve);
+	geometry->size = 0;
+
+	g_hash_table_insert (geometry_table, geometry, geometry);
+	shape_stats.svps += 1;
+
+	nr_arena_shape_svp_new (&geometry->svp, geometry, type, curve->bpath, transform, style);
+	/* Queued svp is accounted when built */
+	if (geometry->svp) nr_arena_shape_account_svp (geometry->svp, geometry);
+
+	return geometry;
+}
+
+static void
+nr_arena_shape_geometry_unref (NRArenaShapeGeometry *geometry)
+{
+	shape_stats.expanded_bytes -= geometry->size;
+
+	geometry->refcount -= 1;
+	if (geometry->refcount < 1) {
+		g_hash_table_remove (geometry_table, geometry);
+		shape_stats.svps -= 1;
+		shape_stats.svp_bytes -= geometry->size;
+		nr_svp_free (geometry->svp);
+		sp_curve_unref (geometry->curve);
+		g_free (geometry);
+	}
+}
+
+static void
+nr_arena_shape_private_svp_new (NRSVP **svp, unsigned int type, ArtBpath *bpath, const NRMatrixD *transform, SPStyle *style)
+{
+	shape_stats.svps += 1;
+
+	nr_arena_shape_svp_new (svp, NULL, type, bpath, transform, style);
+	if (*svp) nr_arena_shape_account_svp (*svp, NULL);
+}
+
+static void
+nr_arena_shape_private_svp_free (NRSVP *svp)
+{
+	size_t size;
+
+	size = nr_arena_shape_svp_size (svp);
+	shape_stats.svps -= 1;
+	shape_stats.svp_bytes -= size;
+	shape_stats.expanded_bytes -= size;
+
+	nr_svp_free (svp);
+}
+
+static void
+nr_arena_shape_release_svps (NRArenaShape *shape)
+{
+	if (shape->fill_geometry) {
+		nr_arena_shape_geometry_unref (shape->fill_geometry);
+		shape->fill_geometry = NULL;
+	} else if (shape->fill_svp) {
+		nr_arena_shape_private_svp_free (shape->fill_svp);
+	}
+	shape->fill_svp = NULL;
+
+	if (shape->stroke_geometry) {
+		nr_arena_shape_geometry_unref (shape->stroke_geometry);
+		shape->stroke_geometry = NULL;
+	} else if (shape->stroke_svp) {
+		nr_arena_shape_private_svp_free (shape->stroke_svp);
+	}
+	shape->stroke_svp = NULL;
+}
+
+static void
+nr_arena_shape_release_draft (NRArenaShape *shape)
+{
+	if (shape->draft_fill_svp) {
+		nr_svp_free (shape->draft_fill_svp);
+		shape->draft_fill_svp = NULL;
+	}
+	if (shape->draft_stroke_svp) {
+		nr_svp_free (shape->draft_stroke_svp);
+		shape->draft_stroke_svp = NULL;
+	}
+}
+
+/*
+ * Sets up mask of area, rendering svp moved by shape integer translation
+ */
+
+static void
+nr_arena_shape_render_mask (NRArenaShape *shape, NRPixBlock *m, NRSVP *svp, NRRectL *area)
+{
+	nr_pixblock_setup_fast (m, NR_PIXBLOCK_MODE_A8,
+				area->x0 - shape->dx, area->y0 - shape->dy,
+				area->x1 - shape->dx, area->y1 - shape->dy, TRUE);
+	nr_pixblock_render_svp_mask_or (m, svp);
+	/* Same pixels, now in arena coordinates */
+	m->area.x0 = area->x0;
+	m->area.y0 = area->y0;
+	m->area.x1 = area->x1;
+	m->area.y1 = area->y1;
+}
+
 static guint
 nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state, guint reset)
 {
 	NRArenaShape *shape;
 	NRArenaItem *child;
-	SPStyle *style;
 	NRRectF bbox;
 	unsigned int newstate, beststate;
 
 	shape = NR_ARENA_SHAPE (item);
-	style = shape->style;
 
 	beststate = NR_ARENA_ITEM_STATE_ALL;
 
@@ -218,6 +657,11 @@ nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state,
 		beststate = beststate & newstate;
 	}
 
+	if (!(state & NR_ARENA_ITEM_STATE_RENDER) && (state & NR_ARENA_ITEM_STATE_DRAFT)) {
+		/* Coarse structures only */
+		return nr_arena_shape_update_draft (shape, gc, beststate);
+	}
+
 	if (!(state & NR_ARENA_ITEM_STATE_RENDER)) {
 		/* We do not have to create rendering structures */
 		shape->ctm = gc->transform;
@@ -245,26 +689,45 @@ nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state,
 		return (state | item->state);
 	}
 
-	/* Request repaint old area if needed */
-	/* fixme: Think about it a bit (Lauris) */
-	/* fixme: Thios is only needed, if actually rendered/had svp (Lauris) */
-	if (!nr_rect_l_test_empty (&item->bbox)) {
-		nr_arena_request_render_rect (item->arena, &item->bbox);
-		nr_rect_l_set_empty (&item->bbox);
-	}
+	if (!shape->prepared) {
+		/* Request repaint old area if needed */
+		/* fixme: Think about it a bit (Lauris) */
+		/* fixme: Thios is only needed, if actually rendered/had svp (Lauris) */
+		if (!nr_rect_l_test_empty (&item->bbox)) {
+			nr_arena_request_render_rect (item->arena, &item->bbox);
+			nr_rect_l_set_empty (&item->bbox);
+		}
+
+		/* Release state data */
+		nr_arena_shape_release_svps (shape);
+		nr_arena_shape_release_painters (shape);
+		nr_arena_shape_release_draft (shape);
 
-	/* Release state data */
-	if (TRUE || !nr_matrix_d_test_transform_equal (&gc->transform, &shape->ctm, NR_EPSILON_D)) {
-		/* Concept test */
-		if (shape->fill_svp) {
-			nr_svp_free (shape->fill_svp);
-			shape->fill_svp = NULL;
+		/* Markers may still wait for second pass of parallel update */
+		if (!shape->curve || !shape->style) return NR_ARENA_ITEM_STATE_ALL & (beststate | ~NR_ARENA_ITEM_STATE_RENDER);
+		if (sp_curve_is_empty (shape->curve)) return NR_ARENA_ITEM_STATE_ALL & (beststate | ~NR_ARENA_ITEM_STATE_RENDER);
+		if ((shape->style->fill.type == SP_PAINT_TYPE_NONE) && (shape->style->stroke.type == SP_PAINT_TYPE_NONE)) {
+			return NR_ARENA_ITEM_STATE_ALL & (beststate | ~NR_ARENA_ITEM_STATE_RENDER);
+		}
+
+		nr_arena_shape_build (shape, gc);
+
+		if (shape_batch) {
+			/* Workers build svps now, bbox is set by second pass */
+			shape->prepared = TRUE;
+			return NR_ARENA_ITEM_STATE_ALL & ~(NR_ARENA_ITEM_STATE_BBOX | NR_ARENA_ITEM_STATE_RENDER);
 		}
 	}
-	if (shape->stroke_svp) {
-		nr_svp_free (shape->stroke_svp);
-		shape->stroke_svp = NULL;
-	}
+
+	shape->prepared = FALSE;
+	nr_arena_shape_commit (shape, gc, beststate);
+
+	return NR_ARENA_ITEM_STATE_ALL & (beststate | ~NR_ARENA_ITEM_STATE_RENDER);
+}
+
+static void
+nr_arena_shape_release_painters (NRArenaShape *shape)
+{
 	if (shape->fill_painter) {
 		sp_painter_free (shape->fill_painter);
 		shape->fill_painter = NULL;
@@ -273,89 +736,74 @@ nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state,
 		sp_painter_free (shape->stroke_painter);
 		shape->stroke_painter = NULL;
 	}
+}
 
-	if (!shape->curve || !shape->style) return NR_ARENA_ITEM_STATE_ALL;
-	if (sp_curve_is_empty (shape->curve)) return NR_ARENA_ITEM_STATE_ALL;
-	if ((shape->style->fill.type == SP_PAINT_TYPE_NONE) && (shape->style->stroke.type == SP_PAINT_TYPE_NONE)) return NR_ARENA_ITEM_STATE_ALL;
+/*
+ * Gets svps of shape, either by building them or from shared geometry;
+ * during parallel update they are only queued
+ */
+
+static void
+nr_arena_shape_build (NRArenaShape *shape, NRGC *gc)
+{
+	SPStyle *style;
+	NRMatrixD t;
+
+	style = shape->style;
+
+	/* Geometry is built at subpixel part of translation and moved by whole pixels */
+	t = gc->transform;
+	if (shape_instancing) {
+		double tx, ty;
+		tx = floor (t.c[4]);
+		ty = floor (t.c[5]);
+		shape->dx = (int) tx;
+		shape->dy = (int) ty;
+		t.c[4] = NR_ARENA_SHAPE_SNAP_X (t.c[4] - tx);
+		t.c[5] = NR_ARENA_SHAPE_SNAP_Y (t.c[5] - ty);
+	} else {
+		shape->dx = shape->dy = 0;
+	}
 
 	/* Build state data */
-	if (shape->style->fill.type != SP_PAINT_TYPE_NONE) {
+	if (style->fill.type != SP_PAINT_TYPE_NONE) {
 		if ((shape->curve->end > 2) || (shape->curve->bpath[1].code == ART_CURVETO)) {
-			if (TRUE || !shape->fill_svp) {
-				NRMatrixF ctmf;
-				NRSVL *svl;
-				unsigned int windrule;
-				nr_matrix_f_from_d (&ctmf, &gc->transform);
-				windrule = (shape->style->fill_rule.value == SP_WIND_RULE_EVENODD) ? NR_WIND_RULE_EVENODD : NR_WIND_RULE_NONZERO;
-				svl = nr_svl_from_art_bpath (shape->curve->bpath, &ctmf, windrule, TRUE, 0.25);
-				shape->fill_svp = nr_svp_from_svl (svl, NULL);
-				nr_svl_free_list (svl);
-			} else if (!NR_MATRIX_DF_TEST_TRANSLATE_CLOSE (&gc->transform, &NR_MATRIX_D_IDENTITY, NR_EPSILON_D)) {
-#if 0
-				ArtSVP *svpa;
-				/* Concept test */
-				svpa = art_svp_translate (shape->fill_svp,
-							  gc->transform.c[4] - shape->ctm.c[4],
-							  gc->transform.c[5] - shape->ctm.c[5]);
-				art_svp_free (shape->fill_svp);
-				shape->fill_svp = svpa;
-#endif
+			if (shape_instancing) {
+				shape->fill_geometry = nr_arena_shape_geometry_get (NR_ARENA_SHAPE_FILL, shape->curve, &t, style);
+				shape->fill_svp = shape->fill_geometry->svp;
+			} else {
+				nr_arena_shape_private_svp_new (&shape->fill_svp, NR_ARENA_SHAPE_FILL, shape->curve->bpath, &t, style);
 			}
 			shape->ctm = gc->transform;
 		}
 	}
 
 	if (style->stroke.type != SP_PAINT_TYPE_NONE) {
-
-		NRBPath bp;
-		float width, scale;
-		NRSVL *svl;
-		scale = NR_MATRIX_DF_EXPANSION (&gc->transform);
-		width = MAX (0.125, style->stroke_width.computed * scale);
-		bp.path = art_bpath_affine_transform (shape->curve->bpath, NR_MATRIX_D_TO_DOUBLE (&gc->transform));
-		if (!style->stroke_dash.n_dash) {
-			svl = nr_bpath_stroke (&bp, NULL, width,
-					       shape->style->stroke_linecap.value,
-					       shape->style->stroke_linejoin.value,
-					       shape->style->stroke_miterlimit.value * M_PI / 180.0,
-					       0.25);
+		/* Dash pattern is not part of geometry key */
+		if (shape_instancing && !style->stroke_dash.n_dash) {
+			shape->stroke_geometry = nr_arena_shape_geometry_get (NR_ARENA_SHAPE_STROKE, shape->curve, &t, style);
+			shape->stroke_svp = shape->stroke_geometry->svp;
 		} else {
-			double dlen;
-			int i;
-			ArtVpath *vp, *pvp;
-			ArtSVP *asvp;
-			vp = art_bez_path_to_vec (bp.path, 0.25);
-			pvp = art_vpath_perturb (vp);
-			art_free (vp);
-			dlen = 0.0;
-			for (i = 0; i < style->stroke_dash.n_dash; i++) dlen += style->stroke_dash.dash[i] * scale;
-			if (dlen >= 1.0) {
-				ArtVpathDash dash;
-				int i;
-				dash.offset = style->stroke_dash.offset * scale;
-				dash.n_dash = style->stroke_dash.n_dash;
-				dash.dash = g_new (double, dash.n_dash);
-				for (i = 0; i < dash.n_dash; i++) {
-					dash.dash[i] = style->stroke_dash.dash[i] * scale;
-				}
-				vp = art_vpath_dash (pvp, &dash);
-				art_free (pvp);
-				pvp = vp;
-				g_free (dash.dash);
-			}
-			asvp = art_svp_vpath_stroke (pvp,
-						     (ArtPathStrokeJoinType)shape->style->stroke_linejoin.value,
-						     (ArtPathStrokeCapType)shape->style->stroke_linecap.value,
-						     width,
-						     shape->style->stroke_miterlimit.value, 0.25);
-			art_free (pvp);
-			svl = nr_svl_from_art_svp (asvp);
-			art_svp_free (asvp);
+			nr_arena_shape_private_svp_new (&shape->stroke_svp, NR_ARENA_SHAPE_STROKE, shape->curve->bpath, &t, style);
 		}
-		shape->stroke_svp = nr_svp_from_svl (svl, NULL);
-		nr_svl_free_list (svl);
-		art_free (bp.path);
 	}
+}
+
+/*
+ * Sets bbox and painters from built svps
+ */
+
+static void
+nr_arena_shape_commit (NRArenaShape *shape, NRGC *gc, unsigned int beststate)
+{
+	NRArenaItem *item, *child;
+	NRRectF bbox;
+
+	item = NR_ARENA_ITEM (shape);
+
+	/* Shared geometry may have been finished by workers */
+	if (shape->fill_geometry) shape->fill_svp = shape->fill_geometry->svp;
+	if (shape->stroke_geometry) shape->stroke_svp = shape->stroke_geometry->svp;
 
 	bbox.x0 = bbox.y0 = bbox.x1 = bbox.y1 = 0.0;
 	if (shape->stroke_svp && shape->stroke_svp->length > 0) {
@@ -364,8 +812,12 @@ nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state,
 	if (shape->fill_svp && shape->fill_svp->length > 0) {
 		nr_svp_bbox (shape->fill_svp, &bbox, FALSE);
 	}
-	if (nr_rect_f_test_empty (&bbox)) return NR_ARENA_ITEM_STATE_ALL;
+	if (nr_rect_f_test_empty (&bbox)) return;
 
+	bbox.x0 += shape->dx;
+	bbox.y0 += shape->dy;
+	bbox.x1 += shape->dx;
+	bbox.y1 += shape->dy;
 	item->bbox.x0 = (NRLong)(bbox.x0 - 1.0F);
 	item->bbox.y0 = (NRLong)(bbox.y0 - 1.0F);
 	item->bbox.x1 = (NRLong)(bbox.x1 + 1.0F);
@@ -389,8 +841,6 @@ nr_arena_shape_update (NRArenaItem *item, NRRectL *area, NRGC *gc, guint state,
 			nr_rect_l_union (&item->bbox, &item->bbox, &child->bbox);
 		}
 	}
-
-	return NR_ARENA_ITEM_STATE_ALL;
 }
 
 static unsigned int
@@ -405,14 +855,15 @@ nr_arena_shape_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigne
 	if (!shape->curve) return item->state;
 	if (!shape->style) return item->state;
 
+	if (flags & NR_ARENA_ITEM_RENDER_DRAFT) return nr_arena_shape_render_draft (shape, area, pb, flags);
+
 	style = shape->style;
 
 	if (shape->fill_svp) {
 		NRPixBlock m;
 		guint32 rgba;
 
-		nr_pixblock_setup_fast (&m, NR_PIXBLOCK_MODE_A8, area->x0, area->y0, area->x1, area->y1, TRUE);
-		nr_pixblock_render_svp_mask_or (&m, shape->fill_svp);
+		nr_arena_shape_render_mask (shape, &m, shape->fill_svp, area);
 		m.empty = FALSE;
 
 		switch (style->fill.type) {
@@ -446,8 +897,7 @@ nr_arena_shape_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigne
 		NRPixBlock m;
 		guint32 rgba;
 
-		nr_pixblock_setup_fast (&m, NR_PIXBLOCK_MODE_A8, area->x0, area->y0, area->x1, area->y1, TRUE);
-		nr_pixblock_render_svp_mask_or (&m, shape->stroke_svp);
+		nr_arena_shape_render_mask (shape, &m, shape->stroke_svp, area);
 		m.empty = FALSE;
 
 		switch (style->stroke.type) {
@@ -487,6 +937,147 @@ nr_arena_shape_render (NRArenaItem *item, NRRectL *area, NRPixBlock *pb, unsigne
 	return item->state;
 }
 
+/*
+ * Builds coarse fill and hairline stroke, dropping full rendering state;
+ * shapes smaller than pixel get only bbox, as draft does not render them
+ */
+
+static unsigned int
+nr_arena_shape_update_draft (NRArenaShape *shape, NRGC *gc, unsigned int beststate)
+{
+	NRArenaItem *item, *child;
+	SPStyle *style;
+	NRMatrixF ctm;
+	NRRectF bbox;
+	NRBPath bp;
+	NRSVL *svl;
+
+	item = NR_ARENA_ITEM (shape);
+
+	if (!nr_rect_l_test_empty (&item->bbox)) {
+		nr_arena_request_render_rect (item->arena, &item->bbox);
+		nr_rect_l_set_empty (&item->bbox);
+	}
+
+	nr_arena_shape_release_svps (shape);
+	nr_arena_shape_release_painters (shape);
+	nr_arena_shape_release_draft (shape);
+	shape->prepared = FALSE;
+	shape->ctm = gc->transform;
+	shape->dx = shape->dy = 0;
+	item->render_opacity = TRUE;
+
+	if (!shape->curve || !shape->style || sp_curve_is_empty (shape->curve)) {
+		return NR_ARENA_ITEM_STATE_ALL & beststate & ~NR_ARENA_ITEM_STATE_RENDER;
+	}
+	style = shape->style;
+
+	bbox.x0 = bbox.y0 = NR_HUGE_F;
+	bbox.x1 = bbox.y1 = -NR_HUGE_F;
+	nr_matrix_f_from_d (&ctm, &gc->transform);
+	bp.path = shape->curve->bpath;
+	nr_path_matrix_f_bbox_f_union (&bp, &ctm, &bbox, 1.0);
+
+	if (((bbox.x1 - bbox.x0) >= 1.0F) || ((bbox.y1 - bbox.y0) >= 1.0F)) {
+		if ((style->fill.type != SP_PAINT_TYPE_NONE) &&
+		    ((shape->curve->end > 2) || (shape->curve->bpath[1].code == ART_CURVETO))) {
+			unsigned int windrule;
+			windrule = (style->fill_rule.value == SP_WIND_RULE_EVENODD) ? NR_WIND_RULE_EVENODD : NR_WIND_RULE_NONZERO;
+			svl = nr_svl_from_art_bpath (bp.path, &ctm, windrule, TRUE, NR_FLATNESS_DRAFT);
+			shape->draft_fill_svp = nr_svp_from_svl (svl, NULL);
+			nr_svl_free_list (svl);
+		}
+		if (style->stroke.type != SP_PAINT_TYPE_NONE) {
+			NRBPath tp;
+			tp.path = art_bpath_affine_transform (bp.path, NR_MATRIX_D_TO_DOUBLE (&gc->transform));
+			svl = nr_bpath_stroke (&tp, NULL, NR_ARENA_SHAPE_DRAFT_HAIRLINE,
+					       NR_STROKE_CAP_BUTT, NR_STROKE_JOIN_BEVEL, 0.0,
+					       NR_FLATNESS_DRAFT);
+			shape->draft_stroke_svp = nr_svp_from_svl (svl, NULL);
+			nr_svl_free_list (svl);
+			art_free (tp.path);
+		}
+	}
+
+	item->bbox.x0 = (NRLong)(bbox.x0 - 1.0F);
+	item->bbox.y0 = (NRLong)(bbox.y0 - 1.0F);
+	item->bbox.x1 = (NRLong)(bbox.x1 + 1.9999F);
+	item->bbox.y1 = (NRLong)(bbox.y1 + 1.9999F);
+	if (beststate & NR_ARENA_ITEM_STATE_BBOX) {
+		for (child = shape->markers; child != NULL; child = child->next) {
+			nr_rect_l_union (&item->bbox, &item->bbox, &child->bbox);
+		}
+	}
+	nr_arena_request_render_rect (item->arena, &item->bbox);
+
+	return NR_ARENA_ITEM_STATE_ALL & beststate & ~NR_ARENA_ITEM_STATE_RENDER;
+}
+
+/* Flat color of paint, paint servers give their average */
+
+static guint32
+nr_arena_shape_paint_rgba (SPIPaint *paint, float opacity)
+{
+	guint32 rgba;
+
+	if (paint->type == SP_PAINT_TYPE_COLOR) return sp_color_get_rgba32_falpha (&paint->value.color, opacity);
+
+	rgba = sp_paint_server_get_average (paint->value.server);
+
+	return (rgba & 0xffffff00) | (guint32) ((rgba & 0xff) * opacity + 0.5);
+}
+
+static unsigned int
+nr_arena_shape_render_draft (NRArenaShape *shape, NRRectL *area, NRPixBlock *pb, unsigned int flags)
+{
+	NRArenaItem *item, *child;
+	NRSVP *fill, *stroke;
+	SPStyle *style;
+	float opacity;
+
+	item = NR_ARENA_ITEM (shape);
+	style = shape->style;
+	/* Otherwise done by item */
+	opacity = (item->render_opacity) ? SP_SCALE24_TO_FLOAT (style->opacity.value) : 1.0;
+
+	/* Full geometry is as good, if present */
+	if (item->state & NR_ARENA_ITEM_STATE_RENDER) {
+		fill = shape->fill_svp;
+		stroke = shape->stroke_svp;
+	} else {
+		fill = shape->draft_fill_svp;
+		stroke = shape->draft_stroke_svp;
+	}
+
+	if (fill && (style->fill.type != SP_PAINT_TYPE_NONE)) {
+		NRPixBlock m;
+		nr_arena_shape_render_mask (shape, &m, fill, area);
+		m.empty = FALSE;
+		nr_blit_pixblock_mask_rgba32 (pb, &m, nr_arena_shape_paint_rgba (&style->fill,
+										 SP_SCALE24_TO_FLOAT (style->fill_opacity.value) * opacity));
+		pb->empty = FALSE;
+		nr_pixblock_release (&m);
+	}
+
+	if (stroke && (style->stroke.type != SP_PAINT_TYPE_NONE)) {
+		NRPixBlock m;
+		nr_arena_shape_render_mask (shape, &m, stroke, area);
+		m.empty = FALSE;
+		nr_blit_pixblock_mask_rgba32 (pb, &m, nr_arena_shape_paint_rgba (&style->stroke,
+										 SP_SCALE24_TO_FLOAT (style->stroke_opacity.value) * opacity));
+		pb->empty = FALSE;
+		nr_pixblock_release (&m);
+	}
+
+	for (child = shape->markers; child != NULL; child = child->next) {
+		unsigned int ret;
+		ret = nr_arena_item_invoke_render (child, area, pb, flags);
+		if (ret & NR_ARENA_ITEM_STATE_INVALID) return ret;
+	}
+
+	return item->state;
+}
+
 static guint
 nr_arena_shape_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 {
@@ -501,8 +1092,7 @@ nr_arena_shape_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 		int x, y;
 
 		/* fixme: We can OR in one step (Lauris) */
-		nr_pixblock_setup_fast (&m, NR_PIXBLOCK_MODE_A8, area->x0, area->y0, area->x1, area->y1, TRUE);
-		nr_pixblock_render_svp_mask_or (&m, shape->fill_svp);
+		nr_arena_shape_render_mask (shape, &m, shape->fill_svp, area);
 
 		for (y = area->y0; y < area->y1; y++) {
 			unsigned char *s, *d;
@@ -521,6 +1111,52 @@ nr_arena_shape_clip (NRArenaItem *item, NRRectL *area, NRPixBlock *pb)
 	return item->state;
 }
 
+/* Corners closer than that to pixel grid render fully opaque edges */
+#define NR_ARENA_SHAPE_PIXEL_EPSILON 1e-3
+
+static unsigned int
+nr_arena_shape_clip_rect (NRArenaItem *item, NRRectL *rect)
+{
+	NRArenaShape *shape;
+	ArtBpath *bp;
+	int x[5], y[5];
+	int i, n;
+
+	shape = NR_ARENA_SHAPE (item);
+
+	if (!shape->curve || !shape->fill_svp) return FALSE;
+
+	/* Single subpath of 3 or 4 lines */
+	bp = shape->curve->bpath;
+	if ((bp[0].code != ART_MOVETO) && (bp[0].code != ART_MOVETO_OPEN)) return FALSE;
+	for (n = 1; bp[n].code == ART_LINETO; n++) {
+		if (n >= 5) return FALSE;
+	}
+	if ((bp[n].code != ART_END) || (n < 4)) return FALSE;
+
+	for (i = 0; i < n; i++) {
+		double px, py;
+		px = NR_MATRIX_DF_TRANSFORM_X (&shape->ctm, bp[i].x3, bp[i].y3);
+		py = NR_MATRIX_DF_TRANSFORM_Y (&shape->ctm, bp[i].x3, bp[i].y3);
+		if (!NR_DF_TEST_CLOSE (px, floor (px + 0.5), NR_ARENA_SHAPE_PIXEL_EPSILON)) return FALSE;
+		if (!NR_DF_TEST_CLOSE (py, floor (py + 0.5), NR_ARENA_SHAPE_PIXEL_EPSILON)) return FALSE;
+		x[i] = (int) floor (px + 0.5);
+		y[i] = (int) floor (py + 0.5);
+	}
+	if ((n == 5) && ((x[4] != x[0]) || (y[4] != y[0]))) return FALSE;
+
+	/* Edges have to alternate between horizontal and vertical */
+	if (!(((y[0] == y[1]) && (x[1] == x[2]) && (y[2] == y[3]) && (x[3] == x[0])) ||
+	      ((x[0] == x[1]) && (y[1] == y[2]) && (x[2] == x[3]) && (y[3] == y[0])))) return FALSE;
+
+	rect->x0 = MIN (x[0], x[2]);
+	rect->y0 = MIN (y[0], y[2]);
+	rect->x1 = MAX (x[0], x[2]);
+	rect->y1 = MAX (y[0], y[2]);
+
+	return !nr_rect_l_test_empty (rect);
+}
+
 static NRArenaItem *
 nr_arena_shape_pick (NRArenaItem *item, double x, double y, double delta, unsigned int sticky)
 {
@@ -533,17 +1169,17 @@ nr_arena_shape_pick (NRArenaItem *item, double x, double y, double delta, unsign
 
 	if (item->state & NR_ARENA_ITEM_STATE_RENDER) {
 		if (shape->fill_svp && (shape->style->fill.type != SP_PAINT_TYPE_NONE)) {
-			if (nr_svp_point_wind (shape->fill_svp, (float) x, (float) y)) return item;
+			if (nr_svp_point_wind (shape->fill_svp, (float) (x - shape->dx), (float) (y - shape->dy))) return item;
 		}
 		if (shape->stroke_svp && (shape->style->stroke.type != SP_PAINT_TYPE_NONE)) {
-			if (nr_svp_point_wind (shape->stroke_svp, (float) x, (float) y)) return item;
+			if (nr_svp_point_wind (shape->stroke_svp, (float) (x - shape->dx), (float) (y - shape->dy))) return item;
 		}
 		if (delta > 1e-3) {
 			if (shape->fill_svp && (shape->style->fill.type != SP_PAINT_TYPE_NONE)) {
-				if (nr_svp_point_distance (shape->fill_svp, (float) x, (float) y) <= delta) return item;
+				if (nr_svp_point_distance (shape->fill_svp, (float) (x - shape->dx), (float) (y - shape->dy)) <= delta) return item;
 			}
 			if (shape->stroke_svp && (shape->style->stroke.type != SP_PAINT_TYPE_NONE)) {
-				if (nr_svp_point_distance (shape->stroke_svp, (float) x, (float) y) <= delta) return item;
+				if (nr_svp_point_distance (shape->stroke_svp, (float) (x - shape->dx), (float) (y - shape->dy)) <= delta) return item;
 			}
 		}
 	} else {
@@ -608,12 +1244,15 @@ nr_arena_shape_set_path (NRArenaShape *shape, SPCurve *curve, unsigned int lieut
 		}
 	}
 
+	shape->prepared = FALSE;
+
 	nr_arena_item_request_update (NR_ARENA_ITEM (shape), NR_ARENA_ITEM_STATE_ALL, FALSE);
 }
 
 /** nr_arena_shape_set_style
  *
- * Unrefs any existing style and ref's to the given one, then requests an update of the arena
+ * Unrefs any existing style and ref's to the given one, then requests an update of the arena.
+ * Shared styles are immutable, so getting the same one again changes nothing.
  */
 void
 nr_arena_shape_set_style (NRArenaShape *shape, SPStyle *style)
@@ -621,10 +1260,14 @@ nr_arena_shape_set_style (NRArenaShape *shape, SPStyle *style)
 	g_return_if_fail (shape != NULL);
 	g_return_if_fail (NR_IS_ARENA_SHAPE (shape));
 
+	if (style && (style == shape->style) && SP_STYLE_IS_SHARED (style)) return;
+
 	if (style) sp_style_ref (style);
 	if (shape->style) sp_style_unref (shape->style);
 	shape->style = style;
 
+	shape->prepared = FALSE;
+
 	nr_arena_item_request_update (NR_ARENA_ITEM (shape), NR_ARENA_ITEM_STATE_ALL, FALSE);
 }
 
@@ -646,3 +1289,189 @@ nr_arena_shape_set_paintbox (NRArenaShape *shape, const NRRectF *pbox)
 	nr_arena_item_request_update (NR_ARENA_ITEM (shape), NR_ARENA_ITEM_STATE_ALL, FALSE);
 }
 
+
+/**
+ * Switches between shared (instanced) and per-shape (expanded) geometry;
+ * affects shapes updated afterwards
+ */
+void
+nr_arena_shape_set_instancing (unsigned int instance)
+{
+	shape_instancing = instance;
+}
+
+const NRArenaShapeStats *
+nr_arena_shape_get_stats (void)
+{
+	return &shape_stats;
+}
+
+/* Parallel update */
+
+static void
+nr_arena_shape_batch_work (NRArenaShapeBatch *batch)
+{
+	while (TRUE) {
+		unsigned int start, end, i;
+
+		g_mutex_lock (batch->mutex);
+		start = batch->next;
+		end = MIN (start + NR_ARENA_SHAPE_PARALLEL_CHUNK, batch->jobs->len);
+		batch->next = end;
+		g_mutex_unlock (batch->mutex);
+
+		if (start >= end) break;
+
+		for (i = start; i < end; i++) {
+			NRArenaShapeJob *job;
+			job = &g_array_index (batch->jobs, NRArenaShapeJob, i);
+			*job->svp = nr_arena_shape_svp_build (job->type, job->bpath, &job->transform, job->style);
+		}
+	}
+}
+
+static void
+nr_arena_shape_pool_func (gpointer data, gpointer user_data)
+{
+	NRArenaShapeBatch *batch;
+
+	batch = (NRArenaShapeBatch *) data;
+
+	nr_arena_shape_batch_work (batch);
+
+	g_mutex_lock (batch->mutex);
+	batch->running -= 1;
+	if (batch->running == 0) g_cond_signal (batch->cond);
+	g_mutex_unlock (batch->mutex);
+}
+
+static void
+nr_arena_shape_batch_run (NRArenaShapeBatch *batch)
+{
+	unsigned int i;
+
+	if (!batch->jobs->len) return;
+
+	if (!build_timer) build_timer = g_timer_new ();
+	g_timer_start (build_timer);
+
+	batch->next = 0;
+	if (shape_pool && (batch->jobs->len >= NR_ARENA_SHAPE_PARALLEL_MIN)) {
+		batch->mutex = g_mutex_new ();
+		batch->cond = g_cond_new ();
+		/* Main thread is one of the workers */
+		batch->running = shape_threads - 1;
+		for (i = 1; i < shape_threads; i++) {
+			g_thread_pool_push (shape_pool, batch, NULL);
+		}
+		nr_arena_shape_batch_work (batch);
+		g_mutex_lock (batch->mutex);
+		while (batch->running > 0) g_cond_wait (batch->cond, batch->mutex);
+		g_mutex_unlock (batch->mutex);
+		g_cond_free (batch->cond);
+		g_mutex_free (batch->mutex);
+	} else {
+		for (i = 0; i < batch->jobs->len; i++) {
+			NRArenaShapeJob *job;
+			job = &g_array_index (batch->jobs, NRArenaShapeJob, i);
+			*job->svp = nr_arena_shape_svp_build (job->type, job->bpath, &job->transform, job->style);
+		}
+	}
+
+	g_timer_stop (build_timer);
+	shape_stats.build_time += g_timer_elapsed (build_timer, NULL);
+	shape_stats.builds += batch->jobs->len;
+
+	/* Statistics are kept by main thread only, in job order */
+	for (i = 0; i < batch->jobs->len; i++) {
+		NRArenaShapeJob *job;
+		job = &g_array_index (batch->jobs, NRArenaShapeJob, i);
+		nr_arena_shape_account_svp (*job->svp, job->geometry);
+	}
+}
+
+/**
+ * Updates item tree like nr_arena_item_invoke_update, but flattens
+ * geometry of shapes in worker threads.
+ *
+ * First pass walks the tree serially and queues svp jobs for shapes that
+ * need them, leaving these shapes without bbox.  After workers have
+ * finished, second pass sets bboxes, painters and render requests in the
+ * same order serial update would.
+ */
+unsigned int
+nr_arena_shape_update_parallel (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigned int state, unsigned int reset)
+{
+	NRArenaShapeBatch batch;
+	unsigned int newstate;
+
+	g_return_val_if_fail (item != NULL, NR_ARENA_ITEM_STATE_INVALID);
+	g_return_val_if_fail (NR_IS_ARENA_ITEM (item), NR_ARENA_ITEM_STATE_INVALID);
+
+	if (!shape_batch) shape_stats.update_vertices = 0;
+
+	/* Nothing to flatten without render state */
+	if ((shape_threads < 2) || shape_batch || !(state & NR_ARENA_ITEM_STATE_RENDER)) {
+		return nr_arena_item_invoke_update (item, area, gc, state, reset);
+	}
+
+	batch.jobs = g_array_new (FALSE, FALSE, sizeof (NRArenaShapeJob));
+
+	shape_batch = &batch;
+	newstate = nr_arena_item_invoke_update (item, area, gc, state, reset);
+	shape_batch = NULL;
+
+	nr_arena_shape_batch_run (&batch);
+	g_array_free (batch.jobs, TRUE);
+
+	/* Reset was already done by first pass */
+	if (!(newstate & NR_ARENA_ITEM_STATE_INVALID)) {
+		newstate = nr_arena_item_invoke_update (item, area, gc, state, NR_ARENA_ITEM_STATE_NONE);
+	}
+
+	return newstate;
+}
+
+/**
+ * Sets number of threads flattening geometry in parallel update, including
+ * main one; 0 means number of processors, 1 disables workers
+ */
+void
+nr_arena_shape_set_threads (unsigned int n_threads)
+{
+	if (n_threads == 0) {
+		n_threads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+		if (sysconf (_SC_NPROCESSORS_ONLN) > 1) n_threads = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+	}
+
+#ifndef NR_HAVE_THREAD_LOCAL
+	/* Svl allocators would be shared */
+	n_threads = 1;
+#endif
+	if (!g_thread_supported ()) n_threads = 1;
+
+	if (shape_pool) {
+		g_thread_pool_free (shape_pool, FALSE, TRUE);
+		shape_pool = NULL;
+	}
+
+	shape_threads = n_threads;
+
+	if (shape_threads > 1) {
+		/* Exclusive threads live as long as pool, and so do their allocators */
+		shape_pool = g_thread_pool_new (nr_arena_shape_pool_func, NULL, shape_threads - 1, TRUE, NULL);
+		if (!shape_pool) shape_threads = 1;
+	}
+}
+
+/**
+ * Returns number of threads actually used, which may be fewer than
+ * requested if threads are unavailable
+ */
+unsigned int
+nr_arena_shape_get_threads (void)
+{
+	return shape_threads;
+}
@@ -25,6 +25,9 @@
 #include "sp-paint-server.h"
 #include "nr-arena-item.h"
 
+typedef struct _NRArenaShapeGeometry NRArenaShapeGeometry;
+typedef struct _NRArenaShapeStats NRArenaShapeStats;
+
 struct _NRArenaShape {
 	NRArenaItem item;
 	/* Shape data */
@@ -37,6 +40,16 @@ struct _NRArenaShape {
 	SPPainter *stroke_painter;
 	NRSVP *fill_svp;
 	NRSVP *stroke_svp;
+	/* Shared geometry owning svps, NULL if svp is private */
+	NRArenaShapeGeometry *fill_geometry;
+	NRArenaShapeGeometry *stroke_geometry;
+	/* Integer translation of svps relative to their geometry */
+	int dx, dy;
+	/* Svps were queued by parallel update, only bbox is left to set */
+	unsigned int prepared : 1;
+	/* Coarse geometry and hairline stroke, if only in draft state */
+	NRSVP *draft_fill_svp;
+	NRSVP *draft_stroke_svp;
 	/* Markers */
 	NRArenaItem *markers;
 };
@@ -45,10 +58,42 @@ struct _NRArenaShapeClass {
 	NRArenaItemClass parent_class;
 };
 
+struct _NRArenaShapeStats {
+	/* SVPs flattened, and seconds spent doing it */
+	unsigned int builds;
+	double build_time;
+	/* Svp vertices built, in total and by last update of tree */
+	unsigned int vertices;
+	unsigned int update_vertices;
+	/* Lookups of instanced geometry */
+	unsigned int lookups;
+	unsigned int hits;
+	/* Live SVPs, and memory held by them */
+	unsigned int svps;
+	size_t svp_bytes;
+	/* Memory live SVPs would need if every shape had its own copy */
+	size_t expanded_bytes;
+};
+
 NRType nr_arena_shape_get_type (void);
 
 void nr_arena_shape_set_path (NRArenaShape *shape, SPCurve *curve, unsigned int lieutenant, const double *affine);
 void nr_arena_shape_set_style (NRArenaShape *shape, SPStyle *style);
 void nr_arena_shape_set_paintbox (NRArenaShape *shape, const NRRectF *pbox);
 
+/*
+ * Instancing shares flattened geometry between shapes holding the same
+ * curve, style and transform up to translation (clones, markers)
+ */
+void nr_arena_shape_set_instancing (unsigned int instance);
+const NRArenaShapeStats *nr_arena_shape_get_stats (void);
+
+/*
+ * Same as nr_arena_item_invoke_update, but svps of all shapes in tree are
+ * built by worker threads; has to be called from main thread
+ */
+unsigned int nr_arena_shape_update_parallel (NRArenaItem *item, NRRectL *area, NRGC *gc, unsigned int state, unsigned int reset);
+void nr_arena_shape_set_threads (unsigned int n_threads);
+unsigned int nr_arena_shape_get_threads (void);
+
 #endif
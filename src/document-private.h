@@ -27,12 +27,28 @@ struct _SPDocumentPrivate {
 	/* It is GHashTable of GSLists */
 	GHashTable *resources;
 
+	/* Rules of all <style> elements, NULL if there are none */
+	SPStyleSheet *stylesheet;
+	guint stylesheet_dirty : 1; /* Has to be rebuilt from <style> elements */
+	guint restyle : 1; /* Objects have to reread styles */
+
+	/* Batch observers, and objects modified in current cycle */
+	GSList *batch_observers;
+	GArray *batch;
+	guint batch_flags;
+	guint batch_flushing; /* Observers removed meanwhile are only marked */
+
 	/* Undo/Redo state */
 	guint sensitive: 1; /* If we save actions to undo stack */
 	SPReprAction * partial; /* partial undo log when interrupted */
 	int history_size;
-	GSList * undo; /* Undo stack of reprs */
-	GSList * redo; /* Redo stack of reprs */
+	GSList * undo; /* Undo stack of steps (document-undo.c) */
+	GSList * redo; /* Redo stack of steps */
+	/* Approximate memory held by stacks, and data moved to spill file */
+	size_t undo_size, redo_size, spilled_size;
 };
 
+/* Records object for batch observers, called by sp_object_invoke_modified */
+void sp_document_batch_add (SPDocument *doc, SPObject *object, guint flags);
+
 #endif
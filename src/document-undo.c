@@ -30,6 +30,30 @@
 #include "document-private.h"
 #include "document.h"
 #include "selection.h"
+#include "prefs-utils.h"
+
+/* Defaults for options.undo, in megabytes */
+#define SP_DOCUMENT_UNDO_BUDGET 64
+#define SP_DOCUMENT_UNDO_SPILL_BUDGET 1024
+
+typedef struct _SPDocumentUndoStep SPDocumentUndoStep;
+
+/*
+ * Undo and redo lists hold steps.  Log size is counted when step is
+ * stored or changed, and the same amount is subtracted when it is moved
+ * or freed, as logs share values and subtrees with document tree and
+ * their size changes with them.
+ */
+struct _SPDocumentUndoStep {
+	SPReprAction *log;
+	size_t size;
+	size_t spilled;
+};
+
+static void sp_document_push_undo (SPDocument *doc, SPReprAction *log);
+static void sp_document_recount_step (SPDocument *doc, SPDocumentUndoStep *step, size_t *total);
+static void sp_document_free_step (SPDocument *doc, SPDocumentUndoStep *step);
+static void sp_document_enforce_undo_budget (SPDocument *doc);
 
 /*
  * Undo & redo
@@ -85,12 +109,24 @@ sp_document_maybe_done (SPDocument *doc, const gchar *key)
 	}
 
 	if (key && doc->actionkey && !strcmp (key, doc->actionkey) && doc->priv->undo) {
-		doc->priv->undo->data = sp_repr_coalesce_log ((SPReprAction *)doc->priv->undo->data, log);
+		SPDocumentUndoStep *step;
+		step = (SPDocumentUndoStep *) doc->priv->undo->data;
+		step->log = sp_repr_coalesce_log (step->log, log);
+		sp_document_recount_step (doc, step, &doc->priv->undo_size);
 	} else {
-		doc->priv->undo = g_slist_prepend (doc->priv->undo, log);
+		/* Previous step is final now, so it can be delta-encoded */
+		if (doc->priv->undo) {
+			SPDocumentUndoStep *prev;
+			prev = (SPDocumentUndoStep *) doc->priv->undo->data;
+			sp_repr_compact_log (prev->log);
+			sp_document_recount_step (doc, prev, &doc->priv->undo_size);
+		}
+		sp_document_push_undo (doc, log);
 		doc->priv->history_size++;
 	}
 
+	sp_document_enforce_undo_budget (doc);
+
 	doc->actionkey = key;
 
 	if (!sp_repr_attr (doc->rroot, "sodipodi:modified")) {
@@ -136,10 +172,13 @@ sp_document_undo (SPDocument *doc)
 		g_warning ("Undo aborted: last operation did not complete transaction");
 		doc->priv->partial = sp_repr_coalesce_log (doc->priv->partial, log);
 	} else if (doc->priv->undo) {
-		log = (SPReprAction *) doc->priv->undo->data;
-		doc->priv->undo = g_slist_remove (doc->priv->undo, log);
-		sp_repr_undo_log (log);
-		doc->priv->redo = g_slist_prepend (doc->priv->redo, log);
+		SPDocumentUndoStep *step;
+		step = (SPDocumentUndoStep *) doc->priv->undo->data;
+		doc->priv->undo = g_slist_remove (doc->priv->undo, step);
+		sp_repr_undo_log (step->log);
+		doc->priv->redo = g_slist_prepend (doc->priv->redo, step);
+		doc->priv->undo_size -= step->size;
+		doc->priv->redo_size += step->size;
 	}
 
 	sp_repr_begin_transaction (doc->rdoc);
@@ -168,10 +207,13 @@ sp_document_redo (SPDocument *doc)
 		g_warning ("Redo aborted: last operation did not complete transaction");
 		doc->priv->partial = sp_repr_coalesce_log (doc->priv->partial, log);
 	} else if (doc->priv->redo) {
-		log = (SPReprAction *) doc->priv->redo->data;
-		doc->priv->redo = g_slist_remove (doc->priv->redo, log);
-		sp_repr_replay_log (log);
-		doc->priv->undo = g_slist_prepend (doc->priv->undo, log);
+		SPDocumentUndoStep *step;
+		step = (SPDocumentUndoStep *) doc->priv->redo->data;
+		doc->priv->redo = g_slist_remove (doc->priv->redo, step);
+		sp_repr_replay_log (step->log);
+		doc->priv->undo = g_slist_prepend (doc->priv->undo, step);
+		doc->priv->redo_size -= step->size;
+		doc->priv->undo_size += step->size;
 	}
 
 	sp_repr_begin_transaction (doc->rdoc);
@@ -187,7 +229,8 @@ sp_document_clear_undo (SPDocument *doc)
 		doc->priv->undo = current->next;
 		doc->priv->history_size--;
 
-		sp_repr_free_log ((SPReprAction *)current->data);
+		doc->priv->undo_size -= ((SPDocumentUndoStep *) current->data)->size;
+		sp_document_free_step (doc, (SPDocumentUndoStep *) current->data);
 		g_slist_free_1 (current);
 	}
 }
@@ -202,8 +245,105 @@ sp_document_clear_redo (SPDocument *doc)
 		doc->priv->redo = current->next;
 		doc->priv->history_size--;
 
-		sp_repr_free_log ((SPReprAction *)current->data);
+		doc->priv->redo_size -= ((SPDocumentUndoStep *) current->data)->size;
+		sp_document_free_step (doc, (SPDocumentUndoStep *) current->data);
 		g_slist_free_1 (current);
 	}
 }
 
+void
+sp_document_get_undo_usage (SPDocument *doc, unsigned int *undo_steps, unsigned int *redo_steps,
+			    size_t *undo_size, size_t *redo_size, size_t *spilled_size)
+{
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (SP_IS_DOCUMENT (doc));
+
+	if (undo_steps) *undo_steps = g_slist_length (doc->priv->undo);
+	if (redo_steps) *redo_steps = g_slist_length (doc->priv->redo);
+	if (undo_size) *undo_size = doc->priv->undo_size;
+	if (redo_size) *redo_size = doc->priv->redo_size;
+	if (spilled_size) *spilled_size = doc->priv->spilled_size;
+}
+
+static void
+sp_document_push_undo (SPDocument *doc, SPReprAction *log)
+{
+	SPDocumentUndoStep *step;
+
+	step = g_new (SPDocumentUndoStep, 1);
+	step->log = log;
+	step->spilled = 0;
+	step->size = sp_repr_log_size (log, &step->spilled);
+	doc->priv->undo = g_slist_prepend (doc->priv->undo, step);
+	doc->priv->undo_size += step->size;
+	doc->priv->spilled_size += step->spilled;
+}
+
+/* Log of step changed, total is undo or redo size holding it */
+static void
+sp_document_recount_step (SPDocument *doc, SPDocumentUndoStep *step, size_t *total)
+{
+	*total -= step->size;
+	doc->priv->spilled_size -= step->spilled;
+	step->spilled = 0;
+	step->size = sp_repr_log_size (step->log, &step->spilled);
+	*total += step->size;
+	doc->priv->spilled_size += step->spilled;
+}
+
+static void
+sp_document_free_step (SPDocument *doc, SPDocumentUndoStep *step)
+{
+	doc->priv->spilled_size -= step->spilled;
+	sp_repr_free_log (step->log);
+	g_free (step);
+}
+
+/*
+ * Keeps undo and redo history under options.undo budget; oldest undo
+ * steps are moved to spill file (if enabled), and dropped once that is
+ * full too.  The most recent step is always kept.
+ */
+static void
+sp_document_enforce_undo_budget (SPDocument *doc)
+{
+	SPDocumentPrivate *priv;
+	size_t budget, spill_budget;
+	GSList *steps, *l;
+	unsigned int spill;
+
+	priv = doc->priv;
+
+	budget = (size_t) prefs_get_int_attribute_limited ("options.undo", "budget", SP_DOCUMENT_UNDO_BUDGET, 1, 65536) << 20;
+	if (priv->undo_size + priv->redo_size <= budget) return;
+
+	spill = prefs_get_int_attribute ("options.undo", "spill", 0);
+	spill_budget = (size_t) prefs_get_int_attribute_limited ("options.undo", "spillbudget", SP_DOCUMENT_UNDO_SPILL_BUDGET, 0, 65536) << 20;
+
+	/* Oldest first */
+	steps = g_slist_reverse (g_slist_copy (priv->undo->next));
+
+	if (spill) {
+		for (l = steps; l && (priv->undo_size + priv->redo_size > budget); l = l->next) {
+			SPDocumentUndoStep *step;
+			step = (SPDocumentUndoStep *) l->data;
+			if (!sp_repr_spill_log (step->log)) spill = FALSE;
+			sp_document_recount_step (doc, step, &priv->undo_size);
+			if (!spill) break;
+		}
+	}
+
+	for (l = steps; l; l = l->next) {
+		SPDocumentUndoStep *step;
+		if ((priv->undo_size + priv->redo_size <= budget) &&
+		    (!spill || (priv->spilled_size <= spill_budget))) break;
+		step = (SPDocumentUndoStep *) l->data;
+		priv->undo = g_slist_remove (priv->undo, step);
+		priv->history_size--;
+		priv->undo_size -= step->size;
+		sp_document_free_step (doc, step);
+	}
+
+	g_slist_free (steps);
+}
+
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <glib.h>
 #include <gtk/gtkmain.h>
+#include <libnr/nr-trace.h>
 #include "xml/repr.h"
 #include "xml/repr-action.h"
 #include "helper/sp-marshal.h"
@@ -27,6 +28,7 @@
 #include "sp-object-repr.h"
 #include "sp-root.h"
 #include "sp-namedview.h"
+#include "sp-style-elem.h"
 #include "document-private.h"
 #include "desktop.h"
 #include "version.h"
@@ -48,6 +50,8 @@ static void sp_document_init (SPDocument *document);
 static void sp_document_dispose (GObject *object);
 
 static gint sp_document_idle_handler (gpointer data);
+static void sp_document_process_restyle (SPDocument *doc);
+static void sp_document_batch_flush (SPDocument *doc);
 
 gboolean sp_document_resource_list_free (gpointer key, gpointer value, gpointer data);
 
@@ -134,11 +138,23 @@ sp_document_init (SPDocument *doc)
 
 	p->resources = g_hash_table_new (g_str_hash, g_str_equal);
 
+	p->stylesheet = NULL;
+	p->stylesheet_dirty = FALSE;
+	p->restyle = FALSE;
+
+	p->batch_observers = NULL;
+	p->batch = NULL;
+	p->batch_flags = 0;
+	p->batch_flushing = 0;
+
 	p->sensitive = FALSE;
 	p->partial = NULL;
 	p->history_size = 0;
 	p->undo = NULL;
 	p->redo = NULL;
+	p->undo_size = 0;
+	p->redo_size = 0;
+	p->spilled_size = 0;
 
 	doc->priv = p;
 }
@@ -177,6 +193,20 @@ sp_document_dispose (GObject *object)
 		g_hash_table_foreach_remove (priv->resources, sp_document_resource_list_free, doc);
 		g_hash_table_destroy (priv->resources);
 
+		if (priv->stylesheet) sp_stylesheet_free (priv->stylesheet);
+
+		while (priv->batch_observers) {
+			g_free (priv->batch_observers->data);
+			priv->batch_observers = g_slist_remove (priv->batch_observers, priv->batch_observers->data);
+		}
+		if (priv->batch) {
+			guint i;
+			for (i = 0; i < priv->batch->len; i++) {
+				g_object_unref (G_OBJECT (g_array_index (priv->batch, SPModifiedEntry, i).object));
+			}
+			g_array_free (priv->batch, TRUE);
+		}
+
 		g_free (priv);
 		doc->priv = NULL;
 	}
@@ -235,6 +265,9 @@ sp_document_create (SPReprDoc *rdoc,
 
 	document->root = sp_object_repr_build_tree (document, rroot);
 
+	/* Objects built before <style> elements have to see their rules too */
+	sp_document_process_restyle (document);
+
 	sodipodi_version = SP_ROOT (document->root)->version.sodipodi;
 
 	/* fixme: Not sure about this, but lets assume ::build updates */
@@ -504,7 +537,11 @@ sp_document_request_modified (SPDocument *doc)
 gint
 sp_document_ensure_up_to_date (SPDocument *doc)
 {
+	double trace = 0.0;
 	int lc;
+
+	NR_TRACE_BEGIN (trace, "document-update");
+	sp_document_process_restyle (doc);
 	lc = 16;
 	while (doc->root->uflags || doc->root->mflags) {
 		lc -= 1;
@@ -515,6 +552,7 @@ sp_document_ensure_up_to_date (SPDocument *doc)
 				gtk_idle_remove (doc->modified_id);
 				doc->modified_id = 0;
 			}
+			NR_TRACE_END (trace, "document-update");
 			return FALSE;
 		}
 		/* Process updates */
@@ -532,6 +570,7 @@ sp_document_ensure_up_to_date (SPDocument *doc)
 		}
 		/* Emit "modified" signal on objects */
 		sp_object_invoke_modified (doc->root, 0);
+		sp_document_batch_flush (doc);
 		/* Emit our own "modified" signal */
 		g_signal_emit (G_OBJECT (doc), signals [MODIFIED], 0,
 			       SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG);
@@ -541,6 +580,7 @@ sp_document_ensure_up_to_date (SPDocument *doc)
 		gtk_idle_remove (doc->modified_id);
 		doc->modified_id = 0;
 	}
+	NR_TRACE_END (trace, "document-update");
 	return TRUE;
 }
 
@@ -548,14 +588,18 @@ static gint
 sp_document_idle_handler (gpointer data)
 {
 	SPDocument *doc;
+	double trace = 0.0;
 	int repeat;
 
 	doc = SP_DOCUMENT (data);
+	NR_TRACE_BEGIN (trace, "document-update");
 
 #ifdef SP_DOCUMENT_DEBUG_IDLE
 	g_print ("->\n");
 #endif
 
+	sp_document_process_restyle (doc);
+
 	/* Process updates */
 	if (doc->root->uflags) {
 		SPItemCtx ctx;
@@ -573,6 +617,7 @@ sp_document_idle_handler (gpointer data)
 
 	/* Emit "modified" signal on objects */
 	sp_object_invoke_modified (doc->root, 0);
+	sp_document_batch_flush (doc);
 
 #ifdef SP_DOCUMENT_DEBUG_IDLE
 	g_print ("\n->");
@@ -586,11 +631,132 @@ sp_document_idle_handler (gpointer data)
 	g_print (" S ->\n");
 #endif
 
+	NR_TRACE_END (trace, "document-update");
+
 	repeat = (doc->root->uflags || doc->root->mflags);
 	if (!repeat) doc->modified_id = 0;
 	return repeat;
 }
 
+/* Batched modification notification */
+
+typedef struct _SPDocumentBatchObserver SPDocumentBatchObserver;
+
+struct _SPDocumentBatchObserver {
+	SPDocumentBatchFunc func;
+	gpointer data;
+	unsigned int removed : 1;
+};
+
+void
+sp_document_add_batch_observer (SPDocument *doc, SPDocumentBatchFunc func, gpointer data)
+{
+	SPDocumentBatchObserver *observer;
+
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (SP_IS_DOCUMENT (doc));
+	g_return_if_fail (func != NULL);
+
+	observer = g_new (SPDocumentBatchObserver, 1);
+	observer->func = func;
+	observer->data = data;
+	observer->removed = FALSE;
+	doc->priv->batch_observers = g_slist_append (doc->priv->batch_observers, observer);
+}
+
+void
+sp_document_remove_batch_observer (SPDocument *doc, SPDocumentBatchFunc func, gpointer data)
+{
+	GSList *l;
+
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (SP_IS_DOCUMENT (doc));
+
+	/* Document may be already disposed */
+	if (!doc->priv) return;
+
+	for (l = doc->priv->batch_observers; l != NULL; l = l->next) {
+		SPDocumentBatchObserver *observer;
+		observer = (SPDocumentBatchObserver *) l->data;
+		if (!observer->removed && (observer->func == func) && (observer->data == data)) {
+			if (doc->priv->batch_flushing) {
+				/* Flush is walking the list, it frees observer afterwards */
+				observer->removed = TRUE;
+			} else {
+				doc->priv->batch_observers = g_slist_remove (doc->priv->batch_observers, observer);
+				g_free (observer);
+			}
+			return;
+		}
+	}
+}
+
+void
+sp_document_batch_add (SPDocument *doc, SPObject *object, guint flags)
+{
+	SPModifiedEntry entry;
+
+	/* Nobody would read it */
+	if (!doc->priv->batch_observers) return;
+
+	if (!doc->priv->batch) doc->priv->batch = g_array_new (FALSE, FALSE, sizeof (SPModifiedEntry));
+
+	g_object_ref (G_OBJECT (object));
+	entry.object = object;
+	entry.flags = flags;
+	g_array_append_val (doc->priv->batch, entry);
+	doc->priv->batch_flags |= flags;
+}
+
+static void
+sp_document_batch_flush (SPDocument *doc)
+{
+	GArray *batch;
+	GSList *observers, *l;
+	guint flags, i;
+
+	batch = doc->priv->batch;
+	if (!batch) return;
+
+	/* Observers may update document again, starting new batch */
+	flags = doc->priv->batch_flags;
+	doc->priv->batch = NULL;
+	doc->priv->batch_flags = 0;
+
+	/* And add or remove observers, so we walk copy and skip removed ones */
+	g_object_ref (G_OBJECT (doc));
+	doc->priv->batch_flushing += 1;
+	observers = g_slist_copy (doc->priv->batch_observers);
+	for (l = observers; l != NULL; l = l->next) {
+		SPDocumentBatchObserver *observer;
+		observer = (SPDocumentBatchObserver *) l->data;
+		if (!observer->removed) {
+			observer->func (doc, (SPModifiedEntry *) batch->data, batch->len, flags, observer->data);
+		}
+	}
+	g_slist_free (observers);
+	doc->priv->batch_flushing -= 1;
+
+	if (!doc->priv->batch_flushing) {
+		l = doc->priv->batch_observers;
+		while (l != NULL) {
+			SPDocumentBatchObserver *observer;
+			observer = (SPDocumentBatchObserver *) l->data;
+			l = l->next;
+			if (observer->removed) {
+				doc->priv->batch_observers = g_slist_remove (doc->priv->batch_observers, observer);
+				g_free (observer);
+			}
+		}
+	}
+
+	for (i = 0; i < batch->len; i++) {
+		g_object_unref (G_OBJECT (g_array_index (batch, SPModifiedEntry, i).object));
+	}
+	g_array_free (batch, TRUE);
+	g_object_unref (G_OBJECT (doc));
+}
+
 SPObject *
 sp_document_add_repr (SPDocument *document, SPRepr *repr)
 {
@@ -747,6 +913,69 @@ sp_document_get_resource_list (SPDocument *document, const gchar *key)
 	return (GSList*)g_hash_table_lookup (document->priv->resources, key);
 }
 
+/* Stylesheets */
+
+/**
+ * Returns rules of all <style> elements in document order, rebuilding
+ * them if some element has changed; NULL if document has no rules
+ */
+SPStyleSheet *
+sp_document_get_stylesheet (SPDocument *doc)
+{
+	SPDocumentPrivate *priv;
+
+	g_return_val_if_fail (doc != NULL, NULL);
+	g_return_val_if_fail (SP_IS_DOCUMENT (doc), NULL);
+
+	priv = doc->priv;
+
+	if (priv->stylesheet_dirty) {
+		GSList *elems, *l;
+		if (priv->stylesheet) sp_stylesheet_free (priv->stylesheet);
+		priv->stylesheet = sp_stylesheet_new ();
+		/* Resource list is in reverse build order */
+		elems = g_slist_reverse (g_slist_copy ((GSList *) sp_document_get_resource_list (doc, "style")));
+		for (l = elems; l != NULL; l = l->next) {
+			const gchar *text;
+			text = sp_style_elem_get_text (SP_STYLE_ELEM (l->data));
+			if (text) sp_stylesheet_parse (priv->stylesheet, text);
+		}
+		g_slist_free (elems);
+		if (sp_stylesheet_n_rules (priv->stylesheet) < 1) {
+			sp_stylesheet_free (priv->stylesheet);
+			priv->stylesheet = NULL;
+		}
+		priv->stylesheet_dirty = FALSE;
+	}
+
+	return priv->stylesheet;
+}
+
+/**
+ * Marks stylesheet to be rebuilt; styles of all objects are reread before
+ * next update
+ */
+void
+sp_document_stylesheet_changed (SPDocument *doc)
+{
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (SP_IS_DOCUMENT (doc));
+
+	doc->priv->stylesheet_dirty = TRUE;
+	doc->priv->restyle = TRUE;
+
+	if (doc->root) sp_document_request_modified (doc);
+}
+
+static void
+sp_document_process_restyle (SPDocument *doc)
+{
+	if (doc->priv->restyle && doc->root) {
+		doc->priv->restyle = FALSE;
+		sp_object_restyle (doc->root, TRUE);
+	}
+}
+
 /* Helpers */
 
 gboolean
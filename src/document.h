@@ -17,6 +17,7 @@
 #include <glib-object.h>
 #include "xml/repr.h"
 #include "forward.h"
+#include "stylesheet.h"
 
 typedef struct _SPDocumentPrivate SPDocumentPrivate;
 
@@ -115,6 +116,10 @@ void sp_document_cancel (SPDocument *document);
 void sp_document_undo (SPDocument * document);
 void sp_document_redo (SPDocument * document);
 
+/* Memory used by undo and redo history (in bytes), and history moved to disk */
+void sp_document_get_undo_usage (SPDocument *document, unsigned int *undo_steps, unsigned int *redo_steps,
+				 size_t *undo_size, size_t *redo_size, size_t *spilled_size);
+
 /* Adds repr to document, returning created object (if any) */
 /* Items will be added to root (fixme: should be namedview root) */
 /* Non-item objects will go to root-level defs group */
@@ -132,6 +137,30 @@ gboolean sp_document_add_resource (SPDocument *document, const gchar *key, SPObj
 gboolean sp_document_remove_resource (SPDocument *document, const gchar *key, SPObject *object);
 const GSList *sp_document_get_resource_list (SPDocument *document, const gchar *key);
 
+/*
+ * Batched modification notification
+ *
+ * Called once per update cycle, after "modified" signals of objects,
+ * with every object that got one, its flags, and union of all flags.
+ * Lets observers of many objects skip per-object signal handlers.
+ */
+
+typedef struct _SPModifiedEntry SPModifiedEntry;
+
+struct _SPModifiedEntry {
+	SPObject *object;
+	guint flags;
+};
+
+typedef void (* SPDocumentBatchFunc) (SPDocument *doc, const SPModifiedEntry *entries, guint length, guint flags, gpointer data);
+
+void sp_document_add_batch_observer (SPDocument *doc, SPDocumentBatchFunc func, gpointer data);
+void sp_document_remove_batch_observer (SPDocument *doc, SPDocumentBatchFunc func, gpointer data);
+
+/* Stylesheet built from <style> elements */
+SPStyleSheet *sp_document_get_stylesheet (SPDocument *doc);
+void sp_document_stylesheet_changed (SPDocument *doc);
+
 /*
  * Ideas: How to overcome style invalidation nightmare
  *
@@ -645,12 +645,14 @@ fit_and_split (SPDrawContext * dc)
 		sp_curve_append_continuous (dc->green_curve, dc->red_curve, 0.0625);
 		curve = sp_curve_copy (dc->red_curve);
 
-		/* fixme: */
-		cshape = sp_canvas_bpath_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), curve);
+		/* Single green item, only new piece is stroked */
+		if (!dc->green_bpaths) {
+			cshape = sp_canvas_bpath_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), NULL);
+			sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cshape), dc->green_color, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
+			dc->green_bpaths = g_slist_prepend (dc->green_bpaths, cshape);
+		}
+		sp_canvas_bpath_append_bpath (SP_CANVAS_BPATH (dc->green_bpaths->data), curve);
 		sp_curve_unref (curve);
-		sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cshape), dc->green_color, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
-
-		dc->green_bpaths = g_slist_prepend (dc->green_bpaths, cshape);
 
 		dc->p[0] = dc->p[dc->npoints - 2];
 		dc->p[1] = dc->p[dc->npoints - 1];
@@ -882,6 +884,8 @@ sp_pencil_context_root_handler (SPEventContext *ec, GdkEvent *event)
 	gint ret;
 	SPDrawAnchor *anchor;
 	NRPointF fp;
+	const SPCanvasMotionSample *history;
+	guint nhistory, i;
 
 	dc = SP_DRAW_CONTEXT (ec);
 	pc = SP_PENCIL_CONTEXT (ec);
@@ -954,6 +958,16 @@ sp_pencil_context_root_handler (SPEventContext *ec, GdkEvent *event)
 					/* Create green anchor */
 					dc->green_anchor = sp_draw_anchor_new (dc, dc->green_curve, TRUE, dc->p[0].x, dc->p[0].y);
 				}
+				/* Samples coalesced into this event, last one is event itself */
+				history = sp_canvas_get_motion_history (SP_DT_CANVAS (dt), &nhistory);
+				for (i = 0; i + 1 < nhistory; i++) {
+					NRPointF hp;
+					sp_desktop_w2d_xy_point (dt, &fp, history[i].x, history[i].y);
+					hp.x = fp.x;
+					hp.y = fp.y;
+					sp_desktop_free_snap (dt, &hp);
+					spdc_add_freehand_point (pc, &hp, history[i].state);
+				}
 				/* fixme: I am not sure, whether we want to snap to anchors in middle of freehand (Lauris) */
 				if (anchor) {
 					p = anchor->dp;
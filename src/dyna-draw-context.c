@@ -478,6 +478,31 @@ sp_dyna_draw_brush (SPDynaDrawContext *dc)
 	dc->npoints++;
 }
 
+/* Moves pen to pointer position in world coordinates */
+static void
+sp_dyna_draw_motion_point (SPDynaDrawContext *dc, double x, double y)
+{
+	SPDesktop *desktop;
+	double xd, yd;
+	NRPointF p;
+
+	desktop = SP_EVENT_CONTEXT (dc)->desktop;
+
+	sp_desktop_w2d_xy_point (desktop, &p, x, y);
+	if (! sp_dyna_draw_apply (dc, p.x, p.y)) return;
+	sp_dyna_draw_get_curr_vpoint (dc, &xd, &yd);
+	p.x = xd;
+	p.y = yd;
+
+	sp_desktop_free_snap (desktop, &p);
+
+	if ((dc->curx != dc->lastx) || (dc->cury != dc->lasty)) {
+		sp_dyna_draw_brush (dc);
+		g_assert (dc->npoints > 0);
+		fit_and_split (dc, FALSE);
+	}
+}
+
 static gint
 sp_dyna_draw_timeout_handler (gpointer data)
 {
@@ -573,30 +598,18 @@ sp_dyna_draw_context_root_handler (SPEventContext * event_context,
 		break;
 	case GDK_MOTION_NOTIFY:
 		if (!dc->use_timeout && (event->motion.state & GDK_BUTTON1_MASK)) {
-			double xd, yd;
+			const SPCanvasMotionSample *history;
+			guint nhistory, i;
 
 			dc->dragging = TRUE;
 			dc->dynahand = TRUE;
 
-			sp_desktop_w2d_xy_point (desktop, &p, event->motion.x, event->motion.y);
-#if 0
-			g_print ("(%g %g)=>(%g %g)\n", event->motion.x, event->motion.y, p.x, p.y);
-#endif
-			if (! sp_dyna_draw_apply (dc, p.x, p.y)) {
-				ret = TRUE;
-				break;
-			}
-			sp_dyna_draw_get_curr_vpoint (dc, &xd, &yd);
-			p.x = xd;
-			p.y = yd;
-
-			sp_desktop_free_snap (desktop, &p);
-
-			if ((dc->curx != dc->lastx) || (dc->cury != dc->lasty)) {
-				sp_dyna_draw_brush (dc);
-				g_assert (dc->npoints > 0);
-				fit_and_split (dc, FALSE);
+			/* Samples coalesced into this event, last one is event itself */
+			history = sp_canvas_get_motion_history (SP_DT_CANVAS (desktop), &nhistory);
+			for (i = 0; i + 1 < nhistory; i++) {
+				sp_dyna_draw_motion_point (dc, history[i].x, history[i].y);
 			}
+			sp_dyna_draw_motion_point (dc, event->motion.x, event->motion.y);
 			ret = TRUE;
 		}
 		break;
@@ -825,17 +838,19 @@ fit_and_split_line (SPDynaDrawContext *dc,
 		g_assert (!sp_curve_empty (dc->currentcurve));
 		concat_current_line (dc);
 
-		cbp = sp_canvas_item_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), SP_TYPE_CANVAS_BPATH, NULL);
+		/* Segments go to single item, only new one is rasterized */
+		if (!dc->segments) {
+			cbp = sp_canvas_item_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), SP_TYPE_CANVAS_BPATH, NULL);
+			/* fixme: We have to parse style color somehow */
+			sp_canvas_bpath_set_fill (SP_CANVAS_BPATH (cbp), DDC_GREEN_RGBA, SP_WIND_RULE_EVENODD);
+			sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cbp), 0x000000ff, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
+			/* fixme: Cannot we cascade it to root more clearly? */
+			g_signal_connect (G_OBJECT (cbp), "event", G_CALLBACK (sp_desktop_root_handler), SP_EVENT_CONTEXT (dc)->desktop);
+			dc->segments = g_slist_prepend (dc->segments, cbp);
+		}
 		curve = sp_curve_copy (dc->currentcurve);
-		sp_canvas_bpath_set_bpath (SP_CANVAS_BPATH (cbp), curve);
+		sp_canvas_bpath_append_bpath (SP_CANVAS_BPATH (dc->segments->data), curve);
 		sp_curve_unref (curve);
-		/* fixme: We have to parse style color somehow */
-		sp_canvas_bpath_set_fill (SP_CANVAS_BPATH (cbp), DDC_GREEN_RGBA, SP_WIND_RULE_EVENODD);
-		sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cbp), 0x000000ff, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
-		/* fixme: Cannot we cascade it to root more clearly? */
-		g_signal_connect (G_OBJECT (cbp), "event", G_CALLBACK (sp_desktop_root_handler), SP_EVENT_CONTEXT (dc)->desktop);
-
-		dc->segments = g_slist_prepend (dc->segments, cbp);
 
 #if 0
 		dc->point1[0] = dc->point1[dc->npoints - 2];
@@ -948,16 +963,17 @@ fit_and_split_calligraphics (SPDynaDrawContext *dc, gboolean release)
 
 			g_assert (!sp_curve_empty (dc->currentcurve));
 
-			cbp = sp_canvas_item_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), SP_TYPE_CANVAS_BPATH, NULL);
+			if (!dc->segments) {
+				cbp = sp_canvas_item_new (SP_DT_SKETCH (SP_EVENT_CONTEXT (dc)->desktop), SP_TYPE_CANVAS_BPATH, NULL);
+				sp_canvas_bpath_set_fill (SP_CANVAS_BPATH (cbp), 0x000000ff, SP_WIND_RULE_EVENODD);
+				sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cbp), 0x00000000, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
+				/* fixme: Cannot we cascade it to root more clearly? */
+				g_signal_connect (G_OBJECT (cbp), "event", G_CALLBACK (sp_desktop_root_handler), SP_EVENT_CONTEXT (dc)->desktop);
+				dc->segments = g_slist_prepend (dc->segments, cbp);
+			}
 			curve = sp_curve_copy (dc->currentcurve);
-			sp_canvas_bpath_set_bpath (SP_CANVAS_BPATH (cbp), curve);
+			sp_canvas_bpath_append_bpath (SP_CANVAS_BPATH (dc->segments->data), curve);
 			sp_curve_unref (curve);
-			sp_canvas_bpath_set_fill (SP_CANVAS_BPATH (cbp), 0x000000ff, SP_WIND_RULE_EVENODD);
-			sp_canvas_bpath_set_stroke (SP_CANVAS_BPATH (cbp), 0x00000000, 1.0, SP_STROKE_LINEJOIN_MITER, SP_STROKE_LINECAP_BUTT);
-			/* fixme: Cannot we cascade it to root more clearly? */
-			g_signal_connect (G_OBJECT (cbp), "event", G_CALLBACK (sp_desktop_root_handler), SP_EVENT_CONTEXT (dc)->desktop);
-
-			dc->segments = g_slist_prepend (dc->segments, cbp);
 		}
 
 		dc->point1[0] = dc->point1[dc->npoints - 1];
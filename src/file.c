@@ -18,6 +18,7 @@
 #include <string.h>
 #include <time.h>
 #include <libnr/nr-pixops.h>
+#include <libnr/nr-trace.h>
 #include <glib.h>
 #include <gtk/gtksignal.h>
 #include <gtk/gtkhbox.h>
@@ -483,6 +484,7 @@ sp_file_export_dialog (void *widget)
 
 #include <display/nr-arena-item.h>
 #include <display/nr-arena.h>
+#include <display/nr-arena-shape.h>
 
 struct SPEBP {
 	int width, height, sheight;
@@ -510,9 +512,9 @@ sp_export_get_rows (const guchar **rows, int row, int num_rows, void *data)
 	bbox.y0 = row;
 	bbox.x1 = ebp->width;
 	bbox.y1 = row + num_rows;
-	/* Update to renderable state */
+	/* Update to renderable state, first stripe builds geometry of everything */
 	nr_matrix_d_set_identity (&gc.transform);
-	nr_arena_item_invoke_update (ebp->root, &bbox, &gc, NR_ARENA_ITEM_STATE_ALL, NR_ARENA_ITEM_STATE_NONE);
+	nr_arena_shape_update_parallel (ebp->root, &bbox, &gc, NR_ARENA_ITEM_STATE_ALL, NR_ARENA_ITEM_STATE_NONE);
 
 	nr_pixblock_setup_extern (&pb, NR_PIXBLOCK_MODE_R8G8B8A8N, bbox.x0, bbox.y0, bbox.x1, bbox.y1, ebp->px, 4 * ebp->width, FALSE, FALSE);
 
@@ -621,4 +623,6 @@ sp_export_png_file (SPDocument *doc, const gchar *filename,
 	sp_item_invoke_hide (SP_ITEM (sp_document_root (doc)), dkey);
 	nr_arena_item_unref (ebp.root);
 	nr_object_unref ((NRObject *) arena);
+
+	NR_TRACE_FRAME ("export");
 }
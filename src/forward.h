@@ -126,6 +126,9 @@ typedef struct _SPGroupClass SPGroupClass;
 typedef struct _SPDefs SPDefs;
 typedef struct _SPDefsClass SPDefsClass;
 
+typedef struct _SPStyleElem SPStyleElem;
+typedef struct _SPStyleElemClass SPStyleElemClass;
+
 typedef struct _SPRoot SPRoot;
 typedef struct _SPRootClass SPRootClass;
 
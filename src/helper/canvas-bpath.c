@@ -12,6 +12,8 @@
  *
  */
 
+#include <math.h>
+#include <string.h>
 #include <libart_lgpl/art_rect.h>
 #include <libart_lgpl/art_vpath.h>
 #include <libart_lgpl/art_bpath.h>
@@ -21,6 +23,7 @@
 #include <libart_lgpl/art_svp_point.h>
 #include <libart_lgpl/art_rect_svp.h>
 #include <libart_lgpl/art_rgb_svp.h>
+#include <libart_lgpl/art_gray_svp.h>
 #include "sp-canvas.h"
 #include "sp-canvas-util.h"
 #include "canvas-bpath.h"
@@ -32,9 +35,26 @@ static void sp_canvas_bpath_destroy (GtkObject *object);
 static void sp_canvas_bpath_update (SPCanvasItem *item, double *affine, unsigned int flags);
 static void sp_canvas_bpath_render (SPCanvasItem *item, SPCanvasBuf *buf);
 static double sp_canvas_bpath_point (SPCanvasItem *item, double x, double y, SPCanvasItem **actual_item);
+
+static void sp_canvas_bpath_update_pieces (SPCanvasBPath *cbp, double *affine);
+static void sp_canvas_bpath_render_pieces (SPCanvasBPath *cbp, SPCanvasBuf *buf);
+static void sp_canvas_bpath_clear_pieces (SPCanvasBPath *cbp);
+static void sp_canvas_bpath_free_tiles (SPCanvasBPath *cbp);
  
 static SPCanvasItemClass *parent_class;
 
+/* Coverage tiles of appended pieces */
+#define TILE_SHIFT 6
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_KEY(tx,ty) GUINT_TO_POINTER (((guint) (tx) & 0xffff) | ((guint) (ty) << 16))
+
+typedef struct _SPCanvasBPathTile SPCanvasBPathTile;
+
+struct _SPCanvasBPathTile {
+	guchar fill[TILE_SIZE * TILE_SIZE];
+	guchar stroke[TILE_SIZE * TILE_SIZE];
+};
+
 GtkType
 sp_canvas_bpath_get_type (void)
 {
@@ -85,6 +105,10 @@ sp_canvas_bpath_init (SPCanvasBPath * bpath)
 
 	bpath->fill_svp = NULL;
 	bpath->stroke_svp = NULL;
+
+	bpath->pieces = NULL;
+	bpath->pending = NULL;
+	bpath->tiles = NULL;
 }
 
 static void
@@ -108,71 +132,90 @@ sp_canvas_bpath_destroy (GtkObject *object)
 		cbp->curve = sp_curve_unref (cbp->curve);
 	}
 
+	sp_canvas_bpath_clear_pieces (cbp);
+
 	if (GTK_OBJECT_CLASS (parent_class)->destroy)
 		(* GTK_OBJECT_CLASS (parent_class)->destroy) (object);
 }
 
+/* Builds fill and stroke svps of curve, as requested by colors, and their bbox */
 static void
-sp_canvas_bpath_update (SPCanvasItem *item, double *affine, unsigned int flags)
+sp_canvas_bpath_build_svps (SPCanvasBPath *cbp, SPCurve *curve, double *affine, ArtSVP **fill, ArtSVP **stroke, ArtDRect *dbox)
 {
-	SPCanvasBPath *cbp;
-	ArtDRect dbox, pbox;
-	ArtIRect ibox;
-
-	cbp = SP_CANVAS_BPATH (item);
-
-	sp_canvas_request_redraw (item->canvas, (int)item->x1, (int)item->y1, (int)item->x2, (int)item->y2);
-
-	if (((SPCanvasItemClass *) parent_class)->update)
-		((SPCanvasItemClass *) parent_class)->update (item, affine, flags);
+	ArtDRect pbox;
 
-	sp_canvas_item_reset_bounds (item);
-
-	if (cbp->fill_svp) {
-		art_svp_free (cbp->fill_svp);
-		cbp->fill_svp = NULL;
-	}
-
-	if (cbp->stroke_svp) {
-		art_svp_free (cbp->stroke_svp);
-		cbp->stroke_svp = NULL;
-	}
-
-	if (!cbp->curve) return;
-
-	dbox.x0 = dbox.y0 = 0.0;
-	dbox.x1 = dbox.y1 = -1.0;
+	*fill = NULL;
+	*stroke = NULL;
+	dbox->x0 = dbox->y0 = 0.0;
+	dbox->x1 = dbox->y1 = -1.0;
 
 	if ((cbp->fill_rgba & 0xff) || (cbp->stroke_rgba & 0xff)) {
 		ArtBpath *bp;
 		ArtVpath *vp, *pp;
-		bp = art_bpath_affine_transform (cbp->curve->bpath, affine);
+		bp = art_bpath_affine_transform (curve->bpath, affine);
 		vp = art_bez_path_to_vec (bp, 0.25);
 		art_free (bp);
 		pp = art_vpath_perturb (vp);
 		art_free (vp);
 
-		if ((cbp->fill_rgba & 0xff) && (cbp->curve->end > 2)) {
+		if ((cbp->fill_rgba & 0xff) && (curve->end > 2)) {
 			ArtSVP *svpa, *svpb;
 			svpa = art_svp_from_vpath (pp);
 			svpb = art_svp_uncross (svpa);
 			art_svp_free (svpa);
-			cbp->fill_svp = art_svp_rewind_uncrossed (svpb, (ArtWindRule)cbp->fill_rule);
+			*fill = art_svp_rewind_uncrossed (svpb, (ArtWindRule)cbp->fill_rule);
 			art_svp_free (svpb);
-			art_drect_svp (&pbox, cbp->fill_svp);
-			art_drect_union (&dbox, &dbox, &pbox);
+			art_drect_svp (&pbox, *fill);
+			art_drect_union (dbox, dbox, &pbox);
 		}
 
-		if ((cbp->stroke_rgba & 0xff) && (cbp->curve->end > 1)) {
-			cbp->stroke_svp = art_svp_vpath_stroke (pp, (ArtPathStrokeJoinType)cbp->stroke_linejoin, (ArtPathStrokeCapType)cbp->stroke_linecap,
-								cbp->stroke_width, cbp->stroke_miterlimit, 0.25);
-			art_drect_svp (&pbox, cbp->stroke_svp);
-			art_drect_union (&dbox, &dbox, &pbox);
+		if ((cbp->stroke_rgba & 0xff) && (curve->end > 1)) {
+			*stroke = art_svp_vpath_stroke (pp, (ArtPathStrokeJoinType)cbp->stroke_linejoin, (ArtPathStrokeCapType)cbp->stroke_linecap,
+							cbp->stroke_width, cbp->stroke_miterlimit, 0.25);
+			art_drect_svp (&pbox, *stroke);
+			art_drect_union (dbox, dbox, &pbox);
 		}
 
 		art_free (pp);
 	}
+}
 
+static void
+sp_canvas_bpath_update (SPCanvasItem *item, double *affine, unsigned int flags)
+{
+	SPCanvasBPath *cbp;
+	ArtDRect dbox;
+	ArtIRect ibox;
+
+	cbp = SP_CANVAS_BPATH (item);
+
+	if (cbp->fill_svp) {
+		art_svp_free (cbp->fill_svp);
+		cbp->fill_svp = NULL;
+	}
+
+	if (cbp->stroke_svp) {
+		art_svp_free (cbp->stroke_svp);
+		cbp->stroke_svp = NULL;
+	}
+
+	if (cbp->pieces || cbp->pending) {
+		if (((SPCanvasItemClass *) parent_class)->update)
+			((SPCanvasItemClass *) parent_class)->update (item, affine, flags);
+		sp_canvas_bpath_update_pieces (cbp, affine);
+		return;
+	}
+
+	sp_canvas_request_redraw (item->canvas, (int)item->x1, (int)item->y1, (int)item->x2, (int)item->y2);
+
+	if (((SPCanvasItemClass *) parent_class)->update)
+		((SPCanvasItemClass *) parent_class)->update (item, affine, flags);
+
+	sp_canvas_item_reset_bounds (item);
+
+	if (!cbp->curve) return;
+
+	sp_canvas_bpath_build_svps (cbp, cbp->curve, affine, &cbp->fill_svp, &cbp->stroke_svp, &dbox);
 
 	art_drect_to_irect (&ibox, &dbox);
 
@@ -197,6 +240,11 @@ sp_canvas_bpath_render (SPCanvasItem *item, SPCanvasBuf *buf)
 		buf->is_buf = TRUE;
 	}
 
+	if (cbp->tiles) {
+		sp_canvas_bpath_render_pieces (cbp, buf);
+		return;
+	}
+
 	if (cbp->fill_svp) {
 		art_rgb_svp_alpha (cbp->fill_svp, buf->rect.x0, buf->rect.y0, buf->rect.x1, buf->rect.y1, cbp->fill_rgba,
 				   buf->buf, buf->buf_rowstride,
@@ -221,6 +269,20 @@ sp_canvas_bpath_point (SPCanvasItem *item, double x, double y, SPCanvasItem **ac
 
 	cbp = SP_CANVAS_BPATH (item);
 
+	if (cbp->tiles) {
+		SPCanvasBPathTile *tile;
+		int ix, iy, pos;
+		/* Only exact hits, coverage does not tell distance */
+		ix = (int) floor (x);
+		iy = (int) floor (y);
+		tile = (SPCanvasBPathTile *) g_hash_table_lookup (cbp->tiles, TILE_KEY (ix >> TILE_SHIFT, iy >> TILE_SHIFT));
+		if (!tile) return BIGVAL;
+		pos = (iy & (TILE_SIZE - 1)) * TILE_SIZE + (ix & (TILE_SIZE - 1));
+		if (!tile->fill[pos] && !tile->stroke[pos]) return BIGVAL;
+		*actual_item = item;
+		return 0.0;
+	}
+
 	if (cbp->fill_svp) {
 		wind = art_svp_point_wind (cbp->fill_svp, x, y);
 		if (wind) {
@@ -272,6 +334,13 @@ sp_canvas_bpath_set_bpath (SPCanvasBPath *cbp, SPCurve *curve)
 		cbp->curve = sp_curve_unref (cbp->curve);
 	}
 
+	if (cbp->pieces || cbp->pending) {
+		sp_canvas_request_redraw (SP_CANVAS_ITEM (cbp)->canvas, (int) SP_CANVAS_ITEM (cbp)->x1, (int) SP_CANVAS_ITEM (cbp)->y1,
+					  (int) SP_CANVAS_ITEM (cbp)->x2, (int) SP_CANVAS_ITEM (cbp)->y2);
+		sp_canvas_item_reset_bounds (SP_CANVAS_ITEM (cbp));
+		sp_canvas_bpath_clear_pieces (cbp);
+	}
+
 	if (curve) {
 		cbp->curve = sp_curve_ref (curve);
 	}
@@ -279,6 +348,22 @@ sp_canvas_bpath_set_bpath (SPCanvasBPath *cbp, SPCurve *curve)
 	sp_canvas_item_request_update (SP_CANVAS_ITEM (cbp));
 }
 
+void
+sp_canvas_bpath_append_bpath (SPCanvasBPath *cbp, SPCurve *curve)
+{
+	g_return_if_fail (cbp != NULL);
+	g_return_if_fail (SP_IS_CANVAS_BPATH (cbp));
+	g_return_if_fail (curve != NULL);
+
+	if (cbp->curve) {
+		sp_canvas_bpath_set_bpath (cbp, NULL);
+	}
+
+	cbp->pending = g_slist_prepend (cbp->pending, sp_curve_ref (curve));
+
+	sp_canvas_item_request_update (SP_CANVAS_ITEM (cbp));
+}
+
 void
 sp_canvas_bpath_set_fill (SPCanvasBPath *cbp, guint32 rgba, SPWindRule rule)
 {
@@ -287,6 +372,8 @@ sp_canvas_bpath_set_fill (SPCanvasBPath *cbp, guint32 rgba, SPWindRule rule)
 
 	cbp->fill_rgba = rgba;
 	cbp->fill_rule = rule;
+	/* Rasterize pieces again */
+	sp_canvas_bpath_free_tiles (cbp);
 
 	sp_canvas_item_request_update (SP_CANVAS_ITEM (cbp));
 }
@@ -301,7 +388,190 @@ sp_canvas_bpath_set_stroke (SPCanvasBPath *cbp, guint32 rgba, gdouble width, SPS
 	cbp->stroke_width = MAX (width, 0.1);
 	cbp->stroke_linejoin = join;
 	cbp->stroke_linecap = cap;
+	sp_canvas_bpath_free_tiles (cbp);
 
 	sp_canvas_item_request_update (SP_CANVAS_ITEM (cbp));
 }
 
+/*
+ * Appended pieces
+ *
+ * Every piece is rasterized once into coverage tiles, combined with
+ * earlier coverage by maximum, so drawing long stroke only costs its
+ * newest piece.  Pieces are kept, to be rasterized again if affine or
+ * paint changes.
+ */
+
+static gboolean
+sp_canvas_bpath_free_tile (gpointer key, gpointer value, gpointer data)
+{
+	g_free (value);
+	return TRUE;
+}
+
+static void
+sp_canvas_bpath_free_tiles (SPCanvasBPath *cbp)
+{
+	if (cbp->tiles) {
+		g_hash_table_foreach_remove (cbp->tiles, sp_canvas_bpath_free_tile, NULL);
+		g_hash_table_destroy (cbp->tiles);
+		cbp->tiles = NULL;
+	}
+}
+
+static void
+sp_canvas_bpath_clear_pieces (SPCanvasBPath *cbp)
+{
+	while (cbp->pieces) {
+		sp_curve_unref ((SPCurve *) cbp->pieces->data);
+		cbp->pieces = g_slist_remove (cbp->pieces, cbp->pieces->data);
+	}
+	while (cbp->pending) {
+		sp_curve_unref ((SPCurve *) cbp->pending->data);
+		cbp->pending = g_slist_remove (cbp->pending, cbp->pending->data);
+	}
+	sp_canvas_bpath_free_tiles (cbp);
+}
+
+/* Adds coverage of svp inside box to given plane of tiles */
+static void
+sp_canvas_bpath_rasterize (SPCanvasBPath *cbp, ArtSVP *svp, ArtIRect *box, unsigned int stroke)
+{
+	guchar px[TILE_SIZE * TILE_SIZE];
+	int tx, ty;
+
+	for (ty = box->y0 >> TILE_SHIFT; ty <= ((box->y1 - 1) >> TILE_SHIFT); ty++) {
+		for (tx = box->x0 >> TILE_SHIFT; tx <= ((box->x1 - 1) >> TILE_SHIFT); tx++) {
+			SPCanvasBPathTile *tile;
+			guchar *plane;
+			int x0, y0, x1, y1, x, y;
+			x0 = MAX (box->x0, tx << TILE_SHIFT);
+			y0 = MAX (box->y0, ty << TILE_SHIFT);
+			x1 = MIN (box->x1, (tx + 1) << TILE_SHIFT);
+			y1 = MIN (box->y1, (ty + 1) << TILE_SHIFT);
+			art_gray_svp_aa (svp, x0, y0, x1, y1, px, TILE_SIZE);
+			tile = (SPCanvasBPathTile *) g_hash_table_lookup (cbp->tiles, TILE_KEY (tx, ty));
+			if (!tile) {
+				tile = g_new0 (SPCanvasBPathTile, 1);
+				g_hash_table_insert (cbp->tiles, TILE_KEY (tx, ty), tile);
+			}
+			plane = (stroke) ? tile->stroke : tile->fill;
+			for (y = y0; y < y1; y++) {
+				guchar *s, *d;
+				s = px + (y - y0) * TILE_SIZE;
+				d = plane + (y & (TILE_SIZE - 1)) * TILE_SIZE + (x0 & (TILE_SIZE - 1));
+				for (x = x0; x < x1; x++) {
+					if (*s > *d) *d = *s;
+					s++;
+					d++;
+				}
+			}
+		}
+	}
+}
+
+static void
+sp_canvas_bpath_update_pieces (SPCanvasBPath *cbp, double *affine)
+{
+	SPCanvasItem *item;
+	GSList *l;
+
+	item = SP_CANVAS_ITEM (cbp);
+
+	if (!cbp->tiles || memcmp (affine, cbp->tiles_affine, 6 * sizeof (double))) {
+		/* Everything is rasterized again */
+		sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+		sp_canvas_item_reset_bounds (item);
+		sp_canvas_bpath_free_tiles (cbp);
+		cbp->tiles = g_hash_table_new (NULL, NULL);
+		memcpy (cbp->tiles_affine, affine, 6 * sizeof (double));
+		cbp->pending = g_slist_concat (cbp->pending, cbp->pieces);
+		cbp->pieces = NULL;
+	}
+
+	for (l = cbp->pending; l != NULL; l = l->next) {
+		ArtSVP *fill, *stroke;
+		ArtDRect dbox;
+		ArtIRect ibox;
+
+		sp_canvas_bpath_build_svps (cbp, (SPCurve *) l->data, affine, &fill, &stroke, &dbox);
+		art_drect_to_irect (&ibox, &dbox);
+
+		if ((ibox.x0 < ibox.x1) && (ibox.y0 < ibox.y1)) {
+			if (fill) sp_canvas_bpath_rasterize (cbp, fill, &ibox, FALSE);
+			if (stroke) sp_canvas_bpath_rasterize (cbp, stroke, &ibox, TRUE);
+			if ((item->x1 < item->x2) && (item->y1 < item->y2)) {
+				item->x1 = MIN (item->x1, ibox.x0);
+				item->y1 = MIN (item->y1, ibox.y0);
+				item->x2 = MAX (item->x2, ibox.x1);
+				item->y2 = MAX (item->y2, ibox.y1);
+			} else {
+				item->x1 = ibox.x0;
+				item->y1 = ibox.y0;
+				item->x2 = ibox.x1;
+				item->y2 = ibox.y1;
+			}
+			/* Only new piece needs drawing */
+			sp_canvas_request_redraw (item->canvas, ibox.x0, ibox.y0, ibox.x1, ibox.y1);
+		}
+
+		if (fill) art_svp_free (fill);
+		if (stroke) art_svp_free (stroke);
+	}
+
+	cbp->pieces = g_slist_concat (cbp->pending, cbp->pieces);
+	cbp->pending = NULL;
+}
+
+#define BLEND(d,s,a) ((d) + ((((int) (s) - (int) (d)) * (int) (a) + 127) / 255))
+
+static void
+sp_canvas_bpath_render_plane (guchar *plane, int x0, int y0, int x1, int y1, guint32 rgba, SPCanvasBuf *buf)
+{
+	unsigned int r, g, b, a;
+	int x, y;
+
+	r = (rgba >> 24) & 0xff;
+	g = (rgba >> 16) & 0xff;
+	b = (rgba >> 8) & 0xff;
+	a = rgba & 0xff;
+	if (!a) return;
+
+	for (y = y0; y < y1; y++) {
+		guchar *s, *d;
+		s = plane + (y & (TILE_SIZE - 1)) * TILE_SIZE + (x0 & (TILE_SIZE - 1));
+		d = buf->buf + (y - buf->rect.y0) * buf->buf_rowstride + 3 * (x0 - buf->rect.x0);
+		for (x = x0; x < x1; x++) {
+			if (*s) {
+				unsigned int ca;
+				ca = (*s * a + 127) / 255;
+				d[0] = BLEND (d[0], r, ca);
+				d[1] = BLEND (d[1], g, ca);
+				d[2] = BLEND (d[2], b, ca);
+			}
+			s++;
+			d += 3;
+		}
+	}
+}
+
+static void
+sp_canvas_bpath_render_pieces (SPCanvasBPath *cbp, SPCanvasBuf *buf)
+{
+	int tx, ty;
+
+	for (ty = buf->rect.y0 >> TILE_SHIFT; ty <= ((buf->rect.y1 - 1) >> TILE_SHIFT); ty++) {
+		for (tx = buf->rect.x0 >> TILE_SHIFT; tx <= ((buf->rect.x1 - 1) >> TILE_SHIFT); tx++) {
+			SPCanvasBPathTile *tile;
+			int x0, y0, x1, y1;
+			tile = (SPCanvasBPathTile *) g_hash_table_lookup (cbp->tiles, TILE_KEY (tx, ty));
+			if (!tile) continue;
+			x0 = MAX (buf->rect.x0, tx << TILE_SHIFT);
+			y0 = MAX (buf->rect.y0, ty << TILE_SHIFT);
+			x1 = MIN (buf->rect.x1, (tx + 1) << TILE_SHIFT);
+			y1 = MIN (buf->rect.y1, (ty + 1) << TILE_SHIFT);
+			sp_canvas_bpath_render_plane (tile->fill, x0, y0, x1, y1, cbp->fill_rgba, buf);
+			sp_canvas_bpath_render_plane (tile->stroke, x0, y0, x1, y1, cbp->stroke_rgba, buf);
+		}
+	}
+}
@@ -83,6 +83,13 @@ struct _SPCanvasBPath {
 	/* State */
 	ArtSVP *fill_svp;
 	ArtSVP *stroke_svp;
+
+	/* Appended pieces, and those not rasterized yet */
+	GSList *pieces;
+	GSList *pending;
+	/* Coverage of rasterized pieces in canvas tiles, valid for affine */
+	GHashTable *tiles;
+	double tiles_affine[6];
 };
 
 struct _SPCanvasBPathClass {
@@ -94,6 +101,12 @@ GtkType sp_canvas_bpath_get_type (void);
 SPCanvasItem *sp_canvas_bpath_new (SPCanvasGroup *parent, SPCurve *curve);
 
 void sp_canvas_bpath_set_bpath (SPCanvasBPath *cbp, SPCurve *curve);
+/*
+ * Adds piece filled and stroked on its own, instead of whole path.  Only
+ * new pieces are rasterized at update, earlier ones are kept as coverage.
+ * Setting bpath removes all pieces.
+ */
+void sp_canvas_bpath_append_bpath (SPCanvasBPath *cbp, SPCurve *curve);
 void sp_canvas_bpath_set_fill (SPCanvasBPath *cbp, guint32 rgba, SPWindRule rule);
 void sp_canvas_bpath_set_stroke (SPCanvasBPath *cbp, guint32 rgba, gdouble width, SPStrokeJoinType join, SPStrokeCapType cap);
 
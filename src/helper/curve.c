@@ -48,6 +48,7 @@ sp_curve_new_sized (gint length)
 	curve = g_new (SPCurve, 1);
 
 	curve->refcount = 1;
+	curve->generation = 0;
 	curve->bpath = art_new (ArtBpath, length);
 	curve->bpath->code = ART_END;
 	curve->end = 0;
@@ -58,6 +59,7 @@ sp_curve_new_sized (gint length)
 	curve->posset = FALSE;
 	curve->moving = FALSE;
 	curve->closed = FALSE;
+	curve->shared = FALSE;
 
 	return curve;
 }
@@ -80,6 +82,7 @@ sp_curve_new_from_bpath (ArtBpath *bpath)
 	curve = g_new (SPCurve, 1);
 
 	curve->refcount = 1;
+	curve->generation = 0;
 	curve->bpath = bpath;
 	curve->length = sp_bpath_length (bpath);
 	curve->end = curve->length - 1;
@@ -90,6 +93,7 @@ sp_curve_new_from_bpath (ArtBpath *bpath)
 	curve->posset = FALSE;
 	curve->moving = FALSE;
 	curve->closed = sp_bpath_closed (bpath);
+	curve->shared = FALSE;
 
 	return curve;
 }
@@ -116,6 +120,7 @@ sp_curve_new_from_static_bpath (ArtBpath * bpath)
 	curve = g_new (SPCurve, 1);
 
 	curve->refcount = 1;
+	curve->generation = 0;
 	curve->bpath = bpath;
 	curve->length = sp_bpath_length (bpath);
 	curve->end = curve->length - 1;
@@ -126,6 +131,7 @@ sp_curve_new_from_static_bpath (ArtBpath * bpath)
 	curve->posset = FALSE;
 	curve->moving = FALSE;
 	curve->closed = sp_bpath_closed (bpath);
+	curve->shared = FALSE;
 
 	return curve;
 }
@@ -292,11 +298,11 @@ sp_curve_split (SPCurve * curve)
 		new_curve->substart = 0;
 		new_curve->closed = (new_curve->bpath->code == ART_MOVETO);
 		new_curve->hascpt = (new_curve->bpath->code == ART_MOVETO_OPEN);
-		l = g_slist_append (l, new_curve);
+		l = g_slist_prepend (l, new_curve);
 		p += i;
 	}
 
-	return l;
+	return g_slist_reverse (l);
 }
 
 SPCurve *
@@ -308,6 +314,7 @@ sp_curve_transform (SPCurve *curve, const gdouble t[])
 	g_return_val_if_fail (!curve->sbpath, NULL);
 	g_return_val_if_fail (t != NULL, curve);
 
+	curve->generation += 1;
 	for (i = 0; i < curve->end; i++) {
 		ArtBpath *p;
 		p = curve->bpath + i;
@@ -344,6 +351,7 @@ sp_curve_reset (SPCurve * curve)
 	g_return_if_fail (curve != NULL);
 	g_return_if_fail (!curve->sbpath);
 
+	curve->generation += 1;
 	curve->bpath->code = ART_END;
 	curve->end = 0;
 	curve->substart = 0;
@@ -378,6 +386,7 @@ sp_curve_lineto (SPCurve * curve, gdouble x, gdouble y)
 	g_return_if_fail (!curve->sbpath);
 	g_return_if_fail (curve->hascpt);
 
+	curve->generation += 1;
 	if (curve->moving) {
 		/* simply fix endpoint */
 		g_return_if_fail (!curve->posset);
@@ -431,6 +440,7 @@ sp_curve_lineto_moving (SPCurve * curve, gdouble x, gdouble y)
 	g_return_if_fail (!curve->sbpath);
 	g_return_if_fail (curve->hascpt);
 
+	curve->generation += 1;
 	if (curve->moving) {
 		/* simply change endpoint */
 		g_return_if_fail (!curve->posset);
@@ -486,6 +496,7 @@ sp_curve_curveto (SPCurve * curve, gdouble x0, gdouble y0, gdouble x1, gdouble y
 	g_return_if_fail (curve->hascpt);
 	g_return_if_fail (!curve->moving);
 
+	curve->generation += 1;
 	if (curve->posset) {
 		/* start a new segment */
 		sp_curve_ensure_space (curve, 2);
@@ -540,6 +551,7 @@ sp_curve_closepath (SPCurve * curve)
 	/* We need at last M + C + E */
 	g_return_if_fail (curve->end - curve->substart > 1);
 
+	curve->generation += 1;
 	bs = curve->bpath + curve->substart;
 	be = curve->bpath + curve->end - 1;
 
@@ -573,6 +585,7 @@ sp_curve_closepath_current (SPCurve * curve)
 	/* We need at last M + L + L + E */
 	g_return_if_fail (curve->end - curve->substart > 2);
 
+	curve->generation += 1;
 	bs = curve->bpath + curve->substart;
 	be = curve->bpath + curve->end - 1;
 
@@ -789,6 +802,7 @@ sp_curve_backspace (SPCurve *curve)
 {
 	g_return_if_fail (curve != NULL);
 
+	curve->generation += 1;
 	if (curve->end > 0) {
 		curve->end -= 1;
 		if (curve->end > 0) {
@@ -21,6 +21,7 @@ typedef struct _SPCurve SPCurve;
 
 struct _SPCurve {
 	gint refcount;
+	guint generation;	/* Changes whenever bpath is edited in place */
 	ArtBpath * bpath;
 	gint end;		/* ART_END position */
 	gint length;		/* Num allocated Bpaths */
@@ -31,6 +32,7 @@ struct _SPCurve {
 	guint posset : 1;	/* Previous was moveto */
 	guint moving : 1;	/* Bpath end is moving */
 	guint closed : 1;	/* All subpaths are closed */
+	guint shared : 1;	/* Immutable, held as typed attribute value */
 };
 
 #define SP_CURVE_LENGTH(c) (((SPCurve *)(c))->end)
@@ -16,6 +16,7 @@
 
 #include <png.h>
 #include <glib.h>
+#include <libnr/nr-trace.h>
 #include "png-write.h"
 
 /* This is an example of how to use libpng to read and write PNG files.
@@ -234,6 +235,7 @@ sp_png_write_rgba_striped (const gchar *filename, int width, int height,
 	png_color_8 sig_bit;
 	png_text text_ptr[3];
 	png_uint_32 r;
+	double trace = 0.0;
 
 	g_return_val_if_fail (filename != NULL, FALSE);
 
@@ -352,7 +354,10 @@ sp_png_write_rgba_striped (const gchar *filename, int width, int height,
 		h = MIN (height - r, 64);
 		n = get_rows ((const unsigned char **) row_pointers, r, h, data);
 		if (!n) break;
+		/* Rows are rendered by get_rows, so only encoding is timed here */
+		NR_TRACE_BEGIN (trace, "png-encode");
 		png_write_rows (png_ptr, row_pointers, n);
+		NR_TRACE_END (trace, "png-encode");
 		r += n;
 	}
 
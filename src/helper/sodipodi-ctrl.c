@@ -277,37 +277,34 @@ sp_ctrl_point (SPCanvasItem *item, double x, double y, SPCanvasItem **actual_ite
 	return 1e18;
 }
 
-static void
-sp_ctrl_build_cache (SPCtrl *ctrl)
+/**
+ * Renders control shape of given span into (2 * span + 1)^2 RGBA buffer,
+ * pixbuf is only used by bitmap and image shapes
+ */
+void
+sp_ctrl_build_image (guchar *cache, SPCtrlShapeType shape, gint span, guint32 fill_color, guint32 stroke_color, GdkPixbuf *pixbuf)
 {
         guchar * p, *q;
 	gint size, x, y, z, s, a, side, c;
 	guint8 fr, fg, fb, fa, sr, sg, sb, sa;
-	
-	if (ctrl->filled) {
-	       fr = (ctrl->fill_color >> 24) & 0xff;
-	       fg = (ctrl->fill_color >> 16) & 0xff;
-	       fb = (ctrl->fill_color >> 8) & 0xff;
-	       fa = (ctrl->fill_color) & 0xff;
-	} else { fr = 0x00; fg = 0x00; fb = 0x00; fa = 0x00; }
-	if (ctrl->stroked) {
-		sr = (ctrl->stroke_color >> 24) & 0xff;
-		sg = (ctrl->stroke_color >> 16) & 0xff;
-		sb = (ctrl->stroke_color >> 8) & 0xff;
-		sa = (ctrl->stroke_color) & 0xff;
-	} else { sr = fr; sg = fg; sb = fb; sa = fa; }
-
-
- 	side = (ctrl->span * 2 +1);
-	c = ctrl->span ;
-	g_free (ctrl->cache);
+
+	fr = (fill_color >> 24) & 0xff;
+	fg = (fill_color >> 16) & 0xff;
+	fb = (fill_color >> 8) & 0xff;
+	fa = (fill_color) & 0xff;
+	sr = (stroke_color >> 24) & 0xff;
+	sg = (stroke_color >> 16) & 0xff;
+	sb = (stroke_color >> 8) & 0xff;
+	sa = (stroke_color) & 0xff;
+
+ 	side = (span * 2 +1);
+	c = span ;
 	size = (side) * (side) * 4;
-	ctrl->cache = (guchar*)g_malloc (size);
 	if (side < 2) return;
 	
-	switch (ctrl->shape) {
+	switch (shape) {
 	case SP_CTRL_SHAPE_SQUARE: 
-		p = ctrl->cache;
+		p = cache;
 		for (x=0; x < side; x++) { *p++ = sr; *p++ = sg; *p++ = sb; *p++ = sa; }
 		for (y = 2; y < side; y++) {
 			*p++ = sr; *p++ = sg; *p++ = sb; *p++ = sa;
@@ -315,10 +312,9 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 			*p++ = sr; *p++ = sg; *p++ = sb; *p++ = sa;
 		}
 		for (x=0; x < side; x++) { *p++ = sr; *p++ = sg; *p++ = sb; *p++ = sa; }
-		ctrl->build = TRUE;
 		break;
 	case SP_CTRL_SHAPE_DIAMOND:
-		p = ctrl->cache;
+		p = cache;
 		for (y = 0; y < side; y++) {
 			z = abs (c - y);
 			for (x = 0; x < z; x++) {*p++ = 0x00; *p++ = 0x00; *p++ = 0x00; *p++ = 0x00;}
@@ -329,7 +325,7 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 		}
 		break;
 	case SP_CTRL_SHAPE_CIRCLE:
-		p = ctrl->cache;
+		p = cache;
 		q = p + size -1;
 		s = -1;
 		for (y = 0; y <= c ; y++) {
@@ -363,10 +359,9 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 			}
 			s = z;
 		}
-		ctrl->build = TRUE;
 		break;
 	case SP_CTRL_SHAPE_CROSS:
-		p = ctrl->cache;
+		p = cache;
 		for (y = 0; y < side; y++) {
 			z = abs (c - y);
 			for (x = 0; x < c-z; x++) {*p++ = 0x00; *p++ = 0x00; *p++ = 0x00; *p++ = 0x00;}
@@ -375,18 +370,17 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 			if (z != 0) {*p++ = sr; *p++ = sg; *p++ = sb; *p++ = sa; x++;} 
 			for (; x < side; x++) {*p++ = 0x00; *p++ = 0x00; *p++ = 0x00; *p++ = 0x00;}
 		}
-		ctrl->build = TRUE;
 		break;
 	case SP_CTRL_SHAPE_BITMAP:
-		if (ctrl->pixbuf) {
+		if (pixbuf) {
 			unsigned char *px;
 			unsigned int rs;
-			px = gdk_pixbuf_get_pixels (ctrl->pixbuf);
-			rs = gdk_pixbuf_get_rowstride (ctrl->pixbuf);
+			px = gdk_pixbuf_get_pixels (pixbuf);
+			rs = gdk_pixbuf_get_rowstride (pixbuf);
 			for (y = 0; y < side; y++){
 				unsigned char *s, *d;
 				s = px + y * rs;
-				d = ctrl->cache + 4 * side * y;
+				d = cache + 4 * side * y;
 				for (x = 0; x < side; x++) {
 					if (s[3] < 0x80) {
 						d[0] = 0x00;
@@ -411,14 +405,13 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 		} else {
 			g_print ("control has no pixmap\n");
 		}
-		ctrl->build = TRUE;
 		break;
 	case SP_CTRL_SHAPE_IMAGE:
-		if (ctrl->pixbuf) {
-			guint r = gdk_pixbuf_get_rowstride (ctrl->pixbuf);
+		if (pixbuf) {
+			guint r = gdk_pixbuf_get_rowstride (pixbuf);
 			guchar * pix;
-			q = gdk_pixbuf_get_pixels (ctrl->pixbuf);
-			p = ctrl->cache;
+			q = gdk_pixbuf_get_pixels (pixbuf);
+			p = cache;
 			for (y = 0; y < side; y++){
 				pix = q + (y * r);
 				for (x = 0; x < side; x++) {
@@ -429,7 +422,6 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 				}
 			}
 		} else { g_print ("control has no pixmap\n"); } 
-		ctrl->build = TRUE;
 		break;
 	default:
 		break;
@@ -437,6 +429,23 @@ sp_ctrl_build_cache (SPCtrl *ctrl)
 	
 }
 
+static void
+sp_ctrl_build_cache (SPCtrl *ctrl)
+{
+	guint32 fill, stroke;
+	gint side;
+
+	fill = (ctrl->filled) ? ctrl->fill_color : 0x0;
+	stroke = (ctrl->stroked) ? ctrl->stroke_color : fill;
+
+	side = ctrl->span * 2 + 1;
+	g_free (ctrl->cache);
+	ctrl->cache = (guchar*)g_malloc (side * side * 4);
+
+	sp_ctrl_build_image (ctrl->cache, ctrl->shape, ctrl->span, fill, stroke, ctrl->pixbuf);
+	ctrl->build = TRUE;
+}
+
 #define COMPOSEP11(fc,fa,bc) (((255 - (fa)) * (bc) + (fc) * 255 + 127) / 255)
 #define COMPOSEN11(fc,fa,bc) (((255 - (fa)) * (bc) + (fc) * (fa) + 127) / 255)
 
@@ -68,6 +68,9 @@ GtkType sp_ctrl_get_type (void);
 
 void sp_ctrl_moveto (SPCtrl * ctrl, double x, double y);
 
+/* Renders shape into (2 * span + 1)^2 RGBA buffer, shared with control sets */
+void sp_ctrl_build_image (guchar *cache, SPCtrlShapeType shape, gint span, guint32 fill_color, guint32 stroke_color, GdkPixbuf *pixbuf);
+
 G_END_DECLS
 
 #endif
@@ -19,6 +19,7 @@
 #include <libnr/nr-values.h>
 #include <libnr/nr-macros.h>
 #include <libnr/nr-pixblock.h>
+#include <libnr/nr-trace.h>
 
 #include <gtk/gtkmain.h>
 #include <gtk/gtksignal.h>
@@ -36,6 +37,10 @@
 #include "sp-canvas.h"
 
 #define SP_CANVAS_UPDATE_PRIORITY G_PRIORITY_HIGH_IDLE
+/* Coalesced motion is dispatched before update */
+#define SP_CANVAS_MOTION_PRIORITY (G_PRIORITY_HIGH_IDLE - 10)
+/* Minimum time between picks on motion, in ms */
+#define SP_CANVAS_PICK_INTERVAL 20
 
 #define SP_CANVAS_WINDOW(c) (((GtkWidget *) (c))->window)
 #define DISPLAY_X1(canvas) (((SPCanvas *) (canvas))->x0)
@@ -899,6 +904,9 @@ static gint sp_canvas_crossing (GtkWidget *widget, GdkEventCrossing *event);
 static gint sp_canvas_focus_in (GtkWidget *widget, GdkEventFocus *event);
 static gint sp_canvas_focus_out (GtkWidget *widget, GdkEventFocus *event);
 
+static int sp_canvas_flush_motion (SPCanvas *canvas);
+static gint motion_idle_handler (gpointer data);
+
 static GtkWidgetClass *canvas_parent_class;
 
 /**
@@ -980,6 +988,8 @@ sp_canvas_init (SPCanvas *canvas)
 	gtk_object_ref (GTK_OBJECT (canvas->root));
 	gtk_object_sink (GTK_OBJECT (canvas->root));
 
+	canvas->motion_samples = g_array_new (FALSE, FALSE, sizeof (SPCanvasMotionSample));
+
 	canvas->need_repick = TRUE;
 }
 
@@ -1013,6 +1023,23 @@ shutdown_transients (SPCanvas *canvas)
 		gdk_pointer_ungrab (GDK_CURRENT_TIME);
 	}
 
+	/* Pending motion is dropped */
+	if (canvas->motion_id) {
+		gtk_idle_remove (canvas->motion_id);
+		canvas->motion_id = 0;
+	}
+	if (canvas->pick_id) {
+		gtk_timeout_remove (canvas->pick_id);
+		canvas->pick_id = 0;
+	}
+	canvas->motion_pending = FALSE;
+	canvas->pick_pending = FALSE;
+	if (canvas->motion_event) {
+		gdk_event_free (canvas->motion_event);
+		canvas->motion_event = NULL;
+	}
+	if (canvas->motion_samples) g_array_set_size (canvas->motion_samples, 0);
+
 	remove_idle (canvas);
 }
 
@@ -1031,6 +1058,11 @@ sp_canvas_destroy (GtkObject *object)
 
 	shutdown_transients (canvas);
 
+	if (canvas->motion_samples) {
+		g_array_free (canvas->motion_samples, TRUE);
+		canvas->motion_samples = NULL;
+	}
+
 	if (GTK_OBJECT_CLASS (canvas_parent_class)->destroy)
 		(* GTK_OBJECT_CLASS (canvas_parent_class)->destroy) (object);
 }
@@ -1433,6 +1465,9 @@ sp_canvas_button (GtkWidget *widget, GdkEventButton *event)
 
 	retval = FALSE;
 
+	/* Keep order of events */
+	sp_canvas_flush_motion (canvas);
+
 	/* dispatch normally regardless of the event's window if an item has
 	   has a pointer grab in effect */
 	if (!canvas->grabbed_item && event->window != SP_CANVAS_WINDOW (canvas)) return retval;
@@ -1498,6 +1533,8 @@ sp_canvas_scroll (GtkWidget *widget, GdkEventScroll *event)
 
 	canvas = SP_CANVAS (widget);
 
+	sp_canvas_flush_motion (canvas);
+
 	return emit_event (canvas, (GdkEvent *) event);
 }
 
@@ -1506,7 +1543,7 @@ static int
 sp_canvas_motion (GtkWidget *widget, GdkEventMotion *event)
 {
 	SPCanvas *canvas;
-	int ret;
+	SPCanvasMotionSample sample;
 
 	canvas = SP_CANVAS (widget);
 
@@ -1519,13 +1556,123 @@ sp_canvas_motion (GtkWidget *widget, GdkEventMotion *event)
 		event->y = y;
 	}
 
-	canvas->state = event->state;
-	pick_current_item (canvas, (GdkEvent *) event);
-	ret = emit_event (canvas, (GdkEvent *) event);
+	/* Collect sample, in window coordinates until dispatch */
+	sample.x = event->x;
+	sample.y = event->y;
+	sample.time = event->time;
+	sample.state = event->state;
+	g_array_append_val (canvas->motion_samples, sample);
+
+	if (canvas->motion_event) gdk_event_free (canvas->motion_event);
+	canvas->motion_event = gdk_event_copy ((GdkEvent *) event);
+	canvas->motion_pending = TRUE;
+
+	/* Queued events are handled before idle, so they end in single dispatch */
+	if (!canvas->motion_id) {
+		canvas->motion_id = gtk_idle_add_priority (SP_CANVAS_MOTION_PRIORITY, motion_idle_handler, canvas);
+	}
+
+	return TRUE;
+}
+
+static gint
+pick_timeout_handler (gpointer data)
+{
+	SPCanvas *canvas;
+
+	GDK_THREADS_ENTER ();
+
+	canvas = SP_CANVAS (data);
+
+	canvas->pick_id = 0;
+	if (canvas->pick_pending && !canvas->grabbed_item && canvas->motion_event) {
+		canvas->pick_pending = FALSE;
+		canvas->pick_time = canvas->motion_event->motion.time;
+		pick_current_item (canvas, canvas->motion_event);
+	}
+
+	GDK_THREADS_LEAVE ();
+
+	return FALSE;
+}
+
+/* Dispatches pending motion event, picking new current item at limited rate */
+static int
+sp_canvas_flush_motion (SPCanvas *canvas)
+{
+	GdkEvent *event;
+	guint i;
+	int ret;
+
+	if (!canvas->motion_pending) return FALSE;
+	canvas->motion_pending = FALSE;
+	if (canvas->motion_id) {
+		gtk_idle_remove (canvas->motion_id);
+		canvas->motion_id = 0;
+	}
+
+	event = canvas->motion_event;
+	canvas->state = event->motion.state;
+
+	/* Grabbed item gets everything, so there is nothing to pick */
+	if (!canvas->grabbed_item) {
+		if ((event->motion.time - canvas->pick_time) >= SP_CANVAS_PICK_INTERVAL) {
+			canvas->pick_pending = FALSE;
+			canvas->pick_time = event->motion.time;
+			pick_current_item (canvas, event);
+		} else {
+			canvas->pick_pending = TRUE;
+			if (!canvas->pick_id) {
+				canvas->pick_id = gtk_timeout_add (SP_CANVAS_PICK_INTERVAL, pick_timeout_handler, canvas);
+			}
+		}
+	}
+
+	for (i = 0; i < canvas->motion_samples->len; i++) {
+		SPCanvasMotionSample *sample;
+		sample = &g_array_index (canvas->motion_samples, SPCanvasMotionSample, i);
+		sample->x += canvas->x0;
+		sample->y += canvas->y0;
+	}
+
+	/* Handlers may destroy canvas */
+	gtk_object_ref (GTK_OBJECT (canvas));
+	ret = emit_event (canvas, event);
+	if (canvas->motion_samples) g_array_set_size (canvas->motion_samples, 0);
+	gtk_object_unref (GTK_OBJECT (canvas));
 
 	return ret;
 }
 
+static gint
+motion_idle_handler (gpointer data)
+{
+	SPCanvas *canvas;
+
+	GDK_THREADS_ENTER ();
+
+	canvas = SP_CANVAS (data);
+
+	canvas->motion_id = 0;
+	sp_canvas_flush_motion (canvas);
+
+	GDK_THREADS_LEAVE ();
+
+	return FALSE;
+}
+
+const SPCanvasMotionSample *
+sp_canvas_get_motion_history (SPCanvas *canvas, guint *length)
+{
+	g_return_val_if_fail (canvas != NULL, NULL);
+	g_return_val_if_fail (SP_IS_CANVAS (canvas), NULL);
+	g_return_val_if_fail (length != NULL, NULL);
+
+	*length = canvas->motion_samples->len;
+
+	return (const SPCanvasMotionSample *) canvas->motion_samples->data;
+}
+
 /* We have to fit into pixelstore 64K */
 #define IMAGE_WIDTH_AA 341
 #define IMAGE_HEIGHT_AA 64
@@ -1660,6 +1807,8 @@ sp_canvas_key (GtkWidget *widget, GdkEventKey *event)
 
 	canvas = SP_CANVAS (widget);
 
+	sp_canvas_flush_motion (canvas);
+
 	return emit_event (canvas, (GdkEvent *) event);
 }
 
@@ -1673,6 +1822,8 @@ sp_canvas_crossing (GtkWidget *widget, GdkEventCrossing *event)
 
 	if (event->window != SP_CANVAS_WINDOW (canvas)) return FALSE;
 
+	sp_canvas_flush_motion (canvas);
+
 	canvas->state = event->state;
 	return pick_current_item (canvas, (GdkEvent *) event);
 }
@@ -1848,6 +1999,7 @@ idle_handler (gpointer data)
 	canvas = SP_CANVAS (data);
 
 	ret = do_update (canvas);
+	NR_TRACE_FRAME ("canvas");
 
 	if (ret) {
 		/* Reset idle id */
@@ -1906,6 +2058,7 @@ sp_canvas_update_now (SPCanvas *canvas)
 
 	remove_idle (canvas);
 	do_update (canvas);
+	NR_TRACE_FRAME ("canvas");
 }
 
 static void
@@ -95,6 +95,15 @@ gint sp_canvas_item_order (SPCanvasItem * item);
 
 /* SPCanvas */
 
+typedef struct _SPCanvasMotionSample SPCanvasMotionSample;
+
+/* Pointer position in world coordinates */
+struct _SPCanvasMotionSample {
+	double x, y;
+	guint32 time;
+	guint state;
+};
+
 struct _SPCanvas {
 	GtkWidget widget;
 
@@ -134,9 +143,19 @@ struct _SPCanvas {
 	/* GC for temporary draw pixmap */
 	GdkGC *pixmap_gc;
 
+	/* Latest motion event, dispatched from idle, and samples coalesced into it */
+	GdkEvent *motion_event;
+	GArray *motion_samples;
+	guint motion_id;
+	/* Time of last pick on motion, and timeout for deferred one */
+	guint32 pick_time;
+	guint pick_id;
+
 	unsigned int need_update : 1;
 	unsigned int need_redraw : 1;
 	unsigned int need_repick : 1;
+	unsigned int motion_pending : 1;
+	unsigned int pick_pending : 1;
 
 	/* For use by internal pick_current_item() function */
 	unsigned int left_grabbed_item : 1;
@@ -159,6 +178,13 @@ void sp_canvas_world_to_window (SPCanvas *canvas, double worldx, double worldy,
 
 NRRectF *sp_canvas_get_viewbox (SPCanvas *canvas, NRRectF *viewbox);
 
+/*
+ * Motion events are coalesced until idle.  While one is dispatched, this
+ * returns all samples it stands for, oldest first, ending with event itself.
+ * Tools tracing pointer (freehand) should use them instead of event.
+ */
+const SPCanvasMotionSample *sp_canvas_get_motion_history (SPCanvas *canvas, guint *length);
+
 G_END_DECLS
 
 #endif
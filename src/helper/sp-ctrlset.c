@@ -0,0 +1,894 @@
+#define __SP_CTRLSET_C__
+
+/*
+ * Set of controls drawn and picked as single canvas item
+ *
+ * Controls are rendered by hand, like SPCtrl, from shape images shared
+ * by all controls with same shape and colors.  Lines are drawn as 1 pixel
+ * non-aa lines clipped to rendered tile.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libart_lgpl/art_affine.h>
+
+#include "sp-canvas.h"
+#include "sp-canvas-util.h"
+#include "sp-ctrlset.h"
+
+/* Grid cells are 64 x 64 screen pixels */
+#define CELL_SHIFT 6
+#define CELL(v) ((v) >> CELL_SHIFT)
+#define CELL_KEY(cx,cy) GUINT_TO_POINTER ((((guint) (cx) & 0xffff) << 16) | ((guint) (cy) & 0xffff))
+/* Controls with long lines are not put into grid */
+#define MAX_CELLS 16
+
+typedef struct _SPCtrlSetEntry SPCtrlSetEntry;
+typedef struct _SPCtrlSetImage SPCtrlSetImage;
+
+struct _SPCtrlSetEntry {
+	gpointer data;
+	/* Position and line anchor in item coordinates */
+	double x, y;
+	double lx, ly;
+	guint used : 1;
+	guint visible : 1;
+	guint line : 1;
+	guint dirty : 1;
+	/* Is in grid or in large list, with current bbox */
+	guint indexed : 1;
+	guint large : 1;
+	guint shape : 4;
+	gint span;
+	guint32 fill, stroke, fill_hi, stroke_hi;
+	/* Screen box of shape, NB! x1 & y1 are included */
+	ArtIRect box;
+	/* Screen line ends */
+	gint x0, y0, x1, y1;
+	/* Screen bounds of shape and line */
+	ArtIRect bbox;
+	guint stamp;
+};
+
+struct _SPCtrlSetImage {
+	SPCtrlShapeType shape;
+	gint span;
+	guint32 fill, stroke;
+	guchar *px;
+};
+
+struct _SPCtrlSet {
+	SPCanvasItem item;
+
+	SPCtrlSetEntry *entries;
+	gint length;
+	gint size;
+	/* Handles of removed entries for reuse */
+	GArray *free;
+	/* Handles changed since last update */
+	GArray *dirty;
+
+	/* Cell key -> GArray of handles */
+	GHashTable *cells;
+	GArray *large;
+	/* Scratch for collected handles */
+	GArray *found;
+	guint stamp;
+
+	gint current;
+	guint32 line_rgba;
+	GSList *images;
+
+	guint mapped : 1;
+	double affine[6];
+};
+
+struct _SPCtrlSetClass {
+	SPCanvasItemClass parent_class;
+};
+
+static void sp_ctrlset_class_init (SPCtrlSetClass *klass);
+static void sp_ctrlset_init (SPCtrlSet *cs);
+static void sp_ctrlset_destroy (GtkObject *object);
+
+static void sp_ctrlset_update (SPCanvasItem *item, double *affine, unsigned int flags);
+static void sp_ctrlset_render (SPCanvasItem *item, SPCanvasBuf *buf);
+static double sp_ctrlset_point (SPCanvasItem *item, double x, double y, SPCanvasItem **actual_item);
+
+static SPCanvasItemClass *parent_class;
+
+GtkType
+sp_ctrlset_get_type (void)
+{
+	static GtkType type = 0;
+	if (!type) {
+		static const GTypeInfo info = {
+			sizeof (SPCtrlSetClass),
+			NULL,	/* base_init */
+			NULL,	/* base_finalize */
+			(GClassInitFunc) sp_ctrlset_class_init,
+			NULL,	/* class_finalize */
+			NULL,	/* class_data */
+			sizeof (SPCtrlSet),
+			0,	/* n_preallocs */
+			(GInstanceInitFunc) sp_ctrlset_init,
+		};
+		type = g_type_register_static (SP_TYPE_CANVAS_ITEM, "SPCtrlSet", &info, (GTypeFlags)0);
+	}
+	return type;
+}
+
+static void
+sp_ctrlset_class_init (SPCtrlSetClass *klass)
+{
+	GtkObjectClass *object_class;
+	SPCanvasItemClass *item_class;
+
+	object_class = (GtkObjectClass *) klass;
+	item_class = (SPCanvasItemClass *) klass;
+
+	parent_class = (SPCanvasItemClass *) gtk_type_class (SP_TYPE_CANVAS_ITEM);
+
+	object_class->destroy = sp_ctrlset_destroy;
+
+	item_class->update = sp_ctrlset_update;
+	item_class->render = sp_ctrlset_render;
+	item_class->point = sp_ctrlset_point;
+}
+
+static void
+sp_ctrlset_init (SPCtrlSet *cs)
+{
+	cs->entries = NULL;
+	cs->length = 0;
+	cs->size = 0;
+	cs->free = g_array_new (FALSE, FALSE, sizeof (gint));
+	cs->dirty = g_array_new (FALSE, FALSE, sizeof (gint));
+	cs->cells = g_hash_table_new (NULL, NULL);
+	cs->large = g_array_new (FALSE, FALSE, sizeof (gint));
+	cs->found = g_array_new (FALSE, FALSE, sizeof (gint));
+	cs->stamp = 0;
+	cs->current = -1;
+	cs->line_rgba = 0x0000ff7f;
+	cs->images = NULL;
+	cs->mapped = FALSE;
+}
+
+static gboolean
+sp_ctrlset_free_cell (gpointer key, gpointer value, gpointer data)
+{
+	g_array_free ((GArray *) value, TRUE);
+
+	return TRUE;
+}
+
+static void
+sp_ctrlset_destroy (GtkObject *object)
+{
+	SPCtrlSet *cs;
+
+	cs = SP_CTRLSET (object);
+
+	if (cs->cells) {
+		g_hash_table_foreach_remove (cs->cells, sp_ctrlset_free_cell, NULL);
+		g_hash_table_destroy (cs->cells);
+		cs->cells = NULL;
+	}
+	if (cs->free) {
+		g_free (cs->entries);
+		cs->entries = NULL;
+		cs->length = cs->size = 0;
+		g_array_free (cs->free, TRUE);
+		cs->free = NULL;
+		g_array_free (cs->dirty, TRUE);
+		g_array_free (cs->large, TRUE);
+		g_array_free (cs->found, TRUE);
+	}
+	while (cs->images) {
+		SPCtrlSetImage *image;
+		image = (SPCtrlSetImage *) cs->images->data;
+		g_free (image->px);
+		g_free (image);
+		cs->images = g_slist_remove (cs->images, image);
+	}
+
+	if (GTK_OBJECT_CLASS (parent_class)->destroy)
+		(* GTK_OBJECT_CLASS (parent_class)->destroy) (object);
+}
+
+/* Grid */
+
+static void
+sp_ctrlset_index_insert (SPCtrlSet *cs, gint handle)
+{
+	SPCtrlSetEntry *e;
+	gint cx0, cy0, cx1, cy1, cx, cy;
+
+	e = &cs->entries[handle];
+
+	cx0 = CELL (e->bbox.x0);
+	cy0 = CELL (e->bbox.y0);
+	cx1 = CELL (e->bbox.x1 - 1);
+	cy1 = CELL (e->bbox.y1 - 1);
+
+	e->large = ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > MAX_CELLS);
+	if (e->large) {
+		g_array_append_val (cs->large, handle);
+	} else {
+		for (cy = cy0; cy <= cy1; cy++) {
+			for (cx = cx0; cx <= cx1; cx++) {
+				GArray *cell;
+				cell = (GArray *) g_hash_table_lookup (cs->cells, CELL_KEY (cx, cy));
+				if (!cell) {
+					cell = g_array_new (FALSE, FALSE, sizeof (gint));
+					g_hash_table_insert (cs->cells, CELL_KEY (cx, cy), cell);
+				}
+				g_array_append_val (cell, handle);
+			}
+		}
+	}
+
+	e->indexed = TRUE;
+}
+
+static void
+sp_ctrlset_array_remove (GArray *array, gint handle)
+{
+	guint i;
+
+	for (i = 0; i < array->len; i++) {
+		if (g_array_index (array, gint, i) == handle) {
+			g_array_remove_index_fast (array, i);
+			return;
+		}
+	}
+}
+
+static void
+sp_ctrlset_index_remove (SPCtrlSet *cs, gint handle)
+{
+	SPCtrlSetEntry *e;
+	gint cx0, cy0, cx1, cy1, cx, cy;
+
+	e = &cs->entries[handle];
+
+	if (e->large) {
+		sp_ctrlset_array_remove (cs->large, handle);
+	} else {
+		cx0 = CELL (e->bbox.x0);
+		cy0 = CELL (e->bbox.y0);
+		cx1 = CELL (e->bbox.x1 - 1);
+		cy1 = CELL (e->bbox.y1 - 1);
+		for (cy = cy0; cy <= cy1; cy++) {
+			for (cx = cx0; cx <= cx1; cx++) {
+				GArray *cell;
+				cell = (GArray *) g_hash_table_lookup (cs->cells, CELL_KEY (cx, cy));
+				if (cell) sp_ctrlset_array_remove (cell, handle);
+			}
+		}
+	}
+
+	e->indexed = FALSE;
+}
+
+static void
+sp_ctrlset_entry_compute (SPCtrlSet *cs, SPCtrlSetEntry *e)
+{
+	ArtPoint p;
+	gint x, y;
+
+	p.x = e->x;
+	p.y = e->y;
+	art_affine_point (&p, &p, cs->affine);
+	x = (gint) (p.x + 0.5);
+	y = (gint) (p.y + 0.5);
+
+	e->box.x0 = x - e->span;
+	e->box.y0 = y - e->span;
+	e->box.x1 = x + e->span;
+	e->box.y1 = y + e->span;
+	e->bbox.x0 = e->box.x0;
+	e->bbox.y0 = e->box.y0;
+	e->bbox.x1 = e->box.x1 + 1;
+	e->bbox.y1 = e->box.y1 + 1;
+
+	if (e->line) {
+		e->x0 = x;
+		e->y0 = y;
+		p.x = e->lx;
+		p.y = e->ly;
+		art_affine_point (&p, &p, cs->affine);
+		e->x1 = (gint) (p.x + 0.5);
+		e->y1 = (gint) (p.y + 0.5);
+		e->bbox.x0 = MIN (e->bbox.x0, e->x1);
+		e->bbox.y0 = MIN (e->bbox.y0, e->y1);
+		e->bbox.x1 = MAX (e->bbox.x1, e->x1 + 1);
+		e->bbox.y1 = MAX (e->bbox.y1, e->y1 + 1);
+	}
+}
+
+static void
+sp_ctrlset_grow_bounds (SPCanvasItem *item, ArtIRect *bbox)
+{
+	if (item->x2 <= item->x1) {
+		item->x1 = bbox->x0;
+		item->y1 = bbox->y0;
+		item->x2 = bbox->x1;
+		item->y2 = bbox->y1;
+	} else {
+		item->x1 = MIN (item->x1, bbox->x0);
+		item->y1 = MIN (item->y1, bbox->y0);
+		item->x2 = MAX (item->x2, bbox->x1);
+		item->y2 = MAX (item->y2, bbox->y1);
+	}
+}
+
+/* Reindexes and redraws changed controls */
+static void
+sp_ctrlset_flush (SPCtrlSet *cs)
+{
+	SPCanvasItem *item;
+	guint i;
+
+	if (!cs->mapped) return;
+
+	item = SP_CANVAS_ITEM (cs);
+
+	for (i = 0; i < cs->dirty->len; i++) {
+		SPCtrlSetEntry *e;
+		gint handle;
+		handle = g_array_index (cs->dirty, gint, i);
+		e = &cs->entries[handle];
+		if (e->indexed) {
+			sp_canvas_request_redraw (item->canvas, e->bbox.x0, e->bbox.y0, e->bbox.x1, e->bbox.y1);
+			sp_ctrlset_index_remove (cs, handle);
+		}
+		if (e->used && e->visible) {
+			sp_ctrlset_entry_compute (cs, e);
+			sp_ctrlset_index_insert (cs, handle);
+			sp_canvas_request_redraw (item->canvas, e->bbox.x0, e->bbox.y0, e->bbox.x1, e->bbox.y1);
+			sp_ctrlset_grow_bounds (item, &e->bbox);
+		}
+		e->dirty = FALSE;
+	}
+	g_array_set_size (cs->dirty, 0);
+}
+
+static void
+sp_ctrlset_update (SPCanvasItem *item, double *affine, unsigned int flags)
+{
+	SPCtrlSet *cs;
+	gint i;
+
+	cs = SP_CTRLSET (item);
+
+	if (parent_class->update)
+		(* parent_class->update) (item, affine, flags);
+
+	if (cs->mapped && !memcmp (affine, cs->affine, 6 * sizeof (double))) {
+		sp_ctrlset_flush (cs);
+		return;
+	}
+
+	/* Zoom or scroll, rebuild everything */
+	memcpy (cs->affine, affine, 6 * sizeof (double));
+	cs->mapped = TRUE;
+
+	g_hash_table_foreach_remove (cs->cells, sp_ctrlset_free_cell, NULL);
+	g_array_set_size (cs->large, 0);
+	g_array_set_size (cs->dirty, 0);
+
+	sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+	sp_canvas_item_reset_bounds (item);
+
+	for (i = 0; i < cs->length; i++) {
+		SPCtrlSetEntry *e;
+		e = &cs->entries[i];
+		e->dirty = FALSE;
+		e->indexed = FALSE;
+		if (e->used && e->visible) {
+			sp_ctrlset_entry_compute (cs, e);
+			sp_ctrlset_index_insert (cs, i);
+			sp_ctrlset_grow_bounds (item, &e->bbox);
+		}
+	}
+
+	sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+}
+
+static gint
+sp_ctrlset_compare_handles (const void *a, const void *b)
+{
+	return *((const gint *) a) - *((const gint *) b);
+}
+
+static void
+sp_ctrlset_collect_entry (SPCtrlSet *cs, gint handle, ArtIRect *rect)
+{
+	SPCtrlSetEntry *e;
+
+	e = &cs->entries[handle];
+	if (!e->indexed || (e->stamp == cs->stamp)) return;
+	e->stamp = cs->stamp;
+
+	if ((e->bbox.x0 < rect->x1) && (e->bbox.y0 < rect->y1) &&
+	    (e->bbox.x1 > rect->x0) && (e->bbox.y1 > rect->y0)) {
+		g_array_append_val (cs->found, handle);
+	}
+}
+
+/* Collects indexed controls touching screen rectangle into cs->found, in handle order */
+static guint
+sp_ctrlset_collect (SPCtrlSet *cs, ArtIRect *rect)
+{
+	gint cx0, cy0, cx1, cy1, cx, cy, i;
+	guint j;
+
+	g_array_set_size (cs->found, 0);
+	if ((rect->x1 <= rect->x0) || (rect->y1 <= rect->y0)) return 0;
+
+	cs->stamp += 1;
+
+	cx0 = CELL (rect->x0);
+	cy0 = CELL (rect->y0);
+	cx1 = CELL (rect->x1 - 1);
+	cy1 = CELL (rect->y1 - 1);
+
+	if ((double) (cx1 - cx0 + 1) * (cy1 - cy0 + 1) > cs->length) {
+		for (i = 0; i < cs->length; i++) sp_ctrlset_collect_entry (cs, i, rect);
+		return cs->found->len;
+	}
+
+	for (cy = cy0; cy <= cy1; cy++) {
+		for (cx = cx0; cx <= cx1; cx++) {
+			GArray *cell;
+			cell = (GArray *) g_hash_table_lookup (cs->cells, CELL_KEY (cx, cy));
+			if (!cell) continue;
+			for (j = 0; j < cell->len; j++) {
+				sp_ctrlset_collect_entry (cs, g_array_index (cell, gint, j), rect);
+			}
+		}
+	}
+	for (j = 0; j < cs->large->len; j++) {
+		sp_ctrlset_collect_entry (cs, g_array_index (cs->large, gint, j), rect);
+	}
+
+	qsort (cs->found->data, cs->found->len, sizeof (gint), sp_ctrlset_compare_handles);
+
+	return cs->found->len;
+}
+
+/* Rendering */
+
+#define COMPOSEN11(fc,fa,bc) (((255 - (fa)) * (bc) + (fc) * (fa) + 127) / 255)
+
+static guchar *
+sp_ctrlset_get_image (SPCtrlSet *cs, SPCtrlShapeType shape, gint span, guint32 fill, guint32 stroke)
+{
+	SPCtrlSetImage *image;
+	GSList *l;
+	gint side;
+
+	for (l = cs->images; l != NULL; l = l->next) {
+		image = (SPCtrlSetImage *) l->data;
+		if ((image->shape == shape) && (image->span == span) &&
+		    (image->fill == fill) && (image->stroke == stroke)) return image->px;
+	}
+
+	side = 2 * span + 1;
+	image = g_new (SPCtrlSetImage, 1);
+	image->shape = shape;
+	image->span = span;
+	image->fill = fill;
+	image->stroke = stroke;
+	image->px = g_new0 (guchar, side * side * 4);
+	sp_ctrl_build_image (image->px, shape, span, fill, stroke, NULL);
+	cs->images = g_slist_prepend (cs->images, image);
+
+	return image->px;
+}
+
+static void
+sp_ctrlset_render_line (SPCtrlSetEntry *e, guint32 rgba, SPCanvasBuf *buf)
+{
+	gint dx, dy, t0, t1, t, x, y;
+	guint r, g, b, a;
+	guchar *p;
+
+	r = rgba >> 24;
+	g = (rgba >> 16) & 0xff;
+	b = (rgba >> 8) & 0xff;
+	a = rgba & 0xff;
+
+	dx = e->x1 - e->x0;
+	dy = e->y1 - e->y0;
+
+	if (abs (dx) >= abs (dy)) {
+		/* Step along x, only over columns of tile */
+		if (dx == 0) return;
+		t0 = MAX (MIN (e->x0, e->x1), buf->rect.x0);
+		t1 = MIN (MAX (e->x0, e->x1), buf->rect.x1 - 1);
+		for (t = t0; t <= t1; t++) {
+			y = e->y0 + (gint) floor ((double) (t - e->x0) * dy / dx + 0.5);
+			if ((y < buf->rect.y0) || (y >= buf->rect.y1)) continue;
+			p = buf->buf + (y - buf->rect.y0) * buf->buf_rowstride + (t - buf->rect.x0) * 3;
+			p[0] = COMPOSEN11 (r, a, p[0]);
+			p[1] = COMPOSEN11 (g, a, p[1]);
+			p[2] = COMPOSEN11 (b, a, p[2]);
+		}
+	} else {
+		t0 = MAX (MIN (e->y0, e->y1), buf->rect.y0);
+		t1 = MIN (MAX (e->y0, e->y1), buf->rect.y1 - 1);
+		for (t = t0; t <= t1; t++) {
+			x = e->x0 + (gint) floor ((double) (t - e->y0) * dx / dy + 0.5);
+			if ((x < buf->rect.x0) || (x >= buf->rect.x1)) continue;
+			p = buf->buf + (t - buf->rect.y0) * buf->buf_rowstride + (x - buf->rect.x0) * 3;
+			p[0] = COMPOSEN11 (r, a, p[0]);
+			p[1] = COMPOSEN11 (g, a, p[1]);
+			p[2] = COMPOSEN11 (b, a, p[2]);
+		}
+	}
+}
+
+static void
+sp_ctrlset_render_shape (SPCtrlSetEntry *e, guchar *px, SPCanvasBuf *buf)
+{
+	gint x0, y0, x1, y1, x, y;
+	guchar *p, *q;
+
+	y0 = MAX (e->box.y0, buf->rect.y0);
+	y1 = MIN (e->box.y1, buf->rect.y1 - 1);
+	x0 = MAX (e->box.x0, buf->rect.x0);
+	x1 = MIN (e->box.x1, buf->rect.x1 - 1);
+	for (y = y0; y <= y1; y++) {
+		p = buf->buf + (y - buf->rect.y0) * buf->buf_rowstride + (x0 - buf->rect.x0) * 3;
+		q = px + ((y - e->box.y0) * (e->span * 2 + 1) + (x0 - e->box.x0)) * 4;
+		for (x = x0; x <= x1; x++) {
+			p[0] = COMPOSEN11 (q[0], q[3], p[0]);
+			p[1] = COMPOSEN11 (q[1], q[3], p[1]);
+			p[2] = COMPOSEN11 (q[2], q[3], p[2]);
+			q += 4;
+			p += 3;
+		}
+	}
+}
+
+static void
+sp_ctrlset_render (SPCanvasItem *item, SPCanvasBuf *buf)
+{
+	SPCtrlSet *cs;
+	guint i;
+
+	cs = SP_CTRLSET (item);
+
+	if (!sp_ctrlset_collect (cs, &buf->rect)) return;
+
+	sp_canvas_buf_ensure_buf (buf);
+	buf->is_bg = FALSE;
+
+	/* Lines are below all controls */
+	for (i = 0; i < cs->found->len; i++) {
+		SPCtrlSetEntry *e;
+		e = &cs->entries[g_array_index (cs->found, gint, i)];
+		if (e->line) sp_ctrlset_render_line (e, cs->line_rgba, buf);
+	}
+
+	for (i = 0; i < cs->found->len; i++) {
+		SPCtrlSetEntry *e;
+		guchar *px;
+		gint handle;
+		handle = g_array_index (cs->found, gint, i);
+		e = &cs->entries[handle];
+		if (e->span < 1) continue;
+		if (handle == cs->current) {
+			px = sp_ctrlset_get_image (cs, (SPCtrlShapeType) e->shape, e->span, e->fill_hi, e->stroke_hi);
+		} else {
+			px = sp_ctrlset_get_image (cs, (SPCtrlShapeType) e->shape, e->span, e->fill, e->stroke);
+		}
+		sp_ctrlset_render_shape (e, px, buf);
+	}
+}
+
+static double
+sp_ctrlset_point (SPCanvasItem *item, double x, double y, SPCanvasItem **actual_item)
+{
+	*actual_item = item;
+
+	if (sp_ctrlset_find (SP_CTRLSET (item), x, y) >= 0) return 0.0;
+
+	return 1e18;
+}
+
+/* Methods */
+
+static void
+sp_ctrlset_entry_changed (SPCtrlSet *cs, gint handle)
+{
+	SPCtrlSetEntry *e;
+
+	e = &cs->entries[handle];
+	if (e->dirty) return;
+
+	e->dirty = TRUE;
+	g_array_append_val (cs->dirty, handle);
+	sp_canvas_item_request_update (SP_CANVAS_ITEM (cs));
+}
+
+gint
+sp_ctrlset_add (SPCtrlSet *cs, SPCtrlShapeType shape, gint size, gpointer data)
+{
+	SPCtrlSetEntry *e;
+	gint handle;
+
+	g_return_val_if_fail (cs != NULL, -1);
+	g_return_val_if_fail (SP_IS_CTRLSET (cs), -1);
+
+	if (cs->free->len > 0) {
+		handle = g_array_index (cs->free, gint, cs->free->len - 1);
+		g_array_set_size (cs->free, cs->free->len - 1);
+	} else {
+		if (cs->length >= cs->size) {
+			cs->size = MAX (cs->size << 1, 32);
+			cs->entries = g_renew (SPCtrlSetEntry, cs->entries, cs->size);
+		}
+		handle = cs->length++;
+		e = &cs->entries[handle];
+		e->dirty = FALSE;
+		e->indexed = FALSE;
+		e->large = FALSE;
+		e->stamp = 0;
+	}
+
+	/* Grid state of reused entry is cleaned up by pending update */
+	e = &cs->entries[handle];
+	e->data = data;
+	e->x = e->y = 0.0;
+	e->lx = e->ly = 0.0;
+	e->used = TRUE;
+	e->visible = FALSE;
+	e->line = FALSE;
+	e->shape = shape;
+	e->span = (size - 1) / 2;
+	e->fill = 0x000000ff;
+	e->stroke = 0x000000ff;
+	e->fill_hi = 0x000000ff;
+	e->stroke_hi = 0x000000ff;
+
+	return handle;
+}
+
+void
+sp_ctrlset_remove (SPCtrlSet *cs, gint handle)
+{
+	g_return_if_fail (cs != NULL);
+	g_return_if_fail (SP_IS_CTRLSET (cs));
+	g_return_if_fail ((handle >= 0) && (handle < cs->length));
+	g_return_if_fail (cs->entries[handle].used);
+
+	cs->entries[handle].used = FALSE;
+	cs->entries[handle].data = NULL;
+	if (cs->current == handle) cs->current = -1;
+
+	sp_ctrlset_entry_changed (cs, handle);
+	g_array_append_val (cs->free, handle);
+}
+
+#define CHECK_HANDLE(cs,h) \
+	g_return_if_fail (cs != NULL); \
+	g_return_if_fail (SP_IS_CTRLSET (cs)); \
+	g_return_if_fail ((h >= 0) && (h < cs->length)); \
+	g_return_if_fail (cs->entries[h].used);
+
+void
+sp_ctrlset_set_shape (SPCtrlSet *cs, gint handle, SPCtrlShapeType shape, gint size)
+{
+	SPCtrlSetEntry *e;
+
+	CHECK_HANDLE (cs, handle);
+
+	e = &cs->entries[handle];
+	if ((e->shape == shape) && (e->span == (size - 1) / 2)) return;
+
+	e->shape = shape;
+	e->span = (size - 1) / 2;
+	sp_ctrlset_entry_changed (cs, handle);
+}
+
+void
+sp_ctrlset_set_colors (SPCtrlSet *cs, gint handle, guint32 fill, guint32 stroke, guint32 fill_hi, guint32 stroke_hi)
+{
+	SPCtrlSetEntry *e;
+
+	CHECK_HANDLE (cs, handle);
+
+	e = &cs->entries[handle];
+	if ((e->fill == fill) && (e->stroke == stroke) && (e->fill_hi == fill_hi) && (e->stroke_hi == stroke_hi)) return;
+
+	e->fill = fill;
+	e->stroke = stroke;
+	e->fill_hi = fill_hi;
+	e->stroke_hi = stroke_hi;
+	sp_ctrlset_entry_changed (cs, handle);
+}
+
+void
+sp_ctrlset_set_position (SPCtrlSet *cs, gint handle, double x, double y)
+{
+	SPCtrlSetEntry *e;
+
+	CHECK_HANDLE (cs, handle);
+
+	e = &cs->entries[handle];
+	if ((e->x == x) && (e->y == y)) return;
+
+	e->x = x;
+	e->y = y;
+	sp_ctrlset_entry_changed (cs, handle);
+}
+
+void
+sp_ctrlset_set_line (SPCtrlSet *cs, gint handle, gboolean line, double x, double y)
+{
+	SPCtrlSetEntry *e;
+
+	CHECK_HANDLE (cs, handle);
+
+	e = &cs->entries[handle];
+	if (!line && !e->line) return;
+	if (line && e->line && (e->lx == x) && (e->ly == y)) return;
+
+	e->line = line;
+	e->lx = x;
+	e->ly = y;
+	sp_ctrlset_entry_changed (cs, handle);
+}
+
+void
+sp_ctrlset_set_line_rgba32 (SPCtrlSet *cs, guint32 rgba)
+{
+	SPCanvasItem *item;
+
+	g_return_if_fail (cs != NULL);
+	g_return_if_fail (SP_IS_CTRLSET (cs));
+
+	if (rgba != cs->line_rgba) {
+		cs->line_rgba = rgba;
+		item = SP_CANVAS_ITEM (cs);
+		sp_canvas_request_redraw (item->canvas, (int) item->x1, (int) item->y1, (int) item->x2, (int) item->y2);
+	}
+}
+
+void
+sp_ctrlset_show (SPCtrlSet *cs, gint handle, gboolean visible)
+{
+	SPCtrlSetEntry *e;
+
+	CHECK_HANDLE (cs, handle);
+
+	e = &cs->entries[handle];
+	if (e->visible == (visible != FALSE)) return;
+
+	e->visible = (visible != FALSE);
+	sp_ctrlset_entry_changed (cs, handle);
+}
+
+void
+sp_ctrlset_set_current (SPCtrlSet *cs, gint handle)
+{
+	g_return_if_fail (cs != NULL);
+	g_return_if_fail (SP_IS_CTRLSET (cs));
+	g_return_if_fail ((handle >= -1) && (handle < cs->length));
+
+	if (handle == cs->current) return;
+
+	if (cs->current >= 0) sp_ctrlset_entry_changed (cs, cs->current);
+	cs->current = handle;
+	if (cs->current >= 0) sp_ctrlset_entry_changed (cs, cs->current);
+}
+
+gpointer
+sp_ctrlset_get_data (SPCtrlSet *cs, gint handle)
+{
+	g_return_val_if_fail (cs != NULL, NULL);
+	g_return_val_if_fail (SP_IS_CTRLSET (cs), NULL);
+	g_return_val_if_fail ((handle >= 0) && (handle < cs->length), NULL);
+
+	return cs->entries[handle].data;
+}
+
+gboolean
+sp_ctrlset_get_position (SPCtrlSet *cs, gint handle, NRPointD *p)
+{
+	g_return_val_if_fail (cs != NULL, FALSE);
+	g_return_val_if_fail (SP_IS_CTRLSET (cs), FALSE);
+	g_return_val_if_fail ((handle >= 0) && (handle < cs->length), FALSE);
+	g_return_val_if_fail (p != NULL, FALSE);
+
+	if (!cs->entries[handle].used) return FALSE;
+
+	p->x = cs->entries[handle].x;
+	p->y = cs->entries[handle].y;
+
+	return TRUE;
+}
+
+gint
+sp_ctrlset_find (SPCtrlSet *cs, double x, double y)
+{
+	ArtIRect rect;
+	gint i;
+
+	g_return_val_if_fail (cs != NULL, -1);
+	g_return_val_if_fail (SP_IS_CTRLSET (cs), -1);
+
+	sp_ctrlset_flush (cs);
+
+	rect.x0 = (gint) floor (x);
+	rect.y0 = (gint) floor (y);
+	rect.x1 = rect.x0 + 1;
+	rect.y1 = rect.y0 + 1;
+	sp_ctrlset_collect (cs, &rect);
+
+	/* Topmost is drawn last */
+	for (i = (gint) cs->found->len - 1; i >= 0; i--) {
+		SPCtrlSetEntry *e;
+		gint handle;
+		handle = g_array_index (cs->found, gint, i);
+		e = &cs->entries[handle];
+		if ((x >= e->box.x0) && (x <= e->box.x1) && (y >= e->box.y0) && (y <= e->box.y1)) return handle;
+	}
+
+	return -1;
+}
+
+GSList *
+sp_ctrlset_find_rect (SPCtrlSet *cs, NRRectD *rect)
+{
+	ArtIRect srect;
+	ArtPoint p;
+	GSList *handles;
+	double x0, y0, x1, y1;
+	gint i;
+
+	g_return_val_if_fail (cs != NULL, NULL);
+	g_return_val_if_fail (SP_IS_CTRLSET (cs), NULL);
+	g_return_val_if_fail (rect != NULL, NULL);
+
+	sp_ctrlset_flush (cs);
+
+	if (!cs->mapped) return NULL;
+
+	/* Screen bounds of rectangle corners */
+	x0 = y0 = 1e18;
+	x1 = y1 = -1e18;
+	for (i = 0; i < 4; i++) {
+		p.x = (i & 1) ? rect->x1 : rect->x0;
+		p.y = (i & 2) ? rect->y1 : rect->y0;
+		art_affine_point (&p, &p, cs->affine);
+		x0 = MIN (x0, p.x);
+		y0 = MIN (y0, p.y);
+		x1 = MAX (x1, p.x);
+		y1 = MAX (y1, p.y);
+	}
+	srect.x0 = (gint) floor (x0) - 1;
+	srect.y0 = (gint) floor (y0) - 1;
+	srect.x1 = (gint) ceil (x1) + 2;
+	srect.y1 = (gint) ceil (y1) + 2;
+	sp_ctrlset_collect (cs, &srect);
+
+	handles = NULL;
+	for (i = (gint) cs->found->len - 1; i >= 0; i--) {
+		SPCtrlSetEntry *e;
+		gint handle;
+		handle = g_array_index (cs->found, gint, i);
+		e = &cs->entries[handle];
+		if ((e->x >= rect->x0) && (e->x <= rect->x1) && (e->y >= rect->y0) && (e->y <= rect->y1)) {
+			handles = g_slist_prepend (handles, GINT_TO_POINTER (handle));
+		}
+	}
+
+	return handles;
+}
@@ -0,0 +1,57 @@
+#ifndef __SP_CTRLSET_H__
+#define __SP_CTRLSET_H__
+
+/*
+ * Set of controls drawn and picked as single canvas item
+ *
+ * Controls are small fixed-size shapes like SPCtrl, optionally
+ * connected by line to some anchor point.  Positions are in item
+ * (usually desktop) coordinates, controls are addressed by integer
+ * handles.  Controls are kept in uniform grid of screen cells, so
+ * rendering tile and picking only look at controls nearby, and moving
+ * control only redraws and reindexes that control.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <libnr/nr-types.h>
+#include "sp-canvas.h"
+#include "sodipodi-ctrl.h"
+
+G_BEGIN_DECLS
+
+#define SP_TYPE_CTRLSET (sp_ctrlset_get_type ())
+#define SP_CTRLSET(obj) (GTK_CHECK_CAST ((obj), SP_TYPE_CTRLSET, SPCtrlSet))
+#define SP_IS_CTRLSET(obj) (GTK_CHECK_TYPE ((obj), SP_TYPE_CTRLSET))
+
+typedef struct _SPCtrlSet SPCtrlSet;
+typedef struct _SPCtrlSetClass SPCtrlSetClass;
+
+GtkType sp_ctrlset_get_type (void);
+
+/* Returns handle of new, hidden control */
+gint sp_ctrlset_add (SPCtrlSet *cs, SPCtrlShapeType shape, gint size, gpointer data);
+void sp_ctrlset_remove (SPCtrlSet *cs, gint handle);
+
+void sp_ctrlset_set_shape (SPCtrlSet *cs, gint handle, SPCtrlShapeType shape, gint size);
+/* Highlighted colors are used for current control */
+void sp_ctrlset_set_colors (SPCtrlSet *cs, gint handle, guint32 fill, guint32 stroke, guint32 fill_hi, guint32 stroke_hi);
+void sp_ctrlset_set_position (SPCtrlSet *cs, gint handle, double x, double y);
+/* Draws line from control to given point */
+void sp_ctrlset_set_line (SPCtrlSet *cs, gint handle, gboolean line, double x, double y);
+void sp_ctrlset_set_line_rgba32 (SPCtrlSet *cs, guint32 rgba);
+void sp_ctrlset_show (SPCtrlSet *cs, gint handle, gboolean visible);
+/* Sets highlighted control, -1 for none */
+void sp_ctrlset_set_current (SPCtrlSet *cs, gint handle);
+
+gpointer sp_ctrlset_get_data (SPCtrlSet *cs, gint handle);
+gboolean sp_ctrlset_get_position (SPCtrlSet *cs, gint handle, NRPointD *p);
+
+/* Topmost visible control at canvas world point, or -1 */
+gint sp_ctrlset_find (SPCtrlSet *cs, double x, double y);
+/* Handles of visible controls with position inside item rectangle */
+GSList *sp_ctrlset_find_rect (SPCtrlSet *cs, NRRectD *rect);
+
+G_END_DECLS
+
+#endif
@@ -391,11 +391,12 @@ inkscape_segv_handler (int signum)
 				g_snprintf (c, 1024, "/tmp/inkscape-%.256s.%s.%d", docname, sptstr, count);
 				file = fopen (c, "w");
 			}
-			if (file) {
-				sp_repr_save_stream (sp_repr_document (repr), file);
+			if (file && sp_repr_save_stream (sp_repr_document (repr), file)) {
 				savednames = g_slist_prepend (savednames, g_strdup (c));
 				fclose (file);
 			} else {
+				/* Short write (full disk etc.) counts as failure */
+				if (file) fclose (file);
 				docname = sp_repr_attr (repr, "sodipodi:docname");
 				failednames = g_slist_prepend (failednames, (docname) ? g_strdup (docname) : g_strdup (_("Untitled document")));
 			}
@@ -419,6 +419,8 @@ sp_ui_view_menu (GtkMenu *menu, SPDocument *doc)
 	sp_ui_menu_append_item_from_verb (GTK_MENU (menu), SP_VERB_ZOOM_DRAWING);
 	sp_ui_menu_append_item_from_verb (GTK_MENU (menu), SP_VERB_ZOOM_PAGE);
 	sp_ui_menu_append_item_from_verb (GTK_MENU (menu), SP_VERB_ZOOM_PAGE_WIDTH);
+	sp_ui_menu_append_item (GTK_MENU (menu), NULL, NULL, NULL, NULL);
+	sp_ui_menu_append_item_from_verb (GTK_MENU (menu), SP_VERB_TOGGLE_DRAFT);
 	/* View:New View*/
 	sp_ui_menu_append_item (menu, NULL, NULL, NULL, NULL);
 	sp_ui_menu_append_item (menu, NULL, _("New View"), G_CALLBACK(sp_ui_new_view), NULL);
@@ -13,6 +13,7 @@
 #include "nr-pixops.h"
 #include "nr-compose.h"
 #include "nr-blit.h"
+#include "nr-trace.h"
 
 void
 nr_blit_pixblock_pixblock_alpha (NRPixBlock *d, NRPixBlock *s, unsigned int alpha)
@@ -21,6 +22,7 @@ nr_blit_pixblock_pixblock_alpha (NRPixBlock *d, NRPixBlock *s, unsigned int alph
 	unsigned char *dpx, *spx;
 	int dbpp, sbpp;
 	int w, h;
+	double trace = 0.0;
 
 	if (alpha == 0) return;
 	if (s->empty) return;
@@ -63,6 +65,7 @@ nr_blit_pixblock_pixblock_alpha (NRPixBlock *d, NRPixBlock *s, unsigned int alph
 	w = clip.x1 - clip.x0;
 	h = clip.y1 - clip.y0;
 
+	NR_TRACE_BEGIN (trace, "composite");
 	switch (d->mode) {
 	case NR_PIXBLOCK_MODE_A8:
 		/* No rendering into alpha at moment */
@@ -113,6 +116,7 @@ nr_blit_pixblock_pixblock_alpha (NRPixBlock *d, NRPixBlock *s, unsigned int alph
 		}
 		break;
 	}
+	NR_TRACE_END (trace, "composite");
 }
 
 void
@@ -122,6 +126,7 @@ nr_blit_pixblock_pixblock_mask (NRPixBlock *d, NRPixBlock *s, NRPixBlock *m)
 	unsigned char *dpx, *spx, *mpx;
 	int dbpp, sbpp;
 	int w, h;
+	double trace = 0.0;
 
 	if (s->empty) return;
 	/* fixme: */
@@ -165,6 +170,7 @@ nr_blit_pixblock_pixblock_mask (NRPixBlock *d, NRPixBlock *s, NRPixBlock *m)
 	w = clip.x1 - clip.x0;
 	h = clip.y1 - clip.y0;
 
+	NR_TRACE_BEGIN (trace, "composite");
 	switch (d->mode) {
 	case NR_PIXBLOCK_MODE_A8:
 		/* No rendering into alpha at moment */
@@ -215,11 +221,14 @@ nr_blit_pixblock_pixblock_mask (NRPixBlock *d, NRPixBlock *s, NRPixBlock *m)
 		}
 		break;
 	}
+	NR_TRACE_END (trace, "composite");
 }
 
 void
 nr_blit_pixblock_mask_rgba32 (NRPixBlock *d, NRPixBlock *m, unsigned long rgba)
 {
+	double trace = 0.0;
+
 	if (!(rgba & 0xff)) return;
 
 	if (m) {
@@ -239,6 +248,7 @@ nr_blit_pixblock_mask_rgba32 (NRPixBlock *d, NRPixBlock *m, unsigned long rgba)
 		w = clip.x1 - clip.x0;
 		h = clip.y1 - clip.y0;
 
+		NR_TRACE_BEGIN (trace, "composite");
 		if (d->empty) {
 			if (d->mode == NR_PIXBLOCK_MODE_R8G8B8) {
 				nr_R8G8B8_R8G8B8_A8_RGBA32 (dpx, w, h, d->rs, mpx, m->rs, rgba);
@@ -260,6 +270,7 @@ nr_blit_pixblock_mask_rgba32 (NRPixBlock *d, NRPixBlock *m, unsigned long rgba)
 	} else {
 		unsigned int r, g, b, a;
 		int x, y;
+		NR_TRACE_BEGIN (trace, "composite");
 		r = NR_RGBA32_R (rgba);
 		g = NR_RGBA32_G (rgba);
 		b = NR_RGBA32_B (rgba);
@@ -297,5 +308,6 @@ nr_blit_pixblock_mask_rgba32 (NRPixBlock *d, NRPixBlock *m, unsigned long rgba)
 			}
 		}
 	}
+	NR_TRACE_END (trace, "composite");
 }
 
@@ -24,6 +24,17 @@
 #define nr_free free
 #define nr_renew(p,t,n) ((t *) realloc (p, (n) * sizeof (t)))
 
+/* Free lists of path flattening are per thread, so it can run in parallel */
+#if defined (__GNUC__)
+#define NR_THREAD_LOCAL __thread
+#define NR_HAVE_THREAD_LOCAL 1
+#elif defined (_MSC_VER)
+#define NR_THREAD_LOCAL __declspec(thread)
+#define NR_HAVE_THREAD_LOCAL 1
+#else
+#define NR_THREAD_LOCAL
+#endif
+
 #ifndef TRUE
 #define TRUE (!0)
 #endif
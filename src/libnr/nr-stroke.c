@@ -143,82 +143,96 @@ nr_svl_stroke_build_finish_segment (NRSVLStrokeBuild *svlb)
 	nr_svl_build_finish_segment (&svlb->right);
 }
 
-#define MAX_SUBDIVIDE_DEPTH 10
+/* Sum of turning angles of polyline, bounding that of curve within it */
+
+static double
+nr_stroke_polyline_turn (const double *x, const double *y, int n)
+{
+	double px, py, turn;
+	int i;
+
+	px = py = 0.0;
+	turn = 0.0;
+	for (i = 1; i < n; i++) {
+		double dx, dy;
+		dx = x[i] - x[i - 1];
+		dy = y[i] - y[i - 1];
+		if ((dx == 0.0) && (dy == 0.0)) continue;
+		if ((px != 0.0) || (py != 0.0)) {
+			turn += fabs (atan2 (px * dy - py * dx, px * dx + py * dy));
+		}
+		px = dx;
+		py = dy;
+	}
+
+	return turn;
+}
 
 static void
 nr_svl_stroke_build_curveto (NRSVLStrokeBuild *svlb,
 			     double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3,
-			     float flatness, int level)
+			     float flatness)
 {
-	double t_x0, t_y0, t_x1, t_y1, t_x2, t_y2, t_x3, t_y3;
-	double dx1_0, dy1_0, dx2_0, dy2_0, dx3_0, dy3_0, dx2_3, dy2_3, d3_0_2;
-	double s1_q, t1_q, s2_q, t2_q, v2_q;
-	double f2, f2_q;
-	double x00t, y00t, x0tt, y0tt, xttt, yttt, x1tt, y1tt, x11t, y11t;
-
-	if (level >= MAX_SUBDIVIDE_DEPTH) goto nosubdivide;
-
-	t_x0 = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x0, y0);
-	t_y0 = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x0, y0);
-	t_x1 = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x1, y1);
-	t_y1 = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x1, y1);
-	t_x2 = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x2, y2);
-	t_y2 = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x2, y2);
-	t_x3 = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x3, y3);
-	t_y3 = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x3, y3);
-
-	dx1_0 = t_x1 - t_x0;
-	dy1_0 = t_y1 - t_y0;
-	dx2_0 = t_x2 - t_x0;
-	dy2_0 = t_y2 - t_y0;
-	dx3_0 = t_x3 - t_x0;
-	dy3_0 = t_y3 - t_y0;
-	dx2_3 = t_x3 - t_x2;
-	dy2_3 = t_y3 - t_y2;
-	f2 = flatness * flatness;
-	d3_0_2 = dx3_0 * dx3_0 + dy3_0 * dy3_0;
-	if (d3_0_2 < f2) {
-		double d1_0_2, d2_0_2;
-		d1_0_2 = dx1_0 * dx1_0 + dy1_0 * dy1_0;
-		d2_0_2 = dx2_0 * dx2_0 + dy2_0 * dy2_0;
-		if ((d1_0_2 < f2) && (d2_0_2 < f2)) {
-			goto nosubdivide;
-		} else {
-			goto subdivide;
+	double tx[4], ty[4];
+	double width_2;
+	unsigned int n, i;
+
+	tx[0] = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x0, y0);
+	ty[0] = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x0, y0);
+	tx[1] = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x1, y1);
+	ty[1] = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x1, y1);
+	tx[2] = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x2, y2);
+	ty[2] = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x2, y2);
+	tx[3] = NR_MATRIX_DF_TRANSFORM_X (&svlb->transform, x3, y3);
+	ty[3] = NR_MATRIX_DF_TRANSFORM_Y (&svlb->transform, x3, y3);
+
+	n = nr_curve_flatten_steps (tx[0], ty[0], tx[1], ty[1], tx[2], ty[2], tx[3], ty[3], flatness);
+
+	/*
+	 * Steps are joined by bevels, cutting outer edge at turn a by
+	 * width_2 * (1 - cos (a / 2)), so wide strokes need smaller turns
+	 */
+	width_2 = svlb->width_2 * NR_MATRIX_DF_EXPANSION (&svlb->transform);
+	if ((n > 1) && (width_2 > flatness)) {
+		double turn, amax;
+		turn = nr_stroke_polyline_turn (tx, ty, 4);
+		amax = 2.0 * acos (1.0 - flatness / width_2);
+		n = (unsigned int) MIN (MAX (n, ceil (turn / amax)), NR_CURVE_STEPS_MAX);
+	}
+
+	if (n > 1) {
+		double h, ax, ay, bx, by, cx, cy;
+		double fx1, fy1, fx2, fy2, fx3, fy3, x, y;
+		/* Forward differences of curve polynomial */
+		h = 1.0 / n;
+		ax = x3 - x0 + 3.0 * (x1 - x2);
+		ay = y3 - y0 + 3.0 * (y1 - y2);
+		bx = 3.0 * (x0 - 2.0 * x1 + x2);
+		by = 3.0 * (y0 - 2.0 * y1 + y2);
+		cx = 3.0 * (x1 - x0);
+		cy = 3.0 * (y1 - y0);
+		fx1 = ((ax * h + bx) * h + cx) * h;
+		fy1 = ((ay * h + by) * h + cy) * h;
+		fx2 = (6.0 * ax * h + 2.0 * bx) * h * h;
+		fy2 = (6.0 * ay * h + 2.0 * by) * h * h;
+		fx3 = 6.0 * ax * h * h * h;
+		fy3 = 6.0 * ay * h * h * h;
+		x = x0;
+		y = y0;
+		for (i = 1; i < n; i++) {
+			x += fx1;
+			y += fy1;
+			fx1 += fx2;
+			fy1 += fy2;
+			fx2 += fx3;
+			fy2 += fy3;
+			nr_svl_stroke_build_lineto (svlb, (float) x, (float) y);
+			/* Force all joins after first to bevels */
+			svlb->curve = TRUE;
 		}
 	}
-	f2_q = flatness * flatness * d3_0_2;
-	s1_q = dx1_0 * dx3_0 + dy1_0 * dy3_0;
-	t1_q = dy1_0 * dx3_0 - dx1_0 * dy3_0;
-	s2_q = dx2_0 * dx3_0 + dy2_0 * dy3_0;
-	t2_q = dy2_0 * dx3_0 - dx2_0 * dy3_0;
-	v2_q = dx2_3 * dx3_0 + dy2_3 * dy3_0;
-	if ((t1_q * t1_q) > f2_q) goto subdivide;
-	if ((t2_q * t2_q) > f2_q) goto subdivide;
-	if ((s1_q < 0.0) && ((s1_q * s1_q) > f2_q)) goto subdivide;
-	if ((v2_q < 0.0) && ((v2_q * v2_q) > f2_q)) goto subdivide;
-	if (s1_q >= s2_q) goto subdivide;
-
- nosubdivide:
+
 	nr_svl_stroke_build_lineto (svlb, (float) x3, (float) y3);
-	return;
-
- subdivide:
-	x00t = (x0 + x1) * 0.5;
-	y00t = (y0 + y1) * 0.5;
-	x0tt = (x0 + 2 * x1 + x2) * 0.25;
-	y0tt = (y0 + 2 * y1 + y2) * 0.25;
-	x1tt = (x1 + 2 * x2 + x3) * 0.25;
-	y1tt = (y1 + 2 * y2 + y3) * 0.25;
-	x11t = (x2 + x3) * 0.5;
-	y11t = (y2 + y3) * 0.5;
-	xttt = (x0tt + x1tt) * 0.5;
-	yttt = (y0tt + y1tt) * 0.5;
-
-	nr_svl_stroke_build_curveto (svlb, x0, y0, x00t, y00t, x0tt, y0tt, xttt, yttt, flatness, level + 1);
-	/* Force all joins after first to bevels */
-	svlb->curve = TRUE;
-	nr_svl_stroke_build_curveto (svlb, xttt, yttt, x1tt, y1tt, x11t, y11t, x3, y3, flatness, level + 1);
 }
 
 NRSVL *
@@ -288,7 +302,7 @@ nr_bpath_stroke (const NRBPath *path, NRMatrixF *transform,
 		case ART_CURVETO:
 			x = bp->x3;
 			y = bp->y3;
-			nr_svl_stroke_build_curveto (&svlb, sx, sy, bp->x1, bp->y1, bp->x2, bp->y2, x, y, flatness, 0);
+			nr_svl_stroke_build_curveto (&svlb, sx, sy, bp->x1, bp->y1, bp->x2, bp->y2, x, y, flatness);
 			/* Restore original join type */
 			svlb.curve = FALSE;
 			sx = x;
@@ -33,6 +33,11 @@ struct _NRSVLBuild {
 void nr_svl_build_finish_segment (NRSVLBuild *svlb);
 void nr_svl_build_moveto (NRSVLBuild *svlb, float x, float y);
 void nr_svl_build_lineto (NRSVLBuild *svlb, float x, float y);
+/* Upper limit of steps single curve is flattened into */
+#define NR_CURVE_STEPS_MAX 1024
+
+unsigned int nr_curve_flatten_steps (double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3,
+				     float flatness);
 void nr_svl_build_curveto (NRSVLBuild *svlb,
 			   double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3,
 			   float flatness);
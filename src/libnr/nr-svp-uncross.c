@@ -752,7 +752,7 @@ nr_svl_slice_ensure_vertex_at (NRSVLSlice *s, NRCoord x, NRCoord y)
 /* Slices */
 
 #define NR_SLICE_ALLOC_SIZE 32
-static NRSVLSlice * ffslice = NULL;
+static NR_THREAD_LOCAL NRSVLSlice * ffslice = NULL;
 
 NRSVLSlice *
 nr_svl_slice_new (NRSVL * svl, NRCoord y)
@@ -13,6 +13,7 @@
 
 #define NR_SVP_LENGTH_MAX 128
 
+#include <math.h>
 #include <assert.h>
 #include <stdio.h>
 #include <glib.h>
@@ -348,64 +349,76 @@ nr_svl_build_lineto (NRSVLBuild *svlb, float x, float y)
 	}
 }
 
+/*
+ * Number of uniform steps approximating curve within flatness, from the
+ * largest second difference of control points (Wang's formula).  Curves
+ * with control polygon shorter than quantization step collapse to single
+ * line, and no step is made shorter than that step.
+ */
+
+unsigned int
+nr_curve_flatten_steps (double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3,
+			float flatness)
+{
+	double ddx, ddy, dd2, len, step, n;
+
+	step = 1.0 / MIN (NR_QUANT_X, NR_QUANT_Y);
+	len = hypot (x1 - x0, y1 - y0) + hypot (x2 - x1, y2 - y1) + hypot (x3 - x2, y3 - y2);
+	if (len < step) return 1;
+
+	ddx = x0 - 2.0 * x1 + x2;
+	ddy = y0 - 2.0 * y1 + y2;
+	dd2 = ddx * ddx + ddy * ddy;
+	ddx = x1 - 2.0 * x2 + x3;
+	ddy = y1 - 2.0 * y2 + y3;
+	dd2 = MAX (dd2, ddx * ddx + ddy * ddy);
+	if (dd2 <= 0.0) return 1;
+
+	n = ceil (sqrt (0.75 * sqrt (dd2) / MAX (flatness, step)));
+	n = MIN (n, floor (len / step));
+	n = MIN (n, NR_CURVE_STEPS_MAX);
+
+	return (n > 1.0) ? (unsigned int) n : 1;
+}
+
 void
 nr_svl_build_curveto (NRSVLBuild *svlb, double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3, float flatness)
 {
-	double dx1_0, dy1_0, dx2_0, dy2_0, dx3_0, dy3_0, dx2_3, dy2_3, d3_0_2;
-	double s1_q, t1_q, s2_q, t2_q, v2_q;
-	double f2, f2_q;
-	double x00t, y00t, x0tt, y0tt, xttt, yttt, x1tt, y1tt, x11t, y11t;
-
-	dx1_0 = x1 - x0;
-	dy1_0 = y1 - y0;
-	dx2_0 = x2 - x0;
-	dy2_0 = y2 - y0;
-	dx3_0 = x3 - x0;
-	dy3_0 = y3 - y0;
-	dx2_3 = x3 - x2;
-	dy2_3 = y3 - y2;
-	f2 = flatness * flatness;
-	d3_0_2 = dx3_0 * dx3_0 + dy3_0 * dy3_0;
-	if (d3_0_2 < f2) {
-		double d1_0_2, d2_0_2;
-		d1_0_2 = dx1_0 * dx1_0 + dy1_0 * dy1_0;
-		d2_0_2 = dx2_0 * dx2_0 + dy2_0 * dy2_0;
-		if ((d1_0_2 < f2) && (d2_0_2 < f2)) {
-			goto nosubdivide;
-		} else {
-			goto subdivide;
+	unsigned int n, i;
+
+	n = nr_curve_flatten_steps (x0, y0, x1, y1, x2, y2, x3, y3, flatness);
+
+	if (n > 1) {
+		double h, ax, ay, bx, by, cx, cy;
+		double fx1, fy1, fx2, fy2, fx3, fy3, x, y;
+		/* Forward differences of curve polynomial */
+		h = 1.0 / n;
+		ax = x3 - x0 + 3.0 * (x1 - x2);
+		ay = y3 - y0 + 3.0 * (y1 - y2);
+		bx = 3.0 * (x0 - 2.0 * x1 + x2);
+		by = 3.0 * (y0 - 2.0 * y1 + y2);
+		cx = 3.0 * (x1 - x0);
+		cy = 3.0 * (y1 - y0);
+		fx1 = ((ax * h + bx) * h + cx) * h;
+		fy1 = ((ay * h + by) * h + cy) * h;
+		fx2 = (6.0 * ax * h + 2.0 * bx) * h * h;
+		fy2 = (6.0 * ay * h + 2.0 * by) * h * h;
+		fx3 = 6.0 * ax * h * h * h;
+		fy3 = 6.0 * ay * h * h * h;
+		x = x0;
+		y = y0;
+		for (i = 1; i < n; i++) {
+			x += fx1;
+			y += fy1;
+			fx1 += fx2;
+			fy1 += fy2;
+			fx2 += fx3;
+			fy2 += fy3;
+			nr_svl_build_lineto (svlb, (float) x, (float) y);
 		}
 	}
-	f2_q = flatness * flatness * d3_0_2;
-	s1_q = dx1_0 * dx3_0 + dy1_0 * dy3_0;
-	t1_q = dy1_0 * dx3_0 - dx1_0 * dy3_0;
-	s2_q = dx2_0 * dx3_0 + dy2_0 * dy3_0;
-	t2_q = dy2_0 * dx3_0 - dx2_0 * dy3_0;
-	v2_q = dx2_3 * dx3_0 + dy2_3 * dy3_0;
-	if ((t1_q * t1_q) > f2_q) goto subdivide;
-	if ((t2_q * t2_q) > f2_q) goto subdivide;
-	if ((s1_q < 0.0) && ((s1_q * s1_q) > f2_q)) goto subdivide;
-	if ((v2_q < 0.0) && ((v2_q * v2_q) > f2_q)) goto subdivide;
-	if (s1_q >= s2_q) goto subdivide;
-
- nosubdivide:
+
 	nr_svl_build_lineto (svlb, (float) x3, (float) y3);
-	return;
-
- subdivide:
-	x00t = (x0 + x1) * 0.5;
-	y00t = (y0 + y1) * 0.5;
-	x0tt = (x0 + 2 * x1 + x2) * 0.25;
-	y0tt = (y0 + 2 * y1 + y2) * 0.25;
-	x1tt = (x1 + 2 * x2 + x3) * 0.25;
-	y1tt = (y1 + 2 * y2 + y3) * 0.25;
-	x11t = (x2 + x3) * 0.5;
-	y11t = (y2 + y3) * 0.5;
-	xttt = (x0tt + x1tt) * 0.5;
-	yttt = (y0tt + y1tt) * 0.5;
-
-	nr_svl_build_curveto (svlb, x0, y0, x00t, y00t, x0tt, y0tt, xttt, yttt, flatness);
-	nr_svl_build_curveto (svlb, xttt, yttt, x1tt, y1tt, x11t, y11t, x3, y3, flatness);
 }
 
 NRSVL *
@@ -656,7 +669,7 @@ nr_svl_point_wind (NRSVL *svl, float x, float y)
 /* NRVertex */
 
 #define NR_VERTEX_ALLOC_SIZE 4096
-static NRVertex *ffvertex = NULL;
+static NR_THREAD_LOCAL NRVertex *ffvertex = NULL;
 
 NRVertex *
 nr_vertex_new (void)
@@ -756,7 +769,7 @@ nr_vertex_reverse_list (NRVertex * v)
 /* NRSVL */
 
 #define NR_SVL_ALLOC_SIZE 256
-static NRSVL *ffsvl = NULL;
+static NR_THREAD_LOCAL NRSVL *ffsvl = NULL;
 
 NRSVL *
 nr_svl_new (void)
@@ -949,7 +962,7 @@ nr_svl_calculate_bbox (NRSVL *svl)
 /* NRFlat */
 
 #define NR_FLAT_ALLOC_SIZE 128
-static NRFlat *ffflat = NULL;
+static NR_THREAD_LOCAL NRFlat *ffflat = NULL;
 
 NRFlat *
 nr_flat_new_full (NRCoord y, NRCoord x0, NRCoord x1)
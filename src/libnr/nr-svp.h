@@ -57,6 +57,10 @@ int nr_svp_point_wind (NRSVP *svp, float x, float y);
 double nr_svp_point_distance (NRSVP *svp, float x, float y);
 void nr_svp_bbox (NRSVP *svp, NRRectF *bbox, unsigned int clear);
 
+/* Curve flattening tolerance in device pixels, by rendering mode */
+#define NR_FLATNESS_NORMAL 0.25F
+#define NR_FLATNESS_DRAFT 2.0F
+
 /* Sorted vertex lists */
 
 /* fixme: Move/remove this (Lauris) */
@@ -0,0 +1,320 @@
+#define __NR_TRACE_C__
+
+/*
+ * Pixel buffer rendering library
+ *
+ * Runtime tracing of scoped timings and counters
+ *
+ * This code is in public domain
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "nr-macros.h"
+#include "nr-trace.h"
+
+/* Further events are dropped, but still summarized */
+#define NR_TRACE_EVENTS_MAX (1 << 20)
+#define NR_TRACE_STACK_SIZE 64
+#define NR_TRACE_NAMES_MAX 64
+
+typedef struct _NRTraceEvent NRTraceEvent;
+typedef struct _NRTraceStat NRTraceStat;
+
+struct _NRTraceEvent {
+	const char *name;
+	/* Chrome phase: 'X' scope, 'C' counter, 'i' frame */
+	char phase;
+	unsigned int tid;
+	/* Microseconds since init */
+	double ts, dur;
+	unsigned int value;
+};
+
+/* Per-frame sums of scope or counter */
+struct _NRTraceStat {
+	const char *name;
+	unsigned int counter : 1;
+	unsigned int calls;
+	unsigned int value;
+	double time;
+};
+
+unsigned int nr_trace_flags = 0;
+
+/* libnr has no thread library, so lock is provided by application */
+static void (* trace_lock) (void) = NULL;
+static void (* trace_unlock) (void) = NULL;
+
+#define NR_TRACE_LOCK() do { if (trace_lock) trace_lock (); } while (0)
+#define NR_TRACE_UNLOCK() do { if (trace_unlock) trace_unlock (); } while (0)
+
+static char *trace_filename = NULL;
+static double trace_start = 0.0;
+static double trace_frame_start = 0.0;
+static NRTraceEvent *trace_events = NULL;
+static unsigned int trace_n_events = 0;
+static unsigned int trace_size_events = 0;
+static unsigned int trace_dropped = 0;
+static NRTraceStat trace_stats[NR_TRACE_NAMES_MAX];
+static unsigned int trace_n_stats = 0;
+static unsigned int trace_n_threads = 0;
+
+/* Scopes open in calling thread */
+static NR_THREAD_LOCAL const char *trace_stack[NR_TRACE_STACK_SIZE];
+static NR_THREAD_LOCAL unsigned int trace_depth = 0;
+static NR_THREAD_LOCAL unsigned int trace_tid = 0;
+
+static double
+nr_trace_now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+/* Following have to be called with lock held */
+
+static NRTraceStat *
+nr_trace_stat_lookup (const char *name, unsigned int counter)
+{
+	unsigned int i;
+
+	for (i = 0; i < trace_n_stats; i++) {
+		if (!strcmp (trace_stats[i].name, name)) return &trace_stats[i];
+	}
+	if (trace_n_stats >= NR_TRACE_NAMES_MAX) return NULL;
+
+	trace_stats[i].name = name;
+	trace_stats[i].counter = counter;
+	trace_stats[i].calls = 0;
+	trace_stats[i].value = 0;
+	trace_stats[i].time = 0.0;
+	trace_n_stats += 1;
+
+	return &trace_stats[i];
+}
+
+static void
+nr_trace_add_event (const char *name, char phase, double start, double duration, unsigned int value)
+{
+	NRTraceEvent *event;
+
+	if (!(nr_trace_flags & NR_TRACE_EVENTS)) return;
+
+	if (trace_n_events >= trace_size_events) {
+		if (trace_size_events >= NR_TRACE_EVENTS_MAX) {
+			trace_dropped += 1;
+			return;
+		}
+		trace_size_events = MAX (trace_size_events << 1, 4096);
+		trace_events = nr_renew (trace_events, NRTraceEvent, trace_size_events);
+	}
+
+	if (!trace_tid) trace_tid = ++trace_n_threads;
+
+	event = &trace_events[trace_n_events++];
+	event->name = name;
+	event->phase = phase;
+	event->tid = trace_tid;
+	event->ts = 1e6 * (start - trace_start);
+	event->dur = 1e6 * duration;
+	event->value = value;
+}
+
+/**
+ * Sets functions serializing access to trace buffer; needed only if
+ * traced code runs in several threads, and has to be called before
+ * nr_trace_init
+ */
+void
+nr_trace_set_lock (void (* lock) (void), void (* unlock) (void))
+{
+	trace_lock = lock;
+	trace_unlock = unlock;
+}
+
+/**
+ * Enables tracing; flags is combination of NR_TRACE_EVENTS, which keeps
+ * events for Chrome trace written to filename at shutdown, and
+ * NR_TRACE_SUMMARY, which prints summary of every frame
+ */
+void
+nr_trace_init (const char *filename, unsigned int flags)
+{
+	if (filename) {
+		flags |= NR_TRACE_EVENTS;
+	} else {
+		flags &= ~NR_TRACE_EVENTS;
+	}
+	if (!flags) return;
+
+	NR_TRACE_LOCK ();
+	if (trace_filename) free (trace_filename);
+	trace_filename = (filename) ? strdup (filename) : NULL;
+	trace_start = trace_frame_start = nr_trace_now ();
+	NR_TRACE_UNLOCK ();
+
+	nr_trace_flags = flags;
+}
+
+/**
+ * Writes collected events, in Chrome trace event format, and disables
+ * tracing
+ */
+void
+nr_trace_shutdown (void)
+{
+	unsigned int i;
+	FILE *fp;
+
+	if (!nr_trace_flags) return;
+	nr_trace_flags = 0;
+
+	NR_TRACE_LOCK ();
+
+	if (trace_filename) {
+		fp = fopen (trace_filename, "w");
+		if (fp) {
+			fprintf (fp, "{\"traceEvents\":[\n");
+			for (i = 0; i < trace_n_events; i++) {
+				NRTraceEvent *e;
+				e = &trace_events[i];
+				/* Integer microseconds are independent of locale */
+				fprintf (fp, "{\"name\":\"%s\",\"cat\":\"inkscape\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%lu",
+					 e->name, e->phase, e->tid, (unsigned long) e->ts);
+				if (e->phase == 'X') {
+					fprintf (fp, ",\"dur\":%lu}", (unsigned long) e->dur);
+				} else if (e->phase == 'C') {
+					fprintf (fp, ",\"args\":{\"value\":%u}}", e->value);
+				} else {
+					fprintf (fp, ",\"s\":\"g\"}");
+				}
+				fprintf (fp, (i + 1 < trace_n_events) ? ",\n" : "\n");
+			}
+			fprintf (fp, "],\"displayTimeUnit\":\"ms\"}\n");
+			fclose (fp);
+		} else {
+			fprintf (stderr, "Cannot write trace to %s\n", trace_filename);
+		}
+		if (trace_dropped) {
+			fprintf (stderr, "Trace was full, %u events were dropped\n", trace_dropped);
+		}
+		free (trace_filename);
+		trace_filename = NULL;
+	}
+
+	if (trace_events) {
+		nr_free (trace_events);
+		trace_events = NULL;
+	}
+	trace_n_events = 0;
+	trace_size_events = 0;
+	trace_dropped = 0;
+	trace_n_stats = 0;
+
+	NR_TRACE_UNLOCK ();
+}
+
+double
+nr_trace_begin (const char *name)
+{
+	if (trace_depth < NR_TRACE_STACK_SIZE) trace_stack[trace_depth] = name;
+	trace_depth += 1;
+
+	return nr_trace_now ();
+}
+
+void
+nr_trace_end (const char *name, double start)
+{
+	NRTraceStat *stat;
+	unsigned int outermost, i;
+	double end;
+
+	end = nr_trace_now ();
+
+	if (trace_depth > 0) trace_depth -= 1;
+	/* Recursion is timed by outermost scope */
+	outermost = TRUE;
+	for (i = 0; (i < trace_depth) && (i < NR_TRACE_STACK_SIZE); i++) {
+		if (!strcmp (trace_stack[i], name)) {
+			outermost = FALSE;
+			break;
+		}
+	}
+
+	NR_TRACE_LOCK ();
+	stat = nr_trace_stat_lookup (name, FALSE);
+	if (stat) {
+		stat->calls += 1;
+		if (outermost) stat->time += end - start;
+	}
+	if (outermost) nr_trace_add_event (name, 'X', start, end - start, 0);
+	NR_TRACE_UNLOCK ();
+}
+
+void
+nr_trace_count (const char *name, unsigned int n)
+{
+	NRTraceStat *stat;
+
+	NR_TRACE_LOCK ();
+	stat = nr_trace_stat_lookup (name, TRUE);
+	if (stat) {
+		stat->calls += 1;
+		stat->value += n;
+	}
+	NR_TRACE_UNLOCK ();
+}
+
+/**
+ * Ends frame, i.e. one canvas redraw or export; records frame marker
+ * and counter values, and prints summary if requested
+ */
+void
+nr_trace_frame (const char *name)
+{
+	unsigned int i;
+	double now;
+
+	now = nr_trace_now ();
+
+	NR_TRACE_LOCK ();
+
+	nr_trace_add_event (name, 'i', now, 0.0, 0);
+	for (i = 0; i < trace_n_stats; i++) {
+		if (trace_stats[i].counter && trace_stats[i].calls) {
+			nr_trace_add_event (trace_stats[i].name, 'C', now, 0.0, trace_stats[i].value);
+		}
+	}
+
+	if (nr_trace_flags & NR_TRACE_SUMMARY) {
+		fprintf (stderr, "Frame %s %.2f ms:", name, 1000.0 * (now - trace_frame_start));
+		for (i = 0; i < trace_n_stats; i++) {
+			NRTraceStat *stat;
+			stat = &trace_stats[i];
+			if (!stat->calls) continue;
+			if (stat->counter) {
+				fprintf (stderr, " %s %u", stat->name, stat->value);
+			} else {
+				fprintf (stderr, " %s %.2f ms/%u", stat->name, 1000.0 * stat->time, stat->calls);
+			}
+		}
+		fprintf (stderr, "\n");
+	}
+
+	for (i = 0; i < trace_n_stats; i++) {
+		trace_stats[i].calls = 0;
+		trace_stats[i].value = 0;
+		trace_stats[i].time = 0.0;
+	}
+	trace_frame_start = now;
+
+	NR_TRACE_UNLOCK ();
+}
@@ -0,0 +1,44 @@
+#ifndef __NR_TRACE_H__
+#define __NR_TRACE_H__
+
+/*
+ * Pixel buffer rendering library
+ *
+ * Runtime tracing of scoped timings and counters
+ *
+ * This code is in public domain
+ */
+
+/*
+ * Tracing is off unless nr_trace_init was called, and then costs single
+ * test of nr_trace_flags at every trace point.  Scopes with same name
+ * nested in each other (recursive updates and renders) are timed as
+ * single outermost scope, while all of them are counted as calls.
+ */
+
+#define NR_TRACE_EVENTS (1 << 0)
+#define NR_TRACE_SUMMARY (1 << 1)
+
+extern unsigned int nr_trace_flags;
+
+#define NR_TRACE_BEGIN(v,name) do { if (nr_trace_flags) (v) = nr_trace_begin (name); } while (0)
+#define NR_TRACE_END(v,name) do { if (nr_trace_flags) nr_trace_end (name, (v)); } while (0)
+#define NR_TRACE_COUNT(name,n) do { if (nr_trace_flags) nr_trace_count (name, (n)); } while (0)
+#define NR_TRACE_FRAME(name) do { if (nr_trace_flags) nr_trace_frame (name); } while (0)
+
+/* Threaded callers have to provide lock, as libnr does not use thread library */
+void nr_trace_set_lock (void (* lock) (void), void (* unlock) (void));
+
+/* Writes Chrome trace event JSON to filename at shutdown, if not NULL */
+void nr_trace_init (const char *filename, unsigned int flags);
+void nr_trace_shutdown (void);
+
+/* Names have to be static strings */
+double nr_trace_begin (const char *name);
+void nr_trace_end (const char *name, double start);
+void nr_trace_count (const char *name, unsigned int n);
+
+/* Ends frame, printing its summary to stderr if requested */
+void nr_trace_frame (const char *name);
+
+#endif
@@ -353,7 +353,7 @@ nr_rasterfont_ensure_glyph_slot (NRRasterFont *rf, unsigned int glyph, unsigned
 			a.c[4] = 0.0;
 			a.c[5] = 0.0;
 
-			svl = nr_svl_from_art_bpath (gbp.path, &a, NR_WIND_RULE_NONZERO, TRUE, 0.25);
+			svl = nr_svl_from_art_bpath (gbp.path, &a, NR_WIND_RULE_NONZERO, TRUE, NR_FLATNESS_NORMAL);
 			svp = nr_svp_from_svl (svl, NULL);
 			nr_svl_free_list (svl);
 
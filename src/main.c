@@ -62,6 +62,8 @@
 #include "sp-namedview.h"
 #include "sp-guide.h"
 #include "sp-object-repr.h"
+#include "display/nr-arena-shape.h"
+#include "libnr/nr-trace.h"
 
 #ifdef WIN32
 #include "modules/win32.h"
@@ -93,6 +95,12 @@ enum {
 	SP_ARG_EXPORT_SVG,
 	SP_ARG_SLIDESHOW,
 	SP_ARG_BITMAP_ICONS,
+	SP_ARG_MEMORY_REPORT,
+	SP_ARG_INTERN_VALUES,
+	SP_ARG_NO_INSTANCING,
+	SP_ARG_THREADS,
+	SP_ARG_TRACE,
+	SP_ARG_TRACE_SUMMARY,
 	SP_ARG_LAST
 };
 #endif
@@ -100,6 +108,8 @@ enum {
 int sp_main_gui (int argc, const char **argv);
 int sp_main_console (int argc, const char **argv);
 static void sp_do_export_png (SPDocument *doc);
+static void sp_print_shape_report (FILE *file);
+static void sp_trace_init (void);
 
 /* fixme: We need this non-static, but better arrange it another way (Lauris) */
 gboolean sp_bitmap_icons = FALSE;
@@ -113,6 +123,12 @@ static gchar *sp_export_width = NULL;
 static gchar *sp_export_height = NULL;
 static gchar *sp_export_background = NULL;
 static gchar *sp_export_svg = NULL;
+static gboolean sp_memory_report = FALSE;
+static gboolean sp_intern_values = FALSE;
+static gboolean sp_no_instancing = FALSE;
+static int sp_threads = 0;
+static gchar *sp_trace = NULL;
+static gboolean sp_trace_summary = FALSE;
 
 #ifdef WITH_POPT
 static GSList *sp_process_args (poptContext ctx);
@@ -151,6 +167,24 @@ struct poptOption options[] = {
 	{"bitmap-icons", 'i', POPT_ARG_NONE, &sp_bitmap_icons, SP_ARG_BITMAP_ICONS,
 	 N_("Prefer bitmap (xpm) icons to SVG ones"),
 	 NULL},
+	{"memory-report", 0, POPT_ARG_NONE, &sp_memory_report, SP_ARG_MEMORY_REPORT,
+	 N_("Print memory used by XML tree and rendering geometry of document(s)"),
+	 NULL},
+	{"intern-values", 0, POPT_ARG_NONE, &sp_intern_values, SP_ARG_INTERN_VALUES,
+	 N_("Share repeated attribute values (saves memory on large documents)"),
+	 NULL},
+	{"no-instancing", 0, POPT_ARG_NONE, &sp_no_instancing, SP_ARG_NO_INSTANCING,
+	 N_("Give every clone and marker its own rendering geometry"),
+	 NULL},
+	{"threads", 0, POPT_ARG_INT, &sp_threads, SP_ARG_THREADS,
+	 N_("Number of threads building rendering geometry (0 is one per processor, 1 disables)"),
+	 N_("NUMBER")},
+	{"trace", 0, POPT_ARG_STRING, &sp_trace, SP_ARG_TRACE,
+	 N_("Write timings of updates and rendering to FILENAME in Chrome trace event format"),
+	 N_("FILENAME")},
+	{"trace-summary", 0, POPT_ARG_NONE, &sp_trace_summary, SP_ARG_TRACE_SUMMARY,
+	 N_("Print timings of updates and rendering for every redraw or export"),
+	 NULL},
 	POPT_AUTOHELP POPT_TABLEEND
 };
 #endif
@@ -165,6 +199,9 @@ main (int argc, const char **argv)
 	fpsetmask (fpgetmask() & ~(FP_X_DZ|FP_X_INV));
 #endif
 
+	/* Rendering geometry is built by worker threads */
+	if (!g_thread_supported ()) g_thread_init (NULL);
+
 	bindtextdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
@@ -184,7 +221,8 @@ main (int argc, const char **argv)
 		    !strncmp (argv[i], "--print", 7) ||
 		    !strcmp (argv[i], "-e") ||
 		    !strncmp (argv[i], "--export-png", 12) ||
-		    !strncmp (argv[i], "--export-svg", 12)) {
+		    !strncmp (argv[i], "--export-svg", 12) ||
+		    !strcmp (argv[i], "--memory-report")) {
 			use_gui = FALSE;
 			break;
 		} else if (!strcmp (argv[i], "-x") || !strcmp (argv[i], "--with-gui")) {
@@ -235,6 +273,11 @@ sp_main_gui (int argc, const char **argv)
 	poptFreeContext (ctx);
 #endif
 
+	sp_repr_set_value_interning (sp_intern_values);
+	nr_arena_shape_set_instancing (!sp_no_instancing);
+	nr_arena_shape_set_threads (MAX (sp_threads, 0));
+	sp_trace_init ();
+
 #ifdef WIN32
 	sp_win32_init (0, NULL, "Inkscape");
 #endif
@@ -284,6 +327,8 @@ sp_main_gui (int argc, const char **argv)
 
 	gtk_main ();
 
+	nr_trace_shutdown ();
+
 #ifdef WIN32
 	sp_win32_finish ();
 #endif
@@ -328,6 +373,11 @@ sp_main_console (int argc, const char **argv)
 		exit (0);
 	}
 
+	sp_repr_set_value_interning (sp_intern_values);
+	nr_arena_shape_set_instancing (!sp_no_instancing);
+	nr_arena_shape_set_threads (MAX (sp_threads, 0));
+	sp_trace_init ();
+
 	/* Check for and set up printing path */
 	printer = NULL;
 	if (sp_global_printer != NULL) {
@@ -367,17 +417,78 @@ sp_main_console (int argc, const char **argv)
 				repr = sp_object_invoke_write (sp_document_root (doc), repr, SP_OBJECT_WRITE_BUILD);
 				sp_repr_save_file (sp_repr_document (repr), sp_export_svg);
 			}
+			if (sp_memory_report) {
+				g_print ("%s:\n", (gchar *) fl->data);
+				sp_repr_print_memory_report (sp_document_repr_doc (doc), stdout);
+			}
 		}
 		fl = g_slist_remove (fl, fl->data);
 	}
 
+	/* Value store and shape caches are process-wide */
+	if (sp_memory_report) {
+		g_print ("All documents:\n");
+		sp_repr_print_value_report (stdout);
+		sp_print_shape_report (stdout);
+	}
+
 	g_free (printer);
 
 	inkscape_unref ();
 
+	nr_trace_shutdown ();
+
 	return 0;
 }
 
+G_LOCK_DEFINE_STATIC (trace);
+
+static void
+sp_trace_lock (void)
+{
+	G_LOCK (trace);
+}
+
+static void
+sp_trace_unlock (void)
+{
+	G_UNLOCK (trace);
+}
+
+/* Command line takes precedence over INKSCAPE_TRACE and INKSCAPE_TRACE_SUMMARY */
+
+static void
+sp_trace_init (void)
+{
+	const gchar *filename;
+	unsigned int flags;
+
+	filename = (sp_trace) ? sp_trace : getenv ("INKSCAPE_TRACE");
+	if (filename && !*filename) filename = NULL;
+	flags = 0;
+	if (sp_trace_summary || getenv ("INKSCAPE_TRACE_SUMMARY")) flags |= NR_TRACE_SUMMARY;
+
+	/* Shapes are flattened by worker threads */
+	nr_trace_set_lock (sp_trace_lock, sp_trace_unlock);
+	nr_trace_init (filename, flags);
+}
+
+static void
+sp_print_shape_report (FILE *file)
+{
+	const NRArenaShapeStats *stats;
+
+	stats = nr_arena_shape_get_stats ();
+
+	fprintf (file, "Shape geometry (%s): %u flattened in %.3f s, %u of %u instanced lookups shared\n",
+		 (sp_no_instancing) ? "expanded" : "instanced",
+		 stats->builds, stats->build_time, stats->hits, stats->lookups);
+	fprintf (file, "  %u vertices generated, %u by last update\n",
+		 stats->vertices, stats->update_vertices);
+	fprintf (file, "  %u live svps, %lu bytes, %lu bytes if expanded\n",
+		 stats->svps, (unsigned long) stats->svp_bytes, (unsigned long) stats->expanded_bytes);
+}
+
 static void
 sp_do_export_png (SPDocument *doc)
 {
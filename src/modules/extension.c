@@ -30,6 +30,7 @@
 #include <sp-namedview.h>
 
 #include "system.h"
+#include "worker.h"
 
 #include "extension.h"
 
@@ -38,6 +39,7 @@
 
 /* Prototypes */
 static void extension_execute (const gchar * command, const gchar * filein, const gchar * fileout);
+static void extension_filter_show (SPDocument * mydoc);
 
 
 /* Real functions */
@@ -94,7 +96,8 @@ solve_reldir (SPRepr * reprin) {
 
 	The command is saved as an attribute to the highest level
 	Repr.  The string is free'd because it is copied by the attribute
-	add function.
+	add function.  So is the worker flag of the command, which tells
+	that the extension can be kept running (see worker.h).
 
 	Now, depending on the type of module, the functions are set to
 	use the extension functions in this file.  Basically there are
@@ -109,6 +112,7 @@ extension_load (SPModule *module)
 {
 	SPRepr * child_repr;
 	gchar * command_text = NULL;
+	unsigned int worker = FALSE;
 	/* This should probably check to find the executable... */
 	g_return_if_fail(SP_IS_MODULE(module));
 	g_return_if_fail(module->repr != NULL);
@@ -120,6 +124,7 @@ extension_load (SPModule *module)
 			while (child_repr != NULL) {
 				if (!strcmp(sp_repr_name(child_repr), "command")) {
 					command_text = solve_reldir(child_repr);
+					sp_repr_get_boolean(child_repr, "worker", &worker);
 					break;
 				}
 				child_repr = sp_repr_next(child_repr);
@@ -134,6 +139,7 @@ extension_load (SPModule *module)
 
 	sp_repr_set_attr(module->repr, "command", command_text);
 	g_free(command_text);
+	sp_repr_set_attr(module->repr, "worker", (worker) ? "true" : NULL);
 
 	if (SP_IS_MODULE_INPUT(module)) {
 		SP_MODULE_INPUT(module)->open = extension_open;
@@ -155,14 +161,17 @@ extension_load (SPModule *module)
 	\brief    Unload this puppy!
 	\param    module  Extension to be unloaded.
 
-	This function just sets the module to unloaded.  There doesn't
-	seem to be a Repr attribute delete command, and it isn't that
-	much memory to leave around anyway.
+	This function just sets the module to unloaded, stopping its
+	worker process if there is one.  There doesn't seem to be a Repr
+	attribute delete command, and it isn't that much memory to leave
+	around anyway.
 */
 void
 extension_unload (SPModule *module)
 {
+	extension_worker_stop(module);
 	sp_repr_set_attr(module->repr, "command", NULL);
+	sp_repr_set_attr(module->repr, "worker", NULL);
 
 	if (SP_IS_MODULE_INPUT(module)) {
 		SP_MODULE_INPUT(module)->open = NULL;
@@ -367,6 +376,11 @@ extension_save (SPModule * module, SPDocument * doc, const gchar * filename)
 	to execute the script on the two SVG documents (actually only one
 	exists at the time, the other is created by that script).  At that
 	point both should be full, and the second one is loaded.
+
+	Extensions that can run as workers skip all of that.  The document,
+	or only the selection, is sent to the running worker, and its patch
+	is applied to the document in place.  Only if the worker can't be
+	used the temporary files are.
 */
 void
 extension_filter (SPModule * module, SPDocument * doc)
@@ -378,6 +392,18 @@ extension_filter (SPModule * module, SPDocument * doc)
 	char * command;
 	SPItem * selected;
 	SPDocument * mydoc;
+	unsigned int worker;
+
+	worker = FALSE;
+	sp_repr_get_boolean(module->repr, "worker", &worker);
+	if (worker) {
+		const GSList * items;
+		items = sp_selection_item_list (SP_DT_SELECTION (SP_ACTIVE_DESKTOP));
+		if (extension_worker_filter(module, doc, items, &mydoc)) {
+			if (mydoc != NULL) extension_filter_show(mydoc);
+			return;
+		}
+	}
 
 	tempfilename_in = (char *)tempfilename_in_x;
 
@@ -437,22 +463,31 @@ extension_filter (SPModule * module, SPDocument * doc)
 	unlink(tempfilename_in);
 	unlink(tempfilename_out);
 
-	/* Do something with mydoc.... */
-	/* TODO: This creates a new window, which really isn't
-	 * ideal...  there needs to be a better way to do this. */
-	if (1) {
-		SPViewWidget *dtw;
+	g_return_if_fail (mydoc != NULL);
 
-		g_return_if_fail (mydoc != NULL);
+	extension_filter_show(mydoc);
 
-		dtw = sp_desktop_widget_new (sp_document_namedview (mydoc, NULL));
-		sp_document_unref (mydoc);
-		g_return_if_fail (dtw != NULL);
+	return;
+}
 
-		sp_create_window (dtw, TRUE);
-	}
+/**
+	\return   none
+	\brief    Shows result of filter, taking over the reference.
+	\param    mydoc    Document created by the filter.
+*/
+static void
+extension_filter_show (SPDocument * mydoc)
+{
+	SPViewWidget *dtw;
 
-	return;
+	/* Do something with mydoc.... */
+	/* TODO: This creates a new window, which really isn't
+	 * ideal...  there needs to be a better way to do this. */
+	dtw = sp_desktop_widget_new (sp_document_namedview (mydoc, NULL));
+	sp_document_unref (mydoc);
+	g_return_if_fail (dtw != NULL);
+
+	sp_create_window (dtw, TRUE);
 }
 
 /**
@@ -26,11 +26,14 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <signal.h>
 #include <errno.h>
+#include <zlib.h>
 
 #include <libnr/nr-macros.h>
 #include <libnr/nr-matrix.h>
+#include <libnr/nr-pixblock.h>
 
 #include <glib.h>
 #include <gtk/gtkstock.h>
@@ -46,13 +49,30 @@
 
 #include "helper/sp-intl.h"
 #include "display/nr-arena-item.h"
+#include "display/nr-arena-shape.h"
 #include "helper/canvas-bpath.h"
+#include "svg/svg.h"
 #include "enums.h"
 #include "document.h"
 #include "style.h"
 
 #include "ps.h"
 
+/* Output is written to stream in blocks of that size */
+#define SP_PS_BUFFER_SIZE 65536
+/* Height of bitmap bands */
+#define SP_PS_BAND_HEIGHT 64
+
+typedef struct _SPPSBand SPPSBand;
+
+/* Rendered band, encoded by worker thread while next one is rendered */
+struct _SPPSBand {
+	SPModulePrintPlain *pmod;
+	guchar *px;
+	unsigned int width, height, rs;
+	NRMatrixF transform;
+};
+
 static void sp_module_print_plain_class_init (SPModulePrintPlainClass *klass);
 static void sp_module_print_plain_init (SPModulePrintPlain *fmod);
 static void sp_module_print_plain_finalize (GObject *object);
@@ -69,9 +89,20 @@ static unsigned int sp_module_print_plain_stroke (SPModulePrint *mod, const NRBP
 static unsigned int sp_module_print_plain_image (SPModulePrint *mod, guchar *px, unsigned int w, unsigned int h, unsigned int rs,
 						 const NRMatrixF *transform, const SPStyle *style);
 
-static void sp_print_bpath (FILE *stream, const ArtBpath *bp);
-static unsigned int sp_ps_print_image (FILE *ofp, guchar *px, unsigned int width, unsigned int height, unsigned int rs,
+static unsigned int sp_module_print_plain_open (SPModulePrintPlain *pmod, const gchar *fn, unsigned int pipe);
+static unsigned int sp_module_print_plain_close (SPModulePrintPlain *pmod);
+
+static unsigned int sp_ps_flush (SPModulePrintPlain *pmod);
+static void sp_ps_write (SPModulePrintPlain *pmod, const void *data, unsigned int len);
+static void sp_ps_puts (SPModulePrintPlain *pmod, const gchar *str);
+static void sp_ps_printf (SPModulePrintPlain *pmod, const gchar *format, ...) G_GNUC_PRINTF (2, 3);
+static void sp_ps_number (SPModulePrintPlain *pmod, double val);
+static void sp_ps_matrix (SPModulePrintPlain *pmod, const NRMatrixF *m);
+
+static void sp_print_bpath (SPModulePrintPlain *pmod, const ArtBpath *bp);
+static unsigned int sp_ps_print_image (SPModulePrintPlain *pmod, guchar *px, unsigned int width, unsigned int height, unsigned int rs,
 				       const NRMatrixF *transform);
+static gpointer sp_ps_print_band (gpointer data);
 
 static SPModulePrintClass *print_plain_parent_class;
 
@@ -121,6 +152,8 @@ static void
 sp_module_print_plain_init (SPModulePrintPlain *pmod)
 {
 	pmod->dpi = 72;
+	pmod->buffer = g_new (guchar, SP_PS_BUFFER_SIZE);
+	pmod->length = 0;
 }
 
 static void
@@ -129,9 +162,9 @@ sp_module_print_plain_finalize (GObject *object)
 	SPModulePrintPlain *gpmod;
 
 	gpmod = (SPModulePrintPlain *) object;
-	
-	/* fixme: should really use pclose for popen'd streams */
-	if (gpmod->stream) fclose (gpmod->stream);
+
+	sp_module_print_plain_close (gpmod);
+	g_free (gpmod->buffer);
 
 	/* restore default signal handling for SIGPIPE */
 	(void) signal(SIGPIPE, SIG_DFL);
@@ -253,7 +286,6 @@ sp_module_print_plain_setup (SPModulePrint *mod)
 	if (response == GTK_RESPONSE_OK) {
 		const gchar *fn;
 		const char *sstr;
-		FILE *osf, *osp;
 		pmod->bitmap = gtk_toggle_button_get_active ((GtkToggleButton *) rb);
 		sstr = gtk_entry_get_text (GTK_ENTRY (GTK_COMBO (combo)->entry));
 		pmod->dpi = (unsigned int) MAX ((int)(atof (sstr)), 1);
@@ -265,40 +297,22 @@ sp_module_print_plain_setup (SPModulePrint *mod)
 			sp_repr_set_attr (repr, "resolution", sstr);
 			sp_repr_set_attr (repr, "destination", fn);
 		}
-		osf = NULL;
-		osp = NULL;
 		if (fn) {
 			if (*fn == '|') {
 				fn += 1;
 				while (isspace (*fn)) fn += 1;
-#ifndef WIN32
-				osp = popen (fn, "w");
-#else
-				osp = _popen (fn, "w");
-#endif
-				pmod->stream = osp;
+				ret = sp_module_print_plain_open (pmod, fn, TRUE);
 			} else if (*fn == '>') {
 				fn += 1;
 				while (isspace (*fn)) fn += 1;
-				osf = fopen (fn, "w+");
-				pmod->stream = osf;
+				ret = sp_module_print_plain_open (pmod, fn, FALSE);
 			} else {
 				gchar *qn;
 				qn = g_strdup_printf ("lpr -P %s", fn);
-#ifndef WIN32
-				osp = popen (qn, "w");
-#else
-				osp = _popen (qn, "w");
-#endif
+				ret = sp_module_print_plain_open (pmod, qn, TRUE);
 				g_free (qn);
-				pmod->stream = osp;
 			}
 		}
-		if (pmod->stream) {
-			/* fixme: this is kinda icky */
-			(void) signal(SIGPIPE, SIG_IGN);
-			ret = TRUE;
-		}
 	}
 
 	gtk_widget_destroy (dlg);
@@ -306,26 +320,108 @@ sp_module_print_plain_setup (SPModulePrint *mod)
 	return ret;
 }
 
+/**
+ * Sets up printing without dialog, using bitmap and resolution settings
+ * from preferences; filename starting with '|' is command to pipe output to
+ */
+unsigned int
+sp_module_print_plain_setup_file (SPModulePrintPlain *pmod, const gchar *filename)
+{
+	SPRepr *repr;
+
+	g_return_val_if_fail (pmod != NULL, FALSE);
+	g_return_val_if_fail (SP_IS_MODULE_PRINT_PLAIN (pmod), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	repr = ((SPModule *) pmod)->repr;
+	if (repr) {
+		unsigned int p2bm;
+		const gchar *val;
+		p2bm = FALSE;
+		sp_repr_get_boolean (repr, "bitmap", &p2bm);
+		pmod->bitmap = p2bm;
+		val = sp_repr_attr (repr, "resolution");
+		if (val) pmod->dpi = (unsigned int) MAX ((int)(atof (val)), 1);
+	}
+
+	if (*filename == '|') {
+		filename += 1;
+		while (isspace (*filename)) filename += 1;
+		return sp_module_print_plain_open (pmod, filename, TRUE);
+	}
+
+	return sp_module_print_plain_open (pmod, filename, FALSE);
+}
+
+static unsigned int
+sp_module_print_plain_open (SPModulePrintPlain *pmod, const gchar *fn, unsigned int pipe)
+{
+	sp_module_print_plain_close (pmod);
+
+	if (pipe) {
+#ifndef WIN32
+		pmod->stream = popen (fn, "w");
+#else
+		pmod->stream = _popen (fn, "w");
+#endif
+	} else {
+		pmod->stream = fopen (fn, "wb");
+	}
+	if (!pmod->stream) return FALSE;
+
+	pmod->pipe = pipe;
+	pmod->length = 0;
+	pmod->error = FALSE;
+	/* fixme: this is kinda icky */
+	(void) signal(SIGPIPE, SIG_IGN);
+
+	return TRUE;
+}
+
+static unsigned int
+sp_module_print_plain_close (SPModulePrintPlain *pmod)
+{
+	unsigned int ok;
+
+	if (!pmod->stream) return TRUE;
+
+	ok = sp_ps_flush (pmod);
+	if (pmod->pipe) {
+#ifndef WIN32
+		if (pclose (pmod->stream)) ok = FALSE;
+#else
+		if (_pclose (pmod->stream)) ok = FALSE;
+#endif
+	} else {
+		if (fclose (pmod->stream)) ok = FALSE;
+	}
+	pmod->stream = NULL;
+
+	return ok;
+}
+
 static unsigned int
 sp_module_print_plain_begin (SPModulePrint *mod, SPDocument *doc)
 {
 	SPModulePrintPlain *pmod;
-	int res;
 
 	pmod = (SPModulePrintPlain *) mod;
 
-	res = fprintf (pmod->stream, "%%!\n");
+	if (!pmod->stream) return 0;
+
+	sp_ps_puts (pmod, "%!PS-Adobe-3.0\n");
+	/* Bitmaps are written as Flate compressed image dictionaries */
+	sp_ps_puts (pmod, "%%LanguageLevel: 3\n");
+	sp_ps_puts (pmod, "%%EndComments\n");
 	/* flush this to test output stream as early as possible */
-	if (fflush(pmod->stream)) {
+	if (!sp_ps_flush (pmod) || fflush(pmod->stream)) {
 /*		g_print("caught error in sp_module_print_plain_begin\n");*/
 		if (ferror(pmod->stream)) {
 			g_print("Error %d on output stream: %s\n", errno,
 				g_strerror(errno));
 		}
 		g_print("Printing failed\n");
-		/* fixme: should use pclose() for pipes */
-		fclose(pmod->stream);
-		pmod->stream = NULL;
+		sp_module_print_plain_close (pmod);
 		fflush(stdout);
 		return 0;
 	}
@@ -334,29 +430,32 @@ sp_module_print_plain_begin (SPModulePrint *mod, SPDocument *doc)
 
 	if (pmod->bitmap) return 0;
 
-	if (res >= 0) res = fprintf (pmod->stream, "%g %g translate\n", 0.0, sp_document_height (doc));
-	if (res >= 0) res = fprintf (pmod->stream, "0.8 -0.8 scale\n");
+	sp_ps_number (pmod, 0.0);
+	sp_ps_number (pmod, sp_document_height (doc));
+	sp_ps_puts (pmod, "translate\n");
+	sp_ps_puts (pmod, "0.8 -0.8 scale\n");
 
-	return res;
+	return 0;
 }
 
 static unsigned int
 sp_module_print_plain_finish (SPModulePrint *mod)
 {
-	int res;
-
 	SPModulePrintPlain *pmod;
 
 	pmod = (SPModulePrintPlain *) mod;
-	if (!pmod->stream) return 0;
+	/* Stream is closed if begin could not write to it */
+	if (!pmod->stream) return (unsigned int) -1;
 
 	if (pmod->bitmap) {
 		double x0, y0, x1, y1;
 		int width, height;
 		float scale;
 		NRMatrixF affine;
-		guchar *px;
-		int y;
+		SPPSBand band;
+		GThread *thread;
+		guchar *px[2];
+		int y, cur;
 
 		scale = pmod->dpi / 72.0;
 
@@ -377,9 +476,13 @@ sp_module_print_plain_finish (SPModulePrint *mod)
 
 		nr_arena_item_set_transform (mod->root, &affine);
 
-		px = nr_new (guchar, 4 * width * 64);
+		/* Band is compressed and written by thread while next one is rendered */
+		px[0] = nr_new (guchar, 4 * width * SP_PS_BAND_HEIGHT);
+		px[1] = nr_new (guchar, 4 * width * SP_PS_BAND_HEIGHT);
+		thread = NULL;
+		cur = 0;
 
-		for (y = 0; y < height; y += 64) {
+		for (y = 0; y < height; y += SP_PS_BAND_HEIGHT) {
 			NRRectL bbox;
 			NRGC gc;
 			NRMatrixF imgt;
@@ -388,17 +491,18 @@ sp_module_print_plain_finish (SPModulePrint *mod)
 			bbox.x0 = 0;
 			bbox.y0 = y;
 			bbox.x1 = width;
-			bbox.y1 = MIN (height, y + 64);
-			/* Update to renderable state */
+			bbox.y1 = MIN (height, y + SP_PS_BAND_HEIGHT);
+			/* Update to renderable state, flattening geometry in parallel as export does */
 			nr_matrix_d_set_identity (&gc.transform);
-			nr_arena_item_invoke_update (mod->root, &bbox, &gc, NR_ARENA_ITEM_STATE_ALL, NR_ARENA_ITEM_STATE_NONE);
+			nr_arena_shape_update_parallel (mod->root, &bbox, &gc, NR_ARENA_ITEM_STATE_ALL, NR_ARENA_ITEM_STATE_NONE);
 			/* Render */
 			/* This should take guchar* instead of unsigned char*) */
 			nr_pixblock_setup_extern (&pb, NR_PIXBLOCK_MODE_R8G8B8A8N,
 						  bbox.x0, bbox.y0, bbox.x1, bbox.y1,
-						  (guchar*)px, 4 * width, FALSE, FALSE);
-			memset (px, 0xff, 4 * width * 64);
+						  (guchar*)px[cur], 4 * width, FALSE, FALSE);
+			memset (px[cur], 0xff, 4 * width * SP_PS_BAND_HEIGHT);
 			nr_arena_item_invoke_render (mod->root, &bbox, &pb, 0);
+			nr_pixblock_release (&pb);
 			/* Blitter goes here */
 			imgt.c[0] = (bbox.x1 - bbox.x0) / scale;
 			imgt.c[1] = 0.0;
@@ -407,15 +511,32 @@ sp_module_print_plain_finish (SPModulePrint *mod)
 			imgt.c[4] = 0.0;
 			imgt.c[5] = pmod->height - y / scale - (bbox.y1 - bbox.y0) / scale;
 
-			sp_ps_print_image (pmod->stream, px, bbox.x1 - bbox.x0, bbox.y1 - bbox.y0, 4 * width, &imgt);
+			/* Previous band has to be written first, and its buffer is reused */
+			if (thread) g_thread_join (thread);
+			thread = NULL;
+			band.pmod = pmod;
+			band.px = px[cur];
+			band.width = bbox.x1 - bbox.x0;
+			band.height = bbox.y1 - bbox.y0;
+			band.rs = 4 * width;
+			band.transform = imgt;
+			if (g_thread_supported ()) thread = g_thread_create (sp_ps_print_band, &band, TRUE, NULL);
+			if (!thread) sp_ps_print_band (&band);
+			cur = !cur;
 		}
 
-		nr_free (px);
+		if (thread) g_thread_join (thread);
+
+		nr_free (px[0]);
+		nr_free (px[1]);
 	}
 
-	res = fprintf (pmod->stream, "showpage\n");
+	sp_ps_puts (pmod, "showpage\n");
+	sp_ps_puts (pmod, "%%EOF\n");
+	/* Closing tells whether all output got to file or printer command */
+	if (!sp_module_print_plain_close (pmod)) return (unsigned int) -1;
 
-	return res;
+	return 0;
 }
 
 static unsigned int
@@ -428,10 +549,11 @@ sp_module_print_plain_bind (SPModulePrint *mod, const NRMatrixF *transform, floa
 	if (!pmod->stream) return 0;  // XXX: fixme, returning -1 as unsigned.
 	if (pmod->bitmap) return 0;
 
-	return fprintf (pmod->stream, "gsave [%g %g %g %g %g %g] concat\n",
-			transform->c[0], transform->c[1],
-			transform->c[2], transform->c[3],
-			transform->c[4], transform->c[5]);
+	sp_ps_puts (pmod, "gsave ");
+	sp_ps_matrix (pmod, transform);
+	sp_ps_puts (pmod, "concat\n");
+
+	return 0;
 }
 
 static unsigned int
@@ -444,7 +566,9 @@ sp_module_print_plain_release (SPModulePrint *mod)
 	if (!pmod->stream) return 0; // XXX: fixme, returning -1 as unsigned.
 	if (pmod->bitmap) return 0;
 
-	return fprintf (pmod->stream, "grestore\n");
+	sp_ps_puts (pmod, "grestore\n");
+
+	return 0;
 }
 
 static unsigned int
@@ -463,14 +587,17 @@ sp_module_print_plain_fill (SPModulePrint *mod, const NRBPath *bpath, const NRMa
 
 		sp_color_get_rgb_floatv (&style->fill.value.color, rgb);
 
-		fprintf (pmod->stream, "%g %g %g setrgbcolor\n", rgb[0], rgb[1], rgb[2]);
+		sp_ps_number (pmod, rgb[0]);
+		sp_ps_number (pmod, rgb[1]);
+		sp_ps_number (pmod, rgb[2]);
+		sp_ps_puts (pmod, "setrgbcolor\n");
 
-		sp_print_bpath (pmod->stream, bpath->path);
+		sp_print_bpath (pmod, bpath->path);
 
 		if (style->fill_rule.value == SP_WIND_RULE_EVENODD) {
-			fprintf (pmod->stream, "eofill\n");
+			sp_ps_puts (pmod, "eofill\n");
 		} else {
-			fprintf (pmod->stream, "fill\n");
+			sp_ps_puts (pmod, "fill\n");
 		}
 	}
 
@@ -493,26 +620,32 @@ sp_module_print_plain_stroke (SPModulePrint *mod, const NRBPath *bpath, const NR
 
 		sp_color_get_rgb_floatv (&style->stroke.value.color, rgb);
 
-		fprintf (pmod->stream, "%g %g %g setrgbcolor\n", rgb[0], rgb[1], rgb[2]);
+		sp_ps_number (pmod, rgb[0]);
+		sp_ps_number (pmod, rgb[1]);
+		sp_ps_number (pmod, rgb[2]);
+		sp_ps_puts (pmod, "setrgbcolor\n");
 
-		sp_print_bpath (pmod->stream, bpath->path);
+		sp_print_bpath (pmod, bpath->path);
 
 		if (style->stroke_dash.n_dash > 0) {
 			int i;
-			fprintf (pmod->stream, "[");
+			sp_ps_puts (pmod, "[");
 			for (i = 0; i < style->stroke_dash.n_dash; i++) {
-				fprintf (pmod->stream, (i) ? " %g" : "%g", style->stroke_dash.dash[i]);
+				sp_ps_number (pmod, style->stroke_dash.dash[i]);
 			}
-			fprintf (pmod->stream, "] %g setdash\n", style->stroke_dash.offset);
+			sp_ps_puts (pmod, "] ");
+			sp_ps_number (pmod, style->stroke_dash.offset);
+			sp_ps_puts (pmod, "setdash\n");
 		} else {
-			fprintf (pmod->stream, "[] 0 setdash\n");
+			sp_ps_puts (pmod, "[] 0 setdash\n");
 		}
 
-		fprintf (pmod->stream, "%g setlinewidth\n", style->stroke_width.computed);
-		fprintf (pmod->stream, "%d setlinejoin\n", style->stroke_linejoin.computed);
-		fprintf (pmod->stream, "%d setlinecap\n", style->stroke_linecap.computed);
+		sp_ps_number (pmod, style->stroke_width.computed);
+		sp_ps_puts (pmod, "setlinewidth\n");
+		sp_ps_printf (pmod, "%d setlinejoin\n", style->stroke_linejoin.computed);
+		sp_ps_printf (pmod, "%d setlinecap\n", style->stroke_linecap.computed);
 
-		fprintf (pmod->stream, "stroke\n");
+		sp_ps_puts (pmod, "stroke\n");
 	}
 
 	return 0;
@@ -529,77 +662,146 @@ sp_module_print_plain_image (SPModulePrint *mod, guchar *px, unsigned int w, uns
 	if (!pmod->stream) return 0; // XXX: fixme, returning -1 as unsigned.
 	if (pmod->bitmap) return 0;
 
-	return sp_ps_print_image (pmod->stream, px, w, h, rs, transform);
-#if 0
-	fprintf (pmod->stream, "gsave\n");
-	fprintf (pmod->stream, "/rowdata %d string def\n", 3 * w);
-	fprintf (pmod->stream, "[%g %g %g %g %g %g] concat\n",
-		 transform->c[0],
-		 transform->c[1],
-		 transform->c[2],
-		 transform->c[3],
-		 transform->c[4],
-		 transform->c[5]);
-	fprintf (pmod->stream, "%d %d 8 [%d 0 0 -%d 0 %d]\n", w, h, w, h, h);
-	fprintf (pmod->stream, "{currentfile rowdata readhexstring pop}\n");
-	fprintf (pmod->stream, "false 3 colorimage\n");
-
-	for (r = 0; r < h; r++) {
-		guchar *s;
-		int c0, c1, c;
-		s = px + r * rs;
-		for (c0 = 0; c0 < w; c0 += 24) {
-			c1 = MIN (w, c0 + 24);
-			for (c = c0; c < c1; c++) {
-				static const char xtab[] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
-				fputc (xtab[s[0] >> 4], pmod->stream);
-				fputc (xtab[s[0] & 0xf], pmod->stream);
-				fputc (xtab[s[1] >> 4], pmod->stream);
-				fputc (xtab[s[1] & 0xf], pmod->stream);
-				fputc (xtab[s[2] >> 4], pmod->stream);
-				fputc (xtab[s[2] & 0xf], pmod->stream);
-				s += 4;
-			}
-			fputs ("\n", pmod->stream);
+	return sp_ps_print_image (pmod, px, w, h, rs, transform);
+}
+
+/* Buffered output */
+
+/* Returns FALSE if writing to stream has failed */
+static unsigned int
+sp_ps_flush (SPModulePrintPlain *pmod)
+{
+	if (pmod->length > 0) {
+		if (!pmod->error && (fwrite (pmod->buffer, 1, pmod->length, pmod->stream) != pmod->length)) {
+			pmod->error = TRUE;
 		}
+		pmod->length = 0;
 	}
 
-	fprintf (pmod->stream, "grestore\n");
+	return !pmod->error;
+}
 
-	return 0;
-#endif
+static void
+sp_ps_write (SPModulePrintPlain *pmod, const void *data, unsigned int len)
+{
+	const guchar *p;
+
+	p = (const guchar *) data;
+	while (len > 0) {
+		unsigned int n;
+		if (pmod->length >= SP_PS_BUFFER_SIZE) sp_ps_flush (pmod);
+		n = MIN (len, SP_PS_BUFFER_SIZE - pmod->length);
+		memcpy (pmod->buffer + pmod->length, p, n);
+		pmod->length += n;
+		p += n;
+		len -= n;
+	}
+}
+
+static void
+sp_ps_puts (SPModulePrintPlain *pmod, const gchar *str)
+{
+	sp_ps_write (pmod, str, strlen (str));
+}
+
+/* Only for integers and strings, numbers are locale dependent */
+static void
+sp_ps_printf (SPModulePrintPlain *pmod, const gchar *format, ...)
+{
+	gchar c[256];
+	va_list args;
+	int len;
+
+	va_start (args, format);
+	len = g_vsnprintf (c, 256, format, args);
+	va_end (args);
+
+	if ((len >= 0) && (len < 256)) {
+		sp_ps_write (pmod, c, len);
+	} else {
+		gchar *str;
+		va_start (args, format);
+		str = g_strdup_vprintf (format, args);
+		va_end (args);
+		sp_ps_puts (pmod, str);
+		g_free (str);
+	}
+}
+
+/* Writes number followed by space */
+static void
+sp_ps_number (SPModulePrintPlain *pmod, double val)
+{
+	gchar c[64];
+	unsigned int len, e, p;
+
+	len = sp_svg_number_write_de (c, val, 6, 0);
+	/* Strip trailing zeroes of fraction, but keep exponent */
+	for (e = 0; (e < len) && (c[e] != 'e'); e++);
+	if (memchr (c, '.', e)) {
+		p = e;
+		while (c[p - 1] == '0') p -= 1;
+		if (c[p - 1] == '.') p -= 1;
+		memmove (c + p, c + e, len - e);
+		len -= e - p;
+	}
+	c[len++] = ' ';
+
+	sp_ps_write (pmod, c, len);
+}
+
+static void
+sp_ps_matrix (SPModulePrintPlain *pmod, const NRMatrixF *m)
+{
+	int i;
+
+	sp_ps_puts (pmod, "[");
+	for (i = 0; i < 6; i++) sp_ps_number (pmod, m->c[i]);
+	sp_ps_puts (pmod, "] ");
 }
 
 /* PostScript helpers */
 
 static void
-sp_print_bpath (FILE *stream, const ArtBpath *bp)
+sp_print_bpath (SPModulePrintPlain *pmod, const ArtBpath *bp)
 {
 	unsigned int closed;
 
-	fprintf (stream, "newpath\n");
+	sp_ps_puts (pmod, "newpath\n");
 	closed = FALSE;
 	while (bp->code != ART_END) {
 		switch (bp->code) {
 		case ART_MOVETO:
 			if (closed) {
-				fprintf (stream, "closepath\n");
+				sp_ps_puts (pmod, "closepath\n");
 			}
 			closed = TRUE;
-			fprintf (stream, "%g %g moveto\n", bp->x3, bp->y3);
+			sp_ps_number (pmod, bp->x3);
+			sp_ps_number (pmod, bp->y3);
+			sp_ps_puts (pmod, "moveto\n");
 			break;
 		case ART_MOVETO_OPEN:
 			if (closed) {
-				fprintf (stream, "closepath\n");
+				sp_ps_puts (pmod, "closepath\n");
 			}
 			closed = FALSE;
-			fprintf (stream, "%g %g moveto\n", bp->x3, bp->y3);
+			sp_ps_number (pmod, bp->x3);
+			sp_ps_number (pmod, bp->y3);
+			sp_ps_puts (pmod, "moveto\n");
 			break;
 		case ART_LINETO:
-			fprintf (stream, "%g %g lineto\n", bp->x3, bp->y3);
+			sp_ps_number (pmod, bp->x3);
+			sp_ps_number (pmod, bp->y3);
+			sp_ps_puts (pmod, "lineto\n");
 			break;
 		case ART_CURVETO:
-			fprintf (stream, "%g %g %g %g %g %g curveto\n", bp->x1, bp->y1, bp->x2, bp->y2, bp->x3, bp->y3);
+			sp_ps_number (pmod, bp->x1);
+			sp_ps_number (pmod, bp->y1);
+			sp_ps_number (pmod, bp->x2);
+			sp_ps_number (pmod, bp->y2);
+			sp_ps_number (pmod, bp->x3);
+			sp_ps_number (pmod, bp->y3);
+			sp_ps_puts (pmod, "curveto\n");
 			break;
 		default:
 			break;
@@ -607,273 +809,180 @@ sp_print_bpath (FILE *stream, const ArtBpath *bp)
 		bp += 1;
 	}
 	if (closed) {
-		fprintf (stream, "closepath\n");
+		sp_ps_puts (pmod, "closepath\n");
 	}
 }
 
-/* The following code is licensed under GNU GPL */
+static gpointer
+sp_ps_print_band (gpointer data)
+{
+	SPPSBand *band;
 
-static void
-compress_packbits (int nin,
-                   guchar *src,
-                   int *nout,
-                   guchar *dst)
-
-{register gchar c;
- int nrepeat, nliteral;
- guchar *run_start;
- guchar *start_dst = dst;
- guchar *last_literal = NULL;
-
- for (;;)
- {
-   if (nin <= 0) break;
-
-   run_start = src;
-   c = *run_start;
-
-   /* Search repeat bytes */
-   if ((nin > 1) && (c == src[1]))
-   {
-     nrepeat = 1;
-     nin -= 2;
-     src += 2;
-     while ((nin > 0) && (c == *src))
-     {
-       nrepeat++;
-       src++;
-       nin--;
-       if (nrepeat == 127) break; /* Maximum repeat */
-     }
-
-     /* Add two-byte repeat to last literal run ? */
-     if (   (nrepeat == 1)
-         && (last_literal != NULL) && (((*last_literal)+1)+2 <= 128))
-     {
-       *last_literal += 2;
-       *(dst++) = c;
-       *(dst++) = c;
-       continue;
-     }
-
-     /* Add repeat run */
-     *(dst++) = (guchar)((-nrepeat) & 0xff);
-     *(dst++) = c;
-     last_literal = NULL;
-     continue;
-   }
-   /* Search literal bytes */
-   nliteral = 1;
-   nin--;
-   src++;
-
-   for (;;)
-   {
-     if (nin <= 0) break;
-
-     if ((nin >= 2) && (src[0] == src[1])) /* A two byte repeat ? */
-       break;
-
-     nliteral++;
-     nin--;
-     src++;
-     if (nliteral == 128) break; /* Maximum literal run */
-   }
-
-   /* Could be added to last literal run ? */
-   if ((last_literal != NULL) && (((*last_literal)+1)+nliteral <= 128))
-   {
-     *last_literal += nliteral;
-   }
-   else
-   {
-     last_literal = dst;
-     *(dst++) = (guchar)(nliteral-1);
-   }
-   while (nliteral-- > 0) *(dst++) = *(run_start++);
- }
- *nout = dst - start_dst;
+	band = (SPPSBand *) data;
+
+	sp_ps_print_image (band->pmod, band->px, band->width, band->height, band->rs, &band->transform);
+
+	return NULL;
 }
 
-static guint32 ascii85_buf;
-static int ascii85_len = 0;
-static int ascii85_linewidth = 0;
+/* The following code is licensed under GNU GPL */
+
+typedef struct _SPPSAscii85 SPPSAscii85;
+
+struct _SPPSAscii85 {
+	guint32 buf;
+	int len;
+	int linewidth;
+};
 
 static void
-ascii85_init (void)
+ascii85_init (SPPSAscii85 *a85)
 {
-  ascii85_len = 0;
-  ascii85_linewidth = 0;
+  a85->buf = 0;
+  a85->len = 0;
+  a85->linewidth = 0;
 }
 
 static void
-ascii85_flush (FILE *ofp)
+ascii85_flush (SPModulePrintPlain *pmod, SPPSAscii85 *a85)
 {
-  char c[5];
-  int i;
-  gboolean zero_case = (ascii85_buf == 0);
+  char c[5], out[16];
+  int i, n;
+  gboolean zero_case = (a85->buf == 0);
   static int max_linewidth = 75;
 
   for (i=4; i >= 0; i--)
     {
-      c[i] = (ascii85_buf % 85) + '!';
-      ascii85_buf /= 85;
+      c[i] = (a85->buf % 85) + '!';
+      a85->buf /= 85;
     }
+  n = 0;
   /* check for special case: "!!!!!" becomes "z", but only if not
    * at end of data. */
-  if (zero_case && (ascii85_len == 4))
+  if (zero_case && (a85->len == 4))
     {
-      if (ascii85_linewidth >= max_linewidth)
+      if (a85->linewidth >= max_linewidth)
       {
-        putc ('\n', ofp);
-        ascii85_linewidth = 0;
+        out[n++] = '\n';
+        a85->linewidth = 0;
       }
-      putc ('z', ofp);
-      ascii85_linewidth++;
+      out[n++] = 'z';
+      a85->linewidth++;
     }
   else
     {
-      for (i=0; i < ascii85_len+1; i++)
+      for (i=0; i < a85->len+1; i++)
       {
-        if ((ascii85_linewidth >= max_linewidth) && (c[i] != '%'))
+        if ((a85->linewidth >= max_linewidth) && (c[i] != '%'))
         {
-          putc ('\n', ofp);
-          ascii85_linewidth = 0;
+          out[n++] = '\n';
+          a85->linewidth = 0;
         }
-	putc (c[i], ofp);
-        ascii85_linewidth++;
+	out[n++] = c[i];
+        a85->linewidth++;
       }
     }
+  sp_ps_write (pmod, out, n);
 
-  ascii85_len = 0;
-  ascii85_buf = 0;
-}
-
-static inline void
-ascii85_out (gchar byte, FILE *ofp)
-{
-  if (ascii85_len == 4)
-    ascii85_flush (ofp);
-
-  ascii85_buf <<= 8;
-  ascii85_buf |= byte;
-  ascii85_len++;
+  a85->len = 0;
+  a85->buf = 0;
 }
 
 static void
-ascii85_nout (int n, gchar *uptr, FILE *ofp)
+ascii85_nout (SPModulePrintPlain *pmod, SPPSAscii85 *a85, int n, const guchar *uptr)
 {
  while (n-- > 0)
  {
-   ascii85_out (*uptr, ofp);
+   if (a85->len == 4)
+     ascii85_flush (pmod, a85);
+
+   a85->buf <<= 8;
+   a85->buf |= *uptr;
+   a85->len++;
    uptr++;
  }
 }
 
 static void
-ascii85_done (FILE *ofp)
+ascii85_done (SPModulePrintPlain *pmod, SPPSAscii85 *a85)
 {
-  if (ascii85_len)
+  if (a85->len)
     {
       /* zero any unfilled buffer portion, then flush */
-      ascii85_buf <<= (8 * (4-ascii85_len));
-      ascii85_flush (ofp);
+      a85->buf <<= (8 * (4-a85->len));
+      ascii85_flush (pmod, a85);
     }
 
-  putc ('~', ofp);
-  putc ('>', ofp);
-  putc ('\n', ofp);
+  sp_ps_puts (pmod, "~>\n");
 }
 
+/* Writes RGB of R8G8B8A8 pixels as Level 3 image with Flate compressed data */
 static unsigned int
-sp_ps_print_image (FILE *ofp, guchar *px, unsigned int width, unsigned int height, unsigned int rs,
+sp_ps_print_image (SPModulePrintPlain *pmod, guchar *px, unsigned int width, unsigned int height, unsigned int rs,
 		   const NRMatrixF *transform)
 {
+	SPPSAscii85 a85;
+	z_stream zs;
+	guchar *row, *zbuf;
 	unsigned int i, j;
-	/* gchar *data, *src; */
-	guchar *packb = NULL, *plane = NULL;
-
-	fprintf (ofp, "gsave\n");
-	fprintf (ofp, "[%g %g %g %g %g %g] concat\n",
-		 transform->c[0],
-		 transform->c[1],
-		 transform->c[2],
-		 transform->c[3],
-		 transform->c[4],
-		 transform->c[5]);
-	fprintf (ofp, "%d %d 8 [%d 0 0 -%d 0 %d]\n", width, height, width, height, height);
-
-	/* Write read image procedure */
-	fprintf (ofp, "%% Strings to hold RGB-samples per scanline\n");
-	fprintf (ofp, "/rstr %d string def\n", width);
-	fprintf (ofp, "/gstr %d string def\n", width);
-	fprintf (ofp, "/bstr %d string def\n", width);
-	fprintf (ofp, "{currentfile /ASCII85Decode filter /RunLengthDecode filter rstr readstring pop}\n");
-	fprintf (ofp, "{currentfile /ASCII85Decode filter /RunLengthDecode filter gstr readstring pop}\n");
-	fprintf (ofp, "{currentfile /ASCII85Decode filter /RunLengthDecode filter bstr readstring pop}\n");
-	fprintf (ofp, "true 3\n");
-
-	/* Allocate buffer for packbits data. Worst case: Less than 1% increase */
-	packb = (guchar *)g_malloc ((width * 105)/100+2);
-	plane = (guchar *)g_malloc (width);
-
-	/* ps_begin_data (ofp); */
-	fprintf (ofp, "colorimage\n");
-
-#define GET_RGB_TILE(begin) \
-  {int scan_lines; \
-    scan_lines = (i+tile_height-1 < height) ? tile_height : (height-i); \
-    gimp_pixel_rgn_get_rect (&pixel_rgn, begin, 0, i, width, scan_lines); \
-    src = begin; }
-
-	for (i = 0; i < height; i++) {
-		/* if ((i % tile_height) == 0) GET_RGB_TILE (data); */ /* Get more data */
-		guchar *plane_ptr, *src_ptr;
-		int rgb, nout;
-		guchar *src;
-
-		src = px + i * rs;
-
-		/* Iterate over RGB */
-		for (rgb = 0; rgb < 3; rgb++) {
-			src_ptr = src + rgb;
-			plane_ptr = plane;
+	int flush;
+
+	memset (&zs, 0, sizeof (zs));
+	if (deflateInit (&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+		g_warning ("Cannot initialize compression of image data");
+		return 0;
+	}
+
+	sp_ps_puts (pmod, "gsave\n");
+	sp_ps_matrix (pmod, transform);
+	sp_ps_puts (pmod, "concat\n");
+	sp_ps_puts (pmod, "/DeviceRGB setcolorspace\n");
+	sp_ps_printf (pmod, "<< /ImageType 1 /Width %u /Height %u /BitsPerComponent 8\n", width, height);
+	sp_ps_printf (pmod, "/Decode [0 1 0 1 0 1] /ImageMatrix [%u 0 0 -%u 0 %u]\n", width, height, height);
+	sp_ps_puts (pmod, "/DataSource currentfile /ASCII85Decode filter /FlateDecode filter\n");
+	sp_ps_puts (pmod, ">> image\n");
+
+	row = g_new (guchar, 3 * width);
+	zbuf = g_new (guchar, SP_PS_BUFFER_SIZE);
+	ascii85_init (&a85);
+
+	/* Extra iteration finishes stream */
+	for (i = 0; i <= height; i++) {
+		if (i < height) {
+			guchar *s, *d;
+			s = px + i * rs;
+			d = row;
 			for (j = 0; j < width; j++) {
-				*(plane_ptr++) = *src_ptr;
-				src_ptr += 4;
+				d[0] = s[0];
+				d[1] = s[1];
+				d[2] = s[2];
+				d += 3;
+				s += 4;
 			}
-			compress_packbits (width, plane, &nout, packb);
-			ascii85_init ();
-			ascii85_nout (nout, (gchar*)packb, ofp);
-			ascii85_out (128, ofp); /* Write EOD of RunLengthDecode filter */
-			ascii85_done (ofp);
+			zs.avail_in = 3 * width;
+			flush = Z_NO_FLUSH;
+		} else {
+			zs.avail_in = 0;
+			flush = Z_FINISH;
 		}
+		zs.next_in = row;
+		do {
+			zs.next_out = zbuf;
+			zs.avail_out = SP_PS_BUFFER_SIZE;
+			deflate (&zs, flush);
+			ascii85_nout (pmod, &a85, SP_PS_BUFFER_SIZE - zs.avail_out, zbuf);
+		} while (zs.avail_out == 0);
 	}
-	/* ps_end_data (ofp); */
-
-#if 0
-	fprintf (ofp, "showpage\n");
-	g_free (data);
-#endif
 
-	g_free (packb);
-	g_free (plane);
+	deflateEnd (&zs);
+	ascii85_done (pmod, &a85);
 
-#if 0
-	if (ferror (ofp))
-	{
-		g_message (_("write error occured"));
-		return (FALSE);
-	}
-#endif
+	g_free (row);
+	g_free (zbuf);
 
-	fprintf (ofp, "grestore\n");
+	sp_ps_puts (pmod, "grestore\n");
 
 	return 0;
-#undef GET_RGB_TILE
 }
 
 /* End of GNU GPL code */
-
-
-
@@ -28,6 +28,13 @@ struct _SPModulePrintPlain {
 	float width;
 	float height;
 	FILE *stream;
+	/* Stream was opened with popen */
+	unsigned int pipe : 1;
+	/* Writing to stream has failed */
+	unsigned int error : 1;
+	/* Output buffer, written to stream when full */
+	unsigned char *buffer;
+	unsigned int length;
 };
 
 struct _SPModulePrintPlainClass {
@@ -36,4 +43,7 @@ struct _SPModulePrintPlainClass {
 
 GType sp_module_print_plain_get_type (void);
 
+/* Non-interactive setup, filename starting with '|' is pipe to program */
+unsigned int sp_module_print_plain_setup_file (SPModulePrintPlain *pmod, const gchar *filename);
+
 #endif
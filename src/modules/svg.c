@@ -173,8 +173,11 @@ svg_save (SPModule *mod, SPDocument *doc, const gchar *uri)
 	}
 
 	/* TODO: */
-	sp_repr_save_file (sp_repr_document (repr), uri);
-	sp_document_set_uri (doc, uri);
+	if (sp_repr_save_file (sp_repr_document (repr), uri)) {
+		sp_document_set_uri (doc, uri);
+	} else {
+		g_warning ("Could not save document to %s", uri);
+	}
 
 	if (!spns) sp_repr_document_unref (rdoc);
 }
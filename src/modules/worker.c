@@ -0,0 +1,453 @@
+#define __SP_WORKER_C__
+
+/*
+ * Long-lived extension processes
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <glib.h>
+
+#include <xml/repr-private.h>
+#include <document.h>
+#include <sp-object.h>
+
+#include "worker.h"
+
+#define EXTENSION_WORKER_VERSION 1
+#define EXTENSION_WORKER_NAME_SIZE 32
+/* Longest frame we accept from worker */
+#define EXTENSION_WORKER_FRAME_MAX (256 * 1024 * 1024)
+/* Milliseconds worker may stay silent while we wait for reply */
+#define EXTENSION_WORKER_TIMEOUT 60000
+
+typedef struct _SPExtensionWorker SPExtensionWorker;
+
+struct _SPExtensionWorker {
+	GPid pid;
+	/* Stdout of worker, read unbuffered so poll sees everything */
+	int in;
+	/* Stdin of worker */
+	FILE *out;
+	unsigned int subtree : 1;
+	unsigned int patch : 1;
+	/* Worker did not answer in time or lost sync */
+	unsigned int hung : 1;
+};
+
+/* Running workers by module */
+static GHashTable *workers = NULL;
+
+static void
+extension_worker_reap (GPid pid, gint status, gpointer data)
+{
+	g_spawn_close_pid (pid);
+}
+
+static void
+extension_worker_free (SPExtensionWorker *w)
+{
+	/* Worker exits when its stdin is closed, unless it is stuck */
+	if (w->hung) kill (w->pid, SIGKILL);
+	if (w->out) fclose (w->out);
+	if (w->in >= 0) close (w->in);
+	g_free (w);
+}
+
+static unsigned int
+extension_worker_write_frame (SPExtensionWorker *w, const gchar *name, const gchar *data, int length)
+{
+	fprintf (w->out, "%s %d\n", name, length);
+	if (length > 0) fwrite (data, 1, length, w->out);
+
+	return !ferror (w->out);
+}
+
+/* Reads exactly length bytes, marking worker hung if it stays silent */
+static unsigned int
+extension_worker_read (SPExtensionWorker *w, gchar *buf, int length)
+{
+	while (length > 0) {
+		struct pollfd pfd;
+		ssize_t n;
+		int ret;
+		pfd.fd = w->in;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		ret = poll (&pfd, 1, EXTENSION_WORKER_TIMEOUT);
+		if ((ret < 0) && (errno == EINTR)) continue;
+		if (ret == 0) {
+			g_warning ("Extension worker did not answer in %d seconds", EXTENSION_WORKER_TIMEOUT / 1000);
+			w->hung = TRUE;
+			return FALSE;
+		}
+		if (ret < 0) return FALSE;
+		n = read (w->in, buf, length);
+		if ((n < 0) && (errno == EINTR)) continue;
+		if (n <= 0) return FALSE;
+		buf += n;
+		length -= n;
+	}
+
+	return TRUE;
+}
+
+/* Payload is returned zero-terminated, and has to be freed */
+static unsigned int
+extension_worker_read_frame (SPExtensionWorker *w, gchar *name, gchar **data, int *length)
+{
+	gchar line[64];
+	int len;
+
+	*data = NULL;
+	/* Header is short, so it is read bytewise to not consume payload */
+	for (len = 0; len < (int) sizeof (line) - 1; len++) {
+		if (!extension_worker_read (w, line + len, 1)) return FALSE;
+		if (line[len] == '\n') break;
+	}
+	if (len >= (int) sizeof (line) - 1) len = 0;
+	line[len] = '\0';
+	if ((sscanf (line, "%31s %d", name, length) != 2) || (*length < 0) || (*length > EXTENSION_WORKER_FRAME_MAX)) {
+		g_warning ("Extension worker sent invalid frame header");
+		w->hung = TRUE;
+		return FALSE;
+	}
+
+	*data = g_try_malloc (*length + 1);
+	if (!*data || !extension_worker_read (w, *data, *length)) {
+		g_free (*data);
+		*data = NULL;
+		return FALSE;
+	}
+	(*data)[*length] = '\0';
+
+	return TRUE;
+}
+
+static SPExtensionWorker *
+extension_worker_start (const gchar *command)
+{
+	SPExtensionWorker *w;
+	gchar name[EXTENSION_WORKER_NAME_SIZE];
+	gchar *cmdline, **argv, *data;
+	GPid pid;
+	gint fdin, fdout;
+	unsigned int ready, done;
+	int length;
+
+	cmdline = g_strdup_printf ("%s --worker", command);
+	if (!g_shell_parse_argv (cmdline, NULL, &argv, NULL)) {
+		g_free (cmdline);
+		return NULL;
+	}
+	g_free (cmdline);
+
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL,
+				       &pid, &fdin, &fdout, NULL, NULL)) {
+		g_strfreev (argv);
+		return NULL;
+	}
+	g_strfreev (argv);
+	/* Reaped whenever it exits, so stopped workers leave no zombies */
+	g_child_watch_add (pid, extension_worker_reap, NULL);
+
+	w = g_new0 (SPExtensionWorker, 1);
+	w->pid = pid;
+	w->in = fdout;
+	w->out = fdopen (fdin, "w");
+	if (!w->out) {
+		close (fdin);
+		w->hung = TRUE;
+		extension_worker_free (w);
+		return NULL;
+	}
+
+	/* Worker introduces itself */
+	ready = FALSE;
+	done = FALSE;
+	while (!done && extension_worker_read_frame (w, name, &data, &length)) {
+		if (!strcmp (name, "end")) {
+			done = TRUE;
+		} else if (!strcmp (name, "ready")) {
+			gchar **caps;
+			int i;
+			caps = g_strsplit (data, " ", 0);
+			if (caps[0] && (atoi (caps[0]) == EXTENSION_WORKER_VERSION)) {
+				ready = TRUE;
+				for (i = 1; caps[i]; i++) {
+					if (!strcmp (caps[i], "subtree")) w->subtree = TRUE;
+					if (!strcmp (caps[i], "patch")) w->patch = TRUE;
+				}
+			}
+			g_strfreev (caps);
+		}
+		g_free (data);
+	}
+
+	if (!done || !ready) {
+		g_warning ("Extension %s does not work as worker", command);
+		w->hung = TRUE;
+		extension_worker_free (w);
+		return NULL;
+	}
+
+	return w;
+}
+
+static SPExtensionWorker *
+extension_worker_get (SPModule *module)
+{
+	SPExtensionWorker *w;
+
+	if (!workers) workers = g_hash_table_new (NULL, NULL);
+
+	w = (SPExtensionWorker *) g_hash_table_lookup (workers, module);
+	if (!w) {
+		const gchar *command;
+		command = sp_repr_attr (module->repr, "command");
+		if (!command) return NULL;
+		w = extension_worker_start (command);
+		if (w) g_hash_table_insert (workers, module, w);
+	}
+
+	return w;
+}
+
+void
+extension_worker_stop (SPModule *module)
+{
+	SPExtensionWorker *w;
+
+	if (!workers) return;
+
+	w = (SPExtensionWorker *) g_hash_table_lookup (workers, module);
+	if (!w) return;
+
+	g_hash_table_remove (workers, module);
+	extension_worker_free (w);
+}
+
+/* Document with copies of given reprs under root, in given order */
+static gchar *
+extension_worker_subtree (SPDocument *doc, const GSList *reprs, int *length)
+{
+	SPReprDoc *rdoc;
+	SPRepr *root, *src, *ref;
+	const GSList *l;
+	gchar *buf;
+	unsigned int i;
+
+	rdoc = sp_repr_document_new ("svg");
+	root = sp_repr_document_root (rdoc);
+
+	/* Root keeps namespaces and size of document */
+	src = sp_document_repr_root (doc);
+	for (i = 0; i < SP_REPR_N_ATTRIBUTES (src); i++) {
+		SPReprAttr *attr;
+		attr = SP_REPR_NTH_ATTRIBUTE (src, i);
+		sp_repr_set_attr (root, SP_REPR_ATTRIBUTE_KEY (attr), SP_REPR_ATTRIBUTE_VALUE (attr));
+	}
+
+	ref = NULL;
+	for (l = reprs; l != NULL; l = l->next) {
+		SPRepr *copy;
+		copy = sp_repr_duplicate ((SPRepr *) l->data);
+		sp_repr_add_child (root, copy, ref);
+		sp_repr_unref (copy);
+		ref = copy;
+	}
+
+	buf = sp_repr_save_buf (rdoc, length);
+	sp_repr_document_unref (rdoc);
+
+	return buf;
+}
+
+static SPRepr *
+extension_worker_lookup (SPDocument *doc, const gchar *id)
+{
+	SPObject *object;
+
+	if (!id) return NULL;
+	object = sp_document_lookup_id (doc, id);
+	if (!object) {
+		g_warning ("Extension patch refers to unknown object %s", id);
+		return NULL;
+	}
+
+	return SP_OBJECT_REPR (object);
+}
+
+/* Inserts copies of element children of src after ref */
+static void
+extension_worker_insert (SPRepr *parent, SPRepr *ref, SPRepr *src)
+{
+	SPRepr *child;
+
+	for (child = sp_repr_children (src); child != NULL; child = sp_repr_next (child)) {
+		SPRepr *copy;
+		if (SP_REPR_TYPE (child) != SP_XML_ELEMENT_NODE) continue;
+		copy = sp_repr_duplicate (child);
+		sp_repr_add_child (parent, copy, ref);
+		sp_repr_unref (copy);
+		ref = copy;
+	}
+}
+
+/* Returns number of operations applied */
+static unsigned int
+extension_worker_apply_patch (SPDocument *doc, SPRepr *patch)
+{
+	SPRepr *op;
+	unsigned int count;
+
+	count = 0;
+	for (op = sp_repr_children (patch); op != NULL; op = sp_repr_next (op)) {
+		const gchar *name;
+		SPRepr *repr;
+
+		if (SP_REPR_TYPE (op) != SP_XML_ELEMENT_NODE) continue;
+		name = sp_repr_name (op);
+
+		if (!strcmp (name, "attr")) {
+			repr = extension_worker_lookup (doc, sp_repr_attr (op, "id"));
+			if (!repr || !sp_repr_attr (op, "name")) continue;
+			sp_repr_set_attr (repr, sp_repr_attr (op, "name"), sp_repr_attr (op, "value"));
+		} else if (!strcmp (name, "replace")) {
+			SPRepr *parent, *prev, *child;
+			repr = extension_worker_lookup (doc, sp_repr_attr (op, "id"));
+			if (!repr || !sp_repr_parent (repr)) continue;
+			parent = sp_repr_parent (repr);
+			prev = NULL;
+			for (child = sp_repr_children (parent); child != repr; child = sp_repr_next (child)) prev = child;
+			/* Old element goes first, so replacement can keep its id */
+			sp_repr_unparent (repr);
+			extension_worker_insert (parent, prev, op);
+		} else if (!strcmp (name, "insert")) {
+			SPRepr *ref;
+			repr = extension_worker_lookup (doc, sp_repr_attr (op, "parent"));
+			if (!repr) continue;
+			ref = NULL;
+			if (sp_repr_attr (op, "after")) {
+				ref = extension_worker_lookup (doc, sp_repr_attr (op, "after"));
+				if (!ref || (sp_repr_parent (ref) != repr)) continue;
+			}
+			extension_worker_insert (repr, ref, op);
+		} else if (!strcmp (name, "delete")) {
+			repr = extension_worker_lookup (doc, sp_repr_attr (op, "id"));
+			if (!repr || !sp_repr_parent (repr)) continue;
+			sp_repr_unparent (repr);
+		} else {
+			g_warning ("Unknown extension patch operation %s", name);
+			continue;
+		}
+		count += 1;
+	}
+
+	return count;
+}
+
+unsigned int
+extension_worker_filter (SPModule *module, SPDocument *doc, const GSList *items, SPDocument **result)
+{
+	SPExtensionWorker *w;
+	gchar name[EXTENSION_WORKER_NAME_SIZE];
+	GSList *reprs;
+	const GSList *l;
+	GString *args;
+	gchar *buf, *data;
+	int length;
+	unsigned int subtree, ok, done, applied;
+#ifdef SIGPIPE
+	void (* oldpipe) (int);
+#endif
+
+	g_return_val_if_fail (module != NULL, FALSE);
+	g_return_val_if_fail (doc != NULL, FALSE);
+	g_return_val_if_fail (result != NULL, FALSE);
+
+	*result = NULL;
+
+	w = extension_worker_get (module);
+	if (!w) return FALSE;
+
+	/* Selected elements in document order, clones have no usable ids */
+	reprs = NULL;
+	for (l = items; l != NULL; l = l->next) {
+		if (!SP_OBJECT_IS_CLONED (l->data)) reprs = g_slist_prepend (reprs, SP_OBJECT_REPR (l->data));
+	}
+	reprs = g_slist_sort (reprs, (GCompareFunc) sp_repr_compare_position);
+
+	args = g_string_new ("");
+	for (l = reprs; l != NULL; l = l->next) {
+		g_string_append_printf (args, "--id=%s\n", sp_repr_attr ((SPRepr *) l->data, "id"));
+	}
+
+	subtree = w->subtree && (reprs != NULL);
+	if (subtree) {
+		buf = extension_worker_subtree (doc, reprs, &length);
+	} else {
+		buf = sp_repr_save_buf (sp_document_repr_doc (doc), &length);
+	}
+	g_slist_free (reprs);
+
+#ifdef SIGPIPE
+	/* Dead worker must not take us with it */
+	oldpipe = signal (SIGPIPE, SIG_IGN);
+#endif
+
+	ok = extension_worker_write_frame (w, "args", args->str, args->len) &&
+		extension_worker_write_frame (w, "mode", (subtree) ? "subtree" : "document", (subtree) ? 7 : 8) &&
+		extension_worker_write_frame (w, "svg", buf, length) &&
+		extension_worker_write_frame (w, "end", NULL, 0) &&
+		!fflush (w->out);
+	g_string_free (args, TRUE);
+	g_free (buf);
+
+	done = FALSE;
+	applied = FALSE;
+	while (ok && !done) {
+		ok = extension_worker_read_frame (w, name, &data, &length);
+		if (!ok) break;
+		if (!strcmp (name, "end")) {
+			done = TRUE;
+		} else if (!strcmp (name, "svg")) {
+			if (!*result) *result = sp_document_new_from_mem (data, length, TRUE, FALSE);
+		} else if (!strcmp (name, "patch")) {
+			SPReprDoc *rdoc;
+			rdoc = sp_repr_read_mem (data, length, NULL);
+			if (rdoc) {
+				if (extension_worker_apply_patch (doc, sp_repr_document_root (rdoc))) applied = TRUE;
+				sp_repr_document_unref (rdoc);
+			}
+		} else if (!strcmp (name, "error")) {
+			g_warning ("Extension failed: %s", data);
+		}
+		g_free (data);
+	}
+
+#ifdef SIGPIPE
+	signal (SIGPIPE, oldpipe);
+#endif
+
+	if (applied) sp_document_done (doc);
+
+	if (!done) {
+		/* Worker died, hung or lost sync, next run starts new one */
+		w->hung = TRUE;
+		extension_worker_stop (module);
+		if (!applied && !*result) return FALSE;
+	}
+
+	return TRUE;
+}
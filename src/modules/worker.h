@@ -0,0 +1,40 @@
+/*
+ * Long-lived extension processes
+ *
+ * Extensions with worker="true" on their command are started once, with
+ * --worker argument, and then talk to us over their stdin and stdout.
+ * Everything is sent as frames, "<name> <length>\n" followed by length
+ * bytes of payload, and every message is sequence of frames ending with
+ * "end 0\n".
+ *
+ * Worker starts by sending "ready" frame with protocol version and
+ * capabilities, like "1 subtree patch".  Request has "args" frame with
+ * arguments, one per line, "mode" frame and "svg" frame.  In "subtree"
+ * mode document root only holds copies of selected elements, with
+ * their ids, otherwise ("document" mode) it is whole document.  Reply
+ * has "svg" frame with complete new document, or "patch" frame with
+ * changes to apply to document, and optionally "error" frame.
+ *
+ * Patch is XML document with <patch> root and following operations:
+ *   <attr id="ID" name="NAME" value="VALUE"/>, without value unsets
+ *   <replace id="ID">ELEMENTS</replace>
+ *   <insert parent="ID" after="ID">ELEMENTS</insert>, without after prepends
+ *   <delete id="ID"/>
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#ifndef __MODULES_WORKER_H__
+#define __MODULES_WORKER_H__
+
+#include "module.h"
+
+/*
+ * Runs filter on selected items in worker, starting it if needed.
+ * Patches are applied to document, complete document is returned in
+ * result.  Returns FALSE if worker could not be used at all.
+ */
+unsigned int extension_worker_filter (SPModule *module, SPDocument *doc, const GSList *items, SPDocument **result);
+void extension_worker_stop (SPModule *module);
+
+#endif /* __MODULES_WORKER_H__ */
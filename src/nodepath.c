@@ -16,8 +16,7 @@
 #include <gdk/gdkkeysyms.h>
 #include "svg/svg.h"
 #include "helper/sp-canvas-util.h"
-#include "helper/sp-ctrlline.h"
-#include "knot.h"
+#include "helper/sp-ctrlset.h"
 #include "inkscape.h"
 #include "document.h"
 #include "desktop.h"
@@ -55,6 +54,8 @@ static gchar * parse_nodetypes (const gchar * types, gint length);
 
 static void stamp_repr  (SPNodePath * np);
 static SPCurve * create_curve (SPNodePath * np);
+static void update_object_partial (SPNodePath * np, GList * nodes);
+static void sp_nodepath_invalidate_curve (SPNodePath * np);
 static gchar * create_typestr (SPNodePath * np);
 
 static void sp_node_ensure_ctrls (SPPathNode * node);
@@ -70,17 +71,18 @@ static void sp_node_set_selected (SPPathNode * node, gboolean selected);
 static void sp_node_adjust_knot (SPPathNode * node, gint which_adjust);
 static void sp_node_adjust_knots (SPPathNode * node);
 
-/* Knot event handlers */
+/* Handle event handlers */
 
-static void node_clicked (SPKnot * knot, guint state, gpointer data);
-static void node_grabbed (SPKnot * knot, guint state, gpointer data);
-static void node_ungrabbed (SPKnot * knot, guint state, gpointer data);
-static gboolean node_request (SPKnot * knot, NRPointF *p, guint state, gpointer data);
-static void node_ctrl_clicked (SPKnot * knot, guint state, gpointer data);
-static void node_ctrl_grabbed (SPKnot * knot, guint state, gpointer data);
-static void node_ctrl_ungrabbed (SPKnot * knot, guint state, gpointer data);
-static gboolean node_ctrl_request (SPKnot * knot, NRPointF *p, guint state, gpointer data);
-static void node_ctrl_moved (SPKnot * knot, NRPointF *p, guint state, gpointer data);
+static gint sp_nodepath_event (SPCanvasItem * item, GdkEvent * event, SPNodePath * np);
+static void node_clicked (SPPathNode * n, guint state);
+static void node_grabbed (SPPathNode * n, guint state);
+static void node_ungrabbed (SPPathNode * n, guint state);
+static gboolean node_request (SPPathNode * n, NRPointF *p, guint state);
+static void node_ctrl_clicked (SPPathNode * n, gint which, guint state);
+static void node_ctrl_grabbed (SPPathNode * n, gint which, guint state);
+static void node_ctrl_ungrabbed (SPPathNode * n, gint which, guint state);
+static gboolean node_ctrl_request (SPPathNode * n, gint which, NRPointF *p, guint state);
+static void node_ctrl_moved (SPPathNode * n, gint which, NRPointF *p, guint state);
 
 /* Constructors and destructors */
 
@@ -100,6 +102,11 @@ static ArtPathcode sp_node_path_code_from_side (SPPathNode * node, SPPathNodeSid
 
 // active_node indicates mouseover node
 static SPPathNode * active_node = NULL;
+// drag was canceled by esc, so following release is ignored
+static gboolean drag_escaped = FALSE;
+
+#define NODEPATH_EVENT_MASK (GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK | \
+			     GDK_POINTER_MOTION_HINT_MASK | GDK_KEY_PRESS_MASK | GDK_KEY_RELEASE_MASK)
 
 /**
 \brief Creates new nodepath from item 
@@ -133,6 +140,12 @@ sp_nodepath_new (SPDesktop * desktop, SPItem * item)
 	np->path = path;
 	np->subpaths = NULL;
 	np->selected = NULL;
+	np->ctrls = sp_canvas_item_new (SP_DT_CONTROLS (desktop), SP_TYPE_CTRLSET, NULL);
+	np->hovered = -1;
+	np->grabbed = -1;
+	np->moved = FALSE;
+	np->curve = NULL;
+	gtk_signal_connect (GTK_OBJECT (np->ctrls), "event", GTK_SIGNAL_FUNC (sp_nodepath_event), np);
 	sp_item_i2d_affine (SP_ITEM (path), &i2d);
 	nr_matrix_d_from_f (&np->i2d, &i2d);
 	nr_matrix_d_invert (&np->d2i, &np->i2d);
@@ -253,7 +266,98 @@ update_object (SPNodePath * np)
 
 	sp_shape_set_curve (SP_SHAPE (np->path), curve, TRUE);
 
-	sp_curve_unref (curve);
+	/* Keep it, so following drags can patch it */
+	if (np->curve) sp_curve_unref (np->curve);
+	np->curve = curve;
+}
+
+static void
+sp_nodepath_invalidate_curve (SPNodePath * np)
+{
+	if (np->curve) {
+		sp_curve_unref (np->curve);
+		np->curve = NULL;
+	}
+}
+
+/* Rewrites curve segment ending at node, and subpath moveto if node starts it */
+static gboolean
+curve_patch_segment (SPNodePath * np, SPPathNode * n)
+{
+	SPNodeSubPath * sp;
+	ArtBpath * bp;
+
+	sp = n->subpath;
+
+	if (n == sp->first) {
+		if ((sp->index < 0) || (sp->index >= np->curve->end)) return FALSE;
+		bp = np->curve->bpath + sp->index;
+		if ((bp->code != ART_MOVETO) && (bp->code != ART_MOVETO_OPEN)) return FALSE;
+		bp->x3 = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, n->pos.x, n->pos.y);
+		bp->y3 = NR_MATRIX_DF_TRANSFORM_Y (&np->d2i, n->pos.x, n->pos.y);
+		/* Only closed subpath ends with its first node */
+		if (!sp->closed) return TRUE;
+	}
+
+	if ((n->index < 0) || (n->index >= np->curve->end)) return FALSE;
+	bp = np->curve->bpath + n->index;
+	if (bp->code != n->code) return FALSE;
+
+	bp->x3 = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, n->pos.x, n->pos.y);
+	bp->y3 = NR_MATRIX_DF_TRANSFORM_Y (&np->d2i, n->pos.x, n->pos.y);
+	if (n->code == ART_CURVETO) {
+		bp->x1 = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, n->p.other->n.pos.x, n->p.other->n.pos.y);
+		bp->y1 = NR_MATRIX_DF_TRANSFORM_Y (&np->d2i, n->p.other->n.pos.x, n->p.other->n.pos.y);
+		bp->x2 = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, n->p.pos.x, n->p.pos.y);
+		bp->y2 = NR_MATRIX_DF_TRANSFORM_Y (&np->d2i, n->p.pos.x, n->p.pos.y);
+	}
+
+	return TRUE;
+}
+
+/* Node position and handles appear in its own and following segment */
+static gboolean
+curve_patch_node (SPNodePath * np, SPPathNode * n)
+{
+	if (!curve_patch_segment (np, n)) return FALSE;
+	if (n->n.other && !curve_patch_segment (np, n->n.other)) return FALSE;
+
+	return TRUE;
+}
+
+/**
+\brief Updates path after given nodes were moved, touching only curve segments around them.
+Moving node adjusts handles of its neighbours too, so those are patched as well.
+Falls back to rebuilding whole curve if path does not have the curve we built
+or node structure changed since.
+*/
+static void
+update_object_partial (SPNodePath * np, GList * nodes)
+{
+	GList * l;
+
+	g_assert (np);
+
+	/* Curve held as typed attribute value (e.g. by duplicate) must not change */
+	if (!np->curve || (SP_SHAPE (np->path)->curve != np->curve) || np->curve->shared) {
+		update_object (np);
+		return;
+	}
+
+	for (l = nodes; l != NULL; l = l->next) {
+		SPPathNode * n;
+		n = (SPPathNode *) l->data;
+		if ((n->p.other && !curve_patch_node (np, n->p.other)) ||
+		    !curve_patch_node (np, n) ||
+		    (n->n.other && !curve_patch_node (np, n->n.other))) {
+			update_object (np);
+			return;
+		}
+	}
+
+	/* Shape and its views hold the same curve, shared geometry is keyed on its generation */
+	np->curve->generation += 1;
+	sp_object_request_update (SP_OBJECT (np->path), SP_OBJECT_MODIFIED_FLAG);
 }
 
 /**
@@ -292,19 +396,16 @@ update_repr_internal (SPNodePath * np)
 {
 	SPCurve * curve;
 	gchar * typestr;
-	gchar * svgpath;
 
 	g_assert (np);
 
 	curve = create_curve (np);
 	typestr = create_typestr (np);
 
-	svgpath = sp_svg_write_path (curve->bpath);
-
-	sp_repr_set_attr (SP_OBJECT (np->path)->repr, "d", svgpath);
+	/* Path reads binary data back directly, string is made on save */
+	sp_path_set_repr_bpath (SP_OBJECT (np->path)->repr, curve->bpath);
 	sp_repr_set_attr (SP_OBJECT (np->path)->repr, "sodipodi:nodetypes", typestr);
 
-	g_free (svgpath);
 	g_free (typestr);
 	sp_curve_unref (curve);
 }
@@ -372,6 +473,9 @@ create_curve (SPNodePath * np)
 		p3.x = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, sp->first->pos.x, sp->first->pos.y);
 		p3.y = NR_MATRIX_DF_TRANSFORM_Y (&np->d2i, sp->first->pos.x, sp->first->pos.y);
 		sp_curve_moveto (curve, p3.x, p3.y);
+		/* Moveto is written with first segment, lone one is dropped */
+		sp->index = (sp->first->n.other) ? curve->end : -1;
+		sp->first->index = -1;
 		n = sp->first->n.other;
 		while (n) {
 			p3.x = NR_MATRIX_DF_TRANSFORM_X (&np->d2i, n->pos.x, n->pos.y);
@@ -391,6 +495,7 @@ create_curve (SPNodePath * np)
 				g_assert_not_reached ();
 				break;
 			}
+			n->index = curve->end - 1;
 			if (n != sp->last) {
 				n = n->n.other;
 			} else {
@@ -478,12 +583,19 @@ sp_nodepath_destroy (SPNodePath * np)
 {
 	g_assert (np);
 
+	if (active_node && (active_node->subpath->nodepath == np)) active_node = NULL;
+
 	while (np->subpaths) {
 		sp_nodepath_subpath_destroy ((SPNodeSubPath *) np->subpaths->data);
 	}
 
 	g_assert (!np->selected);
 
+	if (np->grabbed >= 0) sp_canvas_item_ungrab (np->ctrls, GDK_CURRENT_TIME);
+	gtk_object_destroy (GTK_OBJECT (np->ctrls));
+
+	if (np->curve) sp_curve_unref (np->curve);
+
 	g_free (np);
 }
 
@@ -694,6 +806,7 @@ sp_nodepath_set_line_type (SPPathNode * end, ArtPathcode code)
 	start = end->p.other;
 
 	end->code = code;
+	sp_nodepath_invalidate_curve (end->subpath->nodepath);
 
 	if (code == ART_LINETO) {
 		if (start->code == ART_LINETO) start->type = SP_PATHNODE_CUSP;
@@ -735,9 +848,9 @@ sp_nodepath_set_node_type (SPPathNode * node, SPPathNodeType type)
 	node->type = type;
 
 	if (node->type == SP_PATHNODE_CUSP) {
-		g_object_set (G_OBJECT (node->knot), "shape", SP_KNOT_SHAPE_DIAMOND, "size", 9, NULL);
+		sp_ctrlset_set_shape (SP_CTRLSET (node->subpath->nodepath->ctrls), node->ctrl, SP_CTRL_SHAPE_DIAMOND, 9);
 	} else {
-		g_object_set (G_OBJECT (node->knot), "shape", SP_KNOT_SHAPE_SQUARE, "size", 7, NULL);
+		sp_ctrlset_set_shape (SP_CTRLSET (node->subpath->nodepath->ctrls), node->ctrl, SP_CTRL_SHAPE_SQUARE, 7);
 	}
 
 	sp_node_adjust_knots (node);
@@ -817,7 +930,7 @@ sp_nodepath_selected_nodes_move (SPNodePath * nodepath, gdouble dx, gdouble dy)
 		sp_node_moveto (n, n->pos.x + bx, n->pos.y + by);
 	}
 
-	update_object (nodepath);
+	update_object_partial (nodepath, nodepath->selected);
 }
 
 void
@@ -873,11 +986,12 @@ sp_node_ensure_knot (SPPathNode * node, gint which, gboolean show_knot)
 	SPNodePath * nodepath;
 	SPPathNodeSide * side;
 	ArtPathcode code;
-	NRPointF p;
+	SPCtrlSet * cs;
 
 	g_assert (node != NULL);
 
 	nodepath = node->subpath->nodepath;
+	cs = SP_CTRLSET (nodepath->ctrls);
 
 	side = sp_node_get_side (node, which);
 	code = sp_node_path_code_from_side (node, side);
@@ -885,21 +999,11 @@ sp_node_ensure_knot (SPPathNode * node, gint which, gboolean show_knot)
 	show_knot = show_knot && (code == ART_CURVETO);
 
 	if (show_knot) {
-		if (!SP_KNOT_IS_VISIBLE (side->knot)) {
-			sp_knot_show (side->knot);
-		}
-
-		p.x = side->pos.x;
-		p.y = side->pos.y;
-
-		sp_knot_set_position (side->knot, &p, 0);
-		sp_canvas_item_show (side->line);
-
+		sp_ctrlset_set_position (cs, side->ctrl, side->pos.x, side->pos.y);
+		sp_ctrlset_set_line (cs, side->ctrl, TRUE, node->pos.x, node->pos.y);
+		sp_ctrlset_show (cs, side->ctrl, TRUE);
 	} else {
-		if (SP_KNOT_IS_VISIBLE (side->knot)) {
-			sp_knot_hide (side->knot);
-		}
-		sp_canvas_item_hide (side->line);
+		sp_ctrlset_show (cs, side->ctrl, FALSE);
 	}
 }
 
@@ -907,21 +1011,14 @@ void
 sp_node_ensure_ctrls (SPPathNode * node)
 {
 	SPNodePath * nodepath;
-	NRPointF p;
 	gboolean show_knots;
 
 	g_assert (node != NULL);
 
 	nodepath = node->subpath->nodepath;
 
-	if (!SP_KNOT_IS_VISIBLE (node->knot)) {
-		sp_knot_show (node->knot);
-	}
-
-	p.x = node->pos.x;
-	p.y = node->pos.y;
-
-	sp_knot_set_position (node->knot, &p, 0);
+	sp_ctrlset_set_position (SP_CTRLSET (nodepath->ctrls), node->ctrl, node->pos.x, node->pos.y);
+	sp_ctrlset_show (SP_CTRLSET (nodepath->ctrls), node->ctrl, TRUE);
 
 	show_knots = node->selected;
 	if (node->p.other != NULL) {
@@ -1172,6 +1269,7 @@ sp_node_selected_join_segment (void)
 
 		/*similar to sp_nodepath_subpath_close (sp), without the node destruction*/
 		sp->closed = TRUE;
+		sp_nodepath_invalidate_curve (nodepath);
 
 		sp->first->p.other = sp->last;
 		sp->last->n.other = sp->first;
@@ -1301,22 +1399,15 @@ sp_node_selected_set_type (SPPathNodeType type)
 static void
 sp_node_set_selected (SPPathNode * node, gboolean selected)
 {
+	SPCtrlSet * cs;
+
 	node->selected = selected;
 
+	cs = SP_CTRLSET (node->subpath->nodepath->ctrls);
 	if (selected) {
-		g_object_set (G_OBJECT (node->knot),
-			      "fill", NODE_FILL_SEL,
-			      "fill_mouseover", NODE_FILL_SEL_HI,
-			      "stroke", NODE_STROKE_SEL,
-			      "stroke_mouseover", NODE_STROKE_SEL_HI,
-			      NULL);
+		sp_ctrlset_set_colors (cs, node->ctrl, NODE_FILL_SEL, NODE_STROKE_SEL, NODE_FILL_SEL_HI, NODE_STROKE_SEL_HI);
 	} else {
-		g_object_set (G_OBJECT (node->knot),
-			      "fill", NODE_FILL,
-			      "fill_mouseover", NODE_FILL_HI,
-			      "stroke", NODE_STROKE,
-			      "stroke_mouseover", NODE_STROKE_HI,
-			      NULL);
+		sp_ctrlset_set_colors (cs, node->ctrl, NODE_FILL, NODE_STROKE, NODE_FILL_HI, NODE_STROKE_HI);
 	}
 
 	sp_node_ensure_ctrls (node);
@@ -1339,16 +1430,14 @@ sp_nodepath_node_select (SPPathNode * node, gboolean incremental, gboolean overr
 
 	if (incremental) {
 		if (override) {
-			if (!g_list_find (nodepath->selected, node)) {
+			if (!node->selected) {
 				nodepath->selected = g_list_append (nodepath->selected, node);
 			}
 			sp_node_set_selected (node, TRUE);
 		} else { // toggle
 			if (node->selected) {
-				g_assert (g_list_find (nodepath->selected, node));
 				nodepath->selected = g_list_remove (nodepath->selected, node);
 			} else {
-				g_assert (!g_list_find (nodepath->selected, node));
 				nodepath->selected = g_list_append (nodepath->selected, node);
 			}
 			sp_node_set_selected (node, !node->selected);
@@ -1390,6 +1479,47 @@ sp_nodepath_deselect (SPNodePath *nodepath)
 	}
 }
 
+/**
+\brief add nodes to selection in list order, or toggle them; frees the list
+*/
+static void
+sp_nodepath_select_list (SPNodePath *nodepath, GList *nodes, gboolean toggle)
+{
+	GList * l, * added;
+	gboolean removed;
+
+	/* Appending one by one is quadratic for big selections */
+	added = NULL;
+	removed = FALSE;
+	for (l = nodes; l != NULL; l = l->next) {
+		SPPathNode * node;
+		node = (SPPathNode *) l->data;
+		if (!node->selected) {
+			sp_node_set_selected (node, TRUE);
+			added = g_list_prepend (added, node);
+		} else if (toggle) {
+			sp_node_set_selected (node, FALSE);
+			removed = TRUE;
+		}
+	}
+
+	if (removed) {
+		l = nodepath->selected;
+		while (l) {
+			GList * next;
+			next = l->next;
+			if (!((SPPathNode *) l->data)->selected) {
+				nodepath->selected = g_list_delete_link (nodepath->selected, l);
+			}
+			l = next;
+		}
+	}
+
+	nodepath->selected = g_list_concat (nodepath->selected, g_list_reverse (added));
+
+	g_list_free (nodes);
+}
+
 /**
 \brief select all nodes in the nodepath
 */
@@ -1397,18 +1527,19 @@ void
 sp_nodepath_select_all (SPNodePath *nodepath)
 {
 	SPNodeSubPath * subpath;
-	SPPathNode * node;
-	GList * spl, * nl;
+	GList * spl, * nl, * nodes;
 
 	if (!nodepath) return;
 
+	nodes = NULL;
 	for (spl = nodepath->subpaths; spl != NULL; spl = spl->next) {
 		subpath = (SPNodeSubPath *) spl->data;
 		for (nl = subpath->nodes; nl != NULL; nl = nl->next) {
-			node = (SPPathNode *) nl->data;
-			sp_nodepath_node_select (node, TRUE, TRUE);
+			nodes = g_list_prepend (nodes, nl->data);
 		}
 	}
+
+	sp_nodepath_select_list (nodepath, g_list_reverse (nodes), FALSE);
 }
 
 /**
@@ -1490,30 +1621,31 @@ sp_nodepath_select_prev (SPNodePath *nodepath)
 void
 sp_nodepath_select_rect (SPNodePath *nodepath, NRRectD *b, gboolean incremental)
 {
-	SPNodeSubPath * subpath;
-	SPPathNode * node;
-	ArtPoint p;
-	GList * spl, * nl;
+	SPCtrlSet * cs;
+	GSList * handles, * l;
+	GList * nodes;
 
 	if (!incremental) {
 		sp_nodepath_deselect (nodepath);
 	}
 
-	for (spl = nodepath->subpaths; spl != NULL; spl = spl->next) {
-		subpath = (SPNodeSubPath *) spl->data;
-		for (nl = subpath->nodes; nl != NULL; nl = nl->next) {
-			node = (SPPathNode *) nl->data;
-#if 0
-			art_affine_point (&p, &node->pos, nodepath->i2d);
-#else
-			p.x = node->pos.x;
-			p.y = node->pos.y;
-#endif
-			if ((p.x > b->x0) && (p.x < b->x1) && (p.y > b->y0) && (p.y < b->y1)) {
-				sp_nodepath_node_select (node, TRUE, FALSE);
-			}
+	/* Only handles near rectangle are looked at */
+	cs = SP_CTRLSET (nodepath->ctrls);
+	handles = sp_ctrlset_find_rect (cs, b);
+	nodes = NULL;
+	for (l = handles; l != NULL; l = l->next) {
+		SPPathNode * node;
+		gint handle;
+		handle = GPOINTER_TO_INT (l->data);
+		node = (SPPathNode *) sp_ctrlset_get_data (cs, handle);
+		if (handle != node->ctrl) continue;
+		if ((node->pos.x > b->x0) && (node->pos.x < b->x1) && (node->pos.y > b->y0) && (node->pos.y < b->y1)) {
+			nodes = g_list_prepend (nodes, node);
 		}
 	}
+	g_slist_free (handles);
+
+	sp_nodepath_select_list (nodepath, nodes, TRUE);
 }
 
 /**
@@ -1535,11 +1667,11 @@ GList *save_nodepath_selection (SPNodePath *nodepath)
 				node = (SPPathNode *) nl->data;
 				i ++; 
 				if (node->selected) {
-					r = g_list_append (r, GINT_TO_POINTER (i));
+					r = g_list_prepend (r, GINT_TO_POINTER (i));
 					}
 				}
 			}
-		return r;
+		return g_list_reverse (r);
 }
 
 /**
@@ -1549,22 +1681,26 @@ void restore_nodepath_selection (SPNodePath *nodepath, GList *r)
 {
 	SPPathNode *node, *last = NULL;
 	SPNodeSubPath * subpath, *subpath_next;
-	GList * spl, * nl = NULL;
+	GList * spl, * nl = NULL, * nodes = NULL;
 	guint i = 0;
 
 		sp_nodepath_deselect (nodepath);
 
+		/* Positions are in ascending order */
 		for (spl = nodepath->subpaths; spl != NULL; spl = spl->next) {
 			subpath = (SPNodeSubPath *) spl->data;
 			for (nl = subpath->nodes; nl != NULL; nl = nl->next) {
 				node = (SPPathNode *) nl->data;
 				i ++; 
-				if (g_list_find (r, GINT_TO_POINTER (i))) {
-					sp_nodepath_node_select (node, TRUE, TRUE);
+				while (r && ((guint) GPOINTER_TO_INT (r->data) < i)) r = r->next;
+				if (r && ((guint) GPOINTER_TO_INT (r->data) == i)) {
+					nodes = g_list_prepend (nodes, node);
 					}
 				}
 			}
 
+		sp_nodepath_select_list (nodepath, g_list_reverse (nodes), FALSE);
+
 }
 
 /**
@@ -1620,7 +1756,6 @@ sp_node_adjust_knot (SPPathNode * node, gint which_adjust)
 
 		me->pos.x = node->pos.x + dx * len / linelen;
 		me->pos.y = node->pos.y + dy * len / linelen;
-		sp_knot_set_position (me->knot, &me->pos, 0);
 
 		sp_node_ensure_ctrls (node);
 		return;
@@ -1630,7 +1765,6 @@ sp_node_adjust_knot (SPPathNode * node, gint which_adjust)
 
 		me->pos.x = 2 * node->pos.x - other->pos.x;
 		me->pos.y = 2 * node->pos.y - other->pos.y;
-		sp_knot_set_position (me->knot, &me->pos, 0);
 
 		sp_node_ensure_ctrls (node);
 		return;
@@ -1648,7 +1782,6 @@ sp_node_adjust_knot (SPPathNode * node, gint which_adjust)
 
 	me->pos.x = node->pos.x - dx * len / otherlen;
 	me->pos.y = node->pos.y - dy * len / otherlen;
-	sp_knot_set_position (me->knot, &me->pos, 0);
 
 	sp_node_ensure_ctrls (node);
 }
@@ -1722,29 +1855,157 @@ sp_node_adjust_knots (SPPathNode * node)
 }
 
 /*
- * Knot events
+ * Handle events
+ *
+ * All handles of nodepath are drawn by single canvas item, so grabbing,
+ * dragging and highlighting, that SPKnot does for every knot, is done here
  */
-static gboolean
-node_event (SPKnot * knot, GdkEvent * event, SPPathNode * n)
+
+static SPPathNode *
+sp_nodepath_handle_node (SPNodePath * np, gint handle, gint * which)
+{
+	SPPathNode * n;
+
+	n = (SPPathNode *) sp_ctrlset_get_data (SP_CTRLSET (np->ctrls), handle);
+
+	if (handle == n->p.ctrl) {
+		*which = -1;
+	} else if (handle == n->n.ctrl) {
+		*which = 1;
+	} else {
+		*which = 0;
+	}
+
+	return n;
+}
+
+static void
+sp_nodepath_set_hovered (SPNodePath * np, gint handle)
+{
+	SPPathNode * n;
+	gint which;
+
+	if (handle == np->hovered) return;
+
+	np->hovered = handle;
+	sp_ctrlset_set_current (SP_CTRLSET (np->ctrls), handle);
+
+	active_node = NULL;
+	if (handle >= 0) {
+		n = sp_nodepath_handle_node (np, handle, &which);
+		if (which == 0) active_node = n;
+	}
+}
+
+static gint
+sp_nodepath_event (SPCanvasItem * item, GdkEvent * event, SPNodePath * np)
 {
-	gboolean ret = FALSE;
+	SPCtrlSet * cs;
+	SPPathNode * n;
+	NRPointF p;
+	NRPointD pos;
+	gint handle, which;
+
+	cs = SP_CTRLSET (item);
+
 	switch (event->type) {
-	case GDK_ENTER_NOTIFY:
-		active_node = n;
+	case GDK_BUTTON_PRESS:
+		if (event->button.button != 1) break;
+		handle = sp_ctrlset_find (cs, event->button.x, event->button.y);
+		if (handle < 0) break;
+		sp_desktop_w2d_xy_point (np->desktop, &p, event->button.x, event->button.y);
+		sp_ctrlset_get_position (cs, handle, &pos);
+		np->hx = p.x - pos.x;
+		np->hy = p.y - pos.y;
+		sp_canvas_item_grab (item, NODEPATH_EVENT_MASK, NULL, event->button.time);
+		np->grabbed = handle;
+		np->moved = FALSE;
+		sp_nodepath_set_hovered (np, handle);
+		return TRUE;
+	case GDK_BUTTON_RELEASE:
+		if (event->button.button != 1) break;
+		if (drag_escaped) {
+			drag_escaped = FALSE;
+			return TRUE;
+		}
+		if (np->grabbed < 0) break;
+		handle = np->grabbed;
+		np->grabbed = -1;
+		sp_canvas_item_ungrab (item, event->button.time);
+		n = sp_nodepath_handle_node (np, handle, &which);
+		if (np->moved) {
+			np->moved = FALSE;
+			if (which == 0) {
+				node_ungrabbed (n, event->button.state);
+			} else {
+				node_ctrl_ungrabbed (n, which, event->button.state);
+			}
+		} else {
+			if (which == 0) {
+				node_clicked (n, event->button.state);
+			} else {
+				node_ctrl_clicked (n, which, event->button.state);
+			}
+		}
+		return TRUE;
+	case GDK_MOTION_NOTIFY:
+		if (np->grabbed >= 0) {
+			n = sp_nodepath_handle_node (np, np->grabbed, &which);
+			if (!np->moved) {
+				if (which == 0) {
+					node_grabbed (n, event->motion.state);
+				} else {
+					node_ctrl_grabbed (n, which, event->motion.state);
+				}
+				np->moved = TRUE;
+			}
+			sp_desktop_w2d_xy_point (np->desktop, &p, event->motion.x, event->motion.y);
+			p.x -= np->hx;
+			p.y -= np->hy;
+			if (which == 0) {
+				node_request (n, &p, event->motion.state);
+			} else if (!node_ctrl_request (n, which, &p, event->motion.state)) {
+				node_ctrl_moved (n, which, &p, event->motion.state);
+			}
+			return TRUE;
+		}
+		/* Pointer can move between handles without leaving item */
+		sp_nodepath_set_hovered (np, sp_ctrlset_find (cs, event->motion.x, event->motion.y));
 		break;
+	case GDK_ENTER_NOTIFY:
+		if (np->grabbed < 0) {
+			sp_nodepath_set_hovered (np, sp_ctrlset_find (cs, event->crossing.x, event->crossing.y));
+		}
+		return TRUE;
 	case GDK_LEAVE_NOTIFY:
-		active_node = NULL;
-		break;
+		if (np->grabbed < 0) sp_nodepath_set_hovered (np, -1);
+		return TRUE;
 	case GDK_KEY_PRESS:
+		if (np->grabbed < 0) break;
 		switch (event->key.keyval) {
 		case GDK_space:
 			if (event->key.state & GDK_BUTTON1_MASK) {
-				SPNodePath * nodepath;
-				nodepath = n->subpath->nodepath;
-				stamp_repr(nodepath);
-				ret = TRUE;
+				stamp_repr (np);
+				return TRUE;
 			}
 			break;
+		case GDK_Escape:
+			handle = np->grabbed;
+			np->grabbed = -1;
+			sp_canvas_item_ungrab (item, event->key.time);
+			drag_escaped = TRUE;
+			if (np->moved) {
+				np->moved = FALSE;
+				n = sp_nodepath_handle_node (np, handle, &which);
+				if (which == 0) {
+					node_ungrabbed (n, event->key.state);
+				} else {
+					node_ctrl_ungrabbed (n, which, event->key.state);
+				}
+				/* Nodepath may be rebuilt */
+				sp_document_undo (SP_DT_DOCUMENT (np->desktop));
+			}
+			return TRUE;
 		default:
 			break;
 		}
@@ -1753,7 +2014,7 @@ node_event (SPKnot * knot, GdkEvent * event, SPPathNode * n)
 		break;
 	}
 
-	return ret;
+	return FALSE;
 }
 
 gboolean node_key (GdkEvent * event)
@@ -1776,14 +2037,17 @@ gboolean node_key (GdkEvent * event)
 			break;
 		case GDK_c:
 			sp_nodepath_set_node_type (active_node, SP_PATHNODE_CUSP);
+			update_object (active_node->subpath->nodepath);
 			ret = TRUE;
 			break;
 		case GDK_s:
 			sp_nodepath_set_node_type (active_node, SP_PATHNODE_SMOOTH);
+			update_object (active_node->subpath->nodepath);
 			ret = TRUE;
 			break;
 		case GDK_y:
 			sp_nodepath_set_node_type (active_node, SP_PATHNODE_SYMM);
+			update_object (active_node->subpath->nodepath);
 			ret = TRUE;
 			break;
 		case GDK_b:
@@ -1797,114 +2061,71 @@ gboolean node_key (GdkEvent * event)
 }
 
 static void
-node_clicked (SPKnot * knot, guint state, gpointer data)
+node_clicked (SPPathNode * n, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	if (state & GDK_CONTROL_MASK) {
 		if (n->type == SP_PATHNODE_CUSP) {
 			sp_nodepath_set_node_type (n, SP_PATHNODE_SMOOTH);
 		} else {
 			sp_nodepath_set_node_type (n, SP_PATHNODE_CUSP);
 		}
+		update_object (n->subpath->nodepath);
 	} else {
 		sp_nodepath_node_select (n, (state & GDK_SHIFT_MASK), FALSE);
 	}
 }
 
 static void
-node_grabbed (SPKnot * knot, guint state, gpointer data)
+node_grabbed (SPPathNode * n, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	if (!n->selected) {
 		sp_nodepath_node_select (n, (state & GDK_SHIFT_MASK), FALSE);
 	}
 }
 
 static void
-node_ungrabbed (SPKnot * knot, guint state, gpointer data)
+node_ungrabbed (SPPathNode * n, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	update_repr (n->subpath->nodepath);
 }
 
 static gboolean
-node_request (SPKnot *knot, NRPointF *p, guint state, gpointer data)
+node_request (SPPathNode * n, NRPointF *p, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
-	/* fixme: This goes to "moved" event? */
 	sp_nodepath_selected_nodes_move (n->subpath->nodepath,
-					 p->x - knot->x, p->y - knot->y);
+					 p->x - n->pos.x, p->y - n->pos.y);
 
 	return TRUE;
 }
 
 static void
-node_ctrl_clicked (SPKnot * knot, guint state, gpointer data)
+node_ctrl_clicked (SPPathNode * n, gint which, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	sp_nodepath_node_select (n, (state & GDK_SHIFT_MASK), FALSE);
 }
 
 static void
-node_ctrl_grabbed (SPKnot * knot, guint state, gpointer data)
+node_ctrl_grabbed (SPPathNode * n, gint which, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	if (!n->selected) {
 		sp_nodepath_node_select (n, (state & GDK_SHIFT_MASK), FALSE);
 	}
 }
 
 static void
-node_ctrl_ungrabbed (SPKnot * knot, guint state, gpointer data)
+node_ctrl_ungrabbed (SPPathNode * n, gint which, guint state)
 {
-	SPPathNode * n;
-
-	n = (SPPathNode *) data;
-
 	update_repr (n->subpath->nodepath);
 }
 
 static gboolean
-node_ctrl_request (SPKnot * knot, NRPointF *p, guint state, gpointer data)
+node_ctrl_request (SPPathNode * n, gint which, NRPointF *p, guint state)
 {
-	SPPathNode * n;
 	SPPathNodeSide * me, * opposite;
 	ArtPathcode othercode;
-	gint which;
-
-	n = (SPPathNode *) data;
 
-	if (n->p.knot == knot) {
-		me = &n->p;
-		opposite = &n->n;
-		which = -1;
-	} else if (n->n.knot == knot) {
-		me = &n->n;
-		opposite = &n->p;
-		which = 1;
-	} else {
-		me = opposite = NULL;
-		which = 0;
-		g_assert_not_reached ();
-	}
+	me = sp_node_get_side (n, which);
+	opposite = sp_node_opposite_side (n, me);
 
 	othercode = sp_node_path_code_from_side (n, opposite);
 
@@ -1935,56 +2156,26 @@ node_ctrl_request (SPKnot * knot, NRPointF *p, guint state, gpointer data)
 }
 
 static void
-node_ctrl_moved (SPKnot *knot, NRPointF *p, guint state, gpointer data)
+node_ctrl_moved (SPPathNode * n, gint which, NRPointF *p, guint state)
 {
-	SPPathNode * n;
+	SPNodePath * nodepath;
 	SPPathNodeSide * me;
+	GList * nodes;
 
-	n = (SPPathNode *) data;
-
-	if (n->p.knot == knot) {
-		me = &n->p;
-	} else if (n->n.knot == knot) {
-		me = &n->n;
-	} else {
-		me = NULL;
-		g_assert_not_reached ();
-	}
+	nodepath = n->subpath->nodepath;
+	me = sp_node_get_side (n, which);
 
 	me->pos.x = p->x;
 	me->pos.y = p->y;
 
-	sp_ctrlline_set_coords (SP_CTRLLINE (me->line), n->pos.x, n->pos.y, me->pos.x, me->pos.y);
+	sp_ctrlset_set_position (SP_CTRLSET (nodepath->ctrls), me->ctrl, me->pos.x, me->pos.y);
+	sp_ctrlset_set_line (SP_CTRLSET (nodepath->ctrls), me->ctrl, TRUE, n->pos.x, n->pos.y);
 
-	update_object (n->subpath->nodepath);
+	nodes = g_list_prepend (NULL, n);
+	update_object_partial (nodepath, nodes);
+	g_list_free (nodes);
 
-	sp_desktop_set_coordinate_status (knot->desktop, p->x, p->y, 0);
-}
-
-static gboolean
-node_ctrl_event (SPKnot * knot, GdkEvent * event, SPPathNode * n)
-{
-	gboolean ret = FALSE;
-	switch (event->type) {
-	case GDK_KEY_PRESS:
-		switch (event->key.keyval) {
-		case GDK_space:
-			if (event->key.state & GDK_BUTTON1_MASK) {
-				SPNodePath * nodepath;
-				nodepath = n->subpath->nodepath;
-				stamp_repr(nodepath);
-				ret = TRUE;
-			}
-			break;
-		default:
-			break;
-		}
-		break;
-	default:
-		break;
-	}
-
-	return ret;
+	sp_desktop_set_coordinate_status (nodepath->desktop, p->x, p->y, 0);
 }
 
 /*
@@ -2006,6 +2197,7 @@ sp_nodepath_subpath_new (SPNodePath * nodepath)
 	s->nodes = NULL;
 	s->first = NULL;
 	s->last = NULL;
+	s->index = -1;
 
 	nodepath->subpaths = g_list_prepend (nodepath->subpaths, s);
 
@@ -2072,6 +2264,7 @@ sp_nodepath_node_new (SPNodeSubPath *sp, SPPathNode *next, SPPathNodeType type,
 		      NRPointF *ppos, NRPointF *pos, NRPointF *npos)
 {
 	SPPathNode * n, * prev;
+	SPCtrlSet * cs;
 
 	g_assert (sp);
 	g_assert (sp->nodepath);
@@ -2083,10 +2276,13 @@ sp_nodepath_node_new (SPNodeSubPath *sp, SPPathNode *next, SPPathNodeType type,
 
 	n = (SPPathNode*)g_mem_chunk_alloc (nodechunk);
 
+	sp_nodepath_invalidate_curve (sp->nodepath);
+
 	n->subpath = sp;
 	n->type = type;
 	n->code = code;
 	n->selected = FALSE;
+	n->index = -1;
 	n->pos = *pos;
 	n->p.pos = *ppos;
 	n->n.pos = *npos;
@@ -2113,83 +2309,25 @@ sp_nodepath_node_new (SPNodeSubPath *sp, SPPathNode *next, SPPathNodeType type,
 	n->p.other = prev;
 	n->n.other = next;
 
-	n->knot = sp_knot_new (sp->nodepath->desktop);
-	sp_knot_set_position (n->knot, pos, 0);
-	g_object_set (G_OBJECT (n->knot),
-		      "anchor", GTK_ANCHOR_CENTER,
-		      "fill", NODE_FILL,
-		      "fill_mouseover", NODE_FILL_HI,
-		      "stroke", NODE_STROKE,
-		      "stroke_mouseover", NODE_STROKE_HI,
-#if 0
-		      "cursor_mouseover", CursorNodeMouseover,
-		      "cursor_dragging", CursorNodeDragging,
-#endif
-		      NULL);
+	cs = SP_CTRLSET (sp->nodepath->ctrls);
+
 	if (n->type == SP_PATHNODE_CUSP) {
-		g_object_set (G_OBJECT (n->knot), "shape", SP_KNOT_SHAPE_DIAMOND, "size", 9, NULL);
+		n->ctrl = sp_ctrlset_add (cs, SP_CTRL_SHAPE_DIAMOND, 9, n);
 	} else {
-		g_object_set (G_OBJECT (n->knot), "shape", SP_KNOT_SHAPE_SQUARE, "size", 7, NULL);
-	}
-	g_signal_connect (G_OBJECT (n->knot), "event", G_CALLBACK (node_event), n);
-	g_signal_connect (G_OBJECT (n->knot), "clicked", G_CALLBACK (node_clicked), n);
-	g_signal_connect (G_OBJECT (n->knot), "grabbed", G_CALLBACK (node_grabbed), n);
-	g_signal_connect (G_OBJECT (n->knot), "ungrabbed", G_CALLBACK (node_ungrabbed), n);
-	g_signal_connect (G_OBJECT (n->knot), "request", G_CALLBACK (node_request), n);
-	sp_knot_show (n->knot);
-
-	n->p.knot = sp_knot_new (sp->nodepath->desktop);
-	sp_knot_set_position (n->p.knot, ppos, 0);
-	g_object_set (G_OBJECT (n->p.knot),
-		      "shape", SP_KNOT_SHAPE_CIRCLE,
-		      "size", 7,
-		      "anchor", GTK_ANCHOR_CENTER,
-		      "fill", KNOT_FILL,
-		      "fill_mouseover", KNOT_FILL_HI,
-		      "stroke", KNOT_STROKE,
-		      "stroke_mouseover", KNOT_STROKE_HI,
-#if 0
-		      "cursor_mouseover", CursorNodeMouseover,
-		      "cursor_dragging", CursorNodeDragging,
-#endif
-		      NULL);
-	g_signal_connect (G_OBJECT (n->p.knot), "clicked", G_CALLBACK (node_ctrl_clicked), n);
-	g_signal_connect (G_OBJECT (n->p.knot), "grabbed", G_CALLBACK (node_ctrl_grabbed), n);
-	g_signal_connect (G_OBJECT (n->p.knot), "ungrabbed", G_CALLBACK (node_ctrl_ungrabbed), n);
-	g_signal_connect (G_OBJECT (n->p.knot), "request", G_CALLBACK (node_ctrl_request), n);
-	g_signal_connect (G_OBJECT (n->p.knot), "moved", G_CALLBACK (node_ctrl_moved), n);
-	g_signal_connect (G_OBJECT (n->p.knot), "event", G_CALLBACK (node_ctrl_event), n);
-	
-	sp_knot_hide (n->p.knot);
-	n->p.line = sp_canvas_item_new (SP_DT_CONTROLS (n->subpath->nodepath->desktop),
-					       SP_TYPE_CTRLLINE, NULL);
-	sp_canvas_item_hide (n->p.line);
-
-	n->n.knot = sp_knot_new (sp->nodepath->desktop);
-	sp_knot_set_position (n->n.knot, npos, 0);
-	g_object_set (G_OBJECT (n->n.knot),
-		      "shape", SP_KNOT_SHAPE_CIRCLE,
-		      "size", 7,
-		      "anchor", GTK_ANCHOR_CENTER,
-		      "fill", KNOT_FILL,
-		      "fill_mouseover", KNOT_FILL_HI,
-		      "stroke", KNOT_STROKE,
-		      "stroke_mouseover", KNOT_STROKE_HI,
-#if 0
-		      "cursor_mouseover", CursorNodeMouseover,
-		      "cursor_dragging", CursorNodeDragging,
-#endif
-		      NULL);
-	g_signal_connect (G_OBJECT (n->n.knot), "clicked", G_CALLBACK (node_ctrl_clicked), n);
-	g_signal_connect (G_OBJECT (n->n.knot), "grabbed", G_CALLBACK (node_ctrl_grabbed), n);
-	g_signal_connect (G_OBJECT (n->n.knot), "ungrabbed", G_CALLBACK (node_ctrl_ungrabbed), n);
-	g_signal_connect (G_OBJECT (n->n.knot), "request", G_CALLBACK (node_ctrl_request), n);
-	g_signal_connect (G_OBJECT (n->n.knot), "moved", G_CALLBACK (node_ctrl_moved), n);
-	g_signal_connect (G_OBJECT (n->n.knot), "event", G_CALLBACK (node_ctrl_event), n);
-	sp_knot_hide (n->n.knot);
-	n->n.line = sp_canvas_item_new (SP_DT_CONTROLS (n->subpath->nodepath->desktop),
-					       SP_TYPE_CTRLLINE, NULL);
-	sp_canvas_item_hide (n->n.line);
+		n->ctrl = sp_ctrlset_add (cs, SP_CTRL_SHAPE_SQUARE, 7, n);
+	}
+	sp_ctrlset_set_colors (cs, n->ctrl, NODE_FILL, NODE_STROKE, NODE_FILL_HI, NODE_STROKE_HI);
+	sp_ctrlset_set_position (cs, n->ctrl, pos->x, pos->y);
+	sp_ctrlset_show (cs, n->ctrl, TRUE);
+
+	/* Handles are shown with node selection */
+	n->p.ctrl = sp_ctrlset_add (cs, SP_CTRL_SHAPE_CIRCLE, 7, n);
+	sp_ctrlset_set_colors (cs, n->p.ctrl, KNOT_FILL, KNOT_STROKE, KNOT_FILL_HI, KNOT_STROKE_HI);
+	sp_ctrlset_set_position (cs, n->p.ctrl, ppos->x, ppos->y);
+
+	n->n.ctrl = sp_ctrlset_add (cs, SP_CTRL_SHAPE_CIRCLE, 7, n);
+	sp_ctrlset_set_colors (cs, n->n.ctrl, KNOT_FILL, KNOT_STROKE, KNOT_FILL_HI, KNOT_STROKE_HI);
+	sp_ctrlset_set_position (cs, n->n.ctrl, npos->x, npos->y);
 
 	sp->nodes = g_list_prepend (sp->nodes, n);
 
@@ -2200,33 +2338,36 @@ static void
 sp_nodepath_node_destroy (SPPathNode * node)
 {
 	SPNodeSubPath * sp;
+	SPNodePath * np;
+	SPCtrlSet * cs;
 
 	g_assert (node);
 	g_assert (node->subpath);
-	g_assert (SP_IS_KNOT (node->knot));
-	g_assert (SP_IS_KNOT (node->p.knot));
-	g_assert (SP_IS_KNOT (node->n.knot));
 	g_assert (g_list_find (node->subpath->nodes, node));
 
 	sp = node->subpath;
+	np = sp->nodepath;
+
+	sp_nodepath_invalidate_curve (np);
 
 	if (node->selected) {
-		g_assert (g_list_find (node->subpath->nodepath->selected, node));
-		node->subpath->nodepath->selected = g_list_remove (node->subpath->nodepath->selected, node);
+		np->selected = g_list_remove (np->selected, node);
 	}
 
 	node->subpath->nodes = g_list_remove (node->subpath->nodes, node);
-	/*
-	sp_knot_hide (node->knot);
-	sp_knot_hide (node->p.knot);
-	sp_knot_hide (node->n.knot);
-	*/
-	g_object_unref (G_OBJECT (node->knot));
-	g_object_unref (G_OBJECT (node->p.knot));
-	g_object_unref (G_OBJECT (node->n.knot));
-
-	gtk_object_destroy (GTK_OBJECT (node->p.line));
-	gtk_object_destroy (GTK_OBJECT (node->n.line));
+
+	if (active_node == node) active_node = NULL;
+	if ((np->hovered == node->ctrl) || (np->hovered == node->p.ctrl) || (np->hovered == node->n.ctrl)) {
+		np->hovered = -1;
+	}
+	if ((np->grabbed == node->ctrl) || (np->grabbed == node->p.ctrl) || (np->grabbed == node->n.ctrl)) {
+		sp_canvas_item_ungrab (np->ctrls, GDK_CURRENT_TIME);
+		np->grabbed = -1;
+	}
+	cs = SP_CTRLSET (np->ctrls);
+	sp_ctrlset_remove (cs, node->ctrl);
+	sp_ctrlset_remove (cs, node->p.ctrl);
+	sp_ctrlset_remove (cs, node->n.ctrl);
 	
 	if (sp->nodes) {
 		if (sp->closed) {
@@ -11,7 +11,7 @@
  */
 
 #include "xml/repr.h"
-#include "knot.h"
+#include "helper/helper-forward.h"
 #include "sp-path.h"
 #include "desktop-handles.h"
 
@@ -32,6 +32,16 @@ struct _SPNodePath {
 	GList * subpaths;
 	GList * selected;
 	NRMatrixD i2d, d2i;
+	/* Single canvas item drawing and picking all handles */
+	SPCanvasItem * ctrls;
+	/* Handles under pointer and being dragged, or -1 */
+	gint hovered;
+	gint grabbed;
+	guint moved : 1;
+	/* Pointer offset from grabbed handle */
+	double hx, hy;
+	/* Curve given to path, patched in place while nodes are dragged */
+	SPCurve * curve;
 };
 
 struct _SPNodeSubPath {
@@ -40,13 +50,14 @@ struct _SPNodeSubPath {
 	GList * nodes;
 	SPPathNode * first;
 	SPPathNode * last;
+	/* Index of moveto in nodepath curve, or -1 */
+	gint index;
 };
 
 typedef struct {
 	SPPathNode * other;
 	NRPointF pos;
-	SPKnot * knot;
-	SPCanvasItem * line;
+	gint ctrl;
 } SPPathNodeSide;
 
 struct _SPPathNode {
@@ -55,7 +66,9 @@ struct _SPPathNode {
 	guint code : 4;
 	guint selected : 1;
 	NRPointF pos;
-	SPKnot * knot;
+	/* Index of segment ending at node in nodepath curve, or -1 */
+	gint index;
+	gint ctrl;
 	SPPathNodeSide n;
 	SPPathNodeSide p;
 };
@@ -0,0 +1,229 @@
+#define __PATH_CHEMISTRY_BENCH_C__
+
+/*
+ * Benchmark for combine and break apart
+ *
+ * Combines growing numbers of paths, and breaks apart paths with growing
+ * numbers of subpaths, in shown documents.  Time per object should stay
+ * about the same as size doubles.
+ *
+ * Usage: path-chemistry-bench [-n MAX_OBJECTS] [-o RESULTS]
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include <sys/time.h>
+
+#include <glib.h>
+
+#include "display/nr-arena.h"
+#include "display/nr-arena-item.h"
+#include "xml/repr.h"
+#include "document.h"
+#include "sp-item-group.h"
+#include "sp-path.h"
+#include "path-chemistry.h"
+
+#define BENCH_MIN_OBJECTS 1000
+
+static FILE *results = NULL;
+
+static double
+get_time (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+static void
+bench_report (const gchar *measure, int n, double seconds)
+{
+	printf ("%-12s %8d %10.2f ms %8.2f us/object\n", measure, n, 1000.0 * seconds, 1e6 * seconds / n);
+	if (results) {
+		fprintf (results, "%s\t%d\t%.3f\n", measure, n, 1000.0 * seconds);
+	}
+}
+
+static void
+bench_append_square (GString *svg, int i)
+{
+	g_string_append_printf (svg, "M %d %d L %d %d L %d %d L %d %d z ",
+				(i * 37) % 2000, (i * 53) % 2000,
+				(i * 37) % 2000 + 8, (i * 53) % 2000,
+				(i * 37) % 2000 + 8, (i * 53) % 2000 + 8,
+				(i * 37) % 2000, (i * 53) % 2000 + 8);
+}
+
+/* Loads document and shows it, so display is updated as on desktop */
+static SPDocument *
+bench_load (GString *svg, NRArena *arena, unsigned int dkey, NRArenaItem **root)
+{
+	SPDocument *doc;
+
+	g_string_prepend (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"2000\" height=\"2000\">\n");
+	g_string_append (svg, "</svg>\n");
+
+	doc = sp_document_new_from_mem (svg->str, svg->len, FALSE, TRUE);
+	if (!doc) return NULL;
+	sp_document_ensure_up_to_date (doc);
+	*root = sp_item_invoke_show (SP_ITEM (sp_document_root (doc)), arena, dkey, SP_ITEM_SHOW_DISPLAY);
+
+	return doc;
+}
+
+static void
+bench_unload (SPDocument *doc, unsigned int dkey, NRArenaItem *root)
+{
+	sp_item_invoke_hide (SP_ITEM (sp_document_root (doc)), dkey);
+	if (root) nr_arena_item_unref (root);
+	sp_document_unref (doc);
+}
+
+static void
+bench_combine (int n, NRArena *arena, unsigned int dkey)
+{
+	SPDocument *doc;
+	NRArenaItem *root;
+	GString *svg;
+	GSList *items;
+	double start, end;
+	int i;
+
+	svg = g_string_new ("");
+	for (i = 0; i < n; i++) {
+		g_string_append (svg, "<path style=\"fill:#3060c0\" d=\"");
+		bench_append_square (svg, i);
+		g_string_append (svg, "\"/>\n");
+	}
+	doc = bench_load (svg, arena, dkey, &root);
+	g_string_free (svg, TRUE);
+	if (!doc) {
+		g_warning ("Cannot load combine document");
+		return;
+	}
+
+	items = sp_item_group_item_list (SP_GROUP (sp_document_root (doc)));
+
+	start = get_time ();
+	sp_path_combine_items (doc, items);
+	sp_document_done (doc);
+	sp_document_ensure_up_to_date (doc);
+	end = get_time ();
+	bench_report ("combine", n, end - start);
+
+	g_slist_free (items);
+	bench_unload (doc, dkey, root);
+}
+
+static void
+bench_break_apart (int n, NRArena *arena, unsigned int dkey)
+{
+	SPDocument *doc;
+	NRArenaItem *root;
+	GString *svg;
+	GSList *items, *pieces;
+	double start, end;
+	int i;
+
+	svg = g_string_new ("<path style=\"fill:#3060c0\" d=\"");
+	for (i = 0; i < n; i++) bench_append_square (svg, i);
+	g_string_append (svg, "\"/>\n");
+	doc = bench_load (svg, arena, dkey, &root);
+	g_string_free (svg, TRUE);
+	if (!doc) {
+		g_warning ("Cannot load break apart document");
+		return;
+	}
+
+	items = sp_item_group_item_list (SP_GROUP (sp_document_root (doc)));
+
+	start = get_time ();
+	pieces = sp_path_break_apart_item (doc, SP_ITEM (items->data));
+	sp_document_done (doc);
+	sp_document_ensure_up_to_date (doc);
+	end = get_time ();
+	bench_report ("break-apart", n, end - start);
+
+	if (g_slist_length (pieces) != (unsigned int) n) {
+		g_warning ("Break apart made %d paths instead of %d", g_slist_length (pieces), n);
+	}
+
+	g_slist_free (pieces);
+	g_slist_free (items);
+	bench_unload (doc, dkey, root);
+}
+
+int
+main (int argc, const char **argv)
+{
+	NRArena *arena;
+	unsigned int dkey;
+	int max, n, i;
+
+	max = 16000;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			max = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			results = fopen (argv[++i], "w");
+			if (!results) {
+				fprintf (stderr, "Cannot write results to %s\n", argv[i]);
+				return 1;
+			}
+		} else {
+			fprintf (stderr, "Usage: %s [-n MAX_OBJECTS] [-o RESULTS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	g_type_init ();
+	setlocale (LC_NUMERIC, "C");
+
+	if (results) {
+		fprintf (results, "# path-chemistry-bench %s\n", INKSCAPE_VERSION);
+	}
+
+	arena = (NRArena *) nr_object_new (NR_TYPE_ARENA);
+	dkey = sp_item_display_key_new (1);
+
+	for (n = BENCH_MIN_OBJECTS; n <= max; n *= 2) bench_combine (n, arena, dkey);
+	for (n = BENCH_MIN_OBJECTS; n <= max; n *= 2) bench_break_apart (n, arena, dkey);
+
+	nr_object_unref ((NRObject *) arena);
+
+	if (results) fclose (results);
+
+	return 0;
+}
+
+/* Application stubs, as in render-bench; there is never active desktop */
+
+Inkscape *inkscape;
+
+void inkscape_ref (void) {}
+void inkscape_unref (void) {}
+void inkscape_add_document (SPDocument *document) {}
+void inkscape_remove_document (SPDocument *document) {}
+SPRepr *inkscape_get_repr (Inkscape *inkscape, const unsigned char *key) {return NULL;}
+#include "widgets/menu.h"
+void sp_menu_append (SPMenu *menu, const gchar *name, const gchar *tip, const void *data) {}
+
+SPDesktop *inkscape_active_desktop (void) {return NULL;}
+GType sp_desktop_get_type (void) {return G_TYPE_NONE;}
+SPSelection *sp_desktop_selection (SPDesktop *desktop) {return NULL;}
+SPDocument *sp_desktop_document (SPDesktop *desktop) {return NULL;}
+void sp_selection_empty (SPSelection *selection) {}
+void sp_selection_add_repr (SPSelection *selection, SPRepr *repr) {}
+void sp_selection_set_repr (SPSelection *selection, SPRepr *repr) {}
+void sp_selection_set_repr_list (SPSelection *selection, const GSList *list) {}
+const GSList *sp_selection_item_list (SPSelection *selection) {return NULL;}
+SPItem *sp_selection_item (SPSelection *selection) {return NULL;}
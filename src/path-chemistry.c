@@ -45,11 +45,6 @@ sp_selected_path_combine (void)
 	GSList * il;
 	GSList * l;
 	SPRepr * repr;
-	SPItem * item;
-	SPPath * path;
-	SPCurve * c;
-	ArtBpath * abp;
-	gchar * d, * str, * style;
 
 	sp_selected_path_to_curves0 (FALSE, 0);
 
@@ -62,58 +57,26 @@ sp_selected_path_combine (void)
 	if (g_slist_length (il) < 2) return;
 
 	for (l = il; l != NULL; l = l->next) {
-		item = (SPItem *) l->data;
-		if (!SP_IS_SHAPE (item)) return;
+		if (!SP_IS_SHAPE (l->data)) return;
 	}
 
 	il = g_slist_copy (il);
+	/* So releasing originals does not update selection one by one */
+	sp_selection_empty (selection);
 
-	d = "";
-	style = g_strdup (sp_repr_attr ((SP_OBJECT (il->data))->repr, "style"));
-
-	for (l = il; l != NULL; l = l->next) {
-		NRMatrixF i2root;
-		NRMatrixD i2rootd;
-		path = (SPPath *) l->data;
-		c = sp_shape_get_curve (SP_SHAPE (path));
-		sp_item_i2root_affine (SP_ITEM (path), &i2root);
-		nr_matrix_d_from_f (&i2rootd, &i2root);
-		abp = art_bpath_affine_transform (c->bpath, NR_MATRIX_D_TO_DOUBLE (&i2rootd));
-		sp_curve_unref (c);
-		str = sp_svg_write_path (abp);
-		art_free (abp);
-		d = g_strconcat (d, str, NULL);
-		g_free (str);
-		sp_repr_unparent (SP_OBJECT_REPR (path));
-	}
-
+	repr = sp_path_combine_items (SP_DT_DOCUMENT (desktop), il);
 	g_slist_free (il);
-
-	repr = sp_repr_new ("path");
-	sp_repr_set_attr (repr, "style", style);
-	g_free (style);
-	sp_repr_set_attr (repr, "d", d);
-	g_free (d);
-	item = (SPItem *) sp_document_add_repr (SP_DT_DOCUMENT (desktop), repr);
 	sp_document_done (SP_DT_DOCUMENT (desktop));
-	sp_repr_unref (repr);
 
-	sp_selection_set_item (selection, item);
+	sp_selection_set_repr (selection, repr);
 }
 
 void
 sp_selected_path_break_apart (void)
 {
 	SPSelection * selection;
-	SPRepr * repr;
 	SPItem * item;
-	SPPath * path;
-	SPCurve * curve;
-	ArtBpath * abp;
-	NRMatrixF i2root;
-	NRMatrixD d;
-	gchar * style, * str;
-	GSList * list, * l;
+	GSList * list;
 	SPDesktop * desktop;
 	
 	desktop = SP_ACTIVE_DESKTOP;
@@ -125,43 +88,163 @@ sp_selected_path_break_apart (void)
 
 	if (item == NULL) return;
 	if (!SP_IS_PATH (item)) return;
+	if (!SP_SHAPE (item)->curve) return;
 
-	path = SP_PATH (item);
+	sp_selection_empty (selection);
 
-	curve = sp_shape_get_curve (SP_SHAPE (path));
-	if (curve == NULL) return;
+	list = sp_path_break_apart_item (SP_DT_DOCUMENT (desktop), item);
+	sp_document_done (SP_DT_DOCUMENT (desktop));
+
+	sp_selection_set_repr_list (selection, list);
+	g_slist_free (list);
+}
 
-	sp_item_i2root_affine (SP_ITEM (path), &i2root);
-	nr_matrix_d_from_f (&d, &i2root);
-	style = g_strdup (sp_repr_attr (SP_OBJECT (item)->repr, "style"));
+/*
+ * Unparents item reprs, removing all children of same parent in one
+ * pass over its child list
+ */
+static void
+sp_path_remove_items (const GSList *items)
+{
+	GHashTable *children;
+	GSList *parents, *list;
+	const GSList *l;
+	SPRepr *repr, *parent;
+
+	children = g_hash_table_new (NULL, NULL);
+	parents = NULL;
+	for (l = items; l != NULL; l = l->next) {
+		repr = SP_OBJECT_REPR (l->data);
+		parent = sp_repr_parent (repr);
+		list = (GSList *) g_hash_table_lookup (children, parent);
+		if (!list) parents = g_slist_prepend (parents, parent);
+		g_hash_table_insert (children, parent, g_slist_prepend (list, repr));
+	}
 
-	abp = art_bpath_affine_transform (curve->bpath, NR_MATRIX_D_TO_DOUBLE (&d));
+	while (parents) {
+		parent = (SPRepr *) parents->data;
+		list = (GSList *) g_hash_table_lookup (children, parent);
+		sp_repr_remove_children (parent, list);
+		g_slist_free (list);
+		parents = g_slist_remove (parents, parent);
+	}
 
-	sp_curve_unref (curve);
-	sp_repr_unparent (SP_OBJECT_REPR (item));
+	g_hash_table_destroy (children);
+}
 
-	curve = sp_curve_new_from_bpath (abp);
+/* Copy of shape curve in root coordinates */
+static SPCurve *
+sp_path_root_curve (SPShape *shape)
+{
+	SPCurve *curve;
+	NRMatrixF i2root;
+	NRMatrixD i2rootd;
 
-	list = sp_curve_split (curve);
+	curve = sp_shape_get_curve (shape);
+	if (!curve) return NULL;
+
+	sp_item_i2root_affine (SP_ITEM (shape), &i2root);
+	nr_matrix_d_from_f (&i2rootd, &i2root);
+	sp_curve_transform (curve, NR_MATRIX_D_TO_DOUBLE (&i2rootd));
+
+	return curve;
+}
+
+/**
+ * Replaces shapes with single path, made of their curves in root
+ * coordinates and styled like first one.  Curves are concatenated once
+ * and kept as binary path data, and originals are removed in one pass,
+ * so time is linear in number of items and segments.  Returns new path
+ * repr, owned by document.
+ */
+SPRepr *
+sp_path_combine_items (SPDocument *document, const GSList *items)
+{
+	GSList *curves;
+	const GSList *l;
+	SPCurve *curve;
+	SPRepr *repr;
+	gchar *style;
+
+	g_return_val_if_fail (document != NULL, NULL);
+	g_return_val_if_fail (items != NULL, NULL);
+
+	style = g_strdup (sp_repr_attr (SP_OBJECT_REPR (items->data), "style"));
+
+	curves = NULL;
+	for (l = items; l != NULL; l = l->next) {
+		curve = sp_path_root_curve (SP_SHAPE (l->data));
+		if (curve) curves = g_slist_prepend (curves, curve);
+	}
+	curves = g_slist_reverse (curves);
+
+	curve = (curves) ? sp_curve_concat (curves) : sp_curve_new ();
+	while (curves) {
+		sp_curve_unref ((SPCurve *) curves->data);
+		curves = g_slist_remove (curves, curves->data);
+	}
+
+	sp_path_remove_items (items);
+
+	repr = sp_repr_new ("path");
+	sp_repr_set_attr (repr, "style", style);
+	g_free (style);
+	/* String is only made when saving */
+	curve->shared = TRUE;
+	sp_repr_set_attr_typed (repr, "d", &sp_path_curve_value_type, curve);
+	sp_document_add_repr (document, repr);
+	sp_repr_unref (repr);
+
+	return repr;
+}
+
+/**
+ * Replaces path with one path per subpath, in root coordinates and
+ * styled like original.  Pieces are added to root one after another,
+ * so no child list is searched for each.  Returns list of new path
+ * reprs, owned by document.
+ */
+GSList *
+sp_path_break_apart_item (SPDocument *document, SPItem *item)
+{
+	SPCurve *curve;
+	SPRepr *root, *ref, *repr;
+	GSList *list, *reprs;
+	gchar *style;
 
+	g_return_val_if_fail (document != NULL, NULL);
+	g_return_val_if_fail (item != NULL, NULL);
+	g_return_val_if_fail (SP_IS_SHAPE (item), NULL);
+
+	curve = sp_path_root_curve (SP_SHAPE (item));
+	if (!curve) return NULL;
+
+	style = g_strdup (sp_repr_attr (SP_OBJECT_REPR (item), "style"));
+	sp_repr_unparent (SP_OBJECT_REPR (item));
+
+	list = sp_curve_split (curve);
 	sp_curve_unref (curve);
 
-	for (l = list; l != NULL; l = l->next) {
-		curve = (SPCurve *) l->data;
+	root = sp_document_repr_root (document);
+	for (ref = sp_repr_children (root); ref && sp_repr_next (ref); ref = sp_repr_next (ref));
 
+	reprs = NULL;
+	while (list) {
 		repr = sp_repr_new ("path");
 		sp_repr_set_attr (repr, "style", style);
-		str = sp_svg_write_path (curve->bpath);
-		sp_repr_set_attr (repr, "d", str);
-		g_free (str);
-		item = (SPItem *) sp_document_add_repr (SP_DT_DOCUMENT (desktop), repr);
+		/* Typed value takes over curve reference */
+		((SPCurve *) list->data)->shared = TRUE;
+		sp_repr_set_attr_typed (repr, "d", &sp_path_curve_value_type, list->data);
+		sp_repr_add_child (root, repr, ref);
+		reprs = g_slist_prepend (reprs, repr);
 		sp_repr_unref (repr);
-		sp_selection_add_item (selection, item);
+		ref = repr;
+		list = g_slist_remove (list, list->data);
 	}
-	sp_document_done (SP_DT_DOCUMENT (desktop));
 
-	g_slist_free (list);
 	g_free (style);
+
+	return g_slist_reverse (reprs);
 }
 
 /* This function is an entry point from GUI */
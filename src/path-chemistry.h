@@ -14,6 +14,7 @@
  */
 
 #include "forward.h"
+#include "xml/repr.h"
 
 void sp_selected_path_combine (void);
 void sp_selected_path_break_apart (void);
@@ -21,4 +22,8 @@ void sp_selected_path_to_curves (void);
 
 void sp_path_cleanup (SPPath *path);
 
+/* Document level parts of combine and break apart, not using desktop */
+SPRepr *sp_path_combine_items (SPDocument *document, const GSList *items);
+GSList *sp_path_break_apart_item (SPDocument *document, SPItem *item);
+
 #endif
@@ -141,6 +141,8 @@ sp_print_preview_document (SPDocument *doc)
 		mod->root = NULL;
 		nr_object_unref ((NRObject *) mod->arena);
 		mod->arena = NULL;
+		/* Negative result means output did not get to printer */
+		if ((int) ret < 0) g_warning ("Printing failed");
 	}
 
 	g_object_unref (G_OBJECT (mod));
@@ -188,53 +190,58 @@ sp_print_document (SPDocument *doc, unsigned int direct)
 		mod->root = NULL;
 		nr_object_unref ((NRObject *) mod->arena);
 		mod->arena = NULL;
+		/* Negative result means output did not get to printer */
+		if ((int) ret < 0) g_warning ("Printing failed");
 	}
 
 	g_object_unref (G_OBJECT (mod));
 }
 
+/**
+ * Prints document to PostScript file without user interaction, with
+ * settings of plain print module; used for command line printing
+ */
 void
 sp_print_document_to_file (SPDocument *doc, const gchar *filename)
 {
-#ifdef lalala
-#ifdef WITH_GNOME_PRINT
-        GnomePrintConfig *config;
-	SPPrintContext ctx;
-        GnomePrintContext *gpc;
+	SPModulePrint *mod;
+	unsigned int ret;
 
-	config = gnome_print_config_default ();
-        if (!gnome_print_config_set (config, "Settings.Engine.Backend.Driver", "gnome-print-ps")) return;
-        if (!gnome_print_config_set (config, "Settings.Transport.Backend", "file")) return;
-        if (!gnome_print_config_set (config, GNOME_PRINT_KEY_OUTPUT_FILENAME, filename)) return;
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (filename != NULL);
 
 	sp_document_ensure_up_to_date (doc);
 
-	gpc = gnome_print_context_new (config);
-	ctx.gpc = gpc;
+	mod = (SPModulePrint *) sp_module_new_from_path (SP_TYPE_MODULE_PRINT_PLAIN, "printing.ps");
 
-	g_return_if_fail (gpc != NULL);
+	ret = sp_module_print_plain_setup_file ((SPModulePrintPlain *) mod, filename);
 
-	/* Print document */
-	gnome_print_beginpage (gpc, SP_DOCUMENT_NAME (doc));
-	gnome_print_translate (gpc, 0.0, sp_document_height (doc));
-	/* From desktop points to document pixels */
-	gnome_print_scale (gpc, 0.8, -0.8);
-	sp_item_invoke_print (SP_ITEM (sp_document_root (doc)), &ctx);
-        gnome_print_showpage (gpc);
-        gnome_print_context_close (gpc);
-#else
-	SPPrintContext ctx;
-
-	ctx.stream = fopen (filename, "w");
-	if (ctx.stream) {
-		sp_document_ensure_up_to_date (doc);
-		fprintf (ctx.stream, "%g %g translate\n", 0.0, sp_document_height (doc));
-		fprintf (ctx.stream, "0.8 -0.8 scale\n");
-		sp_item_invoke_print (SP_ITEM (sp_document_root (doc)), &ctx);
-		fprintf (ctx.stream, "showpage\n");
-		fclose (ctx.stream);
+	if (ret) {
+		/* fixme: This has to go into module constructor somehow */
+		/* Create new arena */
+		mod->base = SP_ITEM (sp_document_root (doc));
+		mod->arena = (NRArena *) nr_object_new (NR_TYPE_ARENA);
+		mod->dkey = sp_item_display_key_new (1);
+		mod->root = sp_item_invoke_show (mod->base, mod->arena, mod->dkey, SP_ITEM_SHOW_PRINT);
+		/* Print document */
+		if (((SPModulePrintClass *) G_OBJECT_GET_CLASS (mod))->begin)
+			ret = ((SPModulePrintClass *) G_OBJECT_GET_CLASS (mod))->begin (mod, doc);
+		sp_item_invoke_print (mod->base, (SPPrintContext *) mod);
+		if (((SPModulePrintClass *) G_OBJECT_GET_CLASS (mod))->finish)
+			ret = ((SPModulePrintClass *) G_OBJECT_GET_CLASS (mod))->finish (mod);
+		/* Release arena */
+		sp_item_invoke_hide (mod->base, mod->dkey);
+		mod->base = NULL;
+		nr_arena_item_unref (mod->root);
+		mod->root = NULL;
+		nr_object_unref ((NRObject *) mod->arena);
+		mod->arena = NULL;
+		/* Negative result means output did not get to file */
+		if ((int) ret < 0) g_warning ("Could not print to %s", filename);
+	} else {
+		g_warning ("Cannot print to %s", filename);
 	}
-#endif
-#endif
+
+	g_object_unref (G_OBJECT (mod));
 }
 
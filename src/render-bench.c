@@ -0,0 +1,479 @@
+#define __RENDER_BENCH_C__
+
+/*
+ * Headless rendering benchmark
+ *
+ * Generates synthetic documents of several kinds, and times loading,
+ * updating, arena update, rendering at several zooms, picking and
+ * saving of each.  Results can be written as tab separated lines of
+ * corpus, measurement and milliseconds, for comparing builds.
+ *
+ * Usage: render-bench [-s SCALE] [-t THREADS] [-o RESULTS] [CORPUS...]
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <locale.h>
+#include <sys/time.h>
+
+#include <glib.h>
+
+#include <libnr/nr-macros.h>
+#include <libnr/nr-matrix.h>
+#include <libnr/nr-pixblock.h>
+#include "display/nr-arena.h"
+#include "display/nr-arena-item.h"
+#include "display/nr-arena-shape.h"
+#include "xml/repr.h"
+#include "document.h"
+#include "sp-item.h"
+
+#define BENCH_WIDTH 2000
+#define BENCH_HEIGHT 2000
+
+/* Viewport rendered at every zoom, in stripes like PNG export */
+#define BENCH_VIEW_WIDTH 800
+#define BENCH_VIEW_HEIGHT 600
+#define BENCH_STRIPE 64
+
+#define BENCH_RENDER_RUNS 3
+#define BENCH_PICKS 1000
+
+/* 16x16 RGBA PNG */
+static const gchar bench_png[] =
+"iVBORw0KGgoAAAANSUhEUgAAABAAAAAQCAYAAAAf8/9hAAABJ0lEQVR42hXMwYBFIQAAwIfwEUIIIYQQQgghhBBCCCGEEELIYHc6zHW+72t/PwKRRKZQaXQGk8XmcPm+n4BAJJEpVBqdwWSxOdzfC4KAQCSRKVQancFksTnc8IIoIBBJZAqVRmcwWWwON74gCQhEEplCpdEZTBabw00vyAICkUSmUGl0BpPF5nDzC4qAQCSRKVQancFksTnc8oIqIBBJZAqVRmcwWWwOt76gCQhEEplCpdEZTBabw20v6AICkUSmUGl0BpPF5nD7C4aAQCSRKVQancFksTnc8YIpIBBJZAqVRmcwWWwOd75gCQhEEplCpdEZTBabw10v2AICkUSmUGl0BpPF5nD3C46AQCSRKVQancFksTnc84IrIBBJZAqVRmcwWWwOl39OS28fFvYVWwAAAABJRU5ErkJggg==";
+
+static const double bench_zooms[] = {0.25, 1.0, 4.0};
+
+typedef struct _BenchCorpus BenchCorpus;
+
+struct _BenchCorpus {
+	const gchar *name;
+	/* Number of objects at scale 1 */
+	int count;
+	void (* build) (GString *svg, int count);
+};
+
+static FILE *results = NULL;
+
+static double
+get_time (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+static void
+bench_report (const gchar *corpus, const gchar *measure, double seconds)
+{
+	printf ("%-16s %-20s %10.2f ms\n", corpus, measure, 1000.0 * seconds);
+	if (results) {
+		fprintf (results, "%s\t%s\t%.3f\n", corpus, measure, 1000.0 * seconds);
+	}
+}
+
+/* Corpora */
+
+static void
+bench_append_blob (GString *svg, double x, double y, double r, int n_curves)
+{
+	int i;
+
+	g_string_append_printf (svg, "M %g %g", x + r, y);
+	for (i = 0; i < n_curves; i++) {
+		double a0, a1, k;
+		a0 = 2.0 * M_PI * i / n_curves;
+		a1 = 2.0 * M_PI * (i + 1) / n_curves;
+		/* Alternate radii make it wavy */
+		k = (i & 1) ? 0.6 : 1.3;
+		g_string_append_printf (svg, " C %g %g %g %g %g %g",
+					x + k * r * cos (a0 + 0.3 / n_curves), y + k * r * sin (a0 + 0.3 / n_curves),
+					x + k * r * cos (a1 - 0.3 / n_curves), y + k * r * sin (a1 - 0.3 / n_curves),
+					x + r * cos (a1), y + r * sin (a1));
+	}
+	g_string_append (svg, " z");
+}
+
+static void
+bench_build_small_paths (GString *svg, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		g_string_append (svg, "<path d=\"");
+		bench_append_blob (svg, (i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 4.0 + i % 7, 4);
+		g_string_append_printf (svg, "\" style=\"fill:#%06x;stroke:#000000;stroke-width:0.5\"/>\n",
+					(i * 2654435761U) & 0xffffff);
+	}
+}
+
+static void
+bench_build_huge_path (GString *svg, int count)
+{
+	int i;
+
+	g_string_append (svg, "<path style=\"fill:#3060c0;fill-rule:evenodd;stroke:#000000;stroke-width:1\" d=\"M 1000 1000");
+	for (i = 0; i < count; i++) {
+		double a, r;
+		/* Spiral of curves crossing its previous turns */
+		a = 0.05 * i;
+		r = 900.0 * i / count;
+		g_string_append_printf (svg, " C %g %g %g %g %g %g",
+					1000.0 + (r + 40.0) * cos (a + 0.01), 1000.0 + (r - 40.0) * sin (a + 0.01),
+					1000.0 + (r - 40.0) * cos (a + 0.03), 1000.0 + (r + 40.0) * sin (a + 0.03),
+					1000.0 + r * cos (a + 0.05), 1000.0 + r * sin (a + 0.05));
+	}
+	g_string_append (svg, " z\"/>\n");
+}
+
+static void
+bench_build_dashed_strokes (GString *svg, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		g_string_append (svg, "<path d=\"");
+		bench_append_blob (svg, (i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 20.0 + i % 30, 8);
+		g_string_append_printf (svg, "\" style=\"fill:none;stroke:#%06x;stroke-width:%d;stroke-dasharray:%d %d;stroke-linejoin:round\"/>\n",
+					(i * 2654435761U) & 0xffffff, 1 + i % 4, 2 + i % 9, 1 + i % 5);
+	}
+}
+
+static void
+bench_build_gradients (GString *svg, int count)
+{
+	int n_gradients, i;
+
+	n_gradients = MAX (count / 10, 1);
+	g_string_append (svg, "<defs>\n");
+	for (i = 0; i < n_gradients; i++) {
+		if (i & 1) {
+			g_string_append_printf (svg, "<radialGradient id=\"g%d\" cx=\"0.5\" cy=\"0.5\" r=\"0.5\">", i);
+		} else {
+			g_string_append_printf (svg, "<linearGradient id=\"g%d\" x1=\"0\" y1=\"0\" x2=\"1\" y2=\"%d\">", i, i % 3);
+		}
+		g_string_append_printf (svg, "<stop offset=\"0\" style=\"stop-color:#%06x\"/>"
+					"<stop offset=\"0.5\" style=\"stop-color:#ffffff;stop-opacity:0.5\"/>"
+					"<stop offset=\"1\" style=\"stop-color:#%06x\"/>",
+					(i * 2654435761U) & 0xffffff, (i * 40503U) & 0xffffff);
+		g_string_append (svg, (i & 1) ? "</radialGradient>\n" : "</linearGradient>\n");
+	}
+	g_string_append (svg, "</defs>\n");
+
+	for (i = 0; i < count; i++) {
+		g_string_append_printf (svg, "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" style=\"fill:url(#g%d)\"/>\n",
+					(i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 20 + i % 80, 20 + i % 60,
+					i % n_gradients);
+	}
+}
+
+static void
+bench_build_patterns (GString *svg, int count)
+{
+	int n_patterns, i;
+
+	n_patterns = MAX (count / 50, 1);
+	g_string_append (svg, "<defs>\n");
+	for (i = 0; i < n_patterns; i++) {
+		g_string_append_printf (svg, "<pattern id=\"p%d\" patternUnits=\"userSpaceOnUse\" width=\"%d\" height=\"%d\">"
+					"<circle cx=\"4\" cy=\"4\" r=\"3\" style=\"fill:#%06x\"/>"
+					"<rect x=\"6\" y=\"6\" width=\"4\" height=\"4\" style=\"fill:#000000\"/>"
+					"</pattern>\n",
+					i, 10 + i % 6, 10 + i % 4, (i * 2654435761U) & 0xffffff);
+	}
+	g_string_append (svg, "</defs>\n");
+
+	for (i = 0; i < count; i++) {
+		g_string_append_printf (svg, "<ellipse cx=\"%d\" cy=\"%d\" rx=\"%d\" ry=\"%d\" style=\"fill:url(#p%d);stroke:#000000\"/>\n",
+					(i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 20 + i % 50, 10 + i % 40,
+					i % n_patterns);
+	}
+}
+
+static void
+bench_build_clips (GString *svg, int count)
+{
+	int i;
+
+	g_string_append (svg, "<defs>\n");
+	for (i = 0; i < count; i++) {
+		int x, y;
+		x = (i * 37) % BENCH_WIDTH;
+		y = (i * 53) % BENCH_HEIGHT;
+		g_string_append_printf (svg, "<clipPath id=\"c%d\"><circle cx=\"%d\" cy=\"%d\" r=\"%d\"/></clipPath>\n",
+					i, x, y, 10 + i % 30);
+		if (i & 1) {
+			g_string_append_printf (svg, "<mask id=\"m%d\"><rect x=\"%d\" y=\"%d\" width=\"40\" height=\"40\" style=\"fill:#808080\"/></mask>\n",
+						i, x - 20, y - 20);
+		}
+	}
+	g_string_append (svg, "</defs>\n");
+
+	for (i = 0; i < count; i++) {
+		int x, y;
+		x = (i * 37) % BENCH_WIDTH;
+		y = (i * 53) % BENCH_HEIGHT;
+		g_string_append_printf (svg, "<g clip-path=\"url(#c%d)\"", i);
+		if (i & 1) g_string_append_printf (svg, " mask=\"url(#m%d)\"", i);
+		g_string_append_printf (svg, "><rect x=\"%d\" y=\"%d\" width=\"50\" height=\"50\" style=\"fill:#%06x\"/>"
+					"<path d=\"M %d %d L %d %d\" style=\"stroke:#000000;stroke-width:3\"/></g>\n",
+					x - 25, y - 25, (i * 2654435761U) & 0xffffff, x - 30, y - 30, x + 30, y + 30);
+	}
+}
+
+static void
+bench_build_text (GString *svg, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		g_string_append_printf (svg, "<text x=\"%d\" y=\"%d\" style=\"font-family:Sans;font-size:%d;fill:#%06x\">"
+					"Text %d <tspan style=\"font-weight:bold\">with span</tspan></text>\n",
+					(i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 8 + i % 24,
+					(i * 2654435761U) & 0xffffff, i);
+	}
+}
+
+static void
+bench_build_images (GString *svg, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		g_string_append_printf (svg, "<image x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" xlink:href=\"data:image/png;base64,%s\"/>\n",
+					(i * 37) % BENCH_WIDTH, (i * 53) % BENCH_HEIGHT, 16 + i % 64, 16 + i % 48, bench_png);
+	}
+}
+
+static const BenchCorpus corpora[] = {
+	{"small-paths", 10000, bench_build_small_paths},
+	{"huge-path", 20000, bench_build_huge_path},
+	{"dashed-strokes", 1000, bench_build_dashed_strokes},
+	{"gradients", 2000, bench_build_gradients},
+	{"patterns", 500, bench_build_patterns},
+	{"clips", 500, bench_build_clips},
+	{"text", 500, bench_build_text},
+	{"images", 200, bench_build_images}
+};
+
+/* Measurements */
+
+static void
+bench_update (NRArenaItem *root, double zoom)
+{
+	NRMatrixF affine;
+	NRRectL area;
+	NRGC gc;
+
+	nr_matrix_f_set_scale (&affine, zoom, zoom);
+	nr_arena_item_set_transform (root, &affine);
+
+	area.x0 = 0;
+	area.y0 = 0;
+	area.x1 = BENCH_VIEW_WIDTH;
+	area.y1 = BENCH_VIEW_HEIGHT;
+	nr_matrix_d_set_identity (&gc.transform);
+	nr_arena_shape_update_parallel (root, &area, &gc, NR_ARENA_ITEM_STATE_ALL, NR_ARENA_ITEM_STATE_NONE);
+}
+
+static void
+bench_render (NRArenaItem *root)
+{
+	int y;
+
+	for (y = 0; y < BENCH_VIEW_HEIGHT; y += BENCH_STRIPE) {
+		NRPixBlock pb;
+		NRRectL area;
+		area.x0 = 0;
+		area.y0 = y;
+		area.x1 = BENCH_VIEW_WIDTH;
+		area.y1 = MIN (y + BENCH_STRIPE, BENCH_VIEW_HEIGHT);
+		nr_pixblock_setup_fast (&pb, NR_PIXBLOCK_MODE_R8G8B8A8P, area.x0, area.y0, area.x1, area.y1, TRUE);
+		nr_arena_item_invoke_render (root, &area, &pb, 0);
+		nr_pixblock_release (&pb);
+	}
+}
+
+static void
+bench_corpus (const BenchCorpus *corpus, double scale, const gchar *dir)
+{
+	SPDocument *doc;
+	NRArena *arena;
+	NRArenaItem *root;
+	unsigned int dkey;
+	GString *svg;
+	GRand *rand;
+	gchar *filename, c[32];
+	double start, end, best;
+	int count, i, j;
+
+	count = MAX ((int) (corpus->count * scale), 1);
+
+	svg = g_string_new ("<?xml version=\"1.0\" standalone=\"no\"?>\n");
+	g_string_append_printf (svg, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+				"width=\"%d\" height=\"%d\">\n", BENCH_WIDTH, BENCH_HEIGHT);
+	corpus->build (svg, count);
+	g_string_append (svg, "</svg>\n");
+
+	start = get_time ();
+	doc = sp_document_new_from_mem (svg->str, svg->len, FALSE, TRUE);
+	end = get_time ();
+	g_string_free (svg, TRUE);
+	if (!doc) {
+		g_warning ("Cannot load %s corpus", corpus->name);
+		return;
+	}
+	bench_report (corpus->name, "load", end - start);
+
+	start = get_time ();
+	sp_document_ensure_up_to_date (doc);
+	end = get_time ();
+	bench_report (corpus->name, "ensure-up-to-date", end - start);
+
+	arena = (NRArena *) nr_object_new (NR_TYPE_ARENA);
+	dkey = sp_item_display_key_new (1);
+	start = get_time ();
+	root = sp_item_invoke_show (SP_ITEM (sp_document_root (doc)), arena, dkey, SP_ITEM_SHOW_DISPLAY);
+	end = get_time ();
+	bench_report (corpus->name, "show", end - start);
+
+	if (root) {
+		start = get_time ();
+		bench_update (root, 1.0);
+		end = get_time ();
+		bench_report (corpus->name, "arena-update", end - start);
+
+		for (i = 0; i < (int) (sizeof (bench_zooms) / sizeof (bench_zooms[0])); i++) {
+			/* Zooming rebuilds geometry, so update is timed separately */
+			start = get_time ();
+			bench_update (root, bench_zooms[i]);
+			end = get_time ();
+			g_snprintf (c, 32, "update-zoom-%g", bench_zooms[i]);
+			bench_report (corpus->name, c, end - start);
+			best = 0.0;
+			for (j = 0; j < BENCH_RENDER_RUNS; j++) {
+				start = get_time ();
+				bench_render (root);
+				end = get_time ();
+				if ((j == 0) || (end - start < best)) best = end - start;
+			}
+			g_snprintf (c, 32, "render-zoom-%g", bench_zooms[i]);
+			bench_report (corpus->name, c, best);
+		}
+
+		/* Same points for every build */
+		rand = g_rand_new_with_seed (17);
+		bench_update (root, 1.0);
+		start = get_time ();
+		for (i = 0; i < BENCH_PICKS; i++) {
+			nr_arena_item_invoke_pick (root,
+						   g_rand_double_range (rand, 0.0, BENCH_VIEW_WIDTH),
+						   g_rand_double_range (rand, 0.0, BENCH_VIEW_HEIGHT),
+						   1.0, FALSE);
+		}
+		end = get_time ();
+		g_rand_free (rand);
+		bench_report (corpus->name, "pick", end - start);
+
+		sp_item_invoke_hide (SP_ITEM (sp_document_root (doc)), dkey);
+		nr_arena_item_unref (root);
+	}
+	nr_object_unref ((NRObject *) arena);
+
+	filename = g_strdup_printf ("%s/render-bench-%s.svg", dir, corpus->name);
+	start = get_time ();
+	sp_repr_save_file (sp_document_repr_doc (doc), filename);
+	end = get_time ();
+	bench_report (corpus->name, "save", end - start);
+	unlink (filename);
+	g_free (filename);
+
+	sp_document_unref (doc);
+}
+
+int
+main (int argc, const char **argv)
+{
+	const gchar *dir;
+	double scale;
+	int threads, n_selected, i, j;
+
+	scale = 1.0;
+	threads = 1;
+	n_selected = 0;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-s") && (i + 1 < argc)) {
+			scale = atof (argv[++i]);
+		} else if (!strcmp (argv[i], "-t") && (i + 1 < argc)) {
+			threads = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			results = fopen (argv[++i], "w");
+			if (!results) {
+				fprintf (stderr, "Cannot write results to %s\n", argv[i]);
+				return 1;
+			}
+		} else if (argv[i][0] == '-') {
+			fprintf (stderr, "Usage: %s [-s SCALE] [-t THREADS] [-o RESULTS] [CORPUS...]\nCorpora:", argv[0]);
+			for (j = 0; j < (int) (sizeof (corpora) / sizeof (corpora[0])); j++) {
+				fprintf (stderr, " %s", corpora[j].name);
+			}
+			fprintf (stderr, "\n");
+			return 1;
+		} else {
+			n_selected += 1;
+		}
+	}
+
+	g_type_init ();
+	/* Workers fall back to single thread unless threading is initialized */
+	if (!g_thread_supported ()) g_thread_init (NULL);
+	/* Numbers are written in C locale */
+	setlocale (LC_NUMERIC, "C");
+	nr_arena_shape_set_threads (MAX (threads, 0));
+	dir = g_get_tmp_dir ();
+
+	if (results) {
+		fprintf (results, "# render-bench %s scale %g threads %u\n", INKSCAPE_VERSION, scale, nr_arena_shape_get_threads ());
+	}
+
+	for (j = 0; j < (int) (sizeof (corpora) / sizeof (corpora[0])); j++) {
+		if (n_selected) {
+			/* Only corpora named on command line */
+			for (i = 1; i < argc; i++) {
+				if ((argv[i][0] == '-') && (i + 1 < argc)) {
+					i += 1;
+				} else if (!strcmp (argv[i], corpora[j].name)) {
+					break;
+				}
+			}
+			if (i >= argc) continue;
+		}
+		bench_corpus (&corpora[j], scale, dir);
+	}
+
+	if (results) fclose (results);
+
+	return 0;
+}
+
+/* Application stubs, as in spsvgview */
+
+Inkscape *inkscape;
+
+void inkscape_ref (void) {}
+void inkscape_unref (void) {}
+void inkscape_add_document (SPDocument *document) {}
+void inkscape_remove_document (SPDocument *document) {}
+SPRepr *inkscape_get_repr (Inkscape *inkscape, const unsigned char *key) {return NULL;}
+#include "widgets/menu.h"
+void sp_menu_append (SPMenu *menu, const gchar *name, const gchar *tip, const void *data) {}
@@ -172,6 +172,8 @@ sp_select_context_set (SPEventContext *ec, const gchar *key, const gchar *val)
 	if (!strcmp (key, "show")) {
 		if (val && !strcmp (val, "outline")) {
 			sc->seltrans.show = SP_SELTRANS_SHOW_OUTLINE;
+		} else if (val && !strcmp (val, "bitmap")) {
+			sc->seltrans.show = SP_SELTRANS_SHOW_BITMAP;
 		} else {
 			sc->seltrans.show = SP_SELTRANS_SHOW_CONTENT;
 		}
@@ -676,6 +678,13 @@ sp_select_context_config_widget (SPEventContext *ec)
 	gtk_box_pack_start (GTK_BOX (fb), b, FALSE, FALSE, 0);
 	gtk_signal_connect (GTK_OBJECT (b), "toggled", GTK_SIGNAL_FUNC (sp_select_context_show_toggled), sc);
 
+	b = gtk_radio_button_new_with_label (gtk_radio_button_group (GTK_RADIO_BUTTON (b)), _("Show bitmap"));
+	gtk_widget_show (b);
+	gtk_object_set_data (GTK_OBJECT (b), "value", (void*)"bitmap");
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (b), sc->seltrans.show == SP_SELTRANS_SHOW_BITMAP);
+	gtk_box_pack_start (GTK_BOX (fb), b, FALSE, FALSE, 0);
+	gtk_signal_connect (GTK_OBJECT (b), "toggled", GTK_SIGNAL_FUNC (sp_select_context_show_toggled), sc);
+
 	f = gtk_frame_new (_("Object transformation"));
 	gtk_widget_show (f);
 	gtk_box_pack_start (GTK_BOX (vb), f, FALSE, FALSE, 0);
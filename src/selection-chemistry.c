@@ -26,6 +26,7 @@
 #include "sp-item-transform.h" 
 #include "sp-item-group.h"
 #include "sp-path.h"
+#include "sp-image.h"
 #include "path-chemistry.h"
 
 #include "selection-chemistry.h"
@@ -34,6 +35,7 @@
 GSList *clipboard = NULL;
 
 static void sp_matrix_d_set_rotate (NRMatrixD *m, double theta);
+static void sp_selection_share_parsed (SPDocument *doc, SPRepr *src, SPRepr *copy, unsigned int same_document);
 
 void
 sp_selection_delete (gpointer object, gpointer data)
@@ -85,6 +87,7 @@ void sp_selection_duplicate (gpointer object, gpointer data)
 
 	while (selected) {
 		copy = sp_repr_duplicate ((SPRepr *) selected->data);
+		sp_selection_share_parsed (SP_DT_DOCUMENT (desktop), (SPRepr *) selected->data, copy, TRUE);
 		item = (SPItem *) sp_document_add_repr (SP_DT_DOCUMENT (desktop), copy);
 		g_assert (item != NULL);
 		newsel = g_slist_prepend (newsel, copy);
@@ -99,6 +102,34 @@ void sp_selection_duplicate (gpointer object, gpointer data)
 	g_slist_free (newsel);
 }
 
+/*
+ * Gives copy, identical to src subtree, data already parsed by objects
+ * of src (path curves, decoded images), so objects built from copy share
+ * it instead of parsing attribute strings again.  Shared data is
+ * immutable; changing attribute replaces it.
+ */
+static void
+sp_selection_share_parsed (SPDocument *doc, SPRepr *src, SPRepr *copy, unsigned int same_document)
+{
+	const gchar *id;
+	SPObject *object;
+	SPRepr *sc, *cc;
+
+	id = sp_repr_attr (src, "id");
+	object = (id) ? sp_document_lookup_id (doc, id) : NULL;
+	if (object && (SP_OBJECT_REPR (object) == src)) {
+		if (SP_IS_PATH (object)) {
+			if (SP_SHAPE (object)->curve) sp_path_share_repr_curve (copy, SP_SHAPE (object)->curve);
+		} else if (SP_IS_IMAGE (object)) {
+			sp_image_share_repr_pixbuf (copy, SP_IMAGE (object), same_document);
+		}
+	}
+
+	for (sc = src->children, cc = copy->children; sc && cc; sc = sc->next, cc = cc->next) {
+		sp_selection_share_parsed (doc, sc, cc, same_document);
+	}
+}
+
 void
 sp_edit_clear_all (gpointer object, gpointer data)
 {
@@ -236,6 +267,7 @@ sp_selection_group (gpointer object, gpointer data)
 		SPRepr *spnew;
 		current = (SPRepr *) p->data;
 		spnew = sp_repr_duplicate (current);
+		sp_selection_share_parsed (SP_DT_DOCUMENT (desktop), current, spnew, TRUE);
 		sp_repr_unparent (current);
 		sp_repr_append_child (group, spnew);
 		sp_repr_unref (spnew);
@@ -551,6 +583,8 @@ sp_selection_copy (GtkWidget * widget)
 		sl = g_slist_remove (sl, repr);
 		css = sp_repr_css_attr_inherited (repr, "style");
 		copy = sp_repr_duplicate (repr);
+		/* Pasted copies share it in turn, as duplicate keeps typed values */
+		sp_selection_share_parsed (SP_DT_DOCUMENT (desktop), repr, copy, FALSE);
 		sp_repr_css_set (copy, css, "style");
 		sp_repr_css_attr_unref (css);
 
@@ -19,6 +19,7 @@
 #include "desktop.h"
 #include "desktop-handles.h"
 #include "document.h"
+#include "sp-object.h"
 #include "sp-item.h"
 #include "selection.h"
 
@@ -37,6 +38,7 @@ static void sp_selection_dispose (GObject *object);
 static void sp_selection_private_changed (SPSelection *selection);
 
 static void sp_selection_frozen_empty (SPSelection *selection);
+static void sp_selection_detach_item (SPSelection *selection, SPItem *item);
 
 static gint sp_selection_idle_handler (gpointer data);
 
@@ -97,6 +99,8 @@ sp_selection_init (SPSelection *selection)
 {
 	selection->reprs = NULL;
 	selection->items = NULL;
+	selection->itemset = g_hash_table_new (NULL, NULL);
+	selection->document = NULL;
 	selection->idle = 0;
 	selection->flags = 0;
 }
@@ -110,6 +114,11 @@ sp_selection_dispose (GObject *object)
 
 	sp_selection_frozen_empty (selection);
 
+	if (selection->itemset) {
+		g_hash_table_destroy (selection->itemset);
+		selection->itemset = NULL;
+	}
+
 	if (selection->idle) {
 		gtk_idle_remove (selection->idle);
 		selection->idle = 0;
@@ -134,19 +143,31 @@ sp_selection_selected_item_release (SPItem * item, SPSelection * selection)
 	g_slist_free (selection->reprs);
 	selection->reprs = NULL;
 
-	selection->items = g_slist_remove (selection->items, item);
+	sp_selection_detach_item (selection, item);
 
 	sp_selection_changed (selection);
 }
 
-/* Handler for selected objects "modified" signal */
+/*
+ * Batch observer of document; collects flags of selected items, instead
+ * of every item having its own "modified" handler.  Seltrans and the
+ * selection dialogs follow our "modified" signal, so they are notified
+ * once per cycle too; knot holders are rebuilt on "changed" only.
+ */
 
 static void
-sp_selection_selected_item_modified (SPItem *item, guint flags, SPSelection *selection)
+sp_selection_document_modified (SPDocument *doc, const SPModifiedEntry *entries, guint length, guint flags, gpointer data)
 {
-	g_return_if_fail (selection != NULL);
-	g_return_if_fail (SP_IS_SELECTION (selection));
-	g_return_if_fail (sp_selection_item_selected (selection, item));
+	SPSelection *selection;
+	guint i;
+
+	selection = SP_SELECTION (data);
+
+	flags = 0;
+	for (i = 0; i < length; i++) {
+		if (g_hash_table_lookup (selection->itemset, entries[i].object)) flags |= entries[i].flags;
+	}
+	if (!flags) return;
 
 	if (!selection->idle) {
 		/* Request handling to be run in idle loop */
@@ -157,6 +178,40 @@ sp_selection_selected_item_modified (SPItem *item, guint flags, SPSelection *sel
 	selection->flags |= flags;
 }
 
+static void
+sp_selection_attach_item (SPSelection *selection, SPItem *item)
+{
+	SPDocument *doc;
+
+	selection->items = g_slist_prepend (selection->items, item);
+	g_hash_table_insert (selection->itemset, item, item);
+	g_signal_connect (G_OBJECT (item), "release",
+			  G_CALLBACK (sp_selection_selected_item_release), selection);
+
+	doc = SP_OBJECT_DOCUMENT (item);
+	if (doc != selection->document) {
+		if (selection->document) {
+			sp_document_remove_batch_observer (selection->document, sp_selection_document_modified, selection);
+		}
+		selection->document = doc;
+		sp_document_add_batch_observer (doc, sp_selection_document_modified, selection);
+	}
+}
+
+static void
+sp_selection_detach_item (SPSelection *selection, SPItem *item)
+{
+	sp_signal_disconnect_by_data (item, selection);
+	selection->items = g_slist_remove (selection->items, item);
+	g_hash_table_remove (selection->itemset, item);
+
+	/* Items keep document alive, so stop observing while there are none */
+	if (!selection->items && selection->document) {
+		sp_document_remove_batch_observer (selection->document, sp_selection_document_modified, selection);
+		selection->document = NULL;
+	}
+}
+
 /* Our idle loop handler */
 
 static gint
@@ -190,10 +245,7 @@ sp_selection_frozen_empty (SPSelection * selection)
 	selection->reprs = NULL;
 
 	while (selection->items) {
-		SPItem *item;
-		item = SP_ITEM (selection->items->data);
-		sp_signal_disconnect_by_data (item, selection);
-		selection->items = g_slist_remove (selection->items, item);
+		sp_selection_detach_item (selection, SP_ITEM (selection->items->data));
 	}
 }
 
@@ -261,7 +313,7 @@ sp_selection_item_selected (SPSelection * selection, SPItem * item)
 	g_return_val_if_fail (item != NULL, FALSE);
 	g_return_val_if_fail (SP_IS_ITEM (item), FALSE);
 
-	return (g_slist_find (selection->items, item) != NULL);
+	return (g_hash_table_lookup (selection->itemset, item) != NULL);
 }
 
 gboolean
@@ -292,11 +344,7 @@ sp_selection_add_item (SPSelection * selection, SPItem * item)
 	g_slist_free (selection->reprs);
 	selection->reprs = NULL;
 
-	selection->items = g_slist_prepend (selection->items, item);
-	g_signal_connect (G_OBJECT (item), "release",
-			  G_CALLBACK (sp_selection_selected_item_release), selection);
-	g_signal_connect (G_OBJECT (item), "modified",
-			  G_CALLBACK (sp_selection_selected_item_modified), selection);
+	sp_selection_attach_item (selection, item);
 
 	sp_selection_changed (selection);
 }
@@ -366,8 +414,7 @@ sp_selection_remove_item (SPSelection * selection, SPItem * item)
 	g_slist_free (selection->reprs);
 	selection->reprs = NULL;
 
- 	sp_signal_disconnect_by_data (item, selection);
-	selection->items = g_slist_remove (selection->items, item);
+	sp_selection_detach_item (selection, item);
 
 	sp_selection_changed (selection);
 }
@@ -407,11 +454,7 @@ sp_selection_set_item_list (SPSelection * selection, const GSList * list)
 		for (l = list; l != NULL; l = l->next) {
 			i = (SPItem *) l->data;
 			if (!SP_IS_ITEM (i)) break;
-			selection->items = g_slist_prepend (selection->items, i);
-			g_signal_connect (G_OBJECT (i), "release",
-					  G_CALLBACK (sp_selection_selected_item_release), selection);
-			g_signal_connect (G_OBJECT (i), "modified",
-					  G_CALLBACK (sp_selection_selected_item_modified), selection);
+			sp_selection_attach_item (selection, i);
 		}
 	}
 
@@ -22,6 +22,9 @@ struct _SPSelection {
 	SPDesktop *desktop;
 	GSList *reprs;
 	GSList *items;
+	/* Selected items for lookup, and document notifying about them */
+	GHashTable *itemset;
+	SPDocument *document;
 	guint idle;
 	guint flags;
 };
@@ -32,6 +32,7 @@
 #include "seltrans.h"
 #include "sp-metrics.h"
 #include "helper/sp-ctrlline.h"
+#include "display/canvas-arena.h"
 
 static void sp_sel_trans_update_handles (SPSelTrans * seltrans);
 static void sp_sel_trans_update_volatile_state (SPSelTrans * seltrans);
@@ -47,6 +48,8 @@ static gboolean sp_sel_trans_handle_request (SPKnot * knot, NRPointF *p, guint s
 static void sp_sel_trans_sel_changed (SPSelection * selection, gpointer data);
 static void sp_sel_trans_sel_modified (SPSelection * selection, guint flags, gpointer data);
 
+static int sp_object_compare_position (SPObject *a, SPObject *b);
+
 extern GdkPixbuf *handles[];
 
 static gboolean
@@ -98,6 +101,8 @@ sp_sel_trans_init (SPSelTrans * seltrans, SPDesktop * desktop)
 
 	seltrans->grabbed = FALSE;
 	seltrans->show_handles = TRUE;
+	seltrans->draft = FALSE;
+	seltrans->layer = FALSE;
 	for (i = 0; i < 8; i++) seltrans->shandle[i] = NULL;
 	for (i = 0; i < 8; i++) seltrans->rhandle[i] = NULL;
 	seltrans->chandle = NULL;
@@ -238,6 +243,34 @@ sp_sel_trans_set_center (SPSelTrans * seltrans, gdouble x, gdouble y)
 	sp_sel_trans_update_handles (seltrans);
 }
 
+/* Rasterizes views of selected items in desktop drawing into layer */
+static void
+sp_sel_trans_push_layer (SPSelTrans *seltrans)
+{
+	NRArenaItem **aitems;
+	GSList *l, *sorted;
+	int n;
+
+	sorted = g_slist_copy ((GSList *) sp_selection_item_list (seltrans->selection));
+	sorted = g_slist_sort (sorted, (GCompareFunc) sp_object_compare_position);
+
+	aitems = nr_new (NRArenaItem *, seltrans->nitems);
+	n = 0;
+	for (l = sorted; l != NULL; l = l->next) {
+		SPItemView *v;
+		for (v = SP_ITEM (l->data)->display; v != NULL; v = v->next) {
+			if (v->key == seltrans->desktop->dkey) {
+				if (n < seltrans->nitems) aitems[n++] = v->arenaitem;
+				break;
+			}
+		}
+	}
+	g_slist_free (sorted);
+
+	sp_canvas_arena_push_layer (SP_CANVAS_ARENA (seltrans->desktop->drawing), aitems, n);
+	nr_free (aitems);
+}
+
 void
 sp_sel_trans_grab (SPSelTrans * seltrans, NRPointF *p, gdouble x, gdouble y, gboolean show_handles)
 {
@@ -271,6 +304,15 @@ sp_sel_trans_grab (SPSelTrans * seltrans, NRPointF *p, gdouble x, gdouble y, gbo
 
 	nr_matrix_d_set_identity (&seltrans->current);
 
+	/* Content is redrawn on every motion */
+	if (seltrans->show == SP_SELTRANS_SHOW_CONTENT) {
+		sp_canvas_arena_push_draft (SP_CANVAS_ARENA (seltrans->desktop->drawing));
+		seltrans->draft = TRUE;
+	} else if (seltrans->show == SP_SELTRANS_SHOW_BITMAP) {
+		sp_sel_trans_push_layer (seltrans);
+		seltrans->layer = TRUE;
+	}
+
 	seltrans->point.x = p->x;
 	seltrans->point.y = p->y;
 
@@ -317,6 +359,9 @@ sp_sel_trans_transform (SPSelTrans * seltrans, NRMatrixD *affine, NRPointF *norm
 			nr_matrix_multiply_ffd (&i2dnew, &seltrans->transforms[i], affine);
 			sp_item_set_i2d_affine (seltrans->items[i], &i2dnew);
 		}
+	} else if (seltrans->show == SP_SELTRANS_SHOW_BITMAP) {
+		/* Only layer moves, items are left alone */
+		sp_canvas_arena_set_layer_transform (SP_CANVAS_ARENA (seltrans->desktop->drawing), affine);
 	} else {
 		NRPointF p[4];
         	/* update the outline */
@@ -362,7 +407,7 @@ sp_sel_trans_ungrab (SPSelTrans * seltrans)
 		while (l != NULL) {
 			item = SP_ITEM (l->data);
 			/* fixme: We do not have to set it here (Lauris) */
-			if (seltrans->show == SP_SELTRANS_SHOW_OUTLINE) {
+			if (seltrans->show != SP_SELTRANS_SHOW_CONTENT) {
 				NRMatrixF i2d, i2dnew;
 				sp_item_i2d_affine (item, &i2d);
 				nr_matrix_multiply_ffd (&i2dnew, &i2d, &seltrans->current);
@@ -405,6 +450,15 @@ sp_sel_trans_ungrab (SPSelTrans * seltrans)
 	}
 	seltrans->nitems = 0;
 
+	if (seltrans->draft) {
+		sp_canvas_arena_pop_draft (SP_CANVAS_ARENA (seltrans->desktop->drawing));
+		seltrans->draft = FALSE;
+	}
+	if (seltrans->layer) {
+		sp_canvas_arena_pop_layer (SP_CANVAS_ARENA (seltrans->desktop->drawing));
+		seltrans->layer = FALSE;
+	}
+
 	seltrans->grabbed = FALSE;
 	seltrans->show_handles = TRUE;
 	
@@ -469,7 +523,7 @@ sp_sel_trans_stamp (SPSelTrans * seltrans)
 			copy_item = (SPItem *) sp_document_add_repr (SP_DT_DOCUMENT (seltrans->desktop), 
 								     copy_repr);
 			
-			if (seltrans->show == SP_SELTRANS_SHOW_OUTLINE) {
+			if (seltrans->show != SP_SELTRANS_SHOW_CONTENT) {
 				sp_item_i2d_affine (original_item, &i2d);
 				nr_matrix_multiply_ffd (&i2dnew, &i2d, &seltrans->current);
 				sp_item_set_i2d_affine (copy_item, &i2dnew);
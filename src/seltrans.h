@@ -20,7 +20,9 @@ typedef struct _SPSelTrans SPSelTrans;
 
 enum {
 	SP_SELTRANS_SHOW_CONTENT,
-	SP_SELTRANS_SHOW_OUTLINE
+	SP_SELTRANS_SHOW_OUTLINE,
+	/* Content rasterized once at grab, items are updated at ungrab */
+	SP_SELTRANS_SHOW_BITMAP
 };
 
 enum {
@@ -40,13 +42,17 @@ struct _SPSelTrans {
 	SPSelection *selection;
 
 	guint state : 1;
-	guint show : 1;
+	guint show : 2;
 	guint transform : 1;
 
 	unsigned int grabbed : 1;
 	unsigned int show_handles : 1;
 	unsigned int empty : 1;
 	unsigned int changed : 1;
+	/* Drawing is in draft while grabbed */
+	unsigned int draft : 1;
+	/* Selection is drawn as bitmap layer while grabbed */
+	unsigned int layer : 1;
 
 	SPItem **items;
 	NRMatrixF *transforms;
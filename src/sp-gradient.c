@@ -187,6 +187,8 @@ static SPRepr *sp_gradient_write (SPObject *object, SPRepr *repr, guint flags);
 static void sp_gradient_href_release (SPObject *href, SPGradient *gradient);
 static void sp_gradient_href_modified (SPObject *href, guint flags, SPGradient *gradient);
 
+static guint32 sp_gradient_average (SPPaintServer *ps);
+
 static void sp_gradient_invalidate_vector (SPGradient *gr);
 static void sp_gradient_rebuild_vector (SPGradient *gr);
 
@@ -216,9 +218,11 @@ sp_gradient_class_init (SPGradientClass *klass)
 {
 	GObjectClass *gobject_class;
 	SPObjectClass *sp_object_class;
+	SPPaintServerClass *ps_class;
 
 	gobject_class = (GObjectClass *) klass;
 	sp_object_class = (SPObjectClass *) klass;
+	ps_class = (SPPaintServerClass *) klass;
 
 	gradient_parent_class = (SPPaintServerClass *)g_type_class_ref (SP_TYPE_PAINT_SERVER);
 
@@ -229,6 +233,8 @@ sp_gradient_class_init (SPGradientClass *klass)
 	sp_object_class->remove_child = sp_gradient_remove_child;
 	sp_object_class->modified = sp_gradient_modified;
 	sp_object_class->write = sp_gradient_write;
+
+	ps_class->average = sp_gradient_average;
 }
 
 static void
@@ -818,6 +824,37 @@ sp_gradient_rebuild_vector (SPGradient *gr)
 	}
 }
 
+/*
+ * Average of color array, with color weighted by alpha so transparent
+ * stops do not contribute their color
+ */
+
+static guint32
+sp_gradient_average (SPPaintServer *ps)
+{
+	SPGradient *gr;
+	unsigned int r, g, b, a;
+	int i;
+
+	gr = SP_GRADIENT (ps);
+
+	if (!gr->color) sp_gradient_ensure_colors (gr);
+
+	r = g = b = a = 0;
+	for (i = 0; i < NCOLORS; i++) {
+		unsigned int ca;
+		ca = gr->color[4 * i + 3];
+		r += gr->color[4 * i] * ca;
+		g += gr->color[4 * i + 1] * ca;
+		b += gr->color[4 * i + 2] * ca;
+		a += ca;
+	}
+
+	if (!a) return 0;
+
+	return ((r / a) << 24) | ((g / a) << 16) | ((b / a) << 8) | (a / NCOLORS);
+}
+
 void
 sp_gradient_ensure_colors (SPGradient *gr)
 {
@@ -62,8 +62,20 @@ static void sp_image_update_canvas_image (SPImage *image);
 static GdkPixbuf * sp_image_repr_read_dataURI (const gchar * uri_data);
 static GdkPixbuf * sp_image_repr_read_b64 (const gchar * uri_data);
 
+static gchar *sp_image_pixbuf_to_string (const void *data);
+static void sp_image_pixbuf_free (void *data);
+static size_t sp_image_pixbuf_size (const void *data);
+
 static SPItemClass *parent_class;
 
+/* Decoded image attached to existing xlink:href string, never stringified */
+static const SPReprValueType sp_image_pixbuf_value_type = {
+	"GdkPixbuf",
+	sp_image_pixbuf_to_string,
+	sp_image_pixbuf_free,
+	sp_image_pixbuf_size
+};
+
 GType
 sp_image_get_type (void)
 {
@@ -252,9 +264,13 @@ sp_image_update (SPObject *object, SPCtx *ctx, unsigned int flags)
 			image->pixbuf = NULL;
 		}
 		if (image->href) {
+			const GdkPixbuf *shared;
 			GdkPixbuf *pixbuf;
-			pixbuf = sp_image_repr_read_image (object->repr);
-			if (pixbuf) {
+			/* Already decoded by image this one was copied from */
+			shared = sp_repr_attr_typed (object->repr, "xlink:href", &sp_image_pixbuf_value_type);
+			if (shared) {
+				image->pixbuf = gdk_pixbuf_ref ((GdkPixbuf *) shared);
+			} else if ((pixbuf = sp_image_repr_read_image (object->repr)) != NULL) {
 				pixbuf = sp_image_pixbuf_force_rgba (pixbuf);
 				image->pixbuf = pixbuf;
 			}
@@ -461,6 +477,48 @@ sp_image_repr_read_image (SPRepr * repr)
 	return pixbuf;
 }
 
+/*
+ * Attaches decoded image to copy of its repr, so image built from copy
+ * does not load and decode it again.  Relative references resolve
+ * against document base, so they are only shared if copy is going to
+ * the same document.
+ */
+void
+sp_image_share_repr_pixbuf (SPRepr *repr, SPImage *image, unsigned int same_document)
+{
+	const gchar *href;
+
+	g_return_if_fail (repr != NULL);
+	g_return_if_fail (image != NULL);
+	g_return_if_fail (SP_IS_IMAGE (image));
+
+	if (!image->pixbuf) return;
+	href = sp_repr_attr (repr, "xlink:href");
+	if (!href) return;
+	if (!same_document && strncmp (href, "data:", 5) && strncmp (href, "file:", 5) && !g_path_is_absolute (href)) return;
+
+	sp_repr_attr_attach_typed (repr, "xlink:href", &sp_image_pixbuf_value_type, gdk_pixbuf_ref (image->pixbuf));
+}
+
+static gchar *
+sp_image_pixbuf_to_string (const void *data)
+{
+	/* Never called, as value is attached to existing string */
+	g_return_val_if_reached (NULL);
+}
+
+static void
+sp_image_pixbuf_free (void *data)
+{
+	gdk_pixbuf_unref ((GdkPixbuf *) data);
+}
+
+static size_t
+sp_image_pixbuf_size (const void *data)
+{
+	return gdk_pixbuf_get_rowstride ((const GdkPixbuf *) data) * gdk_pixbuf_get_height ((const GdkPixbuf *) data);
+}
+
 static GdkPixbuf *
 sp_image_pixbuf_force_rgba (GdkPixbuf * pixbuf)
 {
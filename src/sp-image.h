@@ -53,6 +53,9 @@ struct _SPImageClass {
 
 GType sp_image_get_type (void);
 
+/* Shares decoded image with copy of image repr */
+void sp_image_share_repr_pixbuf (SPRepr *repr, SPImage *image, unsigned int same_document);
+
 G_END_DECLS
 
 #endif
@@ -34,6 +34,7 @@ static void sp_group_build (SPObject * object, SPDocument * document, SPRepr * r
 static void sp_group_release (SPObject *object);
 static void sp_group_child_added (SPObject * object, SPRepr * child, SPRepr * ref);
 static void sp_group_remove_child (SPObject * object, SPRepr * child);
+static SPObject *sp_group_lookup_child (SPGroup *group, SPRepr *repr, SPObject **prev, gint *position);
 static void sp_group_order_changed (SPObject * object, SPRepr * child, SPRepr * old_ref, SPRepr * new_ref);
 static void sp_group_update (SPObject *object, SPCtx *ctx, guint flags);
 static void sp_group_set (SPObject *object, unsigned int key, const gchar *value);
@@ -105,6 +106,8 @@ static void
 sp_group_init (SPGroup *group)
 {
 	group->children = NULL;
+	group->cursor = NULL;
+	group->cursor_position = 0;
 	group->mode = SP_GROUP_MODE_GROUP;
 }
 
@@ -144,6 +147,7 @@ sp_group_release (SPObject *object)
 
 	group = SP_GROUP (object);
 
+	group->cursor = NULL;
 	while (group->children) {
 		group->children = sp_object_detach_unref (object, group->children);
 	}
@@ -171,11 +175,8 @@ sp_group_child_added (SPObject *object, SPRepr *child, SPRepr *ref)
 	prev = NULL;
 	position = 0;
 	if (ref != NULL) {
-		prev = group->children;
-		while (prev && (prev->repr != ref)) {
-			if (SP_IS_ITEM (prev)) position += 1;
-			prev = prev->next;
-		}
+		SPObject *before;
+		prev = sp_group_lookup_child (group, ref, &before, &position);
 		if (SP_IS_ITEM (prev)) position += 1;
 	}
 
@@ -186,17 +187,29 @@ sp_group_child_added (SPObject *object, SPRepr *child, SPRepr *ref)
 	} else {
 		group->children = sp_object_attach_reref (object, ochild, group->children);
 	}
+	/* Next child is usually added after this one */
+	group->cursor = prev;
+	group->cursor_position = position;
 
 	sp_object_invoke_build (ochild, object->document, child, SP_OBJECT_IS_CLONED (object));
 
 	if (SP_IS_ITEM (ochild)) {
-		SPItemView *v;
+		SPItemView *v, *pv;
 		NRArenaItem *ac;
 		for (v = item->display; v != NULL; v = v->next) {
 			ac = sp_item_invoke_show (SP_ITEM (ochild), NR_ARENA_ITEM_ARENA (v->arenaitem), v->key, v->flags);
 			if (ac) {
-				nr_arena_item_add_child (v->arenaitem, ac, NULL);
-				nr_arena_item_set_order (ac, position);
+				/* Place after preceding item display, without counting siblings */
+				pv = NULL;
+				if (SP_IS_ITEM (prev)) {
+					for (pv = SP_ITEM (prev)->display; pv && (pv->key != v->key); pv = pv->next);
+				}
+				if (pv && (pv->arenaitem->parent == v->arenaitem)) {
+					nr_arena_item_add_child (v->arenaitem, ac, pv->arenaitem);
+				} else {
+					nr_arena_item_add_child (v->arenaitem, ac, NULL);
+					nr_arena_item_set_order (ac, position);
+				}
 				nr_arena_item_unref (ac);
 			}
 		}
@@ -212,27 +225,70 @@ sp_group_remove_child (SPObject * object, SPRepr * child)
 {
 	SPGroup * group;
 	SPObject * prev, * ochild;
+	gint position;
 
 	group = SP_GROUP (object);
 
 	if (((SPObjectClass *) (parent_class))->remove_child)
 		(* ((SPObjectClass *) (parent_class))->remove_child) (object, child);
 
-	prev = NULL;
-	ochild = group->children;
-	while (ochild->repr != child) {
-		prev = ochild;
-		ochild = ochild->next;
-	}
+	ochild = sp_group_lookup_child (group, child, &prev, &position);
+	g_assert (ochild != NULL);
 
 	if (prev) {
 		prev->next = sp_object_detach_unref (object, ochild);
 	} else {
 		group->children = sp_object_detach_unref (object, ochild);
 	}
+	/* Removals in document order continue from here */
+	group->cursor = prev;
+	group->cursor_position = position;
+
 	sp_object_request_modified (object, SP_OBJECT_MODIFIED_FLAG);
 }
 
+/*
+ * Finds child object of repr, with preceding object and number of items
+ * before it.  Children are mostly added and removed in runs in document
+ * order (combine, break apart, paste), so search continues from last
+ * change and only restarts from list start if child is before it.
+ */
+static SPObject *
+sp_group_lookup_child (SPGroup *group, SPRepr *repr, SPObject **prev, gint *position)
+{
+	SPObject *p, *o;
+	gint pos;
+
+	if (group->cursor) {
+		p = group->cursor;
+		pos = group->cursor_position;
+		o = p->next;
+	} else {
+		p = NULL;
+		pos = 0;
+		o = group->children;
+	}
+	while (o && (o->repr != repr)) {
+		if (SP_IS_ITEM (o)) pos += 1;
+		p = o;
+		o = o->next;
+	}
+
+	if (!o && group->cursor) {
+		p = NULL;
+		pos = 0;
+		for (o = group->children; o && (o->repr != repr); o = o->next) {
+			if (SP_IS_ITEM (o)) pos += 1;
+			p = o;
+		}
+	}
+
+	*prev = p;
+	*position = pos;
+
+	return o;
+}
+
 static void
 sp_group_order_changed (SPObject *object, SPRepr *child, SPRepr *old_ref, SPRepr *new_ref)
 {
@@ -245,6 +301,8 @@ sp_group_order_changed (SPObject *object, SPRepr *child, SPRepr *old_ref, SPRepr
 	if (((SPObjectClass *) (parent_class))->order_changed)
 		(* ((SPObjectClass *) (parent_class))->order_changed) (object, child, old_ref, new_ref);
 
+	group->cursor = NULL;
+
 	childobj = oldobj = newobj = NULL;
 	oldpos = newpos = 0;
 
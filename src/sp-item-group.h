@@ -29,6 +29,10 @@ typedef enum _SPGroupMode {
 struct _SPGroup {
 	SPItem item;
 	SPObject *children;
+	/* Child preceding last added or removed one (NULL is list start) */
+	SPObject *cursor;
+	/* Number of item children up to and including cursor */
+	gint cursor_position;
 	SPGroupMode mode;
 };
 
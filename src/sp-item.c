@@ -181,8 +181,12 @@ sp_item_clip_release (SPClipPath *cp, SPItem *item)
 static void
 sp_item_clip_modified (SPClipPath *cp, guint flags, SPItem *item)
 {
-	/* I think cliPath does update automagically */
-	/* g_warning ("Item %s clip path %s modified", SP_OBJECT_ID (item), SP_OBJECT_ID (cp)); */
+	SPItemView *v;
+
+	/* Arena updates itself, but cached coverage has to go */
+	for (v = item->display; v != NULL; v = v->next) {
+		if (v->arenaitem->clip) nr_arena_item_invalidate_coverage (v->arenaitem->clip);
+	}
 }
 
 static void
@@ -204,8 +208,11 @@ sp_item_mask_release (SPMask *mask, SPItem *item)
 static void
 sp_item_mask_modified (SPMask *mask, guint flags, SPItem *item)
 {
-	/* I think mask does update automagically */
-	/* g_warning ("Item %s mask %s modified", SP_OBJECT_ID (item), SP_OBJECT_ID (mask)); */
+	SPItemView *v;
+
+	for (v = item->display; v != NULL; v = v->next) {
+		if (v->arenaitem->mask) nr_arena_item_invalidate_coverage (v->arenaitem->mask);
+	}
 }
 
 static void
@@ -314,12 +321,12 @@ sp_item_set (SPObject *object, unsigned int key, const gchar *value)
 		}
 		break;
 	case SP_ATTR_STYLE:
-		sp_style_read_from_object (object->style, object);
+		sp_object_read_style (object);
 		sp_object_request_update (object, SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
 		break;
 	default:
 		if (SP_ATTRIBUTE_IS_CSS (key)) {
-			sp_style_read_from_object (object->style, object);
+			sp_object_read_style (object);
 			sp_object_request_update (object, SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_STYLE_MODIFIED_FLAG);
 		} else {
 		  if (((SPObjectClass *) (parent_class))->set) {
@@ -385,7 +392,7 @@ sp_item_write (SPObject *object, SPRepr *repr, guint flags)
 	}
 
 	if (SP_OBJECT_PARENT (object)) {
-		s = sp_style_write_difference (SP_OBJECT_STYLE (object), SP_OBJECT_STYLE (SP_OBJECT_PARENT (object)));
+		s = sp_style_write_object_difference (SP_OBJECT_STYLE (object), object);
 		sp_repr_set_attr (repr, "style", (s && *s) ? s : NULL);
 		g_free (s);
 	} else {
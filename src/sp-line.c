@@ -192,9 +192,9 @@ sp_line_write_transform (SPItem *item, SPRepr *repr, NRMatrixF *t)
 		SPStyle *style;
 		gchar *str;
 		/* Scale changed, so we have to adjust stroke width */
-		style = SP_OBJECT_STYLE (item);
+		style = sp_object_style_private (SP_OBJECT (item));
 		style->stroke_width.computed *= sqrt (fabs (sw * sh));
-		str = sp_style_write_difference (style, SP_OBJECT_STYLE (SP_OBJECT_PARENT (item)));
+		str = sp_style_write_object_difference (style, SP_OBJECT (item));
 		sp_repr_set_attr (SP_OBJECT_REPR (item), "style", str);
 		g_free (str);
 	}
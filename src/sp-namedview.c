@@ -100,6 +100,7 @@ sp_namedview_init (SPNamedView * nv)
 	nv->snaptogrid = FALSE;
 	nv->showguides = FALSE;
 	nv->snaptoguides = FALSE;
+	nv->snaptoobjects = FALSE;
 	nv->showborder = TRUE;
 
 	nv->hguides = NULL;
@@ -125,8 +126,10 @@ sp_namedview_build (SPObject * object, SPDocument * document, SPRepr * repr)
 	sp_object_read_attr (object, "snaptogrid");
 	sp_object_read_attr (object, "showguides");
 	sp_object_read_attr (object, "snaptoguides");
+	sp_object_read_attr (object, "snaptoobjects");
 	sp_object_read_attr (object, "gridtolerance");
 	sp_object_read_attr (object, "guidetolerance");
+	sp_object_read_attr (object, "objecttolerance");
 	sp_object_read_attr (object, "gridoriginx");
 	sp_object_read_attr (object, "gridoriginy");
 	sp_object_read_attr (object, "gridspacingx");
@@ -221,6 +224,10 @@ sp_namedview_set (SPObject *object, unsigned int key, const gchar *value)
 		nv->snaptoguides = sp_str_to_bool (value);
 		sp_object_request_modified (object, SP_OBJECT_MODIFIED_FLAG);
 		break;
+	case SP_ATTR_SNAPTOOBJECTS:
+		nv->snaptoobjects = sp_str_to_bool (value);
+		sp_object_request_modified (object, SP_OBJECT_MODIFIED_FLAG);
+		break;
 	case SP_ATTR_GRIDTOLERANCE:
 		nv->gridtoleranceunit = px;
 		nv->gridtolerance = DEFAULTTOLERANCE;
@@ -237,6 +244,14 @@ sp_namedview_set (SPObject *object, unsigned int key, const gchar *value)
 		}
 		sp_object_request_modified (object, SP_OBJECT_MODIFIED_FLAG);
 		break;
+	case SP_ATTR_OBJECTTOLERANCE:
+		nv->objecttoleranceunit = px;
+		nv->objecttolerance = DEFAULTTOLERANCE;
+		if (value) {
+			sp_nv_read_length (value, SP_UNIT_ABSOLUTE | SP_UNIT_DEVICE, &nv->objecttolerance, &nv->objecttoleranceunit);
+		}
+		sp_object_request_modified (object, SP_OBJECT_MODIFIED_FLAG);
+		break;
 	case SP_ATTR_GRIDORIGINX:
 		nv->gridunit = mm;
 		nv->gridoriginx = 0.0;
@@ -33,6 +33,8 @@ struct _SPNamedView {
 	unsigned int snaptogrid : 1;
 	unsigned int showguides : 1;
 	unsigned int snaptoguides : 1;
+	/* Nodes and bbox corners and midpoints of other objects */
+	unsigned int snaptoobjects : 1;
 	unsigned int showborder : 1;
 	unsigned int borderlayer : 2;
 
@@ -49,6 +51,9 @@ struct _SPNamedView {
 	const SPUnit *guidetoleranceunit;
 	gdouble guidetolerance;
 
+	const SPUnit *objecttoleranceunit;
+	gdouble objecttolerance;
+
 	guint32 gridcolor;
 	guint32 guidecolor;
 	guint32 guidehicolor;
@@ -14,6 +14,7 @@
 #include "document.h"
 #include "sp-item.h"
 #include "sp-defs.h"
+#include "sp-style-elem.h"
 #include "sp-symbol.h"
 #include "sp-marker.h"
 #include "sp-use.h"
@@ -101,6 +102,7 @@ sp_object_type_lookup (const gchar * name)
 		g_hash_table_insert (dtable, (void *)"rect", GINT_TO_POINTER (SP_TYPE_RECT));
 		g_hash_table_insert (dtable, (void *)"spiral", GINT_TO_POINTER (SP_TYPE_SPIRAL));
 		g_hash_table_insert (dtable, (void *)"star", GINT_TO_POINTER (SP_TYPE_STAR));
+		g_hash_table_insert (dtable, (void *)"style", GINT_TO_POINTER (SP_TYPE_STYLE_ELEM));
 		g_hash_table_insert (dtable, (void *)"stop", GINT_TO_POINTER (SP_TYPE_STOP));
 		g_hash_table_insert (dtable, (void *)"svg", GINT_TO_POINTER (SP_TYPE_ROOT));
 		g_hash_table_insert (dtable, (void *)"symbol", GINT_TO_POINTER (SP_TYPE_SYMBOL));
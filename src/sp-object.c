@@ -14,10 +14,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <libnr/nr-trace.h>
 #include "helper/sp-marshal.h"
 #include "xml/repr-private.h"
 #include "attributes.h"
 #include "document.h"
+#include "document-private.h"
 #include "style.h"
 #include "sp-object-repr.h"
 #include "sp-root.h"
@@ -63,7 +65,8 @@ SPReprEventVector object_event_vector = {
 	NULL, /* Change content */
 	sp_object_repr_content_changed,
 	NULL, /* change_order */
-	sp_object_repr_order_changed
+	sp_object_repr_order_changed,
+	TRUE /* Typed values - attributes are reread from repr */
 };
 
 static GObjectClass *parent_class;
@@ -133,6 +136,9 @@ sp_object_init (SPObject * object)
 	object->repr = NULL;
 	object->id = NULL;
 	object->style = NULL;
+	object->declared = NULL;
+	object->css = NULL;
+	object->css_generation = 0;
 }
 
 static void
@@ -357,6 +363,13 @@ sp_object_invoke_release (SPObject *object)
 	if (object->style) {
 		object->style = sp_style_unref (object->style);
 	}
+	if (object->declared) {
+		object->declared = sp_style_unref (object->declared);
+	}
+
+	g_free (object->css);
+	object->css = NULL;
+	object->css_generation = 0;
 
 	if (!SP_OBJECT_IS_CLONED (object)) {
 		g_assert (object->id);
@@ -416,6 +429,8 @@ sp_object_repr_order_changed (SPRepr * repr, SPRepr * child, SPRepr * old, SPRep
 static void
 sp_object_private_set (SPObject *object, unsigned int key, const gchar *value)
 {
+	SPStyleSheet *sheet;
+
 	g_assert (SP_IS_DOCUMENT (object->document));
 	/* fixme: rething that cloning issue */
 	g_assert (SP_OBJECT_IS_CLONED (object) || object->id != NULL);
@@ -434,6 +449,12 @@ sp_object_private_set (SPObject *object, unsigned int key, const gchar *value)
 		} else {
 			g_warning ("ID of cloned object changed, so document is out of sync");
 		}
+		sheet = sp_document_get_stylesheet (object->document);
+		if (sheet) sp_object_restyle (object, sp_stylesheet_has_descendant_rules (sheet));
+		break;
+	case SP_ATTR_CLASS:
+		sheet = sp_document_get_stylesheet (object->document);
+		if (sheet) sp_object_restyle (object, sp_stylesheet_has_descendant_rules (sheet));
 		break;
 	case SP_ATTR_XML_SPACE:
 		if (value && !strcmp (value, "preserve")) {
@@ -483,12 +504,79 @@ sp_object_read_attr (SPObject *object, const gchar *key)
 	if (keyid != SP_ATTR_INVALID) {
 		const gchar *value;
 		/* Retrieve the 'key' attribute from the object's XML representation */
-		value = sp_repr_attr (object->repr, key);
+		/* Typed values without string form come as NULL, classes storing */
+		/* such values (SPPath) read them with sp_repr_attr_typed */
+		value = sp_repr_attr_quark_lazy (object->repr, sp_attribute_quark (keyid));
 
 		sp_object_set (object, keyid, value);
 	}
 }
 
+/* Styling */
+
+static void
+sp_object_restyle_one (SPObject *object, gpointer data)
+{
+	object->css_generation = 0;
+	/* Objects keeping style reread it together with stylesheet rules */
+	if (object->style) sp_object_read_attr (object, "style");
+}
+
+void
+sp_object_restyle (SPObject *object, unsigned int deep)
+{
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (SP_IS_OBJECT (object));
+
+	if (deep) {
+		sp_object_invoke_forall (object, sp_object_restyle_one, NULL);
+	} else {
+		sp_object_restyle_one (object, NULL);
+	}
+}
+
+static void
+sp_object_compute_style (SPObject *object)
+{
+	SPStyle *style;
+
+	style = sp_style_compute (object->declared, (object->parent) ? object->parent->style : NULL, object);
+	if (object->style) sp_style_unref (object->style);
+	object->style = style;
+}
+
+void
+sp_object_read_style (SPObject *object)
+{
+	SPStyle *declared;
+
+	g_return_if_fail (object != NULL);
+	g_return_if_fail (SP_IS_OBJECT (object));
+
+	declared = sp_style_declare (object);
+	if (object->declared) sp_style_unref (object->declared);
+	object->declared = declared;
+
+	sp_object_compute_style (object);
+}
+
+SPStyle *
+sp_object_style_private (SPObject *object)
+{
+	g_return_val_if_fail (object != NULL, NULL);
+	g_return_val_if_fail (SP_IS_OBJECT (object), NULL);
+	g_return_val_if_fail (object->style != NULL, NULL);
+
+	if (SP_STYLE_IS_SHARED (object->style)) {
+		SPStyle *style;
+		style = sp_style_duplicate (object->style, object);
+		sp_style_unref (object->style);
+		object->style = style;
+	}
+
+	return object->style;
+}
+
 static unsigned int
 sp_object_repr_change_attr (SPRepr *repr, const gchar *key, const gchar *oldval, const gchar *newval, gpointer data)
 {
@@ -638,6 +726,8 @@ sp_object_request_update (SPObject *object, unsigned int flags)
 void
 sp_object_invoke_update (SPObject *object, SPCtx *ctx, unsigned int flags)
 {
+	double trace = 0.0;
+
 	g_return_if_fail (object != NULL);
 	g_return_if_fail (SP_IS_OBJECT (object));
 	g_return_if_fail (!(flags & ~SP_OBJECT_MODIFIED_CASCADE));
@@ -658,15 +748,17 @@ sp_object_invoke_update (SPObject *object, SPCtx *ctx, unsigned int flags)
 	/* We are currently assuming, that style parsing is done immediately */
 	/* I think this is correct (Lauris) */
 	if ((flags & SP_OBJECT_STYLE_MODIFIED_FLAG) && (flags & SP_OBJECT_PARENT_MODIFIED_FLAG)) {
-		if (object->style && object->parent) {
-			sp_style_merge_from_parent (object->style, object->parent->style);
+		if (object->declared) {
+			sp_object_compute_style (object);
 		}
 		/* attribute */
 		sp_object_read_attr (object, "xml:space");
 	}
 
+	NR_TRACE_BEGIN (trace, "object-update");
 	if (((SPObjectClass *) G_OBJECT_GET_CLASS (object))->update)
 		((SPObjectClass *) G_OBJECT_GET_CLASS (object))->update (object, ctx, flags);
+	NR_TRACE_END (trace, "object-update");
 }
 
 void
@@ -714,6 +806,8 @@ sp_object_invoke_modified (SPObject *object, unsigned int flags)
 
 	g_object_ref (G_OBJECT (object));
 	g_signal_emit (G_OBJECT (object), object_signals[MODIFIED], 0, flags);
+	/* Delivered to batch observers once cascade is finished */
+	if (object->document) sp_document_batch_add (object->document, object, flags);
 	g_object_unref (G_OBJECT (object));
 
 #if 0
@@ -124,7 +124,13 @@ struct _SPObject {
 	SPObject *next; /* Next object in linked list */
 	SPRepr *repr; /* Our xml representation */
 	gchar *id; /* Our very own unique id */
+	/* Computed style, shared between objects unless made private */
 	SPStyle *style;
+	/* Declared style computed one is merged from */
+	SPStyle *declared;
+	/* Declarations of matching stylesheet rules, valid for css_generation */
+	gchar *css;
+	unsigned int css_generation;
 };
 
 struct _SPObjectClass {
@@ -187,6 +193,12 @@ void sp_object_set (SPObject *object, unsigned int key, const gchar *value);
 void sp_object_read_attr (SPObject *object, const gchar *key);
 
 /* Styling */
+/* Rereads style after stylesheet or class change, deep includes descendants */
+void sp_object_restyle (SPObject *object, unsigned int deep);
+/* Rereads declared style and computes style from it */
+void sp_object_read_style (SPObject *object);
+/* Returns style that can be changed, copying shared one */
+SPStyle *sp_object_style_private (SPObject *object);
 
 /* Modification */
 void sp_object_request_update (SPObject *object, unsigned int flags);
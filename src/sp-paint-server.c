@@ -138,6 +138,21 @@ sp_paint_server_painter_free (SPPaintServer *ps, SPPainter *painter)
 	g_assert_not_reached ();
 }
 
+/* Half transparent grey for servers without better idea */
+#define SP_PAINT_SERVER_DEFAULT_AVERAGE 0x7f7f7f7f
+
+guint32
+sp_paint_server_get_average (SPPaintServer *ps)
+{
+	g_return_val_if_fail (ps != NULL, SP_PAINT_SERVER_DEFAULT_AVERAGE);
+	g_return_val_if_fail (SP_IS_PAINT_SERVER (ps), SP_PAINT_SERVER_DEFAULT_AVERAGE);
+
+	if (((SPPaintServerClass *) G_OBJECT_GET_CLASS(ps))->average)
+		return (* ((SPPaintServerClass *) G_OBJECT_GET_CLASS(ps))->average) (ps);
+
+	return SP_PAINT_SERVER_DEFAULT_AVERAGE;
+}
+
 SPPainter *
 sp_painter_free (SPPainter *painter)
 {
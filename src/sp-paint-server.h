@@ -58,6 +58,8 @@ struct _SPPaintServerClass {
 	SPPainter * (* painter_new) (SPPaintServer *ps, const gdouble *affine, const NRRectF *bbox);
 	/* Free SPPaint instance */
 	void (* painter_free) (SPPaintServer *ps, SPPainter *painter);
+	/* Average RGBA32 color, used instead of painter in draft rendering */
+	guint32 (* average) (SPPaintServer *ps);
 };
 
 GType sp_paint_server_get_type (void);
@@ -66,6 +68,8 @@ SPPainter *sp_paint_server_painter_new (SPPaintServer *ps, const gdouble *affine
 
 SPPainter *sp_painter_free (SPPainter *painter);
 
+guint32 sp_paint_server_get_average (SPPaintServer *ps);
+
 G_END_DECLS
 
 #endif
@@ -14,6 +14,7 @@
 
 #include <string.h>
 
+#include <libart_lgpl/art_misc.h>
 #include <libnr/nr-path.h>
 #include <libnr/nr-values.h>
 #include <libnr/nr-macros.h>
@@ -37,8 +38,19 @@ static void sp_path_set (SPObject *object, unsigned int key, const gchar *value)
 static SPRepr *sp_path_write (SPObject *object, SPRepr *repr, guint flags);
 static void sp_path_write_transform (SPItem *item, SPRepr *repr, NRMatrixF *transform);
 
+static gchar *sp_path_curve_to_string (const void *data);
+static void sp_path_curve_free (void *data);
+static size_t sp_path_curve_size (const void *data);
+
 static SPShapeClass *parent_class;
 
+const SPReprValueType sp_path_curve_value_type = {
+	"SPCurve",
+	sp_path_curve_to_string,
+	sp_path_curve_free,
+	sp_path_curve_size
+};
+
 /**
  * Gets the GType object for SPPathClass
  */
@@ -179,13 +191,18 @@ static void
 sp_path_set (SPObject *object, unsigned int key, const gchar *value)
 {
 	SPPath *path;
+	const SPCurve *typed;
 	int marker_type;
 
 	path = (SPPath *) object;
 
 	switch (key) {
 	case SP_ATTR_D:
-		if (value) {
+		typed = (object->repr) ? sp_repr_attr_typed (object->repr, "d", &sp_path_curve_value_type) : NULL;
+		if (typed) {
+			/* Typed curve is immutable, so shape can share it */
+			sp_shape_set_curve ((SPShape *) path, (SPCurve *) typed, TRUE);
+		} else if (value) {
 			ArtBpath *bpath;
 			SPCurve *curve;
 			bpath = sp_svg_read_path (value);
@@ -272,13 +289,14 @@ sp_path_write_transform (SPItem *item, SPRepr *repr, NRMatrixF *transform)
 		if (!NR_DF_TEST_CLOSE (ex, 1.0, NR_EPSILON_D)) {
 			gchar *str;
 			/* Scale changed, so we have to adjust stroke width */
+			style = sp_object_style_private (SP_OBJECT (item));
 			style->stroke_width.computed *= ex;
 			if (style->stroke_dash.n_dash != 0) {
 				int i;
 				for (i = 0; i < style->stroke_dash.n_dash; i++) style->stroke_dash.dash[i] *= ex;
 				style->stroke_dash.offset *= ex;
 			}
-			str = sp_style_write_difference (style, SP_OBJECT_STYLE (SP_OBJECT_PARENT (item)));
+			str = sp_style_write_object_difference (style, SP_OBJECT (item));
 			sp_repr_set_attr (repr, "style", str);
 			g_free (str);
 		}
@@ -286,3 +304,55 @@ sp_path_write_transform (SPItem *item, SPRepr *repr, NRMatrixF *transform)
 	sp_repr_set_attr (repr, "transform", NULL);
 }
 
+static gchar *
+sp_path_curve_to_string (const void *data)
+{
+	return sp_svg_write_path (SP_CURVE_BPATH (data));
+}
+
+static void
+sp_path_curve_free (void *data)
+{
+	sp_curve_unref ((SPCurve *) data);
+}
+
+static size_t
+sp_path_curve_size (const void *data)
+{
+	return (SP_CURVE_LENGTH (data) + 1) * sizeof (ArtBpath);
+}
+
+/**
+ * Sets repr 'd' to copy of bpath as typed value, so readers (SPPath) get
+ * it without parsing, and string is only generated when needed (saving,
+ * XML editor)
+ */
+void
+sp_path_set_repr_bpath (SPRepr *repr, const ArtBpath *bpath)
+{
+	SPCurve *curve;
+
+	g_return_if_fail (repr != NULL);
+	g_return_if_fail (bpath != NULL);
+
+	curve = sp_curve_new_from_foreign_bpath ((ArtBpath *) bpath);
+	if (!curve) return;
+
+	curve->shared = TRUE;
+	sp_repr_set_attr_typed (repr, "d", &sp_path_curve_value_type, curve);
+}
+
+/**
+ * Attaches curve, already parsed from repr 'd' string, to repr as typed
+ * value, so path built from repr shares it instead of parsing string
+ * again.  Caller guarantees that curve is not modified any more.
+ */
+void
+sp_path_share_repr_curve (SPRepr *repr, SPCurve *curve)
+{
+	g_return_if_fail (repr != NULL);
+	g_return_if_fail (curve != NULL);
+
+	curve->shared = TRUE;
+	sp_repr_attr_attach_typed (repr, "d", &sp_path_curve_value_type, sp_curve_ref (curve));
+}
@@ -29,4 +29,11 @@ struct _SPPathClass {
 
 GType sp_path_get_type (void);
 
+/* Immutable SPCurve in repr 'd', stringified only when needed */
+extern const SPReprValueType sp_path_curve_value_type;
+
+void sp_path_set_repr_bpath (SPRepr *repr, const ArtBpath *bpath);
+/* Shares parsed curve with repr already having same 'd' string */
+void sp_path_share_repr_curve (SPRepr *repr, SPCurve *curve);
+
 #endif
@@ -466,13 +466,14 @@ sp_rect_write_transform (SPItem *item, SPRepr *repr, NRMatrixF *t)
 			gchar *str;
 			/* Scale changed, so we have to adjust stroke width */
 			scale = sqrt (fabs (sw * sh));
+			style = sp_object_style_private (SP_OBJECT (item));
 			style->stroke_width.computed *= scale;
 			if (style->stroke_dash.n_dash != 0) {
 				int i;
 				for (i = 0; i < style->stroke_dash.n_dash; i++) style->stroke_dash.dash[i] *= scale;
 				style->stroke_dash.offset *= scale;
 			}
-			str = sp_style_write_difference (style, SP_OBJECT_STYLE (SP_OBJECT_PARENT (item)));
+			str = sp_style_write_object_difference (style, SP_OBJECT (item));
 			sp_repr_set_attr (SP_OBJECT_REPR (item), "style", str);
 			g_free (str);
 		}
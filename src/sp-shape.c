@@ -223,6 +223,8 @@ sp_shape_update (SPObject *object, SPCtx *ctx, unsigned int flags)
 			double aw;
 			ictx = (SPItemCtx *) ctx;
 			aw = 1.0 / NR_MATRIX_DF_EXPANSION (&ictx->i2vp);
+			/* Width depends on viewport, so it cannot stay shared */
+			style = sp_object_style_private (object);
 			style->stroke_width.computed = style->stroke_width.value * aw;
 			for (v = ((SPItem *) (shape))->display; v != NULL; v = v->next) {
 				nr_arena_shape_set_style ((NRArenaShape *) v->arenaitem, style);
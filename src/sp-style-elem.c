@@ -0,0 +1,205 @@
+#define __SP_STYLE_ELEM_C__
+
+/*
+ * SVG <style> implementation
+ *
+ * Text of all <style> elements is given to document stylesheet, which
+ * is rebuilt whenever some of them changes.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <string.h>
+
+#include "xml/repr-private.h"
+#include "document.h"
+#include "sp-style-elem.h"
+
+static void sp_style_elem_class_init (SPStyleElemClass *klass);
+static void sp_style_elem_init (SPStyleElem *elem);
+
+static void sp_style_elem_build (SPObject *object, SPDocument *document, SPRepr *repr);
+static void sp_style_elem_release (SPObject *object);
+static void sp_style_elem_child_added (SPObject *object, SPRepr *child, SPRepr *ref);
+static void sp_style_elem_remove_child (SPObject *object, SPRepr *child);
+
+static void sp_style_elem_read_text (SPStyleElem *elem, SPRepr *removed);
+static void sp_style_elem_text_changed (SPRepr *repr, const gchar *oldcontent, const gchar *newcontent, gpointer data);
+
+static SPReprEventVector text_event_vector = {
+	NULL, /* Destroy */
+	NULL, /* Add child */
+	NULL, /* Child added */
+	NULL, /* Remove child */
+	NULL, /* Child removed */
+	NULL, /* Change attr */
+	NULL, /* Attr changed */
+	NULL, /* Change content */
+	sp_style_elem_text_changed,
+	NULL, /* Change order */
+	NULL /* Order changed */
+};
+
+static SPObjectClass *parent_class;
+
+GType
+sp_style_elem_get_type (void)
+{
+	static GType type = 0;
+	if (!type) {
+		GTypeInfo info = {
+			sizeof (SPStyleElemClass),
+			NULL,	/* base_init */
+			NULL,	/* base_finalize */
+			(GClassInitFunc) sp_style_elem_class_init,
+			NULL,	/* class_finalize */
+			NULL,	/* class_data */
+			sizeof (SPStyleElem),
+			4,	/* n_preallocs */
+			(GInstanceInitFunc) sp_style_elem_init,
+		};
+		type = g_type_register_static (SP_TYPE_OBJECT, "SPStyleElem", &info, (GTypeFlags)0);
+	}
+	return type;
+}
+
+static void
+sp_style_elem_class_init (SPStyleElemClass *klass)
+{
+	SPObjectClass *sp_object_class;
+
+	sp_object_class = (SPObjectClass *) klass;
+
+	parent_class = (SPObjectClass *) g_type_class_ref (SP_TYPE_OBJECT);
+
+	sp_object_class->build = sp_style_elem_build;
+	sp_object_class->release = sp_style_elem_release;
+	sp_object_class->child_added = sp_style_elem_child_added;
+	sp_object_class->remove_child = sp_style_elem_remove_child;
+}
+
+static void
+sp_style_elem_init (SPStyleElem *elem)
+{
+	elem->text = NULL;
+}
+
+static void
+sp_style_elem_build (SPObject *object, SPDocument *document, SPRepr *repr)
+{
+	SPStyleElem *elem;
+	SPRepr *child;
+
+	elem = SP_STYLE_ELEM (object);
+
+	if (((SPObjectClass *) parent_class)->build)
+		((SPObjectClass *) parent_class)->build (object, document, repr);
+
+	for (child = repr->children; child != NULL; child = child->next) {
+		if (SP_REPR_TYPE (child) == SP_XML_TEXT_NODE) {
+			sp_repr_add_listener (child, &text_event_vector, object);
+		}
+	}
+
+	sp_style_elem_read_text (elem, NULL);
+
+	sp_document_add_resource (document, "style", object);
+	sp_document_stylesheet_changed (document);
+}
+
+static void
+sp_style_elem_release (SPObject *object)
+{
+	SPStyleElem *elem;
+	SPRepr *child;
+
+	elem = SP_STYLE_ELEM (object);
+
+	for (child = object->repr->children; child != NULL; child = child->next) {
+		sp_repr_remove_listener_by_data (child, object);
+	}
+
+	if (SP_OBJECT_DOCUMENT (object)) {
+		sp_document_remove_resource (SP_OBJECT_DOCUMENT (object), "style", object);
+		sp_document_stylesheet_changed (SP_OBJECT_DOCUMENT (object));
+	}
+
+	g_free (elem->text);
+	elem->text = NULL;
+
+	if (((SPObjectClass *) parent_class)->release)
+		((SPObjectClass *) parent_class)->release (object);
+}
+
+static void
+sp_style_elem_child_added (SPObject *object, SPRepr *child, SPRepr *ref)
+{
+	if (((SPObjectClass *) parent_class)->child_added)
+		((SPObjectClass *) parent_class)->child_added (object, child, ref);
+
+	if (SP_REPR_TYPE (child) == SP_XML_TEXT_NODE) {
+		sp_repr_add_listener (child, &text_event_vector, object);
+		sp_style_elem_read_text (SP_STYLE_ELEM (object), NULL);
+		sp_document_stylesheet_changed (SP_OBJECT_DOCUMENT (object));
+	}
+}
+
+static void
+sp_style_elem_remove_child (SPObject *object, SPRepr *child)
+{
+	if (((SPObjectClass *) parent_class)->remove_child)
+		((SPObjectClass *) parent_class)->remove_child (object, child);
+
+	if (SP_REPR_TYPE (child) == SP_XML_TEXT_NODE) {
+		sp_repr_remove_listener_by_data (child, object);
+		/* Child is still there, so it has to be skipped explicitly */
+		sp_style_elem_read_text (SP_STYLE_ELEM (object), child);
+		sp_document_stylesheet_changed (SP_OBJECT_DOCUMENT (object));
+	}
+}
+
+static void
+sp_style_elem_read_text (SPStyleElem *elem, SPRepr *removed)
+{
+	const gchar *type;
+	GString *str;
+	SPRepr *child;
+
+	g_free (elem->text);
+	elem->text = NULL;
+
+	/* Only CSS is understood; missing type means CSS too */
+	type = sp_repr_attr (SP_OBJECT_REPR (elem), "type");
+	if (type && strcmp (type, "text/css")) return;
+
+	str = g_string_new ("");
+	for (child = SP_OBJECT_REPR (elem)->children; child != NULL; child = child->next) {
+		if ((child != removed) && (SP_REPR_TYPE (child) == SP_XML_TEXT_NODE) && child->content) {
+			g_string_append (str, child->content);
+			g_string_append_c (str, '\n');
+		}
+	}
+
+	elem->text = str->str;
+	g_string_free (str, FALSE);
+}
+
+static void
+sp_style_elem_text_changed (SPRepr *repr, const gchar *oldcontent, const gchar *newcontent, gpointer data)
+{
+	SPObject *object;
+
+	object = SP_OBJECT (data);
+
+	sp_style_elem_read_text (SP_STYLE_ELEM (object), NULL);
+	sp_document_stylesheet_changed (SP_OBJECT_DOCUMENT (object));
+}
+
+const gchar *
+sp_style_elem_get_text (SPStyleElem *elem)
+{
+	g_return_val_if_fail (elem != NULL, NULL);
+	g_return_val_if_fail (SP_IS_STYLE_ELEM (elem), NULL);
+
+	return elem->text;
+}
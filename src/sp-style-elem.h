@@ -0,0 +1,32 @@
+#ifndef __SP_STYLE_ELEM_H__
+#define __SP_STYLE_ELEM_H__
+
+/*
+ * SVG <style> implementation
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include "sp-object.h"
+
+#define SP_TYPE_STYLE_ELEM            (sp_style_elem_get_type ())
+#define SP_STYLE_ELEM(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SP_TYPE_STYLE_ELEM, SPStyleElem))
+#define SP_STYLE_ELEM_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), SP_TYPE_STYLE_ELEM, SPStyleElemClass))
+#define SP_IS_STYLE_ELEM(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SP_TYPE_STYLE_ELEM))
+#define SP_IS_STYLE_ELEM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), SP_TYPE_STYLE_ELEM))
+
+struct _SPStyleElem {
+	SPObject object;
+	/* Concatenated text children, NULL if stylesheet is not CSS */
+	gchar *text;
+};
+
+struct _SPStyleElemClass {
+	SPObjectClass parent_class;
+};
+
+GType sp_style_elem_get_type (void);
+
+const gchar *sp_style_elem_get_text (SPStyleElem *elem);
+
+#endif
@@ -41,11 +41,21 @@
 #define SP_STYLE_FLAG_IFSET (1 << 0)
 #define SP_STYLE_FLAG_IFDIFF (1 << 1)
 
+/* Longer style strings are parsed directly and never cached */
+#define SP_STYLE_DECL_MAX_LENGTH 1024
+#define SP_STYLE_DECL_CACHE_SIZE 4096
+
 typedef struct _SPStyleEnum SPStyleEnum;
+typedef struct _SPStyleDecl SPStyleDecl;
 
 static void sp_style_clear (SPStyle *style);
 
-static void sp_style_merge_from_style_string (SPStyle *style, const gchar *p);
+static SPStyleDecl *sp_style_decl_lookup (const gchar *str);
+static void sp_style_merge_from_decl (SPStyle *style, const SPStyleDecl *decl, SPDocument *document);
+static void sp_style_merge_from_string (SPStyle *style, const gchar *str, SPDocument *document);
+static const gchar *sp_style_object_css (SPObject *object);
+
+static void sp_style_merge_from_style_string (SPStyle *style, const gchar *p, SPStyleDecl *decl);
 static void sp_style_merge_property (SPStyle *style, gint id, const gchar *val);
 
 static void sp_style_merge_ipaint (SPStyle *style, SPIPaint *paint, SPIPaint *parent);
@@ -102,6 +112,25 @@ struct _SPStyleEnum {
 	gint value;
 };
 
+/*
+ * Parsed style attribute.  Declarations are merged into otherwise cleared
+ * style, which is copied into every style using the same string.  Paint
+ * server references depend on document, so these are kept as strings and
+ * resolved for each object.
+ */
+
+struct _SPStyleDecl {
+	gchar *key;
+	SPStyle *style;
+	gchar *fill_url;
+	gchar *stroke_url;
+};
+
+static GHashTable *decl_cache = NULL;
+static GHashTable *declared_table = NULL;
+static GHashTable *computed_table = NULL;
+static SPStyleCacheStats cache_stats = {0, 0, 0, 0, 0, 0, 0};
+
 static const SPStyleEnum enum_fill_rule[] = {
 	{"nonzero", SP_WIND_RULE_NONZERO},
 	{"evenodd", SP_WIND_RULE_EVENODD},
@@ -256,12 +285,28 @@ sp_style_unref (SPStyle *style)
 	style->refcount -= 1;
 
 	if (style->refcount < 1) {
+		int i;
+		if (style->shared) {
+			/* Table entry has to go before anything it is hashed by */
+			if (style->source) {
+				g_hash_table_remove (computed_table, style);
+				sp_style_unref (style->source);
+				if (style->source_parent) sp_style_unref (style->source_parent);
+				cache_stats.shared -= 1;
+			} else {
+				g_hash_table_remove (declared_table, style);
+				cache_stats.declared -= 1;
+			}
+		}
 /* 		if (style->object) gtk_signal_disconnect_by_data (GTK_OBJECT (style->object), style); */
 		if (style->object) g_signal_handlers_disconnect_matched (G_OBJECT(style->object), G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, style);
 		if (style->text) sp_text_style_unref (style->text);
 		sp_style_paint_clear (style, &style->fill, TRUE, FALSE);
 		sp_style_paint_clear (style, &style->stroke, TRUE, FALSE);
 		g_free (style->stroke_dash.dash);
+		for (i = SP_MARKER_LOC; i < SP_MARKER_LOC_QTY; i++) {
+			g_free (style->marker[i].value);
+		}
 		g_free (style);
 	}
 
@@ -274,7 +319,7 @@ sp_style_unref (SPStyle *style)
 static void
 sp_style_read (SPStyle *style, SPObject *object, SPRepr *repr)
 {
-	const gchar *val;
+	const gchar *val, *css;
 
 	g_assert (style != NULL);
 	g_assert (repr != NULL);
@@ -283,9 +328,16 @@ sp_style_read (SPStyle *style, SPObject *object, SPRepr *repr)
 	sp_style_clear (style);
 
 	/* 1. Style itself */
-	val = sp_repr_attr (repr, "style");
-	if (val != NULL) {
-		sp_style_merge_from_style_string (style, val);
+	val = sp_repr_attr_quark (repr, sp_attribute_quark (SP_ATTR_STYLE));
+	css = (object) ? sp_style_object_css (object) : NULL;
+	if (css) {
+		gchar *str;
+		/* First declaration wins, so rules go after style attribute */
+		str = (val) ? g_strconcat (val, ";", css, NULL) : NULL;
+		sp_style_merge_from_string (style, (str) ? str : css, SP_OBJECT_DOCUMENT (object));
+		g_free (str);
+	} else if (val != NULL) {
+		sp_style_merge_from_string (style, val, (object) ? SP_OBJECT_DOCUMENT (object) : NULL);
 	}
 
 	/* 2. Presentation-only attributes */
@@ -317,8 +369,7 @@ sp_style_read (SPStyle *style, SPObject *object, SPRepr *repr)
 		}
 	}
 
-	/* fixme: CSS etc. parsing goes here */
-	/* 3. Other styling methods */
+	/* 3. Stylesheet rules were merged together with style attribute */
 
 	/* 4. Presentation attributes */
 	/* CSS2 */
@@ -425,21 +476,7 @@ sp_style_read (SPStyle *style, SPObject *object, SPRepr *repr)
 	SPS_READ_PENUM_IF_UNSET (&style->text_anchor, repr, "text-anchor", enum_text_anchor, TRUE);
 	SPS_READ_PENUM_IF_UNSET (&style->writing_mode, repr, "writing-mode", enum_writing_mode, TRUE);
 
-	/* 5. Merge from parent */
-	if (object) {
-		if (object->parent) {
-			sp_style_merge_from_parent (style, SP_OBJECT_STYLE (object->parent));
-		}
-	} else {
-		if (sp_repr_parent (repr)) {
-			SPStyle *parent;
-			/* fixme: This is not the prettiest thing (Lauris) */
-			parent = sp_style_new ();
-			sp_style_read (parent, NULL, sp_repr_parent (repr));
-			sp_style_merge_from_parent (style, parent);
-			sp_style_unref (parent);
-		}
-	}
+	/* 5. Parent style is merged by caller */
 }
 
 void
@@ -450,6 +487,9 @@ sp_style_read_from_object (SPStyle *style, SPObject *object)
 	g_return_if_fail (SP_IS_OBJECT (object));
 
 	sp_style_read (style, object, SP_OBJECT_REPR (object));
+	if (object->parent) {
+		sp_style_merge_from_parent (style, SP_OBJECT_STYLE (object->parent));
+	}
 }
 
 void
@@ -459,6 +499,14 @@ sp_style_read_from_repr (SPStyle *style, SPRepr *repr)
 	g_return_if_fail (repr != NULL);
 
 	sp_style_read (style, NULL, repr);
+	if (sp_repr_parent (repr)) {
+		SPStyle *parent;
+		/* fixme: This is not the prettiest thing (Lauris) */
+		parent = sp_style_new ();
+		sp_style_read_from_repr (parent, sp_repr_parent (repr));
+		sp_style_merge_from_parent (style, parent);
+		sp_style_unref (parent);
+	}
 }
 
 static void
@@ -762,10 +810,11 @@ sp_style_merge_property (SPStyle *style, gint id, const gchar *val)
 
 /*
  * Parses style="fill:red;fill-rule:evenodd;" type string
+ * If decl is given, paint server references are stored there unresolved
  */
 
 static void
-sp_style_merge_from_style_string (SPStyle *style, const gchar *p)
+sp_style_merge_from_style_string (SPStyle *style, const gchar *p, SPStyleDecl *decl)
 {
 	gchar c[BMAX];
 
@@ -798,7 +847,13 @@ sp_style_merge_from_style_string (SPStyle *style, const gchar *p)
 			len = MIN (e - s - 1, 4095);
 			if (len > 0) memcpy (c, s + 1, len);
 			c[len] = '\0';
-			sp_style_merge_property (style, idx, c);
+			if (decl && (idx == SP_PROP_FILL) && !strncmp (c, "url", 3)) {
+				if (!style->fill.set && !decl->fill_url) decl->fill_url = g_strdup (c);
+			} else if (decl && (idx == SP_PROP_STROKE) && !strncmp (c, "url", 3)) {
+				if (!style->stroke.set && !decl->stroke_url) decl->stroke_url = g_strdup (c);
+			} else {
+				sp_style_merge_property (style, idx, c);
+			}
 		} else {
 			g_warning ("Unknown style property at: %s", p);
 		}
@@ -807,6 +862,157 @@ sp_style_merge_from_style_string (SPStyle *style, const gchar *p)
 	}
 }
 
+static void
+sp_style_decl_free (SPStyleDecl *decl)
+{
+	sp_style_unref (decl->style);
+	g_free (decl->fill_url);
+	g_free (decl->stroke_url);
+	g_free (decl->key);
+	g_free (decl);
+}
+
+static gboolean
+sp_style_decl_remove (gpointer key, gpointer value, gpointer data)
+{
+	sp_style_decl_free ((SPStyleDecl *) value);
+
+	return TRUE;
+}
+
+/*
+ * Returns parsed declarations of style string, parsing it only on first use
+ */
+
+static SPStyleDecl *
+sp_style_decl_lookup (const gchar *str)
+{
+	SPStyleDecl *decl;
+
+	if (!decl_cache) decl_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+	cache_stats.decl_lookups += 1;
+
+	decl = (SPStyleDecl *) g_hash_table_lookup (decl_cache, str);
+	if (decl) {
+		cache_stats.decl_hits += 1;
+		return decl;
+	}
+
+	if (cache_stats.decls >= SP_STYLE_DECL_CACHE_SIZE) {
+		/* Declarations are copied out, so nothing refers to cache entries */
+		g_hash_table_foreach_remove (decl_cache, sp_style_decl_remove, NULL);
+		cache_stats.decls = 0;
+	}
+
+	decl = g_new0 (SPStyleDecl, 1);
+	decl->key = g_strdup (str);
+	decl->style = sp_style_new ();
+	sp_style_merge_from_style_string (decl->style, str, decl);
+
+	g_hash_table_insert (decl_cache, decl->key, decl);
+	cache_stats.decls += 1;
+
+	return decl;
+}
+
+/*
+ * Same as merging style string into freshly cleared style
+ */
+
+static void
+sp_style_merge_from_decl (SPStyle *style, const SPStyleDecl *decl, SPDocument *document)
+{
+	SPStyle *parsed;
+	SPObject *object;
+	gint refcount;
+	SPTextStyle *text;
+	unsigned int text_private;
+	int i;
+
+	parsed = decl->style;
+
+	object = style->object;
+	refcount = style->refcount;
+	text = style->text;
+	text_private = style->text_private;
+	memcpy (style, parsed, sizeof (SPStyle));
+	style->refcount = refcount;
+	style->object = object;
+	style->text = text;
+	style->text_private = text_private;
+
+	if (parsed->stroke_dash.n_dash > 0) {
+		style->stroke_dash.dash = g_new (gdouble, parsed->stroke_dash.n_dash);
+		memcpy (style->stroke_dash.dash, parsed->stroke_dash.dash, parsed->stroke_dash.n_dash * sizeof (gdouble));
+	}
+	for (i = SP_MARKER_LOC; i < SP_MARKER_LOC_QTY; i++) {
+		style->marker[i].value = g_strdup (parsed->marker[i].value);
+	}
+
+	if (parsed->text->font_family.set || parsed->text->font.set) {
+		if (!style->text_private) sp_style_privatize_text (style);
+		if (parsed->text->font_family.set) {
+			g_free (style->text->font_family.value);
+			style->text->font_family = parsed->text->font_family;
+			style->text->font_family.value = g_strdup (parsed->text->font_family.value);
+		}
+		if (parsed->text->font.set) {
+			g_free (style->text->font.value);
+			style->text->font = parsed->text->font;
+			style->text->font.value = g_strdup (parsed->text->font.value);
+		}
+	}
+
+	/* Unresolved reference leaves paint to later declaration, as in parser */
+	if (decl->fill_url) {
+		style->fill.set = FALSE;
+		sp_style_read_ipaint (&style->fill, decl->fill_url, style, document);
+		if (!style->fill.set && parsed->fill.set) style->fill = parsed->fill;
+	}
+	if (decl->stroke_url) {
+		style->stroke.set = FALSE;
+		sp_style_read_ipaint (&style->stroke, decl->stroke_url, style, document);
+		if (!style->stroke.set && parsed->stroke.set) style->stroke = parsed->stroke;
+	}
+}
+
+/*
+ * Merges style string, using parsed declarations cache if possible
+ */
+
+static void
+sp_style_merge_from_string (SPStyle *style, const gchar *str, SPDocument *document)
+{
+	if (strlen (str) < SP_STYLE_DECL_MAX_LENGTH) {
+		sp_style_merge_from_decl (style, sp_style_decl_lookup (str), document);
+	} else {
+		sp_style_merge_from_style_string (style, str, NULL);
+	}
+}
+
+/*
+ * Returns declarations of stylesheet rules matching object, recomputing
+ * them only if stylesheet or object class has changed
+ */
+
+static const gchar *
+sp_style_object_css (SPObject *object)
+{
+	SPStyleSheet *sheet;
+
+	sheet = sp_document_get_stylesheet (SP_OBJECT_DOCUMENT (object));
+	if (!sheet) return NULL;
+
+	if (object->css_generation != sp_stylesheet_get_generation (sheet)) {
+		g_free (object->css);
+		object->css = sp_stylesheet_cascade (sheet, SP_OBJECT_REPR (object));
+		object->css_generation = sp_stylesheet_get_generation (sheet);
+	}
+
+	return object->css;
+}
+
 void
 sp_style_merge_from_parent (SPStyle *style, SPStyle *parent)
 {
@@ -1113,6 +1319,34 @@ sp_style_write_string (SPStyle *style)
 
 #define STYLE_BUF_MAX
 
+/**
+ * Writes properties of style that are not already given by stylesheet
+ * rules matching object, or inherited from its parent
+ */
+gchar *
+sp_style_write_object_difference (SPStyle *style, SPObject *object)
+{
+	SPStyle *base;
+	const gchar *css;
+	gchar *str;
+
+	g_return_val_if_fail (style != NULL, NULL);
+	g_return_val_if_fail (object != NULL, NULL);
+	g_return_val_if_fail (SP_IS_OBJECT (object), NULL);
+	g_return_val_if_fail (SP_OBJECT_PARENT (object) != NULL, NULL);
+
+	css = sp_style_object_css (object);
+	if (!css) return sp_style_write_difference (style, SP_OBJECT_STYLE (SP_OBJECT_PARENT (object)));
+
+	base = sp_style_new ();
+	sp_style_merge_from_string (base, css, SP_OBJECT_DOCUMENT (object));
+	sp_style_merge_from_parent (base, SP_OBJECT_STYLE (SP_OBJECT_PARENT (object)));
+	str = sp_style_write_difference (style, base);
+	sp_style_unref (base);
+
+	return str;
+}
+
 gchar *
 sp_style_write_difference (SPStyle *from, SPStyle *to)
 {
@@ -1390,6 +1624,266 @@ sp_style_set_opacity (SPStyle *style, gfloat opacity, unsigned int opacity_set)
 	}
 }
 
+/* Shared styles */
+
+static unsigned int
+sp_style_str_equal (const gchar *a, const gchar *b)
+{
+	return (a == b) || (a && b && !strcmp (a, b));
+}
+
+/*
+ * Copies style without refcount, owner and pointers, so the rest can be
+ * compared bytewise; styles are always allocated zeroed and cleared with
+ * memset, so padding compares equal too
+ */
+
+static void
+sp_style_share_normalize (SPStyle *dst, SPTextStyle *dtext, const SPStyle *src)
+{
+	int i;
+
+	memcpy (dst, src, sizeof (SPStyle));
+	dst->refcount = 0;
+	dst->object = NULL;
+	dst->text = NULL;
+	dst->text_private = FALSE;
+	dst->shared = FALSE;
+	dst->source = dst->source_parent = NULL;
+	dst->stroke_dash.dash = NULL;
+	for (i = SP_MARKER_LOC; i < SP_MARKER_LOC_QTY; i++) {
+		dst->marker[i].value = NULL;
+	}
+
+	memcpy (dtext, src->text, sizeof (SPTextStyle));
+	dtext->refcount = 0;
+	dtext->font_family.value = NULL;
+	dtext->font.value = NULL;
+}
+
+static guint
+sp_style_share_hash (gconstpointer key)
+{
+	const SPStyle *style;
+	SPStyle norm;
+	SPTextStyle ntext;
+	const guchar *p;
+	guint hash;
+	size_t i;
+	int m;
+
+	style = (const SPStyle *) key;
+	sp_style_share_normalize (&norm, &ntext, style);
+
+	hash = 0;
+	p = (const guchar *) &norm;
+	for (i = 0; i < sizeof (SPStyle); i++) hash = (hash << 5) - hash + p[i];
+	p = (const guchar *) &ntext;
+	for (i = 0; i < sizeof (SPTextStyle); i++) hash = (hash << 5) - hash + p[i];
+	if (style->stroke_dash.n_dash > 0) {
+		p = (const guchar *) style->stroke_dash.dash;
+		for (i = 0; i < style->stroke_dash.n_dash * sizeof (gdouble); i++) hash = (hash << 5) - hash + p[i];
+	}
+	for (m = SP_MARKER_LOC; m < SP_MARKER_LOC_QTY; m++) {
+		if (style->marker[m].value) hash ^= g_str_hash (style->marker[m].value);
+	}
+	if (style->text->font_family.value) hash ^= g_str_hash (style->text->font_family.value);
+
+	return hash;
+}
+
+static gboolean
+sp_style_share_equal (gconstpointer a, gconstpointer b)
+{
+	const SPStyle *sa, *sb;
+	SPStyle na, nb;
+	SPTextStyle ta, tb;
+	int i;
+
+	sa = (const SPStyle *) a;
+	sb = (const SPStyle *) b;
+
+	sp_style_share_normalize (&na, &ta, sa);
+	sp_style_share_normalize (&nb, &tb, sb);
+	if (memcmp (&na, &nb, sizeof (SPStyle))) return FALSE;
+	if (memcmp (&ta, &tb, sizeof (SPTextStyle))) return FALSE;
+
+	if ((sa->stroke_dash.n_dash > 0) &&
+	    memcmp (sa->stroke_dash.dash, sb->stroke_dash.dash, sa->stroke_dash.n_dash * sizeof (gdouble))) return FALSE;
+	for (i = SP_MARKER_LOC; i < SP_MARKER_LOC_QTY; i++) {
+		if (!sp_style_str_equal (sa->marker[i].value, sb->marker[i].value)) return FALSE;
+	}
+	if (!sp_style_str_equal (sa->text->font_family.value, sb->text->font_family.value)) return FALSE;
+	if (!sp_style_str_equal (sa->text->font.value, sb->text->font.value)) return FALSE;
+
+	return TRUE;
+}
+
+/* Computed styles are keyed by the styles they were computed from */
+
+static guint
+sp_style_computed_hash (gconstpointer key)
+{
+	const SPStyle *style;
+
+	style = (const SPStyle *) key;
+
+	return GPOINTER_TO_UINT (style->source) * 31 + GPOINTER_TO_UINT (style->source_parent);
+}
+
+static gboolean
+sp_style_computed_equal (gconstpointer a, gconstpointer b)
+{
+	const SPStyle *sa, *sb;
+
+	sa = (const SPStyle *) a;
+	sb = (const SPStyle *) b;
+
+	return (sa->source == sb->source) && (sa->source_parent == sb->source_parent);
+}
+
+static unsigned int
+sp_style_has_paint_server (const SPStyle *style)
+{
+	return (style->fill.type == SP_PAINT_TYPE_PAINTSERVER) || (style->stroke.type == SP_PAINT_TYPE_PAINTSERVER);
+}
+
+/**
+ * Returns new private copy of style, owned by object if given
+ */
+SPStyle *
+sp_style_duplicate (SPStyle *style, SPObject *object)
+{
+	SPStyle *copy;
+	int i;
+
+	g_return_val_if_fail (style != NULL, NULL);
+
+	copy = g_new (SPStyle, 1);
+	memcpy (copy, style, sizeof (SPStyle));
+	copy->refcount = 1;
+	copy->object = NULL;
+	copy->shared = FALSE;
+	copy->source = copy->source_parent = NULL;
+
+	copy->text = g_new (SPTextStyle, 1);
+	memcpy (copy->text, style->text, sizeof (SPTextStyle));
+	copy->text->refcount = 1;
+	copy->text->font_family.value = g_strdup (style->text->font_family.value);
+	copy->text->font.value = g_strdup (style->text->font.value);
+	copy->text_private = TRUE;
+
+	if (style->stroke_dash.n_dash > 0) {
+		copy->stroke_dash.dash = g_new (gdouble, style->stroke_dash.n_dash);
+		memcpy (copy->stroke_dash.dash, style->stroke_dash.dash, style->stroke_dash.n_dash * sizeof (gdouble));
+	} else {
+		copy->stroke_dash.dash = NULL;
+	}
+	for (i = SP_MARKER_LOC; i < SP_MARKER_LOC_QTY; i++) {
+		copy->marker[i].value = g_strdup (style->marker[i].value);
+	}
+
+	/* Paint server references and signals belong to single style */
+	copy->fill.type = SP_PAINT_TYPE_NONE;
+	sp_style_merge_ipaint (copy, &copy->fill, &style->fill);
+	copy->stroke.type = SP_PAINT_TYPE_NONE;
+	sp_style_merge_ipaint (copy, &copy->stroke, &style->stroke);
+
+	if (object) {
+		copy->object = object;
+		g_signal_connect (G_OBJECT (object), "release", G_CALLBACK (sp_style_object_release), copy);
+	}
+
+	return copy;
+}
+
+/**
+ * Returns reference to declared style of object - style attribute,
+ * stylesheet rules and presentation attributes, without inherited values.
+ * Equal declarations share one immutable style, unless they use paint
+ * servers.
+ */
+SPStyle *
+sp_style_declare (SPObject *object)
+{
+	SPStyle *style, *shared;
+
+	g_return_val_if_fail (object != NULL, NULL);
+	g_return_val_if_fail (SP_IS_OBJECT (object), NULL);
+
+	/* Object is needed for resolving paint server references */
+	style = sp_style_new_from_object (object);
+	sp_style_read (style, object, SP_OBJECT_REPR (object));
+	/* Paint servers hold signal connections to single style */
+	if (sp_style_has_paint_server (style)) return style;
+	g_signal_handlers_disconnect_matched (G_OBJECT (object), G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, style);
+	style->object = NULL;
+
+	if (!declared_table) declared_table = g_hash_table_new (sp_style_share_hash, sp_style_share_equal);
+
+	shared = (SPStyle *) g_hash_table_lookup (declared_table, style);
+	if (shared) {
+		sp_style_unref (style);
+		return sp_style_ref (shared);
+	}
+
+	style->shared = TRUE;
+	g_hash_table_insert (declared_table, style, style);
+	cache_stats.declared += 1;
+
+	return style;
+}
+
+/**
+ * Returns reference to style computed from declared and parent style.
+ * If both are shared, so is result, and objects with equal declarations
+ * under the same parent style get the same one without merging.  Other
+ * styles are computed into private style owned by object.
+ */
+SPStyle *
+sp_style_compute (SPStyle *declared, SPStyle *parent, SPObject *object)
+{
+	SPStyle *computed;
+	unsigned int shareable;
+
+	g_return_val_if_fail (declared != NULL, NULL);
+
+	shareable = declared->shared && (!parent || parent->shared);
+
+	if (shareable) {
+		SPStyle key;
+		if (!computed_table) computed_table = g_hash_table_new (sp_style_computed_hash, sp_style_computed_equal);
+		cache_stats.share_lookups += 1;
+		key.source = declared;
+		key.source_parent = parent;
+		computed = (SPStyle *) g_hash_table_lookup (computed_table, &key);
+		if (computed) {
+			cache_stats.share_hits += 1;
+			return sp_style_ref (computed);
+		}
+	}
+
+	computed = sp_style_duplicate (declared, (shareable) ? NULL : object);
+	sp_style_merge_from_parent (computed, parent);
+
+	if (shareable) {
+		/* Sources are referenced, so their addresses stay unique key */
+		computed->shared = TRUE;
+		computed->source = sp_style_ref (declared);
+		computed->source_parent = (parent) ? sp_style_ref (parent) : NULL;
+		g_hash_table_insert (computed_table, computed, computed);
+		cache_stats.shared += 1;
+	}
+
+	return computed;
+}
+
+const SPStyleCacheStats *
+sp_style_get_cache_stats (void)
+{
+	return &cache_stats;
+}
+
 /* SPTextStyle operations */
 
 static SPTextStyle *
@@ -148,6 +148,11 @@ struct _SPStyle {
 	/* Our text style component */
 	SPTextStyle *text;
 	unsigned int text_private : 1;
+	/* Immutable flyweight from sp_style_declare or sp_style_compute */
+	unsigned int shared : 1;
+	/* Declared and parent style shared computed style was made from */
+	SPStyle *source;
+	SPStyle *source_parent;
 
 	/* CSS2 */
 	/* Font */
@@ -228,6 +233,8 @@ void sp_style_merge_from_parent (SPStyle *style, SPStyle *parent);
 
 gchar *sp_style_write_string (SPStyle *style);
 gchar *sp_style_write_difference (SPStyle *from, SPStyle *to);
+/* Difference against stylesheet rules and parent style of object */
+gchar *sp_style_write_object_difference (SPStyle *style, SPObject *object);
 
 void sp_style_set_fill_color_rgba (SPStyle *style, float r, float g, float b, float a, unsigned int fill_set, unsigned int opacity_set);
 void sp_style_set_fill_color_cmyka (SPStyle *style, float c, float m, float y, float k, float a, unsigned int fill_set, unsigned int opacity_set);
@@ -236,6 +243,41 @@ void sp_style_set_stroke_color_cmyka (SPStyle *style, float c, float m, float y,
 
 void sp_style_set_opacity (SPStyle *style, float opacity, unsigned int opacity_set);
 
+/*
+ * Shared styles
+ *
+ * sp_style_declare returns reference to immutable style with the values
+ * declared for object, shared by all equal declarations.  sp_style_compute
+ * merges it with parent style, and returns the same immutable style for
+ * the same declared and parent style, so objects with equal styles hold
+ * one struct and comparing them is a pointer check.  Styles using paint
+ * servers are object-specific and returned private.  Shared styles must
+ * not be changed; sp_style_duplicate gives private copy.
+ */
+
+#define SP_STYLE_IS_SHARED(s) (((SPStyle *) (s))->shared)
+
+SPStyle *sp_style_declare (SPObject *object);
+SPStyle *sp_style_compute (SPStyle *declared, SPStyle *parent, SPObject *object);
+SPStyle *sp_style_duplicate (SPStyle *style, SPObject *object);
+
+typedef struct _SPStyleCacheStats SPStyleCacheStats;
+
+struct _SPStyleCacheStats {
+	/* Parsed style attribute declarations */
+	unsigned int decl_lookups;
+	unsigned int decl_hits;
+	unsigned int decls;
+	/* Shared declared styles */
+	unsigned int declared;
+	/* Shared computed styles */
+	unsigned int share_lookups;
+	unsigned int share_hits;
+	unsigned int shared;
+};
+
+const SPStyleCacheStats *sp_style_get_cache_stats (void);
+
 /* SPTextStyle */
 
 typedef enum {
@@ -0,0 +1,586 @@
+#define __SP_STYLESHEET_C__
+
+/*
+ * CSS stylesheet rules and selector matching
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "xml/repr-private.h"
+#include "stylesheet.h"
+
+#define SP_STYLESHEET_SPECIFICITY_ID 10000
+#define SP_STYLESHEET_SPECIFICITY_CLASS 100
+#define SP_STYLESHEET_SPECIFICITY_TYPE 1
+
+/* Classes beyond this in one class attribute are ignored */
+#define SP_STYLESHEET_MAX_CLASSES 32
+
+typedef struct _SPStyleSelector SPStyleSelector;
+typedef struct _SPStyleRule SPStyleRule;
+
+/* Compound selector, e.g. rect.red#r1 */
+struct _SPStyleSelector {
+	/* Selector some ancestor has to match, NULL if none */
+	SPStyleSelector *ancestor;
+	/* 0 matches any element */
+	GQuark type;
+	GQuark id;
+	unsigned int n_classes;
+	GQuark *classes;
+};
+
+struct _SPStyleRule {
+	SPStyleSelector *selector;
+	gchar *declarations;
+	unsigned int specificity;
+	unsigned int order;
+};
+
+struct _SPStyleSheet {
+	unsigned int generation;
+	unsigned int descendant : 1;
+	GSList *rules;
+	unsigned int n_rules;
+	/* Rules indexed by rightmost id, first class or type; GQuark to GSList */
+	GHashTable *ids;
+	GHashTable *classes;
+	GHashTable *types;
+	GSList *universal;
+};
+
+static unsigned int sheet_generation = 0;
+
+static void sp_stylesheet_selector_free (SPStyleSelector *sel);
+
+SPStyleSheet *
+sp_stylesheet_new (void)
+{
+	SPStyleSheet *sheet;
+
+	sheet = g_new0 (SPStyleSheet, 1);
+
+	sheet_generation += 1;
+	/* Zero is left for never matched elements */
+	if (!sheet_generation) sheet_generation = 1;
+	sheet->generation = sheet_generation;
+
+	sheet->ids = g_hash_table_new (NULL, NULL);
+	sheet->classes = g_hash_table_new (NULL, NULL);
+	sheet->types = g_hash_table_new (NULL, NULL);
+
+	return sheet;
+}
+
+static gboolean
+sp_stylesheet_index_free (gpointer key, gpointer value, gpointer data)
+{
+	g_slist_free ((GSList *) value);
+
+	return TRUE;
+}
+
+void
+sp_stylesheet_free (SPStyleSheet *sheet)
+{
+	GSList *l;
+
+	g_return_if_fail (sheet != NULL);
+
+	for (l = sheet->rules; l != NULL; l = l->next) {
+		SPStyleRule *rule;
+		rule = (SPStyleRule *) l->data;
+		sp_stylesheet_selector_free (rule->selector);
+		g_free (rule->declarations);
+		g_free (rule);
+	}
+	g_slist_free (sheet->rules);
+
+	g_hash_table_foreach_remove (sheet->ids, sp_stylesheet_index_free, NULL);
+	g_hash_table_destroy (sheet->ids);
+	g_hash_table_foreach_remove (sheet->classes, sp_stylesheet_index_free, NULL);
+	g_hash_table_destroy (sheet->classes);
+	g_hash_table_foreach_remove (sheet->types, sp_stylesheet_index_free, NULL);
+	g_hash_table_destroy (sheet->types);
+	g_slist_free (sheet->universal);
+
+	g_free (sheet);
+}
+
+unsigned int
+sp_stylesheet_n_rules (const SPStyleSheet *sheet)
+{
+	g_return_val_if_fail (sheet != NULL, 0);
+
+	return sheet->n_rules;
+}
+
+unsigned int
+sp_stylesheet_has_descendant_rules (const SPStyleSheet *sheet)
+{
+	g_return_val_if_fail (sheet != NULL, FALSE);
+
+	return sheet->descendant;
+}
+
+unsigned int
+sp_stylesheet_get_generation (const SPStyleSheet *sheet)
+{
+	g_return_val_if_fail (sheet != NULL, 0);
+
+	return sheet->generation;
+}
+
+/* Parsing */
+
+static void
+sp_stylesheet_selector_free (SPStyleSelector *sel)
+{
+	while (sel) {
+		SPStyleSelector *ancestor;
+		ancestor = sel->ancestor;
+		g_free (sel->classes);
+		g_free (sel);
+		sel = ancestor;
+	}
+}
+
+static unsigned int
+sp_stylesheet_is_name_char (gchar c)
+{
+	return isalnum ((unsigned char) c) || (c == '-') || (c == '_') || ((unsigned char) c >= 0x80);
+}
+
+/*
+ * Parses compound selector between s and e; returns NULL if it uses
+ * anything not supported (attributes, pseudo-classes, namespaces)
+ */
+
+static SPStyleSelector *
+sp_stylesheet_parse_compound (const gchar *s, const gchar *e, unsigned int *specificity)
+{
+	SPStyleSelector *sel;
+	GQuark classes[SP_STYLESHEET_MAX_CLASSES];
+	const gchar *p;
+	gchar *name;
+
+	sel = g_new0 (SPStyleSelector, 1);
+
+	p = s;
+	if (*p == '*') {
+		p += 1;
+	} else if (sp_stylesheet_is_name_char (*p)) {
+		while ((p < e) && sp_stylesheet_is_name_char (*p)) p += 1;
+		name = g_strndup (s, p - s);
+		sel->type = g_quark_from_string (name);
+		g_free (name);
+		*specificity += SP_STYLESHEET_SPECIFICITY_TYPE;
+	}
+
+	while (p < e) {
+		const gchar *n;
+		gchar kind;
+		kind = *p;
+		if ((kind != '.') && (kind != '#')) break;
+		p += 1;
+		for (n = p; (n < e) && sp_stylesheet_is_name_char (*n); n++);
+		if (n == p) break;
+		name = g_strndup (p, n - p);
+		if (kind == '#') {
+			/* Two different ids never match, so only one is kept */
+			if (sel->id && (sel->id != g_quark_from_string (name))) {
+				g_free (name);
+				break;
+			}
+			sel->id = g_quark_from_string (name);
+			*specificity += SP_STYLESHEET_SPECIFICITY_ID;
+		} else if (sel->n_classes < SP_STYLESHEET_MAX_CLASSES) {
+			classes[sel->n_classes++] = g_quark_from_string (name);
+			*specificity += SP_STYLESHEET_SPECIFICITY_CLASS;
+		}
+		g_free (name);
+		p = n;
+	}
+
+	if ((p < e) || (p == s)) {
+		sp_stylesheet_selector_free (sel);
+		return NULL;
+	}
+
+	if (sel->n_classes > 0) {
+		sel->classes = g_new (GQuark, sel->n_classes);
+		memcpy (sel->classes, classes, sel->n_classes * sizeof (GQuark));
+	}
+
+	return sel;
+}
+
+/*
+ * Parses whitespace separated compound selectors into chain starting
+ * from rightmost one
+ */
+
+static SPStyleSelector *
+sp_stylesheet_parse_selector (const gchar *s, const gchar *e, unsigned int *specificity)
+{
+	SPStyleSelector *sel;
+
+	sel = NULL;
+	*specificity = 0;
+
+	while (s < e) {
+		SPStyleSelector *compound;
+		const gchar *n;
+		while ((s < e) && isspace ((unsigned char) *s)) s += 1;
+		if (s >= e) break;
+		for (n = s; (n < e) && !isspace ((unsigned char) *n); n++);
+		compound = sp_stylesheet_parse_compound (s, n, specificity);
+		if (!compound) {
+			sp_stylesheet_selector_free (sel);
+			return NULL;
+		}
+		compound->ancestor = sel;
+		sel = compound;
+		s = n;
+	}
+
+	return sel;
+}
+
+/*
+ * Rewrites declaration block as "name:value;name:value", the format
+ * style attribute parser expects; NULL if block is empty
+ */
+
+static gchar *
+sp_stylesheet_parse_declarations (const gchar *s, const gchar *e)
+{
+	GString *str;
+	gchar *decls;
+
+	str = g_string_new ("");
+
+	while (s < e) {
+		const gchar *n, *colon, *ns, *ne, *vs, *ve;
+		for (n = s; (n < e) && (*n != ';'); n++);
+		for (colon = s; (colon < n) && (*colon != ':'); colon++);
+		if (colon < n) {
+			for (ns = s; (ns < colon) && isspace ((unsigned char) *ns); ns++);
+			for (ne = colon; (ne > ns) && isspace ((unsigned char) ne[-1]); ne--);
+			for (vs = colon + 1; (vs < n) && isspace ((unsigned char) *vs); vs++);
+			for (ve = n; (ve > vs) && isspace ((unsigned char) ve[-1]); ve--);
+			/* Priority is not supported, but the value is still good */
+			if ((ve - vs >= 10) && !g_ascii_strncasecmp (ve - 10, "!important", 10)) {
+				for (ve -= 10; (ve > vs) && isspace ((unsigned char) ve[-1]); ve--);
+			}
+			if ((ne > ns) && (ve > vs)) {
+				if (str->len > 0) g_string_append_c (str, ';');
+				g_string_append_len (str, ns, ne - ns);
+				g_string_append_c (str, ':');
+				g_string_append_len (str, vs, ve - vs);
+			}
+		}
+		s = n + 1;
+	}
+
+	if (str->len < 1) {
+		g_string_free (str, TRUE);
+		return NULL;
+	}
+
+	decls = str->str;
+	g_string_free (str, FALSE);
+
+	return decls;
+}
+
+static void
+sp_stylesheet_add_rule (SPStyleSheet *sheet, SPStyleSelector *sel, const gchar *decls, unsigned int specificity)
+{
+	SPStyleRule *rule;
+	GHashTable *index;
+	GQuark key;
+
+	rule = g_new (SPStyleRule, 1);
+	rule->selector = sel;
+	rule->declarations = g_strdup (decls);
+	rule->specificity = specificity;
+	rule->order = sheet->n_rules;
+
+	sheet->rules = g_slist_prepend (sheet->rules, rule);
+	sheet->n_rules += 1;
+	if (sel->ancestor) sheet->descendant = TRUE;
+
+	if (sel->id) {
+		index = sheet->ids;
+		key = sel->id;
+	} else if (sel->n_classes > 0) {
+		index = sheet->classes;
+		key = sel->classes[0];
+	} else if (sel->type) {
+		index = sheet->types;
+		key = sel->type;
+	} else {
+		sheet->universal = g_slist_prepend (sheet->universal, rule);
+		return;
+	}
+
+	g_hash_table_insert (index, GUINT_TO_POINTER (key),
+			     g_slist_prepend ((GSList *) g_hash_table_lookup (index, GUINT_TO_POINTER (key)), rule));
+}
+
+/* Copy of text with comments and SGML comment delimiters blanked out */
+
+static gchar *
+sp_stylesheet_strip_comments (const gchar *text)
+{
+	gchar *buf, *p;
+
+	buf = g_strdup (text);
+
+	for (p = buf; *p; p++) {
+		if ((p[0] == '/') && (p[1] == '*')) {
+			gchar *e;
+			e = strstr (p + 2, "*/");
+			e = (e) ? e + 2 : p + strlen (p);
+			memset (p, ' ', e - p);
+			p = e - 1;
+		} else if (!strncmp (p, "<!--", 4)) {
+			memset (p, ' ', 4);
+			p += 3;
+		} else if (!strncmp (p, "-->", 3)) {
+			memset (p, ' ', 3);
+			p += 2;
+		}
+	}
+
+	return buf;
+}
+
+/* Returns position after at-rule starting at p */
+
+static const gchar *
+sp_stylesheet_skip_at_rule (const gchar *p)
+{
+	int depth;
+
+	for (depth = 0; *p; p++) {
+		if ((*p == ';') && (depth == 0)) return p + 1;
+		if (*p == '{') depth += 1;
+		if (*p == '}') {
+			depth -= 1;
+			if (depth <= 0) return p + 1;
+		}
+	}
+
+	return p;
+}
+
+void
+sp_stylesheet_parse (SPStyleSheet *sheet, const gchar *text)
+{
+	gchar *buf;
+	const gchar *p;
+
+	g_return_if_fail (sheet != NULL);
+	g_return_if_fail (text != NULL);
+
+	buf = sp_stylesheet_strip_comments (text);
+
+	p = buf;
+	while (*p) {
+		const gchar *s, *e, *sel;
+		gchar *decls;
+
+		while (isspace ((unsigned char) *p)) p += 1;
+		if (!*p) break;
+		if (*p == '@') {
+			p = sp_stylesheet_skip_at_rule (p);
+			continue;
+		}
+
+		s = strchr (p, '{');
+		if (!s) break;
+		e = strchr (s, '}');
+		if (!e) e = s + strlen (s);
+
+		decls = sp_stylesheet_parse_declarations (s + 1, e);
+		if (decls) {
+			/* Every selector in group becomes separate rule */
+			for (sel = p; sel < s; ) {
+				SPStyleSelector *selector;
+				unsigned int specificity;
+				const gchar *n;
+				for (n = sel; (n < s) && (*n != ','); n++);
+				selector = sp_stylesheet_parse_selector (sel, n, &specificity);
+				if (selector) {
+					sp_stylesheet_add_rule (sheet, selector, decls, specificity);
+				}
+				sel = n + 1;
+			}
+			g_free (decls);
+		}
+
+		p = (*e) ? e + 1 : e;
+	}
+
+	g_free (buf);
+}
+
+/* Matching */
+
+/* Fills classes with quarks of class attribute, 0 for names no rule uses */
+
+static unsigned int
+sp_stylesheet_repr_classes (SPRepr *repr, GQuark *classes)
+{
+	const gchar *p;
+	unsigned int n_classes;
+
+	p = sp_repr_attr (repr, "class");
+	if (!p) return 0;
+
+	n_classes = 0;
+	while (*p && (n_classes < SP_STYLESHEET_MAX_CLASSES)) {
+		const gchar *e;
+		while (isspace ((unsigned char) *p)) p += 1;
+		if (!*p) break;
+		for (e = p; *e && !isspace ((unsigned char) *e); e++);
+		if (e - p < 256) {
+			gchar c[256];
+			memcpy (c, p, e - p);
+			c[e - p] = '\0';
+			classes[n_classes++] = g_quark_try_string (c);
+		}
+		p = e;
+	}
+
+	return n_classes;
+}
+
+static unsigned int
+sp_stylesheet_match_compound (const SPStyleSelector *sel, SPRepr *repr)
+{
+	if (repr->type != SP_XML_ELEMENT_NODE) return FALSE;
+	if (sel->type && (sel->type != (GQuark) repr->name)) return FALSE;
+
+	if (sel->id) {
+		const gchar *id;
+		id = sp_repr_attr (repr, "id");
+		if (!id || (g_quark_try_string (id) != sel->id)) return FALSE;
+	}
+
+	if (sel->n_classes > 0) {
+		GQuark classes[SP_STYLESHEET_MAX_CLASSES];
+		unsigned int n_classes, i, j;
+		n_classes = sp_stylesheet_repr_classes (repr, classes);
+		for (i = 0; i < sel->n_classes; i++) {
+			for (j = 0; j < n_classes; j++) {
+				if (classes[j] == sel->classes[i]) break;
+			}
+			if (j >= n_classes) return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static unsigned int
+sp_stylesheet_match (const SPStyleSelector *sel, SPRepr *repr)
+{
+	if (!sp_stylesheet_match_compound (sel, repr)) return FALSE;
+
+	/* With descendant combinators only, nearest matching ancestor is always best */
+	for (sel = sel->ancestor; sel != NULL; sel = sel->ancestor) {
+		repr = repr->parent;
+		while (repr && !sp_stylesheet_match_compound (sel, repr)) repr = repr->parent;
+		if (!repr) return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+sp_stylesheet_match_list (const GSList *rules, SPRepr *repr, GPtrArray *matched)
+{
+	for (; rules != NULL; rules = rules->next) {
+		SPStyleRule *rule;
+		rule = (SPStyleRule *) rules->data;
+		if (sp_stylesheet_match (rule->selector, repr)) g_ptr_array_add (matched, rule);
+	}
+}
+
+static int
+sp_stylesheet_rule_compare (const void *a, const void *b)
+{
+	const SPStyleRule *ra, *rb;
+
+	ra = *((const SPStyleRule **) a);
+	rb = *((const SPStyleRule **) b);
+
+	/* Most important first, as first declaration of property wins */
+	if (ra->specificity != rb->specificity) return (ra->specificity > rb->specificity) ? -1 : 1;
+	if (ra->order != rb->order) return (ra->order > rb->order) ? -1 : 1;
+
+	return 0;
+}
+
+gchar *
+sp_stylesheet_cascade (const SPStyleSheet *sheet, SPRepr *repr)
+{
+	GQuark classes[SP_STYLESHEET_MAX_CLASSES];
+	unsigned int n_classes, i, j;
+	GPtrArray *matched;
+	const gchar *id;
+	GString *str;
+	gchar *decls;
+
+	g_return_val_if_fail (sheet != NULL, NULL);
+	g_return_val_if_fail (repr != NULL, NULL);
+
+	if ((sheet->n_rules < 1) || (repr->type != SP_XML_ELEMENT_NODE)) return NULL;
+
+	matched = g_ptr_array_new ();
+
+	sp_stylesheet_match_list (sheet->universal, repr, matched);
+	sp_stylesheet_match_list ((GSList *) g_hash_table_lookup (sheet->types, GUINT_TO_POINTER (repr->name)), repr, matched);
+	id = sp_repr_attr (repr, "id");
+	if (id && g_quark_try_string (id)) {
+		sp_stylesheet_match_list ((GSList *) g_hash_table_lookup (sheet->ids, GUINT_TO_POINTER (g_quark_try_string (id))), repr, matched);
+	}
+	n_classes = sp_stylesheet_repr_classes (repr, classes);
+	for (i = 0; i < n_classes; i++) {
+		if (!classes[i]) continue;
+		/* Rule is indexed once, so repeated class must not add it again */
+		for (j = 0; j < i; j++) {
+			if (classes[j] == classes[i]) break;
+		}
+		if (j < i) continue;
+		sp_stylesheet_match_list ((GSList *) g_hash_table_lookup (sheet->classes, GUINT_TO_POINTER (classes[i])), repr, matched);
+	}
+
+	if (matched->len < 1) {
+		g_ptr_array_free (matched, TRUE);
+		return NULL;
+	}
+
+	qsort (matched->pdata, matched->len, sizeof (gpointer), sp_stylesheet_rule_compare);
+
+	str = g_string_new ("");
+	for (i = 0; i < matched->len; i++) {
+		if (i > 0) g_string_append_c (str, ';');
+		g_string_append (str, ((SPStyleRule *) g_ptr_array_index (matched, i))->declarations);
+	}
+	g_ptr_array_free (matched, TRUE);
+
+	decls = str->str;
+	g_string_free (str, FALSE);
+
+	return decls;
+}
@@ -0,0 +1,42 @@
+#ifndef __SP_STYLESHEET_H__
+#define __SP_STYLESHEET_H__
+
+/*
+ * CSS stylesheet rules and selector matching
+ *
+ * Supported selectors are type, class, id, universal and descendant
+ * combinations of these.  Rules are indexed by the id, class or type of
+ * their rightmost compound selector, so matching an element only looks
+ * at rules that can possibly apply to it.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <glib.h>
+#include "xml/repr.h"
+
+G_BEGIN_DECLS
+
+typedef struct _SPStyleSheet SPStyleSheet;
+
+SPStyleSheet *sp_stylesheet_new (void);
+void sp_stylesheet_free (SPStyleSheet *sheet);
+
+/* Appends rules from CSS text; unsupported selectors and at-rules are skipped */
+void sp_stylesheet_parse (SPStyleSheet *sheet, const gchar *text);
+
+unsigned int sp_stylesheet_n_rules (const SPStyleSheet *sheet);
+/* TRUE if ancestors' classes and ids affect matching */
+unsigned int sp_stylesheet_has_descendant_rules (const SPStyleSheet *sheet);
+/* Unique for every sheet, so cached matches can be validated */
+unsigned int sp_stylesheet_get_generation (const SPStyleSheet *sheet);
+
+/*
+ * Declarations of all rules matching repr, most specific first, in the
+ * format of style attribute; NULL if nothing matches
+ */
+gchar *sp_stylesheet_cascade (const SPStyleSheet *sheet, SPRepr *repr);
+
+G_END_DECLS
+
+#endif
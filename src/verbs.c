@@ -47,6 +47,7 @@
 #include "file.h"
 #include "document.h"
 #include "desktop.h"
+#include "display/canvas-arena.h"
 #include "selection.h"
 #include "selection-chemistry.h"
 #include "path-chemistry.h"
@@ -115,6 +116,23 @@ sp_verb_action_file_perform (SPAction *action, void *data)
 	}
 }
 
+/* Shows undo history memory use in status bar */
+static void
+sp_verb_undo_status (SPDesktop *dt)
+{
+	unsigned int undo_steps, redo_steps;
+	size_t undo_size, redo_size, spilled_size;
+	gchar *status;
+
+	sp_document_get_undo_usage (SP_DT_DOCUMENT (dt), &undo_steps, &redo_steps,
+				    &undo_size, &redo_size, &spilled_size);
+	status = g_strdup_printf (_("Undo history: %u steps (%.1f MB), redo: %u steps (%.1f MB), on disk: %.1f MB"),
+				  undo_steps, undo_size / 1048576.0, redo_steps, redo_size / 1048576.0,
+				  spilled_size / 1048576.0);
+	sp_view_set_status (SP_VIEW (dt), status, FALSE);
+	g_free (status);
+}
+
 static void
 sp_verb_action_edit_perform (SPAction *action, void *data)
 {
@@ -129,9 +147,11 @@ sp_verb_action_edit_perform (SPAction *action, void *data)
 	switch ((int) data) {
 	case SP_VERB_EDIT_UNDO:
 		sp_document_undo (SP_DT_DOCUMENT (dt));
+		sp_verb_undo_status (dt);
 		break;
 	case SP_VERB_EDIT_REDO:
 		sp_document_redo (SP_DT_DOCUMENT (dt));
+		sp_verb_undo_status (dt);
 		break;
 	case SP_VERB_EDIT_CUT:
 		sp_selection_cut (NULL);
@@ -355,6 +375,10 @@ sp_verb_action_zoom_perform (SPAction *action, void *data)
 		sp_repr_get_boolean (repr, "showgrid", &v);
 		sp_repr_set_boolean (repr, "showgrid", !(v));
 		break;
+	case SP_VERB_TOGGLE_DRAFT:
+		/* Per view, so not stored in namedview */
+		sp_canvas_arena_set_draft (SP_CANVAS_ARENA (dt->drawing), !SP_CANVAS_ARENA (dt->drawing)->draft);
+		break;
 	default:
 		break;
 	}
@@ -490,6 +514,7 @@ static const SPVerbActionDef props[] = {
 	{SP_VERB_ZOOM_OUT, "ZoomOut", N_("Out"), N_("Zoom out"), "zoom_out"},
 	{SP_VERB_TOGGLE_GRID, "ToggleGrid", N_("Grid"), N_("Toggle grid"), "toggle_grid"},
 	{SP_VERB_TOGGLE_GUIDES, "ToggleGuides", N_("Guides"), N_("Toggle guides"), "toggle_guides"},
+	{SP_VERB_TOGGLE_DRAFT, "ToggleDraft", N_("Draft"), N_("Toggle fast draft rendering in this window"), NULL},
 	{SP_VERB_ZOOM_1_1, "Zoom1:0", N_("1:1"), N_("Zoom to 1:1"), "zoom_1_to_1"},
 	{SP_VERB_ZOOM_1_2, "Zoom1:2", N_("1:2"), N_("Zoom to 1:2"), "zoom_1_to_2"},
 	{SP_VERB_ZOOM_2_1, "Zoom2:1", N_("2:1"), N_("Zoom to 2:1"), "zoom_2_to_1"},
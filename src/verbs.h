@@ -73,6 +73,7 @@ enum {
 	SP_VERB_ZOOM_OUT,
 	SP_VERB_TOGGLE_GRID,
 	SP_VERB_TOGGLE_GUIDES,
+	SP_VERB_TOGGLE_DRAFT,
 	SP_VERB_ZOOM_1_1,
 	SP_VERB_ZOOM_1_2,
 	SP_VERB_ZOOM_2_1,
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <glib.h>
 #include "../utest/utest.h"
 
@@ -6,9 +7,73 @@
 #include "repr-private.h"
 #include "repr-action.h"
 
+/* Checks attribute keys, space separated, in iteration order */
+static int has_attribute_order(SPRepr *repr, const char *keys) {
+	GString *order;
+	unsigned int i;
+	int result;
+
+	order = g_string_new("");
+	for (i = 0; i < SP_REPR_N_ATTRIBUTES(repr); i++) {
+		if (i) g_string_append_c(order, ' ');
+		g_string_append(order, SP_REPR_ATTRIBUTE_KEY(SP_REPR_NTH_ATTRIBUTE(repr, i)));
+	}
+	result = !strcmp(order->str, keys);
+	g_string_free(order, TRUE);
+
+	return result;
+}
+
+/* Checks child element names, space separated, in document order */
+static int has_child_order(SPRepr *repr, const char *names) {
+	GString *order;
+	SPRepr *child;
+	int result;
+
+	order = g_string_new("");
+	for (child = sp_repr_children(repr); child != NULL; child = sp_repr_next(child)) {
+		if (child != sp_repr_children(repr)) g_string_append_c(order, ' ');
+		g_string_append(order, sp_repr_name(child));
+	}
+	result = !strcmp(order->str, names);
+	g_string_free(order, TRUE);
+
+	return result;
+}
+
+/* Typed value holding plain string */
+static gchar *test_value_to_string(const void *data) {
+	return g_strdup((const gchar *) data);
+}
+
+static void test_value_free(void *data) {
+	g_free(data);
+}
+
+static size_t test_value_size(const void *data) {
+	return strlen((const gchar *) data) + 1;
+}
+
+static const SPReprValueType test_value_type = {
+	"test", test_value_to_string, test_value_free, test_value_size
+};
+
+/* Listener keeping the child given as data */
+static unsigned int veto_remove_child(SPRepr *repr, SPRepr *child, SPRepr *ref, void *data) {
+	return child != (SPRepr *) data;
+}
+
+static const SPReprEventVector veto_events = {
+	NULL, NULL, NULL, veto_remove_child, NULL, NULL, NULL, NULL, NULL, NULL, NULL, FALSE
+};
+
 int main(int argc, char *argv[]) {
 	SPReprDoc *document;
 	SPRepr *a, *b, *c, *root;
+	SPRepr *parent, *kids[5];
+	GSList *removed;
+	gchar *oldlong, *newlong;
+	unsigned int i;
 
 	document = sp_repr_document_new("test");
 	root = sp_repr_document_root(document);
@@ -70,6 +135,261 @@ int main(int argc, char *argv[]) {
 	sp_repr_unparent(b);
 	sp_repr_unparent(c);
 
+	UTEST_TEST("attributes keep insertion order") {
+		/* Keys are interned in the opposite order to setting them */
+		g_quark_from_string("test-first");
+		g_quark_from_string("test-second");
+
+		sp_repr_set_attr(a, "test-second", "2");
+		sp_repr_set_attr(a, "test-first", "1");
+		UTEST_ASSERT(has_attribute_order(a, "test-second test-first"));
+
+		sp_repr_set_attr(a, "test-second", "two");
+		UTEST_ASSERT(has_attribute_order(a, "test-second test-first"));
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "test-second"), "two"));
+	}
+
+	UTEST_TEST("attribute lookup past inline slots") {
+		char key[16];
+		unsigned int i;
+
+		for (i = 0; i < 40; i++) {
+			g_snprintf(key, sizeof(key), "k%u", 39 - i);
+			sp_repr_set_attr(b, key, key);
+		}
+		UTEST_ASSERT(SP_REPR_N_ATTRIBUTES(b) == 40);
+		UTEST_ASSERT(!strcmp(SP_REPR_ATTRIBUTE_KEY(SP_REPR_NTH_ATTRIBUTE(b, 0)), "k39"));
+		UTEST_ASSERT(!strcmp(SP_REPR_ATTRIBUTE_KEY(SP_REPR_NTH_ATTRIBUTE(b, 39)), "k0"));
+		for (i = 0; i < 40; i++) {
+			g_snprintf(key, sizeof(key), "k%u", i);
+			UTEST_ASSERT(sp_repr_attr(b, key) && !strcmp(sp_repr_attr(b, key), key));
+		}
+		UTEST_ASSERT(sp_repr_attr(b, "k40") == NULL);
+
+		for (i = 0; i < 40; i += 2) {
+			g_snprintf(key, sizeof(key), "k%u", i);
+			sp_repr_set_attr(b, key, NULL);
+		}
+		UTEST_ASSERT(SP_REPR_N_ATTRIBUTES(b) == 20);
+		UTEST_ASSERT(!strcmp(SP_REPR_ATTRIBUTE_KEY(SP_REPR_NTH_ATTRIBUTE(b, 0)), "k39"));
+		UTEST_ASSERT(!strcmp(SP_REPR_ATTRIBUTE_KEY(SP_REPR_NTH_ATTRIBUTE(b, 19)), "k1"));
+		for (i = 0; i < 40; i++) {
+			g_snprintf(key, sizeof(key), "k%u", i);
+			UTEST_ASSERT((sp_repr_attr(b, key) != NULL) == (i % 2));
+		}
+	}
+
+	UTEST_TEST("unset of attribute keeps order of others") {
+		sp_repr_set_attr(c, "x", "1");
+		sp_repr_set_attr(c, "y", "2");
+		sp_repr_set_attr(c, "z", "3");
+
+		sp_repr_set_attr(c, "y", NULL);
+		UTEST_ASSERT(sp_repr_attr(c, "y") == NULL);
+		UTEST_ASSERT(has_attribute_order(c, "x z"));
+
+		sp_repr_set_attr(c, "y", "2");
+		UTEST_ASSERT(has_attribute_order(c, "x z y"));
+	}
+
+	sp_repr_append_child(root, c);
+
+	UTEST_TEST("rollback of attribute changes") {
+		sp_repr_begin_transaction(document);
+
+		sp_repr_set_attr(c, "x", "one");
+		sp_repr_set_attr(c, "z", NULL);
+		sp_repr_set_attr(c, "w", "4");
+		UTEST_ASSERT(has_attribute_order(c, "x y w"));
+
+		sp_repr_rollback(document);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(c, "x"), "1"));
+		UTEST_ASSERT(!strcmp(sp_repr_attr(c, "z"), "3"));
+		UTEST_ASSERT(sp_repr_attr(c, "w") == NULL);
+		UTEST_ASSERT(has_attribute_order(c, "x z y"));
+	}
+
+	UTEST_TEST("undo and redo of attribute removal") {
+		SPReprAction *log;
+
+		sp_repr_begin_transaction(document);
+		sp_repr_set_attr(c, "x", NULL);
+		log = sp_repr_commit_undoable(document);
+		UTEST_ASSERT(has_attribute_order(c, "z y"));
+
+		sp_repr_undo_log(log);
+		UTEST_ASSERT(has_attribute_order(c, "x z y"));
+
+		sp_repr_replay_log(log);
+		UTEST_ASSERT(has_attribute_order(c, "z y"));
+
+		sp_repr_free_log(log);
+	}
+
+	sp_repr_unparent(c);
+
+	/* Long values, differing in the middle only */
+	oldlong = g_strnfill(2048, 'a');
+	newlong = g_strdup(oldlong);
+	memcpy(newlong + 1000, "0123456789", 10);
+	sp_repr_append_child(root, a);
+
+	UTEST_TEST("undo and redo of compacted attribute change") {
+		SPReprAction *log;
+		size_t before;
+
+		sp_repr_set_attr(a, "d", oldlong);
+		sp_repr_begin_transaction(document);
+		sp_repr_set_attr(a, "d", newlong);
+		log = sp_repr_commit_undoable(document);
+
+		before = sp_repr_log_size(log, NULL);
+		sp_repr_compact_log(log);
+		UTEST_ASSERT(log->act.chgattr.delta != NULL);
+		UTEST_ASSERT(sp_repr_log_size(log, NULL) < before);
+
+		sp_repr_undo_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "d"), oldlong));
+		sp_repr_replay_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "d"), newlong));
+
+		sp_repr_free_log(log);
+	}
+
+	UTEST_TEST("compacted change skipped on base mismatch") {
+		SPReprAction *log;
+
+		sp_repr_set_attr(a, "d", oldlong);
+		sp_repr_begin_transaction(document);
+		sp_repr_set_attr(a, "d", newlong);
+		log = sp_repr_commit_undoable(document);
+		sp_repr_compact_log(log);
+
+		/* Out of order undo - attribute is no longer new value */
+		sp_repr_set_attr(a, "d", "short");
+		sp_repr_undo_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "d"), "short"));
+
+		sp_repr_free_log(log);
+	}
+
+	UTEST_TEST("undo and redo of spilled attribute change") {
+		SPReprAction *log;
+		size_t spilled;
+
+		sp_repr_set_attr(a, "d", oldlong);
+		sp_repr_begin_transaction(document);
+		sp_repr_set_attr(a, "d", newlong);
+		log = sp_repr_commit_undoable(document);
+
+		UTEST_ASSERT(sp_repr_spill_log(log));
+		UTEST_ASSERT(log->act.chgattr.delta != NULL);
+		UTEST_ASSERT(log->act.chgattr.delta->data == NULL);
+		spilled = 0;
+		sp_repr_log_size(log, &spilled);
+		UTEST_ASSERT(spilled > 0);
+
+		sp_repr_undo_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "d"), oldlong));
+		sp_repr_replay_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "d"), newlong));
+
+		sp_repr_free_log(log);
+	}
+
+	UTEST_TEST("typed change keeps its size when stringified") {
+		SPReprAction *log;
+		size_t before;
+
+		sp_repr_set_attr_typed(a, "t", &test_value_type, g_strdup(oldlong));
+		sp_repr_begin_transaction(document);
+		sp_repr_set_attr_typed(a, "t", &test_value_type, g_strdup(newlong));
+		log = sp_repr_commit_undoable(document);
+		before = sp_repr_log_size(log, NULL);
+
+		/* Compacting leaves typed values alone, saving stringifies them */
+		sp_repr_compact_log(log);
+		UTEST_ASSERT(log->act.chgattr.delta == NULL);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "t"), newlong));
+		UTEST_ASSERT(sp_repr_log_size(log, NULL) == before);
+
+		sp_repr_undo_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "t"), oldlong));
+		UTEST_ASSERT(sp_repr_log_size(log, NULL) == before);
+
+		sp_repr_replay_log(log);
+		UTEST_ASSERT(!strcmp(sp_repr_attr(a, "t"), newlong));
+		UTEST_ASSERT(sp_repr_log_size(log, NULL) == before);
+
+		sp_repr_free_log(log);
+	}
+
+	sp_repr_unparent(a);
+	g_free(oldlong);
+	g_free(newlong);
+
+	parent = sp_repr_new("p");
+	sp_repr_append_child(root, parent);
+	for (i = 0; i < 5; i++) {
+		gchar name[2] = { 'a' + i, '\0' };
+		kids[i] = sp_repr_new(name);
+	}
+	/* Out of document order, as callers collect them from selection */
+	removed = g_slist_prepend(NULL, kids[2]);
+	removed = g_slist_prepend(removed, kids[0]);
+	removed = g_slist_prepend(removed, kids[4]);
+
+	UTEST_TEST("removal of non-contiguous children") {
+		for (i = 0; i < 5; i++) sp_repr_append_child(parent, kids[i]);
+
+		sp_repr_remove_children(parent, removed);
+		UTEST_ASSERT(has_child_order(parent, "b d"));
+		UTEST_ASSERT(sp_repr_parent(kids[0]) == NULL);
+		UTEST_ASSERT(sp_repr_parent(kids[2]) == NULL);
+		UTEST_ASSERT(sp_repr_parent(kids[4]) == NULL);
+		UTEST_ASSERT(sp_repr_n_children(parent) == 2);
+	}
+
+	sp_repr_unparent(kids[1]);
+	sp_repr_unparent(kids[3]);
+
+	UTEST_TEST("vetoed removal of children") {
+		for (i = 0; i < 5; i++) sp_repr_append_child(parent, kids[i]);
+		sp_repr_add_listener(parent, &veto_events, kids[2]);
+
+		sp_repr_remove_children(parent, removed);
+		UTEST_ASSERT(has_child_order(parent, "b c d"));
+		UTEST_ASSERT(sp_repr_parent(kids[0]) == NULL);
+		UTEST_ASSERT(sp_repr_parent(kids[2]) == parent);
+		UTEST_ASSERT(sp_repr_parent(kids[4]) == NULL);
+
+		sp_repr_remove_listener_by_data(parent, kids[2]);
+	}
+
+	sp_repr_unparent(kids[1]);
+	sp_repr_unparent(kids[2]);
+	sp_repr_unparent(kids[3]);
+
+	UTEST_TEST("rollback of batch removal") {
+		for (i = 0; i < 5; i++) sp_repr_append_child(parent, kids[i]);
+
+		sp_repr_begin_transaction(document);
+		sp_repr_remove_children(parent, removed);
+		UTEST_ASSERT(has_child_order(parent, "b d"));
+
+		sp_repr_rollback(document);
+		UTEST_ASSERT(has_child_order(parent, "a b c d e"));
+		for (i = 0; i < 5; i++) UTEST_ASSERT(sp_repr_parent(kids[i]) == parent);
+	}
+
+	g_slist_free(removed);
+	for (i = 0; i < 5; i++) {
+		sp_repr_unparent(kids[i]);
+		sp_repr_unref(kids[i]);
+	}
+	sp_repr_unparent(parent);
+	sp_repr_unref(parent);
+
 	/* lots more tests needed ... */
 
 	return utest_end() ? 0 : 1;
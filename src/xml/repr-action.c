@@ -13,6 +13,7 @@
  */
 
 #include <glib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "repr.h"
@@ -26,6 +27,11 @@ static SPReprAction *new_action (SPReprAction *log,
                                  SPReprActionType type,
                                  SPRepr *repr);
 static void free_action (SPReprAction *action);
+static void apply_delta (SPReprAction *action, unsigned int redo);
+static void free_delta (SPReprActionDelta *delta);
+
+/* Attribute changes shorter than this are never delta-encoded */
+#define SP_REPR_DELTA_MIN_LENGTH 1024
 
 void
 sp_repr_begin_transaction (SPReprDoc *doc)
@@ -90,13 +96,19 @@ sp_repr_undo_log (SPReprAction *log)
 			                   action->act.del.ref);
 			break;
 		case SP_REPR_ACTION_CHGATTR:
-			sp_repr_set_attr (action->repr,
-			                  g_quark_to_string (action->act.chgattr.key),
-			                  action->act.chgattr.oldval);
+			if (action->act.chgattr.delta) {
+				apply_delta (action, FALSE);
+			} else {
+				sp_repr_set_attr_value (action->repr,
+				                        action->act.chgattr.key,
+				                        action->act.chgattr.pos,
+				                        action->act.chgattr.oldval,
+				                        action->act.chgattr.oldtyped);
+			}
 			break;
 		case SP_REPR_ACTION_CHGCONTENT:
 			sp_repr_set_content (action->repr,
-			                     action->act.chgattr.oldval);
+			                     action->act.chgcontent.oldval);
 			break;
 		case SP_REPR_ACTION_CHGORDER:
 			sp_repr_change_order (action->repr,
@@ -129,9 +141,15 @@ sp_repr_replay_log (SPReprAction *log)
 			                      action->act.del.child);
 			break;
 		case SP_REPR_ACTION_CHGATTR:
-			sp_repr_set_attr (action->repr,
-			                  g_quark_to_string (action->act.chgattr.key),
-			                  action->act.chgattr.newval);
+			if (action->act.chgattr.delta) {
+				apply_delta (action, TRUE);
+			} else {
+				sp_repr_set_attr_value (action->repr,
+				                        action->act.chgattr.key,
+				                        action->act.chgattr.pos,
+				                        action->act.chgattr.newval,
+				                        action->act.chgattr.newtyped);
+			}
 			break;
 		case SP_REPR_ACTION_CHGCONTENT:
 			sp_repr_set_content (action->repr,
@@ -207,6 +225,19 @@ sp_repr_coalesce_log (SPReprAction *a, SPReprAction *b)
 }
 
 
+/*
+ * Typed values are compared by identity, so they never get stringified
+ * here; values continuing each other are the very same reference anyway
+ */
+static unsigned int
+chgattr_values_equal (const gchar *aval, SPReprTyped *atyped, const gchar *bval, SPReprTyped *btyped)
+{
+	if (atyped || btyped) return atyped == btyped;
+	if (!aval || !bval) return aval == bval;
+
+	return !strcmp (aval, bval);
+}
+
 static void
 coalesce_chgattr (SPReprAction *action)
 {
@@ -227,13 +258,17 @@ coalesce_chgattr (SPReprAction *action)
 		     action->act.chgattr.key == iter->act.chgattr.key )
 		{
 			/* ensure changes are continuous */
-			if (strcmp(action->act.chgattr.oldval, 
-			           iter->act.chgattr.newval)) break;
+			if (action->act.chgattr.delta || iter->act.chgattr.delta) break;
+			if (!chgattr_values_equal (action->act.chgattr.oldval, action->act.chgattr.oldtyped,
+			                           iter->act.chgattr.newval, iter->act.chgattr.newtyped)) break;
 
-			g_free (action->act.chgattr.oldval);
+			sp_repr_value_unref (action->act.chgattr.oldval);
+			if (action->act.chgattr.oldtyped) sp_repr_typed_unref (action->act.chgattr.oldtyped);
 
 			action->act.chgattr.oldval = iter->act.chgattr.oldval;
+			action->act.chgattr.oldtyped = iter->act.chgattr.oldtyped;
 			iter->act.chgattr.oldval = NULL;
+			iter->act.chgattr.oldtyped = NULL;
 			free_action (iter);
 			prev->next = next;
 		} else if ( action->act.chgattr.key == id_key ) {
@@ -327,8 +362,8 @@ sp_repr_log_remove (SPReprAction *log, SPRepr *repr,
 
 SPReprAction *
 sp_repr_log_chgattr (SPReprAction *log, SPRepr *repr,
-                     int key, gchar *oldval,
-                     const gchar *newval)
+                     int key, unsigned int pos, gchar *oldval, SPReprTyped *oldtyped,
+                     gchar *newval, SPReprTyped *newtyped)
 {
 	SPReprAction *action;
 
@@ -336,8 +371,12 @@ sp_repr_log_chgattr (SPReprAction *log, SPRepr *repr,
 
 	action = new_action (log, SP_REPR_ACTION_CHGATTR, repr);
 	action->act.chgattr.key = key;
+	action->act.chgattr.pos = pos;
 	action->act.chgattr.oldval = oldval;
-	action->act.chgattr.newval = ( newval ? g_strdup (newval) : NULL );
+	action->act.chgattr.oldtyped = oldtyped;
+	action->act.chgattr.newval = ( newval ? sp_repr_value_ref (newval) : NULL );
+	action->act.chgattr.newtyped = ( newtyped ? sp_repr_typed_ref (newtyped) : NULL );
+	action->act.chgattr.delta = NULL;
 
 	return action;
 }
@@ -429,8 +468,11 @@ free_action (SPReprAction *action)
 		  sp_repr_unref (action->act.del.ref);
 		break;
 	case SP_REPR_ACTION_CHGATTR:
-		g_free (action->act.chgattr.oldval);
-		g_free (action->act.chgattr.newval);
+		sp_repr_value_unref (action->act.chgattr.oldval);
+		sp_repr_value_unref (action->act.chgattr.newval);
+		if (action->act.chgattr.oldtyped) sp_repr_typed_unref (action->act.chgattr.oldtyped);
+		if (action->act.chgattr.newtyped) sp_repr_typed_unref (action->act.chgattr.newtyped);
+		if (action->act.chgattr.delta) free_delta (action->act.chgattr.delta);
 		break;
 	case SP_REPR_ACTION_CHGCONTENT:
 		g_free (action->act.chgcontent.oldval);
@@ -455,3 +497,261 @@ free_action (SPReprAction *action)
 	action_pool = action;
 }
 
+/*
+ * Undo history memory management
+ */
+
+static FILE *spill_file = NULL;
+static long spill_end = 0;
+static unsigned int spill_live = 0;
+
+static size_t
+value_size (const gchar *value, SPReprTyped *typed)
+{
+	size_t size;
+
+	size = 0;
+	if (value) size += strlen (value) + 1;
+	/* Lazily made string is not counted, so size does not change when it appears */
+	if (typed) {
+		size += sizeof (SPReprTyped);
+		if (typed->type->size) size += typed->type->size (typed->data);
+	}
+
+	return size;
+}
+
+/* Removed subtree is kept alive by log */
+static size_t
+tree_size (SPRepr *repr)
+{
+	SPRepr *child;
+	size_t size;
+	unsigned int i;
+
+	size = repr->type->size;
+	for (i = 0; i < repr->n_attributes; i++) {
+		size += sizeof (SPReprAttr) + value_size (repr->attributes[i].value, repr->attributes[i].typed);
+	}
+	if (repr->content) size += strlen (repr->content) + 1;
+	for (child = repr->children; child != NULL; child = child->next) {
+		size += tree_size (child);
+	}
+
+	return size;
+}
+
+size_t
+sp_repr_log_size (SPReprAction *log, size_t *spilled)
+{
+	SPReprAction *action;
+	size_t size;
+
+	size = 0;
+	for (action = log; action != NULL; action = action->next) {
+		size += sizeof (SPReprAction);
+		switch (action->type) {
+		case SP_REPR_ACTION_DEL:
+			size += tree_size (action->act.del.child);
+			break;
+		case SP_REPR_ACTION_CHGATTR:
+			size += value_size (action->act.chgattr.oldval, action->act.chgattr.oldtyped);
+			size += value_size (action->act.chgattr.newval, action->act.chgattr.newtyped);
+			if (action->act.chgattr.delta) {
+				SPReprActionDelta *delta;
+				size_t len;
+				delta = action->act.chgattr.delta;
+				len = (delta->oldlen + delta->newlen) - 2 * (delta->prefix + delta->suffix);
+				size += sizeof (SPReprActionDelta);
+				if (delta->data) {
+					size += len;
+				} else if (spilled) {
+					*spilled += len;
+				}
+			}
+			break;
+		case SP_REPR_ACTION_CHGCONTENT:
+			if (action->act.chgcontent.oldval) size += strlen (action->act.chgcontent.oldval) + 1;
+			if (action->act.chgcontent.newval) size += strlen (action->act.chgcontent.newval) + 1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return size;
+}
+
+static const gchar *
+action_value (const gchar *value, SPReprTyped *typed)
+{
+	return (typed) ? sp_repr_typed_string (typed) : value;
+}
+
+/*
+ * Replaces both values with their differing middles; with force, change
+ * is encoded even if nothing is saved (for spilling).  Typed values are
+ * only stringified when forced, otherwise they are kept as they are.
+ */
+static unsigned int
+compact_chgattr (SPReprAction *action, unsigned int force)
+{
+	SPReprActionChgAttr *chg;
+	SPReprActionDelta *delta;
+	const gchar *oldstr, *newstr;
+	size_t oldlen, newlen, prefix, suffix, oldmid, newmid;
+
+	chg = &action->act.chgattr;
+	if (chg->delta) return TRUE;
+	/* Creation and removal are kept as they are */
+	if ((!chg->oldval && !chg->oldtyped) || (!chg->newval && !chg->newtyped)) return FALSE;
+
+	if (!force && (chg->oldtyped || chg->newtyped)) return FALSE;
+
+	oldstr = action_value (chg->oldval, chg->oldtyped);
+	newstr = action_value (chg->newval, chg->newtyped);
+	oldlen = strlen (oldstr);
+	newlen = strlen (newstr);
+	if (!force && (oldlen < SP_REPR_DELTA_MIN_LENGTH) && (newlen < SP_REPR_DELTA_MIN_LENGTH)) return FALSE;
+
+	prefix = 0;
+	while ((prefix < oldlen) && (prefix < newlen) && (oldstr[prefix] == newstr[prefix])) prefix += 1;
+	suffix = 0;
+	while ((suffix < oldlen - prefix) && (suffix < newlen - prefix) &&
+	       (oldstr[oldlen - suffix - 1] == newstr[newlen - suffix - 1])) suffix += 1;
+
+	oldmid = oldlen - prefix - suffix;
+	newmid = newlen - prefix - suffix;
+	if (!force && (2 * (oldmid + newmid) > oldlen + newlen)) return FALSE;
+
+	delta = g_new (SPReprActionDelta, 1);
+	delta->prefix = prefix;
+	delta->suffix = suffix;
+	delta->oldlen = oldlen;
+	delta->newlen = newlen;
+	delta->data = g_new (gchar, oldmid + newmid + 1);
+	memcpy (delta->data, oldstr + prefix, oldmid);
+	memcpy (delta->data + oldmid, newstr + prefix, newmid);
+	delta->offset = 0;
+
+	sp_repr_value_unref (chg->oldval);
+	sp_repr_value_unref (chg->newval);
+	if (chg->oldtyped) sp_repr_typed_unref (chg->oldtyped);
+	if (chg->newtyped) sp_repr_typed_unref (chg->newtyped);
+	chg->oldval = chg->newval = NULL;
+	chg->oldtyped = chg->newtyped = NULL;
+	chg->delta = delta;
+
+	return TRUE;
+}
+
+void
+sp_repr_compact_log (SPReprAction *log)
+{
+	SPReprAction *action;
+
+	for (action = log; action != NULL; action = action->next) {
+		if (action->type == SP_REPR_ACTION_CHGATTR) compact_chgattr (action, FALSE);
+	}
+}
+
+unsigned int
+sp_repr_spill_log (SPReprAction *log)
+{
+	SPReprAction *action;
+
+	if (!spill_file) {
+		spill_file = tmpfile ();
+		if (!spill_file) {
+			g_warning ("Cannot create temporary file for undo history");
+			return FALSE;
+		}
+	}
+
+	for (action = log; action != NULL; action = action->next) {
+		SPReprActionDelta *delta;
+		size_t len;
+
+		if (action->type != SP_REPR_ACTION_CHGATTR) continue;
+		if (!compact_chgattr (action, TRUE)) continue;
+		delta = action->act.chgattr.delta;
+		if (!delta->data) continue;
+
+		len = (delta->oldlen + delta->newlen) - 2 * (delta->prefix + delta->suffix);
+		if (fseek (spill_file, spill_end, SEEK_SET) || (fwrite (delta->data, 1, len, spill_file) != len)) {
+			g_warning ("Cannot write undo history to temporary file");
+			return FALSE;
+		}
+		delta->offset = spill_end;
+		spill_end += len;
+		spill_live += 1;
+		g_free (delta->data);
+		delta->data = NULL;
+	}
+
+	return TRUE;
+}
+
+static void
+free_delta (SPReprActionDelta *delta)
+{
+	if (delta->data) {
+		g_free (delta->data);
+	} else {
+		spill_live -= 1;
+		/* Whole file is reused once nothing refers to it */
+		if (spill_live == 0) spill_end = 0;
+	}
+	g_free (delta);
+}
+
+/*
+ * Rebuilds old (undo) or new (redo) value from current one; current
+ * value has to be the other side of change
+ */
+static void
+apply_delta (SPReprAction *action, unsigned int redo)
+{
+	SPReprActionDelta *delta;
+	const gchar *base, *mid;
+	size_t baselen, len, oldmid, newmid;
+	gchar *data, *value;
+
+	delta = action->act.chgattr.delta;
+	base = sp_repr_attr_quark (action->repr, action->act.chgattr.key);
+	baselen = (redo) ? delta->oldlen : delta->newlen;
+	len = (redo) ? delta->newlen : delta->oldlen;
+
+	if (!base || (strlen (base) != baselen)) {
+		g_warning ("Undo history does not match attribute %s, change skipped",
+			   g_quark_to_string (action->act.chgattr.key));
+		return;
+	}
+
+	oldmid = delta->oldlen - delta->prefix - delta->suffix;
+	newmid = delta->newlen - delta->prefix - delta->suffix;
+
+	data = delta->data;
+	if (!data) {
+		data = g_new (gchar, oldmid + newmid + 1);
+		if (fseek (spill_file, delta->offset, SEEK_SET) ||
+		    (fread (data, 1, oldmid + newmid, spill_file) != oldmid + newmid)) {
+			g_warning ("Cannot read undo history from temporary file");
+			g_free (data);
+			return;
+		}
+	}
+	mid = (redo) ? data + oldmid : data;
+
+	value = g_new (gchar, len + 1);
+	memcpy (value, base, delta->prefix);
+	memcpy (value + delta->prefix, mid, len - delta->prefix - delta->suffix);
+	memcpy (value + len - delta->suffix, base + baselen - delta->suffix, delta->suffix);
+	value[len] = '\0';
+
+	sp_repr_set_attr_quark (action->repr, action->act.chgattr.key, value);
+
+	g_free (value);
+	if (data != delta->data) g_free (data);
+}
+
@@ -7,6 +7,8 @@ typedef struct _SPReprActionDel SPReprActionDel;
 typedef struct _SPReprActionChgAttr SPReprActionChgAttr;
 typedef struct _SPReprActionChgContent SPReprActionChgContent;
 typedef struct _SPReprActionChgOrder SPReprActionChgOrder;
+typedef struct _SPReprActionDelta SPReprActionDelta;
+typedef struct _SPReprTyped SPReprTyped;
 
 typedef enum {
 	SP_REPR_ACTION_INVALID,
@@ -29,7 +31,24 @@ struct _SPReprActionDel {
 
 struct _SPReprActionChgAttr {
 	int key;
+	/* Attribute slot, so removed attribute is restored to its place */
+	unsigned int pos;
 	gchar *oldval, *newval;
+	/* Typed values, if attribute held one (value is NULL then) */
+	SPReprTyped *oldtyped, *newtyped;
+	/* Compacted change - values are NULL, and are rebuilt from current one */
+	SPReprActionDelta *delta;
+};
+
+/*
+ * Common prefix and suffix of old and new value are dropped, only the
+ * differing middles are kept, either in memory or in spill file
+ */
+struct _SPReprActionDelta {
+	unsigned int prefix, suffix;
+	unsigned int oldlen, newlen;
+	gchar *data; /* Old middle followed by new middle, NULL if spilled */
+	long offset; /* Position in spill file */
 };
 
 struct _SPReprActionChgContent {
@@ -75,9 +94,11 @@ SPReprAction *sp_repr_log_remove (SPReprAction *log, SPRepr *repr,
                                   SPRepr *child, SPRepr *ref);
 
 /* these two reference oldval directly */
-SPReprAction *sp_repr_log_chgattr (SPReprAction *log, SPRepr *repr, int key,
-                                   gchar *oldval,
-                                   const gchar *newval);
+/* chgattr values are refcounted repr values, newval gets new reference */
+SPReprAction *sp_repr_log_chgattr (SPReprAction *log, SPRepr *repr,
+                                   int key, unsigned int pos,
+                                   gchar *oldval, SPReprTyped *oldtyped,
+                                   gchar *newval, SPReprTyped *newtyped);
 SPReprAction *sp_repr_log_chgcontent (SPReprAction *log, SPRepr *repr,
                                       gchar *oldval,
                                       const gchar *newval);
@@ -86,6 +107,15 @@ SPReprAction *sp_repr_log_chgorder (SPReprAction *log, SPRepr *repr,
                                     SPRepr *child,
                                     SPRepr *oldref, SPRepr *newref);
 
+/* Undo history memory management */
+
+/* Approximate memory held by log; bytes in spill file are added to spilled */
+size_t sp_repr_log_size (SPReprAction *log, size_t *spilled);
+/* Delta-encodes large attribute changes, log has to be undone/replayed in order afterwards */
+void sp_repr_compact_log (SPReprAction *log);
+/* Moves attribute change data to temporary file, returns FALSE if file cannot be used */
+unsigned int sp_repr_spill_log (SPReprAction *log);
+
 #ifdef __cplusplus
 }
 #endif
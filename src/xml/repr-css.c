@@ -145,6 +145,7 @@ sp_repr_css_set (SPRepr * repr, SPCSSAttr * css, const gchar * attr)
 	const char *key;
 	char *val;
 	char c[4096], *p;
+	unsigned int i;
 
 	g_assert (repr != NULL);
 	g_assert (css != NULL);
@@ -153,7 +154,8 @@ sp_repr_css_set (SPRepr * repr, SPCSSAttr * css, const gchar * attr)
 	c[0] = '\0';
 	p = c;
 
-	for (a = ((SPRepr *) css)->attributes; a != NULL; a = a->next) {
+	for (i = 0; i < SP_REPR_N_ATTRIBUTES ((SPRepr *) css); i++) {
+		a = SP_REPR_NTH_ATTRIBUTE ((SPRepr *) css, i);
 		key = SP_REPR_ATTRIBUTE_KEY (a);
 		val = SP_REPR_ATTRIBUTE_VALUE (a);
 		p += g_snprintf (p, c + 4096 - p, "%s:%s;", key, val);
@@ -166,15 +168,14 @@ static void
 sp_repr_css_merge (SPCSSAttr * dst, SPCSSAttr * src)
 {
 	SPReprAttr * attr;
-	const char * key, * val;
+	unsigned int i;
 
 	g_assert (dst != NULL);
 	g_assert (src != NULL);
 
-	for (attr = ((SPRepr *) src)->attributes; attr != NULL; attr = attr->next) {
-		key = SP_REPR_ATTRIBUTE_KEY (attr);
-		val = SP_REPR_ATTRIBUTE_VALUE (attr);
-		sp_repr_set_attr ((SPRepr *) dst, key, val);
+	for (i = 0; i < SP_REPR_N_ATTRIBUTES ((SPRepr *) src); i++) {
+		attr = SP_REPR_NTH_ATTRIBUTE ((SPRepr *) src, i);
+		sp_repr_set_attr_quark ((SPRepr *) dst, attr->key, SP_REPR_ATTRIBUTE_VALUE (attr));
 	}
 
 }
@@ -21,6 +21,7 @@
 #include <libxml/tree.h>
 
 #include <glib.h>
+#include <zlib.h>
 
 #include "repr-private.h"
 
@@ -31,6 +32,7 @@ static const gchar *sp_comment_str =
 "<!-- Created with Inkscape (\"http://www.inkscape.org/\") -->\n";
 
 static SPReprDoc *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
+static xmlDocPtr sp_repr_parse_file (const gchar *filename);
 static SPRepr * sp_repr_svg_read_node (SPXMLDocument *doc, xmlNodePtr node, const gchar *default_ns, GHashTable *prefix_map);
 static void sp_repr_set_xmlns_attr (const gchar *prefix, const gchar *uri, SPRepr *repr);
 static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, GHashTable *prefix_map);
@@ -60,13 +62,13 @@ sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 		  || (strcmp (filename + strlen (filename) - 4,".WMF") == 0))
 			doc = sp_wmf_convert (filename);
 		else
-			doc = xmlParseFile (filename);
+			doc = sp_repr_parse_file (filename);
 	}
 	else {
-		doc = xmlParseFile (filename);
+		doc = sp_repr_parse_file (filename);
 	}
 #else /* HAVE_LIBWMF */
-	doc = xmlParseFile (filename);
+	doc = sp_repr_parse_file (filename);
 #endif /* HAVE_LIBWMF */
 
 	rdoc = sp_repr_do_read (doc, default_ns);
@@ -76,6 +78,50 @@ sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 	return rdoc;
 }
 
+/*
+ * Parses file, decompressing it first if it starts with gzip magic
+ * (i.e. is .svgz), independently of how libxml was built
+ */
+static xmlDocPtr
+sp_repr_parse_file (const gchar *filename)
+{
+	unsigned char magic[2];
+	xmlDocPtr doc;
+	gzFile gzfile;
+	gchar *buffer;
+	int size, length, len;
+	FILE *file;
+
+	file = fopen (filename, "rb");
+	if (!file) return NULL;
+	len = fread (magic, 1, 2, file);
+	fclose (file);
+
+	if ((len < 2) || (magic[0] != 0x1f) || (magic[1] != 0x8b)) {
+		return xmlParseFile (filename);
+	}
+
+	gzfile = gzopen (filename, "rb");
+	if (!gzfile) return NULL;
+
+	size = 65536;
+	length = 0;
+	buffer = g_new (gchar, size);
+	while ((len = gzread (gzfile, buffer + length, size - length)) > 0) {
+		length += len;
+		if (length == size) {
+			size <<= 1;
+			buffer = g_renew (gchar, buffer, size);
+		}
+	}
+	gzclose (gzfile);
+
+	doc = (len < 0) ? NULL : xmlParseMemory (buffer, length);
+	g_free (buffer);
+
+	return doc;
+}
+
 /**
  * Reads and parses XML from a buffer, returning it as an SPReprDoc
  */
@@ -106,6 +152,7 @@ sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
 {
 	SPReprDoc * rdoc;
 	SPRepr * repr;
+	SPReprPool * previous;
 	GHashTable * prefix_map;
 	xmlNodePtr node;
 
@@ -114,6 +161,8 @@ sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
 	if (node == NULL) return NULL;
 	rdoc = sp_repr_document_new ("void");
 
+	/* Allocate whole tree from document pool */
+	previous = sp_repr_pool_set_current (rdoc->repr.pool);
 
 	prefix_map = g_hash_table_new (g_str_hash, g_str_equal);
 
@@ -147,6 +196,8 @@ sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
 	}
 	g_hash_table_destroy (prefix_map);
 
+	sp_repr_pool_set_current (previous);
+
 	return rdoc;
 }
 
@@ -186,7 +237,7 @@ sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, co
 static SPRepr *
 sp_repr_svg_read_node (SPXMLDocument *doc, xmlNodePtr node, const gchar *default_ns, GHashTable *prefix_map)
 {
-	SPRepr *repr, *crepr;
+	SPRepr *repr, *crepr, *ref;
 	xmlAttrPtr prop;
 	xmlNodePtr child;
 	gchar c[256];
@@ -237,51 +288,134 @@ sp_repr_svg_read_node (SPXMLDocument *doc, xmlNodePtr node, const gchar *default
 		sp_repr_set_content (repr, (gchar*)node->content);
 	}
 
-	child = node->xmlChildrenNode;
+	/* Track last child, as sp_repr_append_child would walk the list each time */
+	ref = NULL;
 	for (child = node->xmlChildrenNode; child != NULL; child = child->next) {
 		crepr = sp_repr_svg_read_node (doc, child, default_ns, prefix_map);
 		if (crepr) {
-			sp_repr_append_child (repr, crepr);
+			sp_repr_add_child (repr, crepr, ref);
 			sp_repr_unref (crepr);
+			ref = crepr;
 		}
 	}
 
 	return repr;
 }
 
-void
+/*
+ * Buffered writer, either to stdio stream, zlib stream or string
+ */
+
+#define SP_REPR_WRITER_BUFFER_SIZE 65536
+
+typedef struct _SPReprWriter SPReprWriter;
+
+struct _SPReprWriter {
+	FILE *file;
+	gzFile gzfile;
+	GString *string;
+	/* Set on short write; nothing more is written then */
+	unsigned int failed : 1;
+	size_t length;
+	gchar buffer[SP_REPR_WRITER_BUFFER_SIZE];
+};
+
+typedef struct {
+	gint level;
+	gboolean loose;
+} SPReprWriterLevel;
+
+static void repr_writer_init (SPReprWriter *writer, FILE *file, gzFile gzfile, GString *string);
+static unsigned int repr_writer_flush (SPReprWriter *writer);
+static void repr_write_document (SPReprWriter *writer, SPReprDoc *doc);
+static void repr_write_tree (SPReprWriter *writer, SPRepr *top, gint level);
+
+/**
+ * Returns FALSE if stream could not be written in full
+ */
+unsigned int
 sp_repr_save_stream (SPReprDoc *doc, FILE *fp)
 {
-	SPRepr *repr;
-	const gchar *str;
+	SPReprWriter *writer;
+	unsigned int written;
 
-	/* fixme: do this The Right Way */
+	writer = g_new (SPReprWriter, 1);
+	repr_writer_init (writer, fp, NULL, NULL);
+	repr_write_document (writer, doc);
+	written = repr_writer_flush (writer);
+	g_free (writer);
 
-	fputs ("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n", fp);
+	return written;
+}
 
-	str = sp_repr_attr ((SPRepr *) doc, "doctype");
-	if (str) fputs (str, fp);
-	str = sp_repr_attr ((SPRepr *) doc, "comment");
-	if (str) fputs (str, fp);
+/**
+ * Saves document to file; names ending with ".svgz" are written
+ * gzip-compressed.  Returns FALSE if file could not be written in full.
+ */
+unsigned int
+sp_repr_save_file (SPReprDoc *doc, const gchar *filename)
+{
+	unsigned int written;
+	size_t len;
+
+	g_return_val_if_fail (doc != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
 
-	repr = sp_repr_document_root (doc);
+	len = strlen (filename);
+	if ((len > 5) && !g_ascii_strcasecmp (filename + len - 5, ".svgz")) {
+		gzFile gzfile;
+		SPReprWriter *writer;
+
+		gzfile = gzopen (filename, "wb");
+		if (gzfile == NULL) return FALSE;
+
+		writer = g_new (SPReprWriter, 1);
+		repr_writer_init (writer, NULL, gzfile, NULL);
+		repr_write_document (writer, doc);
+		written = repr_writer_flush (writer);
+		g_free (writer);
+
+		/* Compressor flushes its tail on close */
+		if (gzclose (gzfile) != Z_OK) written = FALSE;
+	} else {
+		FILE * file;
 
-	sp_repr_write_stream (repr, fp, 0);
+		file = fopen (filename, "w");
+		if (file == NULL) return FALSE;
+
+		written = sp_repr_save_stream (doc, file);
+
+		if (fclose (file)) written = FALSE;
+	}
+
+	return written;
 }
 
-void
-sp_repr_save_file (SPReprDoc *doc, const gchar *filename)
+/**
+ * Returns newly allocated document text, for passing documents to
+ * other processes without temporary files
+ */
+gchar *
+sp_repr_save_buf (SPReprDoc *doc, int *length)
 {
-	FILE * file;
+	SPReprWriter *writer;
+	GString *string;
+	gchar *buf;
 
-	file = fopen (filename, "w");
-	g_return_if_fail (file != NULL);
+	g_return_val_if_fail (doc != NULL, NULL);
 
-	sp_repr_save_stream (doc, file);
+	string = g_string_new ("");
+	writer = g_new (SPReprWriter, 1);
+	repr_writer_init (writer, NULL, NULL, string);
+	repr_write_document (writer, doc);
+	repr_writer_flush (writer);
+	g_free (writer);
 
-	fclose (file);
+	if (length) *length = string->len;
+	buf = string->str;
+	g_string_free (string, FALSE);
 
-	return;
+	return buf;
 }
 
 void
@@ -292,71 +426,223 @@ sp_repr_print (SPRepr * repr)
 	return;
 }
 
-/* (No doubt this function already exists elsewhere.) */
+void
+sp_repr_write_stream (SPRepr * repr, FILE * file, gint level)
+{
+	SPReprWriter *writer;
+
+	g_return_if_fail (repr != NULL);
+	g_return_if_fail (file != NULL);
+
+	writer = g_new (SPReprWriter, 1);
+	repr_writer_init (writer, file, NULL, NULL);
+	repr_write_tree (writer, repr, level);
+	repr_writer_flush (writer);
+	g_free (writer);
+}
+
 static void
-repr_quote_write (FILE * file, const gchar * val)
+repr_writer_init (SPReprWriter *writer, FILE *file, gzFile gzfile, GString *string)
 {
-	for (; *val != '\0'; val++) {
-		switch (*val) {
-		case '"': fputs ("&quot;", file); break;
-		case '&': fputs ("&amp;", file); break;
-		case '<': fputs ("&lt;", file); break;
-		case '>': fputs ("&gt;", file); break;
-		default: putc (*val, file); break;
-		}
+	writer->file = file;
+	writer->gzfile = gzfile;
+	writer->string = string;
+	writer->failed = FALSE;
+	writer->length = 0;
+}
+
+static void
+repr_writer_output (SPReprWriter *writer, const gchar *str, size_t len)
+{
+	if (writer->failed) return;
+
+	if (writer->gzfile) {
+		if (gzwrite (writer->gzfile, str, len) != (int) len) writer->failed = TRUE;
+	} else if (writer->string) {
+		g_string_append_len (writer->string, str, len);
+	} else {
+		if (fwrite (str, 1, len, writer->file) != len) writer->failed = TRUE;
 	}
 }
 
-void
-sp_repr_write_stream (SPRepr * repr, FILE * file, gint level)
+/*
+ * Returns FALSE if anything written so far was short
+ */
+static unsigned int
+repr_writer_flush (SPReprWriter *writer)
 {
-	SPReprAttr *attr;
-	SPRepr *child;
-	const gchar *key, *val;
-	gboolean loose;
-	gint i;
+	if (writer->length > 0) {
+		repr_writer_output (writer, writer->buffer, writer->length);
+		writer->length = 0;
+	}
+	if (writer->file && !writer->failed && fflush (writer->file)) writer->failed = TRUE;
 
-	g_return_if_fail (repr != NULL);
-	g_return_if_fail (file != NULL);
+	return !writer->failed;
+}
 
-	if (level > 16) level = 16;
-	for (i = 0; i < level; i++) fputs ("  ", file);
-	fprintf (file, "<%s", sp_repr_name (repr));
-
-	for (attr = repr->attributes; attr != NULL; attr = attr->next) {
-		key = SP_REPR_ATTRIBUTE_KEY (attr);
-		val = SP_REPR_ATTRIBUTE_VALUE (attr);
-		fputs ("\n", file);
-		for (i = 0; i < level + 1; i++) fputs ("  ", file);
-		fprintf (file, " %s=\"", key);
-		repr_quote_write (file, val);
-		putc ('"', file);
+static void
+repr_writer_write (SPReprWriter *writer, const gchar *str, size_t len)
+{
+	if (writer->length + len > SP_REPR_WRITER_BUFFER_SIZE) {
+		repr_writer_flush (writer);
+		if (len > SP_REPR_WRITER_BUFFER_SIZE) {
+			/* Huge runs (path data etc.) bypass buffer */
+			repr_writer_output (writer, str, len);
+			return;
+		}
 	}
-	loose = TRUE;
-	for (child = repr->children; child != NULL; child = child->next) {
-		if (child->type == SP_XML_TEXT_NODE) {
-			loose = FALSE;
-			break;
+	memcpy (writer->buffer + writer->length, str, len);
+	writer->length += len;
+}
+
+#define repr_writer_puts(w,s) repr_writer_write ((w), (s), strlen (s))
+
+static void
+repr_writer_putc (SPReprWriter *writer, gchar c)
+{
+	if (writer->length >= SP_REPR_WRITER_BUFFER_SIZE) repr_writer_flush (writer);
+	writer->buffer[writer->length++] = c;
+}
+
+static void
+repr_writer_indent (SPReprWriter *writer, gint level)
+{
+	static const gchar spaces[] = "                                    ";
+
+	/* Levels are clamped to 17, so this always fits */
+	repr_writer_write (writer, spaces, 2 * level);
+}
+
+/*
+ * Copies runs that need no escaping in one go, so only special
+ * characters are handled one by one
+ */
+static void
+repr_quote_write (SPReprWriter *writer, const gchar *val)
+{
+	while (*val) {
+		size_t run;
+		run = strcspn (val, "\"&<>");
+		if (run > 0) {
+			repr_writer_write (writer, val, run);
+			val += run;
+		}
+		switch (*val) {
+		case '"': repr_writer_write (writer, "&quot;", 6); break;
+		case '&': repr_writer_write (writer, "&amp;", 5); break;
+		case '<': repr_writer_write (writer, "&lt;", 4); break;
+		case '>': repr_writer_write (writer, "&gt;", 4); break;
+		default: return;
 		}
+		val += 1;
 	}
-	if (repr->children /* || sp_repr_content (repr) */ ) {
-		fputs (">", file);
-		if (loose) fputs ("\n", file);
-		for (child = repr->children; child != NULL; child = child->next) {
-			if (child->type == SP_XML_TEXT_NODE) {
-				repr_quote_write (file, sp_repr_content (child));
-			} else {
-				sp_repr_write_stream (child, file, (loose) ? (level + 1) : 0);
+}
+
+static void
+repr_write_document (SPReprWriter *writer, SPReprDoc *doc)
+{
+	const gchar *str;
+
+	/* fixme: do this The Right Way */
+
+	repr_writer_puts (writer, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n");
+
+	str = sp_repr_attr ((SPRepr *) doc, "doctype");
+	if (str) repr_writer_puts (writer, str);
+	str = sp_repr_attr ((SPRepr *) doc, "comment");
+	if (str) repr_writer_puts (writer, str);
+
+	repr_write_tree (writer, sp_repr_document_root (doc), 0);
+}
+
+static void
+repr_write_start_element (SPReprWriter *writer, SPRepr *repr, gint level)
+{
+	guint n;
+
+	repr_writer_indent (writer, level);
+	repr_writer_putc (writer, '<');
+	repr_writer_puts (writer, sp_repr_name (repr));
+
+	for (n = 0; n < SP_REPR_N_ATTRIBUTES (repr); n++) {
+		SPReprAttr *attr;
+		attr = SP_REPR_NTH_ATTRIBUTE (repr, n);
+		repr_writer_putc (writer, '\n');
+		repr_writer_indent (writer, level + 1);
+		repr_writer_putc (writer, ' ');
+		repr_writer_puts (writer, SP_REPR_ATTRIBUTE_KEY (attr));
+		repr_writer_write (writer, "=\"", 2);
+		repr_quote_write (writer, SP_REPR_ATTRIBUTE_VALUE (attr));
+		repr_writer_putc (writer, '"');
+	}
+}
+
+static void
+repr_write_end_element (SPReprWriter *writer, SPRepr *repr, const SPReprWriterLevel *open)
+{
+	if (open->loose) repr_writer_indent (writer, open->level);
+	repr_writer_write (writer, "</", 2);
+	repr_writer_puts (writer, sp_repr_name (repr));
+	repr_writer_write (writer, ">\n", 2);
+}
+
+/*
+ * Walks tree iteratively along parent/next links; open elements are
+ * kept on explicit stack instead of recursing per element
+ */
+static void
+repr_write_tree (SPReprWriter *writer, SPRepr *top, gint level)
+{
+	SPReprWriterLevel *stack;
+	SPRepr *repr;
+	gint depth, size;
+
+	size = 32;
+	stack = g_new (SPReprWriterLevel, size);
+	depth = 0;
+
+	repr = top;
+	while (repr) {
+		if ((repr != top) && (repr->type == SP_XML_TEXT_NODE)) {
+			repr_quote_write (writer, sp_repr_content (repr));
+		} else {
+			if (level > 16) level = 16;
+			repr_write_start_element (writer, repr, level);
+			if (repr->children) {
+				SPRepr *child;
+				if (depth >= size) {
+					size <<= 1;
+					stack = g_renew (SPReprWriterLevel, stack, size);
+				}
+				stack[depth].level = level;
+				stack[depth].loose = TRUE;
+				for (child = repr->children; child != NULL; child = child->next) {
+					if (child->type == SP_XML_TEXT_NODE) {
+						stack[depth].loose = FALSE;
+						break;
+					}
+				}
+				repr_writer_putc (writer, '>');
+				if (stack[depth].loose) repr_writer_putc (writer, '\n');
+				level = (stack[depth].loose) ? (level + 1) : 0;
+				depth += 1;
+				repr = repr->children;
+				continue;
 			}
+			repr_writer_write (writer, " />\n", 4);
 		}
-		
-		if (loose) {
-			for (i = 0; i < level; i++) fputs ("  ", file);
+
+		/* Advance to next sibling, closing finished ancestors */
+		while ((repr != top) && !repr->next) {
+			repr = repr->parent;
+			depth -= 1;
+			repr_write_end_element (writer, repr, &stack[depth]);
+			level = stack[depth].level;
 		}
-		fprintf (file, "</%s>\n", sp_repr_name (repr));
-	} else {
-		fputs (" />\n", file);
+		repr = (repr != top) ? repr->next : NULL;
 	}
+
+	g_free (stack);
 }
 
 #ifdef HAVE_LIBWMF
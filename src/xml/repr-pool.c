@@ -0,0 +1,466 @@
+#define __SP_REPR_POOL_C__
+
+/*
+ * Memory pools and attribute values for repr trees
+ *
+ * Nodes, attribute arrays, listeners and attribute values of one document
+ * are carved from large chunks owned by the document pool, so building and
+ * destroying big documents costs a few large allocations instead of
+ * millions of small ones.  Attribute values are refcounted strings and may
+ * optionally be interned, so repeated style/class values are stored only
+ * once.
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "repr-private.h"
+
+#define SP_REPR_POOL_CHUNK_SIZE (64 * 1024)
+#define SP_REPR_POOL_QUANTUM 8
+#define SP_REPR_POOL_MAX_BLOCK 512
+#define SP_REPR_POOL_N_CLASSES (SP_REPR_POOL_MAX_BLOCK / SP_REPR_POOL_QUANTUM)
+
+/* Values longer than this are never interned (path data etc.) */
+#define SP_REPR_VALUE_INTERN_MAX_LENGTH 256
+
+typedef struct _SPReprPoolChunk SPReprPoolChunk;
+typedef struct _SPReprPoolBlock SPReprPoolBlock;
+typedef struct _SPReprValue SPReprValue;
+
+struct _SPReprPoolChunk {
+	SPReprPoolChunk *next;
+	/* Keeps data 8-byte aligned */
+	double data[1];
+};
+
+struct _SPReprPoolBlock {
+	SPReprPoolBlock *next;
+};
+
+struct _SPReprPool {
+	int refcount;
+	SPReprPoolChunk *chunks;
+	char *pos, *end;
+	SPReprPoolBlock *free[SP_REPR_POOL_N_CLASSES];
+	SPReprPoolStats stats;
+};
+
+struct _SPReprValue {
+	/* Values may outlive their node, so they keep pool alive too */
+	SPReprPool *pool;
+	unsigned int refcount;
+	unsigned int interned;
+};
+
+#define SP_REPR_VALUE_HEADER(v) ((SPReprValue *) ((v) - sizeof (SPReprValue)))
+#define SP_REPR_VALUE_STRING(h) ((gchar *) (h) + sizeof (SPReprValue))
+
+static SPReprPool *default_pool = NULL;
+static SPReprPool *current_pool = NULL;
+
+static unsigned int intern_values = FALSE;
+static GHashTable *intern_table = NULL;
+static SPReprValueStats value_stats = {0, 0, 0, 0, 0, 0};
+
+SPReprPool *
+sp_repr_pool_new (void)
+{
+	SPReprPool *pool;
+
+	pool = g_new0 (SPReprPool, 1);
+	pool->refcount = 1;
+
+	return pool;
+}
+
+SPReprPool *
+sp_repr_pool_ref (SPReprPool *pool)
+{
+	g_return_val_if_fail (pool != NULL, NULL);
+
+	pool->refcount += 1;
+
+	return pool;
+}
+
+SPReprPool *
+sp_repr_pool_unref (SPReprPool *pool)
+{
+	g_return_val_if_fail (pool != NULL, NULL);
+	g_return_val_if_fail (pool->refcount > 0, NULL);
+
+	pool->refcount -= 1;
+
+	if (pool->refcount < 1) {
+		while (pool->chunks) {
+			SPReprPoolChunk *chunk;
+			chunk = pool->chunks;
+			pool->chunks = chunk->next;
+			g_free (chunk);
+		}
+		if (current_pool == pool) current_pool = NULL;
+		g_free (pool);
+	}
+
+	return NULL;
+}
+
+/**
+ * Returns pool that is never freed, for nodes and values not belonging
+ * to any document
+ */
+SPReprPool *
+sp_repr_pool_get_default (void)
+{
+	if (!default_pool) default_pool = sp_repr_pool_new ();
+
+	return default_pool;
+}
+
+/**
+ * Returns pool new nodes are allocated from, unless they are
+ * duplicated from existing node
+ */
+SPReprPool *
+sp_repr_pool_get_current (void)
+{
+	if (current_pool) return current_pool;
+
+	return sp_repr_pool_get_default ();
+}
+
+/**
+ * Makes pool current; returns previous one, which should be restored
+ * afterwards.  NULL restores default pool.
+ */
+SPReprPool *
+sp_repr_pool_set_current (SPReprPool *pool)
+{
+	SPReprPool *previous;
+
+	previous = current_pool;
+	current_pool = pool;
+
+	return previous;
+}
+
+void *
+sp_repr_pool_alloc (SPReprPool *pool, SPReprPoolKind kind, size_t size)
+{
+	unsigned int cls;
+	void *mem;
+
+	g_assert (pool != NULL);
+	g_assert (size > 0);
+
+	pool->stats.live_bytes[kind] += size;
+	pool->stats.live_objects[kind] += 1;
+
+	if (size > SP_REPR_POOL_MAX_BLOCK) {
+		pool->stats.large_bytes += size;
+		return g_malloc (size);
+	}
+
+	cls = (size - 1) / SP_REPR_POOL_QUANTUM;
+
+	if (pool->free[cls]) {
+		mem = pool->free[cls];
+		pool->free[cls] = pool->free[cls]->next;
+		return mem;
+	}
+
+	size = (cls + 1) * SP_REPR_POOL_QUANTUM;
+	if (pool->pos + size > pool->end) {
+		SPReprPoolChunk *chunk;
+		/* Tail of previous chunk is simply abandoned */
+		chunk = (SPReprPoolChunk *) g_malloc (sizeof (SPReprPoolChunk) + SP_REPR_POOL_CHUNK_SIZE);
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+		pool->pos = (char *) chunk->data;
+		pool->end = pool->pos + SP_REPR_POOL_CHUNK_SIZE;
+		pool->stats.chunk_bytes += SP_REPR_POOL_CHUNK_SIZE;
+		pool->stats.n_chunks += 1;
+	}
+
+	mem = pool->pos;
+	pool->pos += size;
+
+	return mem;
+}
+
+void
+sp_repr_pool_free (SPReprPool *pool, SPReprPoolKind kind, void *mem, size_t size)
+{
+	SPReprPoolBlock *block;
+	unsigned int cls;
+
+	g_assert (pool != NULL);
+	g_assert (mem != NULL);
+
+	pool->stats.live_bytes[kind] -= size;
+	pool->stats.live_objects[kind] -= 1;
+
+	if (size > SP_REPR_POOL_MAX_BLOCK) {
+		pool->stats.large_bytes -= size;
+		g_free (mem);
+		return;
+	}
+
+	cls = (size - 1) / SP_REPR_POOL_QUANTUM;
+	block = (SPReprPoolBlock *) mem;
+	block->next = pool->free[cls];
+	pool->free[cls] = block;
+}
+
+const SPReprPoolStats *
+sp_repr_pool_get_stats (const SPReprPool *pool)
+{
+	g_return_val_if_fail (pool != NULL, NULL);
+
+	return &pool->stats;
+}
+
+/* Attribute values */
+
+void
+sp_repr_set_value_interning (unsigned int intern)
+{
+	intern_values = intern;
+}
+
+/* Long strings (path data etc.) exceed pool block size and get own malloc */
+static SPReprValue *
+sp_repr_value_alloc (SPReprPool *pool, const gchar *str, size_t len)
+{
+	SPReprValue *header;
+
+	header = (SPReprValue *) sp_repr_pool_alloc (pool, SP_REPR_POOL_VALUE, sizeof (SPReprValue) + len + 1);
+	header->pool = sp_repr_pool_ref (pool);
+	header->refcount = 1;
+	header->interned = FALSE;
+	memcpy (SP_REPR_VALUE_STRING (header), str, len + 1);
+
+	value_stats.bytes += sizeof (SPReprValue) + len + 1;
+
+	return header;
+}
+
+/**
+ * Creates new refcounted value with copy of str in pool, or returns
+ * reference to existing interned one
+ */
+gchar *
+sp_repr_value_new (SPReprPool *pool, const gchar *str)
+{
+	SPReprValue *header;
+	size_t len;
+
+	g_return_val_if_fail (pool != NULL, NULL);
+	g_return_val_if_fail (str != NULL, NULL);
+
+	len = strlen (str);
+
+	if (!intern_values || (len > SP_REPR_VALUE_INTERN_MAX_LENGTH)) {
+		return SP_REPR_VALUE_STRING (sp_repr_value_alloc (pool, str, len));
+	}
+
+	if (!intern_table) intern_table = g_hash_table_new (g_str_hash, g_str_equal);
+
+	value_stats.intern_lookups += 1;
+
+	header = (SPReprValue *) g_hash_table_lookup (intern_table, str);
+	if (header) {
+		value_stats.intern_hits += 1;
+		header->refcount += 1;
+		return SP_REPR_VALUE_STRING (header);
+	}
+
+	/* Interned values are shared between documents, so they live in default pool */
+	header = sp_repr_value_alloc (sp_repr_pool_get_default (), str, len);
+	header->interned = TRUE;
+	g_hash_table_insert (intern_table, SP_REPR_VALUE_STRING (header), header);
+	value_stats.interned += 1;
+
+	return SP_REPR_VALUE_STRING (header);
+}
+
+gchar *
+sp_repr_value_ref (gchar *value)
+{
+	g_return_val_if_fail (value != NULL, NULL);
+
+	SP_REPR_VALUE_HEADER (value)->refcount += 1;
+
+	return value;
+}
+
+void
+sp_repr_value_unref (gchar *value)
+{
+	SPReprValue *header;
+
+	if (!value) return;
+
+	header = SP_REPR_VALUE_HEADER (value);
+	g_return_if_fail (header->refcount > 0);
+
+	header->refcount -= 1;
+	if (header->refcount < 1) {
+		SPReprPool *pool;
+		size_t size;
+		if (header->interned) {
+			g_hash_table_remove (intern_table, value);
+			value_stats.interned -= 1;
+		}
+		size = sizeof (SPReprValue) + strlen (value) + 1;
+		value_stats.bytes -= size;
+		pool = header->pool;
+		sp_repr_pool_free (pool, SP_REPR_POOL_VALUE, header, size);
+		sp_repr_pool_unref (pool);
+	}
+}
+
+const SPReprValueStats *
+sp_repr_value_get_stats (void)
+{
+	return &value_stats;
+}
+
+/* Typed values */
+
+SPReprTyped *
+sp_repr_typed_new (SPReprPool *pool, const SPReprValueType *type, void *data)
+{
+	SPReprTyped *typed;
+
+	g_return_val_if_fail (pool != NULL, NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+	g_return_val_if_fail (data != NULL, NULL);
+
+	typed = (SPReprTyped *) sp_repr_pool_alloc (pool, SP_REPR_POOL_TYPED, sizeof (SPReprTyped));
+	typed->pool = sp_repr_pool_ref (pool);
+	typed->refcount = 1;
+	typed->type = type;
+	typed->data = data;
+	typed->string = NULL;
+
+	value_stats.typed += 1;
+
+	return typed;
+}
+
+SPReprTyped *
+sp_repr_typed_ref (SPReprTyped *typed)
+{
+	g_return_val_if_fail (typed != NULL, NULL);
+
+	typed->refcount += 1;
+
+	return typed;
+}
+
+void
+sp_repr_typed_unref (SPReprTyped *typed)
+{
+	g_return_if_fail (typed != NULL);
+	g_return_if_fail (typed->refcount > 0);
+
+	typed->refcount -= 1;
+	if (typed->refcount < 1) {
+		SPReprPool *pool;
+		if (typed->type->free) typed->type->free (typed->data);
+		sp_repr_value_unref (typed->string);
+		value_stats.typed -= 1;
+		pool = typed->pool;
+		sp_repr_pool_free (pool, SP_REPR_POOL_TYPED, typed, sizeof (SPReprTyped));
+		sp_repr_pool_unref (pool);
+	}
+}
+
+const gchar *
+sp_repr_typed_string (SPReprTyped *typed)
+{
+	g_return_val_if_fail (typed != NULL, NULL);
+
+	if (!typed->string) {
+		gchar *str;
+		str = typed->type->to_string (typed->data);
+		typed->string = sp_repr_value_new (typed->pool, str);
+		g_free (str);
+		value_stats.typed_stringified += 1;
+	}
+
+	return typed->string;
+}
+
+static void
+sp_repr_count_values (const SPRepr *repr, unsigned int *n_values, size_t *value_bytes)
+{
+	const SPRepr *child;
+	unsigned int i;
+
+	for (i = 0; i < repr->n_attributes; i++) {
+		*n_values += 1;
+		/* Typed values are not stringified just for counting */
+		if (repr->attributes[i].value) *value_bytes += strlen (repr->attributes[i].value) + 1;
+	}
+
+	for (child = repr->children; child != NULL; child = child->next) {
+		sp_repr_count_values (child, n_values, value_bytes);
+	}
+}
+
+/**
+ * Prints memory used by document pool and its attribute values
+ */
+void
+sp_repr_print_memory_report (SPReprDoc *doc, FILE *file)
+{
+	static const char *kind_names[SP_REPR_POOL_N_KINDS] = {
+		"document", "element", "text", "attributes", "listener", "value", "typed"
+	};
+	const SPReprPoolStats *stats;
+	unsigned int n_values;
+	size_t value_bytes;
+	int i;
+
+	g_return_if_fail (doc != NULL);
+	g_return_if_fail (file != NULL);
+
+	stats = sp_repr_pool_get_stats (doc->repr.pool);
+
+	fprintf (file, "Repr pool: %u chunks, %lu bytes in chunks, %lu bytes in large blocks\n",
+		 stats->n_chunks, (unsigned long) stats->chunk_bytes, (unsigned long) stats->large_bytes);
+	for (i = 0; i < SP_REPR_POOL_N_KINDS; i++) {
+		fprintf (file, "  %-12s %10u objects %12lu bytes\n",
+			 kind_names[i], stats->live_objects[i], (unsigned long) stats->live_bytes[i]);
+	}
+
+	n_values = 0;
+	value_bytes = 0;
+	sp_repr_count_values (&doc->repr, &n_values, &value_bytes);
+	fprintf (file, "Attribute values: %u in tree, %lu bytes as plain strings\n",
+		 n_values, (unsigned long) value_bytes);
+}
+
+/**
+ * Prints value store statistics, which are shared by all documents
+ */
+void
+sp_repr_print_value_report (FILE *file)
+{
+	g_return_if_fail (file != NULL);
+
+	fprintf (file, "Value store: %lu bytes live, %u interned, intern hit rate %.1f%% (%u of %u)\n",
+		 (unsigned long) value_stats.bytes, value_stats.interned,
+		 (value_stats.intern_lookups) ? 100.0 * value_stats.intern_hits / value_stats.intern_lookups : 0.0,
+		 value_stats.intern_hits, value_stats.intern_lookups);
+	fprintf (file, "Typed values: %u live, %u stringified\n",
+		 value_stats.typed, value_stats.typed_stringified);
+}
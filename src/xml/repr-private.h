@@ -21,19 +21,73 @@ typedef struct _SPReprClass SPReprClass;
 typedef struct _SPReprAttr SPReprAttr;
 typedef struct _SPReprListener SPReprListener;
 typedef struct _SPReprEventVector SPReprEventVector;
+typedef struct _SPReprPool SPReprPool;
+typedef struct _SPReprPoolStats SPReprPoolStats;
+typedef struct _SPReprValueStats SPReprValueStats;
+
+typedef enum {
+	SP_REPR_POOL_DOCUMENT,
+	SP_REPR_POOL_ELEMENT,
+	SP_REPR_POOL_TEXT,
+	SP_REPR_POOL_ATTRIBUTES,
+	SP_REPR_POOL_LISTENER,
+	SP_REPR_POOL_VALUE,
+	SP_REPR_POOL_TYPED,
+	SP_REPR_POOL_N_KINDS
+} SPReprPoolKind;
+
+struct _SPReprPoolStats {
+	unsigned int n_chunks;
+	size_t chunk_bytes;
+	size_t large_bytes;
+	unsigned int live_objects[SP_REPR_POOL_N_KINDS];
+	size_t live_bytes[SP_REPR_POOL_N_KINDS];
+};
+
+struct _SPReprValueStats {
+	unsigned int intern_lookups;
+	unsigned int intern_hits;
+	unsigned int interned;
+	size_t bytes;
+	unsigned int typed;
+	unsigned int typed_stringified;
+};
 
 struct _SPReprClass {
 	size_t size;
-	SPRepr *pool;
+	SPReprPoolKind kind;
 	void (*init)(SPRepr *repr);
 	void (*copy)(SPRepr *to, const SPRepr *from);
 	void (*finalize)(SPRepr *repr);
 };
 
+/*
+ * Attributes are kept in a flat array in insertion order, which is also
+ * the order they are written in.  Lookup is a binary search over a
+ * separate array of slots sorted by key quark, allocated in the same
+ * block.  The first few attributes live inline in the node itself.
+ */
+
+#define SP_REPR_ATTR_INLINE_SIZE 4
+#define SP_REPR_ATTR_MAX 0xffff
+
+/*
+ * Attribute holds either refcounted string value, or typed value
+ * (value is NULL then), whose string form is generated on demand
+ */
+
 struct _SPReprAttr {
-	SPReprAttr *next;
 	int key;
 	gchar *value;
+	SPReprTyped *typed;
+};
+
+struct _SPReprTyped {
+	SPReprPool *pool;
+	unsigned int refcount;
+	const SPReprValueType *type;
+	void *data;
+	gchar *string;
 };
 
 struct _SPReprListener {
@@ -55,10 +109,14 @@ struct _SPReprEventVector {
 	void (* content_changed) (SPRepr *repr, const gchar *oldcontent, const gchar *newcontent, void * data);
 	unsigned int (* change_order) (SPRepr *repr, SPRepr *child, SPRepr *oldref, SPRepr *newref, void * data);
 	void (* order_changed) (SPRepr *repr, SPRepr *child, SPRepr *oldref, SPRepr *newref, void * data);
+	/* Handlers reread changed attributes from repr, so typed values are not stringified */
+	/* for this listener (oldval/newval are NULL for typed values without string form) */
+	unsigned int typed_values;
 };
 
 struct _SPRepr {
 	SPReprClass *type;
+	SPReprPool *pool;
 	int refcount;
 
 	int name;
@@ -68,7 +126,18 @@ struct _SPRepr {
 	SPRepr *next;
 	SPRepr *children;
 
+	/* Cached child count and sibling positions (valid if positions_valid) */
+	unsigned int n_children;
+	unsigned int position;
+	unsigned int positions_valid : 1;
+
+	unsigned int n_attributes;
+	unsigned int attributes_size;
 	SPReprAttr *attributes;
+	unsigned short *attribute_order;
+	SPReprAttr inline_attributes[SP_REPR_ATTR_INLINE_SIZE];
+	unsigned short inline_order[SP_REPR_ATTR_INLINE_SIZE];
+
 	SPReprListener *listeners;
 	gchar *content;
 };
@@ -88,7 +157,10 @@ struct _SPXMLNs {
 #define SP_REPR_TYPE(r) ((r)->type)
 #define SP_REPR_CONTENT(r) ((r)->content)
 #define SP_REPR_ATTRIBUTE_KEY(a) g_quark_to_string ((a)->key)
-#define SP_REPR_ATTRIBUTE_VALUE(a) ((a)->value)
+#define SP_REPR_ATTRIBUTE_VALUE(a) sp_repr_attribute_value (a)
+
+#define SP_REPR_N_ATTRIBUTES(r) ((r)->n_attributes)
+#define SP_REPR_NTH_ATTRIBUTE(r,n) ((r)->attributes + (n))
 
 extern SPReprClass _sp_repr_xml_document_class;
 extern SPReprClass _sp_repr_xml_element_class;
@@ -99,6 +171,9 @@ extern SPReprClass _sp_repr_xml_text_class;
 #define SP_XML_TEXT_NODE &_sp_repr_xml_text_class
 
 SPRepr *sp_repr_nth_child (const SPRepr *repr, int n);
+const gchar *sp_repr_attribute_value (const SPReprAttr *attr);
+unsigned int sp_repr_set_attr_value (SPRepr *repr, unsigned int key, unsigned int pos, const gchar *value, SPReprTyped *typed);
+int sp_repr_child_position (const SPRepr *repr);
 
 unsigned int sp_repr_change_order (SPRepr *repr, SPRepr *child, SPRepr *ref);
 
@@ -109,4 +184,30 @@ void sp_repr_remove_listener_by_data (SPRepr *repr, void * data);
 
 void sp_repr_document_set_root (SPReprDoc *doc, SPRepr *repr);
 
+/* Pools */
+
+SPReprPool *sp_repr_pool_new (void);
+SPReprPool *sp_repr_pool_ref (SPReprPool *pool);
+SPReprPool *sp_repr_pool_unref (SPReprPool *pool);
+SPReprPool *sp_repr_pool_get_default (void);
+SPReprPool *sp_repr_pool_get_current (void);
+SPReprPool *sp_repr_pool_set_current (SPReprPool *pool);
+void *sp_repr_pool_alloc (SPReprPool *pool, SPReprPoolKind kind, size_t size);
+void sp_repr_pool_free (SPReprPool *pool, SPReprPoolKind kind, void *mem, size_t size);
+const SPReprPoolStats *sp_repr_pool_get_stats (const SPReprPool *pool);
+
+/* Attribute values are refcounted, and have to be released with sp_repr_value_unref */
+
+gchar *sp_repr_value_new (SPReprPool *pool, const gchar *str);
+gchar *sp_repr_value_ref (gchar *value);
+void sp_repr_value_unref (gchar *value);
+const SPReprValueStats *sp_repr_value_get_stats (void);
+
+/* Typed values are immutable and refcounted, string is cached on first request */
+
+SPReprTyped *sp_repr_typed_new (SPReprPool *pool, const SPReprValueType *type, void *data);
+SPReprTyped *sp_repr_typed_ref (SPReprTyped *typed);
+void sp_repr_typed_unref (SPReprTyped *typed);
+const gchar *sp_repr_typed_string (SPReprTyped *typed);
+
 #endif
@@ -0,0 +1,174 @@
+#define __REPR_SAVE_BENCH_C__
+
+/*
+ * Benchmark for repr serializer
+ *
+ * Builds large synthetic document and times plain and compressed
+ * saves of it.  Results can be written as tab separated lines of
+ * measurement, paths and milliseconds, for comparing builds.
+ *
+ * Usage: repr-save-bench [-n NUMBER_OF_PATHS] [-d DIRECTORY] [-o RESULTS]
+ *
+ * Released under GNU GPL, read the file 'COPYING' for more information
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <glib.h>
+
+#include "repr.h"
+
+static FILE *results = NULL;
+
+static double
+get_time (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+
+	return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+static SPReprDoc *
+build_document (int n_paths)
+{
+	SPReprDoc *doc;
+	SPRepr *root, *group, *path;
+	GString *d;
+	gchar c[64];
+	int i, j;
+
+	doc = sp_repr_document_new ("svg");
+	root = sp_repr_document_root (doc);
+	sp_repr_set_attr (root, "width", "1000");
+	sp_repr_set_attr (root, "height", "1000");
+
+	d = g_string_new ("");
+	group = NULL;
+	for (i = 0; i < n_paths; i++) {
+		if ((i % 100) == 0) {
+			group = sp_repr_new ("g");
+			g_snprintf (c, 64, "layer%d", i / 100);
+			sp_repr_set_attr (group, "id", c);
+			sp_repr_append_child (root, group);
+			sp_repr_unref (group);
+		}
+		g_string_assign (d, "M 0 0");
+		for (j = 0; j < 32; j++) {
+			g_snprintf (c, 64, " C %d.5 %d.25 %d %d %d.125 %d", i + j, j, i, j * 2, j, i - j);
+			g_string_append (d, c);
+		}
+		g_string_append (d, " z");
+		path = sp_repr_new ("path");
+		g_snprintf (c, 64, "path%d", i);
+		sp_repr_set_attr (path, "id", c);
+		sp_repr_set_attr (path, "style", "fill:#ff0000;stroke:#000000;stroke-width:1.0 & <more>");
+		sp_repr_set_attr (path, "d", d->str);
+		sp_repr_append_child (group, path);
+		sp_repr_unref (path);
+	}
+	g_string_free (d, TRUE);
+
+	return doc;
+}
+
+static void
+bench_report (const gchar *measure, int n_paths, double seconds)
+{
+	if (results) {
+		fprintf (results, "%s\t%d\t%.3f\n", measure, n_paths, 1000.0 * seconds);
+	}
+}
+
+static unsigned int
+time_save (SPReprDoc *doc, const gchar *filename, int n_paths, int n_runs)
+{
+	struct stat st;
+	double start, end;
+	int i;
+
+	start = get_time ();
+	for (i = 0; i < n_runs; i++) {
+		if (!sp_repr_save_file (doc, filename)) {
+			fprintf (stderr, "Cannot save %s\n", filename);
+			unlink (filename);
+			return FALSE;
+		}
+	}
+	end = get_time ();
+
+	if (stat (filename, &st)) st.st_size = 0;
+
+	printf ("%-24s %8.2f ms per save %10lu bytes %8.2f MB/s\n",
+		strrchr (filename, '.'), 1000.0 * (end - start) / n_runs, (unsigned long) st.st_size,
+		(end > start) ? n_runs * st.st_size / (1048576.0 * (end - start)) : 0.0);
+	bench_report (strrchr (filename, '.') + 1, n_paths, (end - start) / n_runs);
+
+	unlink (filename);
+
+	return TRUE;
+}
+
+int
+main (int argc, const char **argv)
+{
+	SPReprDoc *doc;
+	const gchar *dir;
+	gchar *filename;
+	double start, end;
+	unsigned int saved;
+	int n_paths, i;
+
+	n_paths = 20000;
+	dir = g_get_tmp_dir ();
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && (i + 1 < argc)) {
+			n_paths = atoi (argv[++i]);
+		} else if (!strcmp (argv[i], "-d") && (i + 1 < argc)) {
+			dir = argv[++i];
+		} else if (!strcmp (argv[i], "-o") && (i + 1 < argc)) {
+			results = fopen (argv[++i], "w");
+			if (!results) {
+				fprintf (stderr, "Cannot write results to %s\n", argv[i]);
+				return 1;
+			}
+		} else {
+			fprintf (stderr, "Usage: %s [-n NUMBER_OF_PATHS] [-d DIRECTORY] [-o RESULTS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (results) {
+		fprintf (results, "# repr-save-bench %s\n", INKSCAPE_VERSION);
+	}
+
+	start = get_time ();
+	doc = build_document (n_paths);
+	end = get_time ();
+	printf ("Built document with %d paths in %.2f ms\n", n_paths, 1000.0 * (end - start));
+	bench_report ("build", n_paths, end - start);
+
+	filename = g_strdup_printf ("%s/repr-save-bench.svg", dir);
+	saved = time_save (doc, filename, n_paths, 5);
+	g_free (filename);
+
+	if (saved) {
+		filename = g_strdup_printf ("%s/repr-save-bench.svgz", dir);
+		saved = time_save (doc, filename, n_paths, 5);
+		g_free (filename);
+	}
+
+	sp_repr_document_unref (doc);
+
+	if (results) fclose (results);
+
+	return (saved) ? 0 : 1;
+}
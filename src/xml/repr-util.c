@@ -176,9 +176,7 @@ sp_xml_document_createTextNode (SPXMLDocument *doc, const gchar *data)
 {
 	SPXMLText *text;
 
-	text = sp_repr_new ("text");
-	text->type = SP_XML_TEXT_NODE;
-	sp_repr_set_content (text, data);
+	text = sp_repr_new_text (data);
 
 	return text;
 }
@@ -332,23 +330,10 @@ sp_repr_compare_position (SPRepr * first, SPRepr * second)
 int
 sp_repr_position (SPRepr * repr)
 {
-	SPRepr * parent;
-	SPRepr * sibling;
-	int pos;
-
 	g_assert (repr != NULL);
-	parent = sp_repr_parent (repr);
-	g_assert (parent != NULL);
-
-	pos = 0;
-	for (sibling = parent->children; sibling != NULL; sibling = sibling->next) {
-		if (repr == sibling) return pos;
-		pos += 1;
-	}
-	
-	g_assert_not_reached ();
+	g_assert (sp_repr_parent (repr) != NULL);
 
-	return -1;
+	return sp_repr_child_position (repr);
 }
 
 void
@@ -365,15 +350,9 @@ sp_repr_set_position_relative (SPRepr * repr, int pos)
 int
 sp_repr_n_children (SPRepr * repr)
 {
-	SPRepr * child;
-	int n;
-
 	g_assert (repr != NULL);
 
-	n = 0;
-	for (child = repr->children; child != NULL; child = child->next) n++;
-
-	return n;
+	return repr->n_children;
 }
 
 void
@@ -484,22 +463,22 @@ sp_repr_lookup_child (SPRepr       *repr,
                       const gchar *value)
 {
 	SPRepr *child;
-	SPReprAttr *attr;
 	unsigned int quark;
+	unsigned int pos;
 
 	g_return_val_if_fail (repr != NULL, NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 	g_return_val_if_fail (value != NULL, NULL);
 
-	quark = g_quark_from_string (key);
+	quark = g_quark_try_string (key);
+	if (!quark) return NULL;
 
 	/* Fixme: we should use hash table for faster lookup? */
 	
 	for (child = repr->children; child != NULL; child = child->next) {
-		for (attr = child->attributes; attr != NULL; attr = attr->next) {
-			if ( (INK_STATIC_CAST(unsigned int, attr->key) == quark) && !strcmp (attr->value, value))
-				return child;
-		}
+		const gchar *cval;
+		cval = sp_repr_attr_quark (child, quark);
+		if (cval && !strcmp (cval, value)) return child;
 	}
 
 	return NULL;
@@ -40,10 +40,11 @@ static void repr_finalize (SPRepr *repr);
 static void repr_doc_finalize (SPRepr *repr);
 
 static void bind_document (SPReprDoc *doc, SPRepr *repr);
+static unsigned int sp_repr_remove_child_after (SPRepr *repr, SPRepr *child, SPRepr *ref);
 
 SPReprClass _sp_repr_xml_document_class = {
 	sizeof (SPReprDoc),
-	NULL,
+	SP_REPR_POOL_DOCUMENT,
 	repr_doc_init,
 	repr_doc_copy,
 	repr_doc_finalize
@@ -51,7 +52,7 @@ SPReprClass _sp_repr_xml_document_class = {
 
 SPReprClass _sp_repr_xml_element_class = {
 	sizeof (SPRepr),
-	NULL,
+	SP_REPR_POOL_ELEMENT,
 	repr_init,
 	repr_copy,
 	repr_finalize
@@ -59,32 +60,33 @@ SPReprClass _sp_repr_xml_element_class = {
 
 SPReprClass _sp_repr_xml_text_class = {
 	sizeof (SPRepr),
-	NULL,
+	SP_REPR_POOL_TEXT,
 	repr_init,
 	repr_copy,
 	repr_finalize
 };
 
-static SPRepr *sp_repr_new_from_code (SPReprClass *type, int code);
-static void sp_repr_remove_attribute (SPRepr *repr, SPReprAttr *attr);
+static SPRepr *sp_repr_new_from_code (SPReprClass *type, int code, SPReprPool *pool);
 static void sp_repr_remove_listener (SPRepr *repr, SPListener *listener);
 
-static SPReprAttr *sp_attribute_duplicate (const SPReprAttr *attr);
-static SPReprAttr *sp_attribute_new_from_code (int key, const gchar *value);
+static unsigned int sp_repr_attr_search (const SPRepr *repr, int key, unsigned int *idx);
+static unsigned int sp_repr_attr_find (const SPRepr *repr, int key, unsigned int *pos);
+static void sp_repr_attr_insert (SPRepr *repr, unsigned int pos, int key, gchar *value, SPReprTyped *typed);
+static void sp_repr_attr_remove (SPRepr *repr, unsigned int pos);
+static void sp_repr_attr_clear (SPRepr *repr);
+static void sp_repr_renumber_children (const SPRepr *repr);
 
-static SPRepr * sp_repr_alloc (SPReprClass *type);
+static SPRepr * sp_repr_alloc (SPReprClass *type, SPReprPool *pool);
 static void sp_repr_free (SPRepr *repr);
-static SPReprAttr * sp_attribute_alloc (void);
-static void sp_attribute_free (SPReprAttr *attribute);
-static SPListener *sp_listener_alloc (void);
-static void sp_listener_free (SPListener *listener);
+static SPListener *sp_listener_alloc (SPRepr *repr);
+static void sp_listener_free (SPRepr *repr, SPListener *listener);
 
 static SPRepr *
-sp_repr_new_from_code (SPReprClass *type, int code)
+sp_repr_new_from_code (SPReprClass *type, int code, SPReprPool *pool)
 {
 	SPRepr * repr;
 
-	repr = sp_repr_alloc (type);
+	repr = sp_repr_alloc (type, pool);
 	repr->name = code;
 	repr->type->init (repr);
 
@@ -97,7 +99,7 @@ sp_repr_new (const gchar *name)
 	g_return_val_if_fail (name != NULL, NULL);
 	g_return_val_if_fail (*name != '\0', NULL);
 
-	return sp_repr_new_from_code (SP_XML_ELEMENT_NODE, g_quark_from_string (name));
+	return sp_repr_new_from_code (SP_XML_ELEMENT_NODE, g_quark_from_string (name), sp_repr_pool_get_current ());
 }
 
 SPRepr *
@@ -105,7 +107,7 @@ sp_repr_new_text (const gchar *content)
 {
 	SPRepr * repr;
 	g_return_val_if_fail (content != NULL, NULL);
-	repr = sp_repr_new_from_code (SP_XML_TEXT_NODE, g_quark_from_static_string ("text"));
+	repr = sp_repr_new_from_code (SP_XML_TEXT_NODE, g_quark_from_static_string ("text"), sp_repr_pool_get_current ());
 	repr->content = g_strdup (content);
 	repr->type = SP_XML_TEXT_NODE;
 	return repr;
@@ -117,7 +119,13 @@ repr_init (SPRepr *repr)
 	repr->refcount = 1;
 	repr->doc = NULL;
 	repr->parent = repr->next = repr->children = NULL;
-	repr->attributes = NULL;
+	repr->n_children = 0;
+	repr->position = 0;
+	repr->positions_valid = FALSE;
+	repr->n_attributes = 0;
+	repr->attributes_size = SP_REPR_ATTR_INLINE_SIZE;
+	repr->attributes = repr->inline_attributes;
+	repr->attribute_order = repr->inline_order;
 	repr->listeners = NULL;
 	repr->content = NULL;
 }
@@ -174,7 +182,7 @@ repr_finalize (SPRepr *repr)
 		if (rl->vector->destroy) (* rl->vector->destroy) (repr, rl->data);
 	}
 	while (repr->children) sp_repr_remove_child (repr, repr->children);
-	while (repr->attributes) sp_repr_remove_attribute (repr, repr->attributes);
+	sp_repr_attr_clear (repr);
 	g_free (repr->content);
 	while (repr->listeners) sp_repr_remove_listener (repr, repr->listeners);
 }
@@ -208,7 +216,8 @@ sp_repr_duplicate (const SPRepr *repr)
 {
 	SPRepr *new_repr;
 
-	new_repr = sp_repr_new_from_code (repr->type, repr->name);
+	/* Copies live in the same pool as original */
+	new_repr = sp_repr_new_from_code (repr->type, repr->name, repr->pool);
 
 	repr->type->copy (new_repr, repr);
 
@@ -219,7 +228,7 @@ void
 repr_copy (SPRepr *to, const SPRepr *from)
 {
 	SPRepr *child, *lastchild;
-	SPReprAttr *attr, *lastattr;
+	unsigned int i;
 
 	g_return_if_fail (from != NULL);
 
@@ -232,15 +241,16 @@ repr_copy (SPRepr *to, const SPRepr *from)
 		} else {
 			lastchild = to->children = sp_repr_attach (to, sp_repr_duplicate (child));
 		}
+		to->n_children += 1;
 	}
 
-	lastattr = NULL;
-	for (attr = from->attributes; attr != NULL; attr = attr->next) {
-		if (lastattr) {
-			lastattr = lastattr->next = sp_attribute_duplicate (attr);
-		} else {
-			lastattr = to->attributes = sp_attribute_duplicate (attr);
-		}
+	/* Copy keeps source attribute order */
+	for (i = 0; i < from->n_attributes; i++) {
+		SPReprAttr *attr;
+		attr = from->attributes + i;
+		sp_repr_attr_insert (to, i, attr->key,
+				     (attr->value) ? sp_repr_value_ref (attr->value) : NULL,
+				     (attr->typed) ? sp_repr_typed_ref (attr->typed) : NULL);
 	}
 }
 
@@ -276,21 +286,92 @@ sp_repr_content (const SPRepr *repr)
 const gchar *
 sp_repr_attr (const SPRepr *repr, const gchar *key)
 {
-	SPReprAttr *ra;
 	unsigned int q;
 
 	g_return_val_if_fail (repr != NULL, NULL);
 	g_return_val_if_fail (key != NULL, NULL);
 
-	/* retrieve an int identifier specific to this string */
-	q = g_quark_from_string (key);
+	/* Key never interned means no repr can carry it */
+	q = g_quark_try_string (key);
+	if (!q) return NULL;
 
-	for (ra = repr->attributes; ra != NULL; ra = ra->next)
-	{
-		if ( ra->key == q ) {
-			return ra->value;
-		}
-	}
+	return sp_repr_attr_quark (repr, q);
+}
+
+/**
+ * Same as sp_repr_attr, but takes pre-resolved key quark, so hot paths
+ * can avoid hashing the key string on every lookup
+ */
+const gchar *
+sp_repr_attr_quark (const SPRepr *repr, unsigned int key)
+{
+	unsigned int pos;
+
+	g_return_val_if_fail (repr != NULL, NULL);
+
+	if (!sp_repr_attr_find (repr, key, &pos)) return NULL;
+
+	return sp_repr_attribute_value (repr->attributes + pos);
+}
+
+/**
+ * Same as sp_repr_attr_quark, but never generates string form of typed
+ * value; returns NULL for typed value that has not been stringified yet
+ */
+const gchar *
+sp_repr_attr_quark_lazy (const SPRepr *repr, unsigned int key)
+{
+	unsigned int pos;
+
+	g_return_val_if_fail (repr != NULL, NULL);
+
+	if (!sp_repr_attr_find (repr, key, &pos)) return NULL;
+
+	if (repr->attributes[pos].typed) return repr->attributes[pos].typed->string;
+
+	return repr->attributes[pos].value;
+}
+
+/**
+ * Returns binary data of attribute, if it holds typed value of given type
+ */
+const void *
+sp_repr_attr_typed (const SPRepr *repr, const gchar *key, const SPReprValueType *type)
+{
+	unsigned int pos, q;
+
+	g_return_val_if_fail (repr != NULL, NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+
+	q = g_quark_try_string (key);
+	if (!q || !sp_repr_attr_find (repr, q, &pos)) return NULL;
+	if (!repr->attributes[pos].typed || (repr->attributes[pos].typed->type != type)) return NULL;
+
+	return repr->attributes[pos].typed->data;
+}
+
+/*
+ * String form of attribute value; typed values are stringified and
+ * cached on first request
+ */
+const gchar *
+sp_repr_attribute_value (const SPReprAttr *attr)
+{
+	if (attr->typed) return sp_repr_typed_string (attr->typed);
+
+	return attr->value;
+}
+
+/*
+ * Value as given to listener; only listeners asking for typed values
+ * are not forced to stringify them, as NULL looks like removal otherwise
+ */
+static const gchar *
+sp_repr_listener_value (const SPReprEventVector *vector, const gchar *value, SPReprTyped *typed)
+{
+	if (!typed) return value;
+	if (typed->string || !vector->typed_values) return sp_repr_typed_string (typed);
 
 	return NULL;
 }
@@ -334,112 +415,121 @@ sp_repr_set_content (SPRepr *repr, const gchar *newcontent)
 }
 
 static unsigned int
-sp_repr_del_attr (SPRepr *repr, const gchar *key)
+sp_repr_del_attr (SPRepr *repr, unsigned int q)
 {
-	SPReprAttr *prev, *attr;
 	SPReprListener *rl;
 	unsigned int allowed;
-	unsigned int q;
-
-	g_return_val_if_fail (repr != NULL, FALSE);
-	g_return_val_if_fail (key != NULL, FALSE);
-	g_return_val_if_fail (*key != '\0', FALSE);
+	unsigned int pos;
+	const gchar *key;
+	gchar *oldval;
+	SPReprTyped *oldtyped;
 
 	allowed = TRUE;
 
-	q = g_quark_from_string (key);
-	prev = NULL;
-	for (attr = repr->attributes; attr && (attr->key != q); attr = attr->next)
-	{
-		prev = attr;
-	}
-
-	if (attr) {
-		gchar *oldval;
-
-		oldval = attr->value;
+	if (sp_repr_attr_find (repr, q, &pos)) {
+		key = g_quark_to_string (q);
+		oldval = repr->attributes[pos].value;
+		oldtyped = repr->attributes[pos].typed;
 
 		for (rl = repr->listeners; rl && allowed; rl = rl->next) {
-			if (rl->vector->change_attr) allowed = (* rl->vector->change_attr) (repr, key, oldval, NULL, rl->data);
+			if (rl->vector->change_attr) {
+				allowed = (* rl->vector->change_attr) (repr, key, sp_repr_listener_value (rl->vector, oldval, oldtyped),
+								       NULL, rl->data);
+			}
 		}
 
-		if (allowed) {
-			if (prev) {
-				prev->next = attr->next;
-			} else {
-				repr->attributes = attr->next;
-			}
+		/* Veto handlers may have touched the array */
+		if (allowed && sp_repr_attr_find (repr, q, &pos)) {
+			sp_repr_attr_remove (repr, pos);
 
 			if ( repr->doc && repr->doc->is_logging ) {
-				repr->doc->log = sp_repr_log_chgattr (repr->doc->log, repr, q, oldval, NULL);
+				repr->doc->log = sp_repr_log_chgattr (repr->doc->log, repr, q, pos, oldval, oldtyped, NULL, NULL);
 			}
 			for (rl = repr->listeners; rl != NULL; rl = rl->next) {
-				if (rl->vector->attr_changed) (* rl->vector->attr_changed) (repr, key, oldval, NULL, rl->data);
+				if (rl->vector->attr_changed) {
+					(* rl->vector->attr_changed) (repr, key, sp_repr_listener_value (rl->vector, oldval, oldtyped),
+								      NULL, rl->data);
+				}
 			}
-			if ( repr->doc && repr->doc->is_logging ) {
-				attr->value = NULL;
+			if ( !repr->doc || !repr->doc->is_logging ) {
+				sp_repr_value_unref (oldval);
+				if (oldtyped) sp_repr_typed_unref (oldtyped);
 			}
-
-			sp_attribute_free (attr);
 		}
 	}
 
 	return allowed;
 }
 
+/*
+ * Sets either string value or typed value (borrowed reference); new
+ * attribute is inserted at slot newpos, or appended if that is past end
+ */
 static unsigned int
-sp_repr_chg_attr (SPRepr *repr, const gchar *key, const gchar *value)
+sp_repr_chg_attr (SPRepr *repr, unsigned int q, unsigned int newpos, const gchar *value, SPReprTyped *typed)
 {
-	SPReprAttr *prev, *attr;
 	SPReprListener *rl;
 	unsigned int allowed;
-	gchar *oldval;
-	unsigned int q;
-
-	g_return_val_if_fail (repr != NULL, FALSE);
-	g_return_val_if_fail (key != NULL, FALSE);
-	g_return_val_if_fail (*key != '\0', FALSE);
+	unsigned int pos;
+	const gchar *key;
+	gchar *oldval, *newval;
+	SPReprTyped *oldtyped, *newtyped;
 
 	oldval = NULL;
-	q = g_quark_from_string (key);
-	prev = NULL;
-	for (attr = repr->attributes; attr && (attr->key != q); attr = attr->next)
-	{
-		prev = attr;
-	}
-
-	if (attr) {
-		if (!strcmp (attr->value, value)) return TRUE;
+	oldtyped = NULL;
+	if (sp_repr_attr_find (repr, q, &pos)) {
+		SPReprAttr *attr;
+		attr = repr->attributes + pos;
+		/* Typed values are never stringified just for comparison */
+		if (typed) {
+			if (attr->typed == typed) return TRUE;
+		} else if (!attr->typed) {
+			if (!strcmp (attr->value, value)) return TRUE;
+		}
 		oldval = attr->value;
+		oldtyped = attr->typed;
 	}
 
+	key = g_quark_to_string (q);
+
 	allowed = TRUE;
 	for (rl = repr->listeners; rl && allowed; rl = rl->next) {
-		if (rl->vector->change_attr) allowed = (* rl->vector->change_attr) (repr, key, oldval, value, rl->data);
+		if (rl->vector->change_attr) {
+			allowed = (* rl->vector->change_attr) (repr, key, sp_repr_listener_value (rl->vector, oldval, oldtyped),
+							       sp_repr_listener_value (rl->vector, value, typed), rl->data);
+		}
 	}
 
 	if (allowed) {
-		if (attr) {
-			attr->value = g_strdup (value);
+		if (typed) {
+			newval = NULL;
+			newtyped = sp_repr_typed_ref (typed);
 		} else {
-			attr = sp_attribute_new_from_code (q, value);
-			if (prev) {
-				prev->next = attr;
-			} else {
-				repr->attributes = attr;
-			}
+			newval = sp_repr_value_new (repr->pool, value);
+			newtyped = NULL;
+		}
+		if (sp_repr_attr_find (repr, q, &pos)) {
+			repr->attributes[pos].value = newval;
+			repr->attributes[pos].typed = newtyped;
+		} else {
+			pos = MIN (newpos, repr->n_attributes);
+			sp_repr_attr_insert (repr, pos, q, newval, newtyped);
 		}
 
 		if ( repr->doc && repr->doc->is_logging ) {
-			repr->doc->log = sp_repr_log_chgattr (repr->doc->log, repr, q, oldval, value);
+			repr->doc->log = sp_repr_log_chgattr (repr->doc->log, repr, q, pos, oldval, oldtyped, newval, newtyped);
 		}
 
 		for (rl = repr->listeners; rl != NULL; rl = rl->next) {
-			if (rl->vector->attr_changed) (* rl->vector->attr_changed) (repr, key, oldval, value, rl->data);
+			if (rl->vector->attr_changed) {
+				(* rl->vector->attr_changed) (repr, key, sp_repr_listener_value (rl->vector, oldval, oldtyped),
+							      sp_repr_listener_value (rl->vector, value, typed), rl->data);
+			}
 		}
 
-		if ( oldval && ( !repr->doc || !repr->doc->is_logging ) ) {
-			g_free (oldval);
+		if ( !repr->doc || !repr->doc->is_logging ) {
+			sp_repr_value_unref (oldval);
+			if (oldtyped) sp_repr_typed_unref (oldtyped);
 		}
 	}
 
@@ -449,38 +539,252 @@ sp_repr_chg_attr (SPRepr *repr, const gchar *key, const gchar *value)
 unsigned int
 sp_repr_set_attr (SPRepr *repr, const gchar *key, const gchar *value)
 {
+	unsigned int q;
+
 	g_return_val_if_fail (repr != NULL, FALSE);
 	g_return_val_if_fail (key != NULL, FALSE);
 	g_return_val_if_fail (*key != '\0', FALSE);
 
 	if (!value) {
+		/* Removing never-interned key is always noop */
+		q = g_quark_try_string (key);
+		return (q) ? sp_repr_del_attr (repr, q) : TRUE;
+	}
+
+	return sp_repr_chg_attr (repr, g_quark_from_string (key), SP_REPR_ATTR_MAX, value, NULL);
+}
+
+unsigned int
+sp_repr_set_attr_quark (SPRepr *repr, unsigned int key, const gchar *value)
+{
+	g_return_val_if_fail (repr != NULL, FALSE);
+	g_return_val_if_fail (key != 0, FALSE);
+
+	if (!value) {
+		return sp_repr_del_attr (repr, key);
+	}
+
+	return sp_repr_chg_attr (repr, key, SP_REPR_ATTR_MAX, value, NULL);
+}
+
+/**
+ * Sets attribute to binary value; string form is generated by type
+ * only when needed.  Takes ownership of data, which must not be
+ * modified afterwards.
+ */
+unsigned int
+sp_repr_set_attr_typed (SPRepr *repr, const gchar *key, const SPReprValueType *type, void *data)
+{
+	SPReprTyped *typed;
+	unsigned int allowed;
+
+	g_return_val_if_fail (repr != NULL, FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (*key != '\0', FALSE);
+	g_return_val_if_fail (type != NULL, FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	typed = sp_repr_typed_new (repr->pool, type, data);
+	allowed = sp_repr_chg_attr (repr, g_quark_from_string (key), SP_REPR_ATTR_MAX, NULL, typed);
+	sp_repr_typed_unref (typed);
+
+	return allowed;
+}
+
+/*
+ * Attaches data, equal to parsed existing string value, to attribute;
+ * string is kept as the typed value string, so nothing changes for
+ * readers and no events are emitted.  Data is freed if there is no
+ * plain string value to attach to.
+ */
+unsigned int
+sp_repr_attr_attach_typed (SPRepr *repr, const gchar *key, const SPReprValueType *type, void *data)
+{
+	SPReprAttr *attr;
+	SPReprTyped *typed;
+	unsigned int pos, q;
+
+	g_return_val_if_fail (repr != NULL, FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (type != NULL, FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	q = g_quark_try_string (key);
+	if (!q || !sp_repr_attr_find (repr, q, &pos) || repr->attributes[pos].typed) {
+		if (type->free) type->free (data);
+		return FALSE;
+	}
+
+	attr = repr->attributes + pos;
+	typed = sp_repr_typed_new (repr->pool, type, data);
+	/* Reference moves from attribute to typed value */
+	typed->string = attr->value;
+	attr->value = NULL;
+	attr->typed = typed;
+
+	return TRUE;
+}
+
+/*
+ * Restores stored value pair (as kept in transaction log) to attribute
+ * slot pos; typed value is shared, not copied
+ */
+unsigned int
+sp_repr_set_attr_value (SPRepr *repr, unsigned int key, unsigned int pos, const gchar *value, SPReprTyped *typed)
+{
+	g_return_val_if_fail (repr != NULL, FALSE);
+	g_return_val_if_fail (key != 0, FALSE);
+
+	if (!value && !typed) {
 		return sp_repr_del_attr (repr, key);
 	}
 
-	return sp_repr_chg_attr (repr, key, value);
+	return sp_repr_chg_attr (repr, key, pos, value, typed);
 }
 
+/*
+ * Binary search over sorted slots; if not found, idx is set to insertion point
+ */
+static unsigned int
+sp_repr_attr_search (const SPRepr *repr, int key, unsigned int *idx)
+{
+	unsigned int lo, hi;
+
+	lo = 0;
+	hi = repr->n_attributes;
+	while (lo < hi) {
+		unsigned int mid;
+		int midkey;
+		mid = (lo + hi) / 2;
+		midkey = repr->attributes[repr->attribute_order[mid]].key;
+		if (midkey == key) {
+			*idx = mid;
+			return TRUE;
+		} else if (midkey < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*idx = lo;
+
+	return FALSE;
+}
+
+/*
+ * Sets pos to attribute slot in insertion order
+ */
+static unsigned int
+sp_repr_attr_find (const SPRepr *repr, int key, unsigned int *pos)
+{
+	unsigned int idx;
+
+	if (!sp_repr_attr_search (repr, key, &idx)) return FALSE;
+
+	*pos = repr->attribute_order[idx];
 
+	return TRUE;
+}
+
+/* Sorted slots follow attribute array in the same block */
+#define SP_REPR_ATTR_BLOCK_SIZE(n) ((n) * (sizeof (SPReprAttr) + sizeof (unsigned short)))
+
+/*
+ * Takes ownership of value and typed; key must not be present
+ */
 static void
-sp_repr_remove_attribute (SPRepr *repr, SPReprAttr *attr)
+sp_repr_attr_insert (SPRepr *repr, unsigned int pos, int key, gchar *value, SPReprTyped *typed)
 {
-	g_assert (repr != NULL);
-	g_assert (attr != NULL);
+	unsigned int idx, i;
+
+	g_assert (pos <= repr->n_attributes);
+	g_assert (repr->n_attributes < SP_REPR_ATTR_MAX);
+
+	if (repr->n_attributes >= repr->attributes_size) {
+		SPReprAttr *attributes;
+		unsigned short *order;
+		attributes = (SPReprAttr *) sp_repr_pool_alloc (repr->pool, SP_REPR_POOL_ATTRIBUTES,
+								SP_REPR_ATTR_BLOCK_SIZE (repr->attributes_size << 1));
+		order = (unsigned short *) (attributes + (repr->attributes_size << 1));
+		memcpy (attributes, repr->attributes, repr->n_attributes * sizeof (SPReprAttr));
+		memcpy (order, repr->attribute_order, repr->n_attributes * sizeof (unsigned short));
+		if (repr->attributes != repr->inline_attributes) {
+			sp_repr_pool_free (repr->pool, SP_REPR_POOL_ATTRIBUTES, repr->attributes,
+					   SP_REPR_ATTR_BLOCK_SIZE (repr->attributes_size));
+		}
+		repr->attributes = attributes;
+		repr->attribute_order = order;
+		repr->attributes_size <<= 1;
+	}
 
-	if (attr == repr->attributes) {
-		repr->attributes = attr->next;
-	} else {
-		SPReprAttr * prev;
-		prev = repr->attributes;
-		while (prev->next != attr) {
-			prev = prev->next;
-			g_assert (prev != NULL);
+	if (sp_repr_attr_search (repr, key, &idx)) {
+		g_assert_not_reached ();
+	}
+
+	if (pos < repr->n_attributes) {
+		memmove (repr->attributes + pos + 1, repr->attributes + pos, (repr->n_attributes - pos) * sizeof (SPReprAttr));
+		for (i = 0; i < repr->n_attributes; i++) {
+			if (repr->attribute_order[i] >= pos) repr->attribute_order[i] += 1;
+		}
+	}
+	repr->attributes[pos].key = key;
+	repr->attributes[pos].value = value;
+	repr->attributes[pos].typed = typed;
+
+	if (idx < repr->n_attributes) {
+		memmove (repr->attribute_order + idx + 1, repr->attribute_order + idx,
+			 (repr->n_attributes - idx) * sizeof (unsigned short));
+	}
+	repr->attribute_order[idx] = pos;
+	repr->n_attributes += 1;
+}
+
+/*
+ * Does not free value; later attributes keep their order
+ */
+static void
+sp_repr_attr_remove (SPRepr *repr, unsigned int pos)
+{
+	unsigned int idx, i;
+
+	g_assert (pos < repr->n_attributes);
+
+	if (!sp_repr_attr_search (repr, repr->attributes[pos].key, &idx)) {
+		g_assert_not_reached ();
+	}
+
+	repr->n_attributes -= 1;
+	if (idx < repr->n_attributes) {
+		memmove (repr->attribute_order + idx, repr->attribute_order + idx + 1,
+			 (repr->n_attributes - idx) * sizeof (unsigned short));
+	}
+	if (pos < repr->n_attributes) {
+		memmove (repr->attributes + pos, repr->attributes + pos + 1, (repr->n_attributes - pos) * sizeof (SPReprAttr));
+		for (i = 0; i < repr->n_attributes; i++) {
+			if (repr->attribute_order[i] > pos) repr->attribute_order[i] -= 1;
 		}
-		prev->next = attr->next;
 	}
+}
+
+static void
+sp_repr_attr_clear (SPRepr *repr)
+{
+	unsigned int i;
 
-	g_free (attr->value);
-	sp_attribute_free (attr);
+	for (i = 0; i < repr->n_attributes; i++) {
+		sp_repr_value_unref (repr->attributes[i].value);
+		if (repr->attributes[i].typed) sp_repr_typed_unref (repr->attributes[i].typed);
+	}
+	if (repr->attributes != repr->inline_attributes) {
+		sp_repr_pool_free (repr->pool, SP_REPR_POOL_ATTRIBUTES, repr->attributes,
+				   SP_REPR_ATTR_BLOCK_SIZE (repr->attributes_size));
+	}
+
+	repr->n_attributes = 0;
+	repr->attributes_size = SP_REPR_ATTR_INLINE_SIZE;
+	repr->attributes = repr->inline_attributes;
+	repr->attribute_order = repr->inline_order;
 }
 
 SPRepr *
@@ -519,6 +823,8 @@ sp_repr_add_child (SPRepr *repr, SPRepr *child, SPRepr *ref)
 
 		child->parent = repr;
 		sp_repr_ref (child);
+		repr->n_children += 1;
+		repr->positions_valid = FALSE;
 
 		if (child->doc == NULL) bind_document (repr->doc, child);
 
@@ -551,9 +857,7 @@ bind_document (SPReprDoc *doc, SPRepr *repr)
 unsigned int
 sp_repr_remove_child (SPRepr *repr, SPRepr *child)
 {
-	SPReprListener *rl;
 	SPRepr *ref;
-	unsigned int allowed;
 
 	g_assert (repr != NULL);
 	g_assert (child != NULL);
@@ -567,6 +871,49 @@ sp_repr_remove_child (SPRepr *repr, SPRepr *child)
 		}
 	}
 
+	return sp_repr_remove_child_after (repr, child, ref);
+}
+
+/*
+ * Removes listed children of repr in single pass over child list,
+ * instead of searching preceding sibling of each one.  Listeners get
+ * usual per-child events, in document order.
+ */
+void
+sp_repr_remove_children (SPRepr *repr, const GSList *children)
+{
+	GHashTable *set;
+	SPRepr *ref, *child, *next;
+	const GSList *l;
+
+	g_return_if_fail (repr != NULL);
+
+	set = g_hash_table_new (NULL, NULL);
+	for (l = children; l != NULL; l = l->next) {
+		g_assert (((SPRepr *) l->data)->parent == repr);
+		g_hash_table_insert (set, l->data, l->data);
+	}
+
+	ref = NULL;
+	for (child = repr->children; child && (g_hash_table_size (set) > 0); child = next) {
+		next = child->next;
+		if (g_hash_table_remove (set, child)) {
+			/* Vetoed child stays in place */
+			if (!sp_repr_remove_child_after (repr, child, ref)) ref = child;
+		} else {
+			ref = child;
+		}
+	}
+
+	g_hash_table_destroy (set);
+}
+
+static unsigned int
+sp_repr_remove_child_after (SPRepr *repr, SPRepr *child, SPRepr *ref)
+{
+	SPReprListener *rl;
+	unsigned int allowed;
+
 	allowed = TRUE;
 	for (rl = repr->listeners; rl != NULL; rl = rl->next) {
 		if (rl->vector->remove_child) {
@@ -582,6 +929,8 @@ sp_repr_remove_child (SPRepr *repr, SPRepr *child)
 		}
 		child->parent = NULL;
 		child->next = NULL;
+		repr->n_children -= 1;
+		repr->positions_valid = FALSE;
 
 		if ( repr->doc && repr->doc->is_logging ) {
 			repr->doc->log = sp_repr_log_remove (repr->doc->log, repr, child, ref);
@@ -637,6 +986,7 @@ sp_repr_change_order (SPRepr *repr, SPRepr *child, SPRepr *ref)
 			child->next = repr->children;
 			repr->children = child;
 		}
+		repr->positions_valid = FALSE;
 
 		if ( repr->doc && repr->doc->is_logging ) {
 			repr->doc->log = sp_repr_log_chgorder (repr->doc->log, repr, child, prev, ref);
@@ -681,10 +1031,10 @@ sp_repr_synthesize_events (SPRepr *repr, const SPReprEventVector *vector, void *
 {
 	
 	if (vector->attr_changed) {
-		SPReprAttr *attr;
-		attr = repr->attributes;
-		for ( ; attr ; attr = attr->next ) {
-			vector->attr_changed (repr, g_quark_to_string (attr->key), NULL, attr->value, data);
+		unsigned int i;
+		for (i = 0; i < repr->n_attributes; i++) {
+			vector->attr_changed (repr, g_quark_to_string (repr->attributes[i].key), NULL,
+					      sp_repr_listener_value (vector, repr->attributes[i].value, repr->attributes[i].typed), data);
 		}
 	}
 	if (vector->child_added) {
@@ -713,7 +1063,7 @@ sp_repr_add_listener (SPRepr *repr, const SPReprEventVector *vector, void * data
 		while (last->next) last = last->next;
 	}
 
-	rl = sp_listener_alloc ();
+	rl = sp_listener_alloc (repr);
 	rl->next = NULL;
 	rl->vector = vector;
 	rl->data = data;
@@ -737,7 +1087,7 @@ sp_repr_remove_listener (SPRepr *repr, SPListener *listener)
 		prev->next = listener->next;
 	}
 
-	sp_listener_free (listener);
+	sp_listener_free (repr, listener);
 }
 
 void
@@ -753,7 +1103,7 @@ sp_repr_remove_listener_by_data (SPRepr *repr, void *data)
 			} else {
 				repr->listeners = rl->next;
 			}
-			sp_listener_free (rl);
+			sp_listener_free (repr, rl);
 			return;
 		}
 		last = rl;
@@ -765,6 +1115,8 @@ sp_repr_nth_child (const SPRepr * repr, int n)
 {
 	SPRepr * child;
 
+	if ((n < 0) || (n >= (int) repr->n_children)) return NULL;
+
 	child = repr->children;
 
 	while (n > 0 && child) {
@@ -775,6 +1127,35 @@ sp_repr_nth_child (const SPRepr * repr, int n)
 	return child;
 }
 
+/*
+ * Sibling positions are renumbered lazily in single pass, so repeated
+ * sp_repr_position calls between tree changes are O(1)
+ */
+static void
+sp_repr_renumber_children (const SPRepr *repr)
+{
+	SPRepr *child;
+	unsigned int pos;
+
+	pos = 0;
+	for (child = repr->children; child != NULL; child = child->next) {
+		child->position = pos++;
+	}
+
+	((SPRepr *) repr)->positions_valid = TRUE;
+}
+
+int
+sp_repr_child_position (const SPRepr *repr)
+{
+	g_assert (repr != NULL);
+	g_assert (repr->parent != NULL);
+
+	if (!repr->parent->positions_valid) sp_repr_renumber_children (repr->parent);
+
+	return repr->position;
+}
+
 /* Documents - 1st step in migrating to real XML */
 /* fixme: Do this somewhere, somehow The Right Way (TM) */
 
@@ -783,8 +1164,13 @@ sp_repr_document_new (const char *rootname)
 {
 	SPReprDoc * doc;
 	SPRepr * root;
+	SPReprPool *pool, *previous;
 
-	doc = (SPReprDoc *)sp_repr_new_from_code (SP_XML_DOCUMENT_NODE, g_quark_from_static_string ("xml"));
+	/* Each document gets its own pool, kept alive by nodes allocated from it */
+	pool = sp_repr_pool_new ();
+	previous = sp_repr_pool_set_current (pool);
+
+	doc = (SPReprDoc *)sp_repr_new_from_code (SP_XML_DOCUMENT_NODE, g_quark_from_static_string ("xml"), pool);
 	if (!strcmp (rootname, "svg")) {
 		sp_repr_set_attr (&doc->repr, "version", "1.0");
 		sp_repr_set_attr (&doc->repr, "standalone", "no");
@@ -800,6 +1186,9 @@ sp_repr_document_new (const char *rootname)
 	sp_repr_add_child (&doc->repr, root, 0);
 	sp_repr_unref (root);
 
+	sp_repr_pool_set_current (previous);
+	sp_repr_pool_unref (pool);
+
 	return doc;
 }
 
@@ -870,7 +1259,7 @@ unsigned int
 sp_repr_merge (SPRepr *repr, const SPRepr *src, const gchar *key)
 {
 	SPRepr *child;
-	SPReprAttr *attr;
+	unsigned int i;
 	
 	g_return_val_if_fail (repr != NULL, FALSE);
 	g_return_val_if_fail (src != NULL, FALSE);
@@ -902,72 +1291,21 @@ sp_repr_merge (SPRepr *repr, const SPRepr *src, const gchar *key)
 		}
 	}
 
-	for (attr = src->attributes; attr != NULL; attr = attr->next) {
-		sp_repr_set_attr (repr, SP_REPR_ATTRIBUTE_KEY (attr), SP_REPR_ATTRIBUTE_VALUE (attr));
+	for (i = 0; i < src->n_attributes; i++) {
+		sp_repr_set_attr_value (repr, src->attributes[i].key, SP_REPR_ATTR_MAX, src->attributes[i].value, src->attributes[i].typed);
 	}
 
 	return TRUE;
 }
 
-static SPReprAttr *
-sp_attribute_duplicate (const SPReprAttr *attr)
-{
-	SPReprAttr *new_attr;
-
-	new_attr = sp_attribute_alloc ();
-
-	new_attr->next = NULL;
-	new_attr->key = attr->key;
-	new_attr->value = g_strdup (attr->value);
-
-	return new_attr;
-}
-
-static SPReprAttr *
-sp_attribute_new_from_code (int key, const gchar *value)
-{
-	SPReprAttr *new_attr;
-
-	new_attr = sp_attribute_alloc ();
-
-	new_attr->next = NULL;
-	new_attr->key = key;
-	new_attr->value = g_strdup (value);
-
-	return new_attr;
-}
-
-#define SP_REPR_CHUNK_SIZE 32
-
 static SPRepr *
-sp_repr_alloc (SPReprClass *type)
+sp_repr_alloc (SPReprClass *type, SPReprPool *pool)
 {
 	SPRepr *repr;
 
-	if (type->pool) {
-		repr = type->pool;
-		type->pool = repr->next;
-	} else {
-		char *chunk;
-		size_t max, offset;
-
-		chunk = (char *)g_malloc (type->size * SP_REPR_CHUNK_SIZE);
-
-		max = type->size * ( SP_REPR_CHUNK_SIZE - 1 );
-		for ( offset = type->size ;
-		      offset < max ;
-		      offset += type->size )
-		{
-			repr = (SPRepr *)(chunk+offset);
-			repr->next = (SPRepr *)(chunk+offset+type->size);
-		}
-
-		((SPRepr *)(chunk+offset))->next = NULL;
-		type->pool = (SPRepr *)(chunk+type->size);
-
-		repr = (SPRepr *)chunk;
-	}
+	repr = (SPRepr *) sp_repr_pool_alloc (pool, type->kind, type->size);
 	repr->type = type;
+	repr->pool = sp_repr_pool_ref (pool);
 
 	return repr;
 }
@@ -975,65 +1313,21 @@ sp_repr_alloc (SPReprClass *type)
 static void
 sp_repr_free (SPRepr *repr)
 {
-	repr->next = repr->type->pool;
-	repr->type->pool = repr;
-}
-
-#define SP_ATTRIBUTE_ALLOC_SIZE 32
-static SPReprAttr *free_attribute = NULL;
-
-static SPReprAttr *
-sp_attribute_alloc (void)
-{
-	SPReprAttr *attribute;
-	int i;
-
-	if (free_attribute) {
-		attribute = free_attribute;
-		free_attribute = free_attribute->next;
-	} else {
-		attribute = g_new (SPReprAttr, SP_ATTRIBUTE_ALLOC_SIZE);
-		for (i = 1; i < SP_ATTRIBUTE_ALLOC_SIZE - 1; i++) attribute[i].next = attribute + i + 1;
-		attribute[SP_ATTRIBUTE_ALLOC_SIZE - 1].next = NULL;
-		free_attribute = attribute + 1;
-	}
-
-	return attribute;
-}
+	SPReprPool *pool;
 
-static void
-sp_attribute_free (SPReprAttr *attribute)
-{
-	attribute->next = free_attribute;
-	free_attribute = attribute;
+	pool = repr->pool;
+	sp_repr_pool_free (pool, repr->type->kind, repr, repr->type->size);
+	sp_repr_pool_unref (pool);
 }
 
-#define SP_LISTENER_ALLOC_SIZE 32
-static SPListener *free_listener = NULL;
-
 static SPListener *
-sp_listener_alloc (void)
+sp_listener_alloc (SPRepr *repr)
 {
-	SPListener *listener;
-	int i;
-
-	if (free_listener) {
-		listener = free_listener;
-		free_listener = free_listener->next;
-	} else {
-		listener = g_new (SPListener, SP_LISTENER_ALLOC_SIZE);
-		for (i = 1; i < SP_LISTENER_ALLOC_SIZE - 1; i++) listener[i].next = listener + i + 1;
-		listener[SP_LISTENER_ALLOC_SIZE - 1].next = NULL;
-		free_listener = listener + 1;
-	}
-
-	return listener;
+	return (SPListener *) sp_repr_pool_alloc (repr->pool, SP_REPR_POOL_LISTENER, sizeof (SPListener));
 }
 
 static void
-sp_listener_free (SPListener *listener)
+sp_listener_free (SPRepr *repr, SPListener *listener)
 {
-	listener->next = free_listener;
-	free_listener = listener;
+	sp_repr_pool_free (repr->pool, SP_REPR_POOL_LISTENER, listener, sizeof (SPListener));
 }
-
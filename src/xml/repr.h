@@ -186,6 +186,8 @@ unsigned int sp_repr_merge (SPRepr *repr, const SPRepr *src, const gchar *key);
 const  char *sp_repr_name (const SPRepr *repr);
 const  char *sp_repr_content (const SPRepr *repr);
 const  char *sp_repr_attr (const SPRepr *repr, const gchar *key);
+/* Same as above, but key is already resolved GQuark */
+const  char *sp_repr_attr_quark (const SPRepr *repr, unsigned int key);
 
 /*
  * NB! signal handler may decide, that change is not allowed
@@ -195,6 +197,34 @@ const  char *sp_repr_attr (const SPRepr *repr, const gchar *key);
 
 unsigned int sp_repr_set_content (SPRepr *repr, const gchar *content);
 unsigned int sp_repr_set_attr (SPRepr *repr, const gchar *key, const gchar *value);
+unsigned int sp_repr_set_attr_quark (SPRepr *repr, unsigned int key, const gchar *value);
+
+/*
+ * Typed values
+ *
+ * Attribute may hold binary data (like ArtBpath for path data) instead
+ * of string.  String form is generated with to_string only when somebody
+ * asks for it (sp_repr_attr, saving), so writer and reader sharing the
+ * binary form never format or parse it.  sp_repr_set_attr_typed takes
+ * ownership of data, which is immutable afterwards.
+ */
+
+typedef struct _SPReprValueType SPReprValueType;
+
+struct _SPReprValueType {
+	const gchar *name;
+	gchar *(* to_string) (const void *data);
+	void (* free) (void *data);
+	/* Memory used by data, for undo history accounting (may be NULL) */
+	size_t (* size) (const void *data);
+};
+
+unsigned int sp_repr_set_attr_typed (SPRepr *repr, const gchar *key, const SPReprValueType *type, void *data);
+const void *sp_repr_attr_typed (const SPRepr *repr, const gchar *key, const SPReprValueType *type);
+/* Caches parsed form of existing string value, without change events */
+unsigned int sp_repr_attr_attach_typed (SPRepr *repr, const gchar *key, const SPReprValueType *type, void *data);
+/* String value if it exists without stringifying typed value, NULL otherwise */
+const  char *sp_repr_attr_quark_lazy (const SPRepr *repr, unsigned int key);
 
 #if 0
 /*
@@ -216,6 +246,8 @@ SPRepr *sp_repr_next (SPRepr *repr);
 
 unsigned int sp_repr_add_child (SPRepr * repr, SPRepr * child, SPRepr * ref);
 unsigned int sp_repr_remove_child (SPRepr * repr, SPRepr * child);
+/* Removes many children at once, in time linear in number of children */
+void sp_repr_remove_children (SPRepr * repr, const GSList * children);
 void sp_repr_write_stream (SPRepr * repr, FILE * file, int level);
 
 //#if 0
@@ -228,11 +260,18 @@ int sp_repr_n_children (SPRepr * repr);
 
 SPReprDoc * sp_repr_read_file (const gchar * filename, const gchar *default_ns);
 SPReprDoc * sp_repr_read_mem (const gchar * buffer, int length, const gchar *default_ns);
-void sp_repr_save_stream (SPReprDoc * doc, FILE * to_file);
-void sp_repr_save_file (SPReprDoc * doc, const gchar * filename);
+unsigned int sp_repr_save_stream (SPReprDoc * doc, FILE * to_file);
+unsigned int sp_repr_save_file (SPReprDoc * doc, const gchar * filename);
+gchar *sp_repr_save_buf (SPReprDoc *doc, int *length);
 
 void sp_repr_print (SPRepr * repr);
 
+/* Memory */
+
+void sp_repr_set_value_interning (unsigned int intern);
+void sp_repr_print_memory_report (SPReprDoc *doc, FILE *file);
+void sp_repr_print_value_report (FILE *file);
+
 /* CSS stuff */
 
 typedef struct _SPCSSAttr SPCSSAttr;